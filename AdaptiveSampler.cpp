@@ -0,0 +1,42 @@
+#include "AdaptiveSampler.h"
+
+AdaptiveSampler::AdaptiveSampler(const Policy& policy)
+  : _intervalMs(0), _active(false), _hasSample(false), _lastMillis(0), _lastPercentage(0), _slope(0) {
+    configure(policy);
+}
+
+AdaptiveSampler::Policy AdaptiveSampler::clamp(const Policy& policy) {
+    const uint32_t lowest = MIN_INTERVAL_MS;
+    const uint32_t highest = MAX_INTERVAL_MS;
+    Policy clamped;
+    clamped.fastIntervalMs = constrain(policy.fastIntervalMs, lowest, highest);
+    clamped.slowIntervalMs = constrain(policy.slowIntervalMs, clamped.fastIntervalMs, highest);
+    clamped.slopeThreshold = fmaxf(policy.slopeThreshold, 0.0f);
+    return clamped;
+}
+
+void AdaptiveSampler::configure(const Policy& policy) {
+    _policy = clamp(policy);
+    _intervalMs = _policy.fastIntervalMs;
+}
+
+unsigned long AdaptiveSampler::update(unsigned long now, float percentage) {
+    unsigned long elapsed = now - _lastMillis;
+    if (!_hasSample || elapsed == 0) {
+        _hasSample = true;
+        _lastMillis = now;
+        _lastPercentage = percentage;
+        return _intervalMs;
+    }
+    _slope = fabsf(percentage - _lastPercentage) * 60000.0f / elapsed;
+    _lastMillis = now;
+    _lastPercentage = percentage;
+    _active = _slope >= _policy.slopeThreshold;
+    if (_active) {
+        _intervalMs = _policy.fastIntervalMs;
+    } else if (_intervalMs < _policy.slowIntervalMs) {
+        // Espera exponencial: 1 s, 2 s, 4 s... hasta el tope.
+        _intervalMs = _intervalMs * 2 < _policy.slowIntervalMs ? _intervalMs * 2 : _policy.slowIntervalMs;
+    }
+    return _intervalMs;
+}
@@ -0,0 +1,53 @@
+#ifndef AdaptiveSampler_h
+#define AdaptiveSampler_h
+
+#include <Arduino.h>
+
+// Decide cada cuánto medir un sensor según cómo se mueve su señal filtrada.
+// Con la pendiente entre dos muestras por encima de slopeThreshold (% por
+// minuto) se mide cada fastIntervalMs; mientras la señal está plana la espera
+// se dobla en cada muestra hasta slowIntervalMs. Un riego se ve así a
+// resolución alta y una maceta quieta apenas gasta ADC ni red.
+class AdaptiveSampler {
+  public:
+    struct Policy {
+        uint32_t fastIntervalMs;
+        uint32_t slowIntervalMs;
+        float slopeThreshold;   // % por minuto
+
+        bool operator==(const Policy& other) const {
+            return fastIntervalMs == other.fastIntervalMs && slowIntervalMs == other.slowIntervalMs &&
+                   slopeThreshold == other.slopeThreshold;
+        }
+        bool operator!=(const Policy& other) const { return !(*this == other); }
+    };
+
+    // Límites de lo que se acepta desde el shadow.
+    static const uint32_t MIN_INTERVAL_MS = 100;
+    static const uint32_t MAX_INTERVAL_MS = 3600000;
+
+    explicit AdaptiveSampler(const Policy& policy);
+    // Aplica la política (recortada a los límites) y vuelve al ritmo rápido.
+    void configure(const Policy& policy);
+    const Policy& policy() const { return _policy; }
+
+    // Nueva muestra filtrada en %; devuelve los ms hasta la siguiente.
+    unsigned long update(unsigned long now, float percentage);
+    unsigned long interval() const { return _intervalMs; }
+    // La última muestra superó el umbral de pendiente.
+    bool active() const { return _active; }
+    float slope() const { return _slope; }
+
+    static Policy clamp(const Policy& policy);
+
+  private:
+    Policy _policy;
+    unsigned long _intervalMs;
+    bool _active;
+    bool _hasSample;
+    unsigned long _lastMillis;
+    float _lastPercentage;
+    float _slope;
+};
+
+#endif
@@ -1,451 +1,1007 @@
 #include "AppLogic.h"
+#include "Log.h"
 #include "aws_iot_config.h"
-#include <WiFi.h>
+#include <esp_attr.h>
+#include <esp_sleep.h>
 #include <time.h>
 
-AppLogic::AppLogic()
-    : _mqtt(AWS_IOT_ENDPOINT, 8883, THING_NAME),
-      _sensor(SOIL_MOISTURE_PIN, SOIL_DRY_VALUE, SOIL_WET_VALUE),
-      _servo(SERVO_PIN),
-      _lastTelemetryMillis(0), 
-      _lastReconnectAttempt(0),
-      _currentShadowVersion(0),
-      _lastReportedHumidityRange(RANGE_UNKNOWN), 
-      _lastProcessedEmotion("NEUTRAL"),
-      _reportJustSentByCallback(false)
-       {}
-
-void AppLogic::generateShadowTopics() {
-    _shadowUpdateTopic = String("$aws/things/") + THING_NAME + "/shadow/update";
-    _shadowDeltaTopic = String("$aws/things/") + THING_NAME + "/shadow/update/delta";
-    _shadowGetTopic = String("$aws/things/") + THING_NAME + "/shadow/get";
-    _shadowGetAcceptedTopic = String("$aws/things/") + THING_NAME + "/shadow/get/accepted";
-    _shadowGetRejectedTopic = String("$aws/things/") + THING_NAME + "/shadow/get/rejected";
-    _shadowUpdateAcceptedTopic = String("$aws/things/") + THING_NAME + "/shadow/update/accepted";
-    _shadowUpdateRejectedTopic = String("$aws/things/") + THING_NAME + "/shadow/update/rejected";
-}
-
-void AppLogic::connectWiFi() {
-    Serial.println("Connecting to WiFi...");
-    WiFi.mode(WIFI_STA);
-    WiFi.begin(WIFI_SSID, WIFI_PASS);
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-        delay(500);
-        Serial.print(".");
-        attempts++;
-    }
-    if (WiFi.status() == WL_CONNECTED) {
-        Serial.println("\nWiFi connected!");
-        Serial.print("IP Address: ");
-        Serial.println(WiFi.localIP());
-    } else {
-        Serial.println("\nFailed to connect to WiFi. Will restart.");
-        delay(1000);
-        ESP.restart();
+// Sobrevive al deep sleep en la memoria RTC. Tras un arranque en frío no
+// vale: lo indica magic, y solo se usa si despertó el temporizador y con el
+// mismo número de macetas.
+struct RetainedState {
+    uint32_t magic;
+    uint32_t cycles;
+    uint8_t plantCount;
+    unsigned long shadowVersion[MAX_PLANTS];
+    DeviceState::Snapshot state[MAX_PLANTS];
+};
+
+static const uint32_t RETAINED_MAGIC = 0xF10A5EED;
+RTC_DATA_ATTR static RetainedState retainedState;
+
+AppLogic::Plant::Plant()
+    : channel(0),
+      name(""),
+      shadowVersion(0),
+      queuedFields(0),
+      reports(SHADOW_REPORT_TIMEOUT_MS),
+      lastReportMillis(0),
+      targetEmotion(EMOTION_NEUTRAL),
+      settleReportPending(false),
+      settleReportFields(0),
+      settleClearDesired(false),
+      telemetry(TELEMETRY_SAMPLE_INTERVAL_MS, TELEMETRY_BATCH_SIZE),
+      cycleSynced(false) {}
+
+AppLogic::AppLogic(const DeviceConfig& config)
+    : _config(config),
+      _net(config.wifiSsid, config.wifiPass),
+      _mqtt(config.endpoint, config.port, config.thingName, MQTT_BUFFER_SIZE),
+      _control(config.plants, config.plantCount, config.servoAngles.neutral, DEFAULT_SAMPLING_POLICY),
+      _plantCount(_control.channels()),
+      _mqttRetry(MQTT_RECONNECT_BASE_MS, MQTT_RECONNECT_MAX_MS, MQTT_BREAKER_THRESHOLD, MQTT_BREAKER_COOLDOWN_MS),
+      _mqttWasConnected(false),
+      _firstReportMillis(0),
+      _outbox("/outbox.bin", 16, 4096),
+      _netTask(Scheduler::INVALID_TASK),
+      _mqttTask(Scheduler::INVALID_TASK),
+      _reconnectTask(Scheduler::INVALID_TASK),
+      _reportTask(Scheduler::INVALID_TASK),
+      _outboxTask(Scheduler::INVALID_TASK),
+      _fullReportTask(Scheduler::INVALID_TASK),
+      _metricsTask(Scheduler::INVALID_TASK),
+      _shadowReportTask(Scheduler::INVALID_TASK),
+      _runMode(RUN_DUAL_CORE),
+      _getOnConnect(true),
+      _wakeMillis(0)
+       {
+    for (uint8_t i = 0; i < _plantCount; i++) {
+        _plants[i].channel = i;
+        _plants[i].name = _config.plants[i].shadowName ? _config.plants[i].shadowName : "";
+        _plants[i].state.setServoAngle(_config.servoAngles.neutral);
     }
 }
 
-void AppLogic::syncNTPTime() {
-    Serial.print("Syncing NTP time...");
-    configTime(0, 0, "pool.ntp.org", "time.nist.gov");
-    time_t now = time(nullptr);
-    int attempts = 0;
-    while (now < 1000000000L && attempts < 20) {
-        delay(500);
-        Serial.print(".");
-        now = time(nullptr);
-        attempts++;
-    }
-    if (now < 1000000000L) {
-        Serial.println("\nFailed to sync NTP time. Check network. Will restart.");
-        delay(1000);
-        ESP.restart();
-    } else {
-      Serial.println("\nNTP time synchronized!");
-      struct tm timeinfo;
-      gmtime_r(&now, &timeinfo);
-      Serial.print("Current UTC time: ");
-      Serial.println(asctime(&timeinfo));
+// Shadow clásico: $aws/things/<cosa>/shadow; con nombre:
+// $aws/things/<cosa>/shadow/name/<maceta>. El topic más largo que se usa es
+// el prefijo más "/update/documents"; un nombre que no cabe se avisa aquí.
+void AppLogic::generateTopics() {
+    for (uint8_t i = 0; i < _plantCount; i++) {
+        Plant& plant = _plants[i];
+        bool named = plant.name[0] != '\0';
+        const char* separator = named ? "/name/" : "";
+        int length = snprintf(plant.shadowTopicPrefix, TOPIC_SIZE, "$aws/things/%s/shadow%s%s", _config.thingName,
+                              separator, plant.name);
+        if (length < 0 || (size_t)length + strlen("/update/documents") >= TOPIC_SIZE) {
+            LOGE("APP", "Shadow topics for %s/%s exceed %u characters.", _config.thingName, plant.name,
+                 (unsigned int)(TOPIC_SIZE - 1));
+        }
+        // Desde los mismos datos y no desde shadowTopicPrefix: GCC ve un posible
+        // solape entre miembros del mismo objeto (-Wrestrict).
+        snprintf(plant.shadowUpdateTopic, TOPIC_SIZE, "$aws/things/%s/shadow%s%s/update", _config.thingName,
+                 separator, plant.name);
+        snprintf(plant.shadowGetTopic, TOPIC_SIZE, "$aws/things/%s/shadow%s%s/get", _config.thingName, separator,
+                 plant.name);
+        snprintf(plant.telemetryTopic, TOPIC_SIZE, TELEMETRY_TOPIC_PREFIX "%s%s%s" TELEMETRY_TOPIC_SUFFIX,
+                 _config.thingName, named ? "/" : "", plant.name);
+    }
+    snprintf(_metricsTopic, TOPIC_SIZE, TELEMETRY_TOPIC_PREFIX "%s" METRICS_TOPIC_SUFFIX, _config.thingName);
+}
+
+void AppLogic::buildShadowFilter() {
+    _shadowFilter.clear();
+    _shadowFilter["version"] = true;
+    _shadowFilter["code"] = true;
+    _shadowFilter["message"] = true;
+    _shadowFilter["clientToken"] = true;
+    JsonObject state = _shadowFilter.createNestedObject("state");
+    // update/delta trae los campos deseados directamente en state.
+    state["emotion"] = true;
+    state["servoAngle"] = true;
+    state["sampling"] = true;
+    JsonObject desired = state.createNestedObject("desired");
+    desired["emotion"] = true;
+    desired["servoAngle"] = true;
+    desired["sampling"] = true;
+    JsonObject reported = state.createNestedObject("reported");
+    reported["rawSoilMoisture"] = true;
+    reported["soilMoisturePercent"] = true;
+    reported["humidityRange"] = true;
+    reported["servoAngle"] = true;
+    reported["emotion"] = true;
+    reported["sampling"] = true;
+}
+
+const char* AppLogic::shadowTopicName(uint8_t topicId) {
+    switch (topicId) {
+        case TOPIC_SHADOW_DELTA: return "update/delta";
+        case TOPIC_SHADOW_GET_ACCEPTED: return "get/accepted";
+        case TOPIC_SHADOW_GET_REJECTED: return "get/rejected";
+        case TOPIC_SHADOW_UPDATE_ACCEPTED: return "update/accepted";
+        case TOPIC_SHADOW_UPDATE_REJECTED: return "update/rejected";
+        case TOPIC_SHADOW_UPDATE_DOCUMENTS: return "update/documents";
+        default: return "unknown";
     }
 }
 
 void AppLogic::setupAWSMQTT() {
-    Serial.println("Configuring AWS MQTT...");
-    _mqtt.setCertificates(AWS_ROOT_CA, DEVICE_CERTIFICATE, DEVICE_PRIVATE_KEY);
-    auto mqttCallbackWrapper = [this](const String& topic, const String& message) {
-        this->handleMQTTMessage(topic, message);
+    LOGI("APP", "Configuring AWS MQTT...");
+    if (!_mqtt.setCertificates(_config.credentials)) {
+        // Solo un build de desarrollo trae credenciales PEM de respaldo; sin
+        // ellas no hay conexión posible hasta reprovisionar.
+        const TlsCredentials& fallback = DEFAULT_DEVICE_CONFIG.credentials;
+        if (!fallback.privateKey.empty() && _mqtt.setCertificates(fallback)) {
+            LOGE("APP", "Provisioned credentials rejected. Using the built-in development credentials.");
+        } else {
+            LOGE("APP", "Provisioned credentials rejected. MQTT will not connect until the device is reprovisioned.");
+        }
+    }
+    _mqtt.setMetrics(&_metrics);
+    // Los huecos de la ventana se reservan para el mensaje QoS 1 más grande:
+    // un reporte de shadow o un lote de telemetría.
+    size_t largestPayload = REPORT_PAYLOAD_SIZE;
+    if (TelemetryBatcher::MAX_ENCODED_SIZE > largestPayload) largestPayload = TelemetryBatcher::MAX_ENCODED_SIZE;
+    _mqtt.setPublishWindow(MQTT_INFLIGHT_WINDOW, MQTT_PUBACK_TIMEOUT_MS, MQTT_PUBLISH_MAX_ATTEMPTS, largestPayload);
+    auto mqttCallbackWrapper = [this](uint8_t topicId, char* payload, size_t length) {
+        unsigned long start = micros();
+        this->handleMQTTMessage(topicId, payload, length);
+        _metrics.record(Metrics::MESSAGE_US, micros() - start);
     };
-    _mqtt.subscribe(_shadowDeltaTopic, mqttCallbackWrapper);
-    _mqtt.subscribe(_shadowGetAcceptedTopic, mqttCallbackWrapper);
-    _mqtt.subscribe(_shadowGetRejectedTopic, mqttCallbackWrapper);
-    _mqtt.subscribe(_shadowUpdateAcceptedTopic, mqttCallbackWrapper);
-    _mqtt.subscribe(_shadowUpdateRejectedTopic, mqttCallbackWrapper);
-
-    if (_mqtt.connect()) {
-        Serial.println("Initial MQTT connection successful.");
-        Serial.println("Requesting current shadow state (GET)...");
-        if (!_mqtt.publish(_shadowGetTopic, "")) {
-             Serial.println("Failed to publish GET request.");
+    // Una sola suscripción por maceta cubre get/accepted, get/rejected,
+    // update/accepted, update/rejected y update/delta sin recibir el eco de
+    // nuestros propios publish en shadow/update y shadow/get. El id de ruta
+    // lleva la maceta: maceta * TOPIC_SHADOW_COUNT + topic.
+    char filter[TOPIC_SIZE];
+    for (uint8_t i = 0; i < _plantCount; i++) {
+        const char* prefix = _plants[i].shadowTopicPrefix;
+        uint8_t base = i * TOPIC_SHADOW_COUNT;
+        snprintf(filter, sizeof(filter), "%s/+/+", prefix);
+        _mqtt.subscribe(filter);
+        for (uint8_t topic = 0; topic < TOPIC_SHADOW_COUNT; topic++) {
+            snprintf(filter, sizeof(filter), "%s/%s", prefix, shadowTopicName(topic));
+            _mqtt.route(filter, base + topic, mqttCallbackWrapper);
         }
-    } else {
-        Serial.println("Initial MQTT connection failed. Will retry in loop.");
-        _lastReconnectAttempt = millis();
     }
+    // La conexión se abre desde loop() en cuanto haya red y hora válida.
 }
 
-void AppLogic::setup() {
+void AppLogic::setup(RunMode mode) {
     Serial.begin(115200);
     while(!Serial);
-    Serial.println("Starting AppLogic setup...");
-    generateShadowTopics();
-    connectWiFi();
-    syncNTPTime();
-    _servo.attach();
-    _servo.setNeutral();
+    Log::begin(Serial);
+    LOGI("APP", "Starting AppLogic setup...");
+    _runMode = mode;
+    _wakeMillis = millis();
+    generateTopics();
+    buildShadowFilter();
+    bool resumed = _runMode == RUN_DUTY_CYCLE && restoreRetained();
+    _control.begin();
+    _outbox.begin();
+    if (_runMode == RUN_DUTY_CYCLE && !dutyCycleNeedsNetwork(resumed)) {
+        enterDeepSleep();
+    }
+    _net.begin();
     setupAWSMQTT();
-    Serial.println("AppLogic setup completed.");
+    setupTasks();
+
+    if (_runMode == RUN_DUAL_CORE) {
+        // Red (WiFi, TLS, MQTT, shadow) en el núcleo de la pila WiFi; sensor y
+        // servo en el otro, así un publish lento no frena el control. Si falta
+        // una de las dos, se para la otra antes de pasar a un solo bucle: las
+        // colas SPSC no admiten dos consumidores.
+        if (!_control.startTask(CONTROL_TASK_CORE)) {
+            LOGE("APP", "Failed to start control task. Falling back to single loop.");
+            _runMode = RUN_SINGLE_LOOP;
+        } else if (xTaskCreatePinnedToCore(networkTaskEntry, "network", 8192, this, 1, nullptr, NETWORK_TASK_CORE) !=
+                   pdPASS) {
+            LOGE("APP", "Failed to start network task. Stopping control task, falling back to single loop.");
+            _control.stopTask();
+            _runMode = RUN_SINGLE_LOOP;
+        }
+    }
+    // En un solo bucle el log se vacía desde runNetwork().
+    if (_runMode == RUN_DUAL_CORE && !Log::startTask(NETWORK_TASK_CORE)) {
+        LOGW("APP", "Failed to start log task. Logging from the network task.");
+    }
+    LOGI("APP", "AppLogic setup completed.");
+}
+
+// Cada trabajo periódico es una tarea con su propio ritmo; loop() solo ejecuta
+// lo vencido y duerme hasta el siguiente plazo o hasta que llegue algo por MQTT.
+// Las tareas son comunes a todas las macetas.
+void AppLogic::setupTasks() {
+    _netTask = _scheduler.add([this]() { updateNetwork(); }, _netInterval);
+    _mqttTask = _scheduler.add([this]() { serviceMQTT(); }, _mqttServiceInterval);
+    _reconnectTask = _scheduler.add([this]() { reconnectMQTT(); });
+    _reportTask = _scheduler.add([this]() { checkRangeReports(); });
+    _outboxTask = _scheduler.add([this]() { drainOutbox(); });
+    _fullReportTask = _scheduler.add([this]() { publishFullReport(); }, FULL_REPORT_INTERVAL_MS);
+    _metricsTask = _scheduler.add([this]() { publishMetrics(); }, METRICS_INTERVAL_MS);
+    _shadowReportTask = _scheduler.add([this]() { serviceShadowReports(); });
+
+    _scheduler.runIn(_netTask, 0);
+    _scheduler.runIn(_mqttTask, _mqttServiceInterval);
+    // Despierto unos segundos: el reporte del shadow ya lleva la humedad.
+    if (_runMode == RUN_DUTY_CYCLE) return;
+    _scheduler.runIn(_fullReportTask, FULL_REPORT_INTERVAL_MS);
+    _scheduler.runIn(_metricsTask, METRICS_INTERVAL_MS);
 }
 
 void AppLogic::loop() {
-    if (WiFi.status() != WL_CONNECTED) {
-        Serial.println("WiFi disconnected. Attempting to reconnect...");
-        if (_mqtt.connected()) _mqtt.disconnect();
-        connectWiFi();
-        _lastReconnectAttempt = millis();
+    if (_runMode == RUN_DUAL_CORE) {
+        delay(1000); // Todo el trabajo está en las tareas de red y control.
         return;
     }
+    runNetwork(_control.step());
+    if (_runMode == RUN_DUTY_CYCLE) {
+        if (cycleDone()) {
+            enterDeepSleep();
+        } else if (millis() - _wakeMillis >= DUTY_CYCLE_AWAKE_MAX_MS) {
+            // Lo no confirmado sigue sucio y se reintenta en el próximo ciclo.
+            LOGW("APP", "Cycle not confirmed after %lu ms.", millis() - _wakeMillis);
+            enterDeepSleep();
+        }
+    }
+}
+
+bool AppLogic::cycleDone() const {
+    if (!_outbox.empty() || _control.anyServoMoving()) return false;
+    for (uint8_t i = 0; i < _plantCount; i++) {
+        if (!_plants[i].cycleSynced || !_plants[i].reports.idle()) return false;
+    }
+    return true;
+}
+
+bool AppLogic::restoreRetained() {
+    if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER || retainedState.magic != RETAINED_MAGIC ||
+        retainedState.plantCount != _plantCount) {
+        retainedState.magic = RETAINED_MAGIC;
+        retainedState.cycles = 0;
+        retainedState.plantCount = _plantCount;
+        return false;
+    }
+    retainedState.cycles++;
+    for (uint8_t i = 0; i < _plantCount; i++) {
+        Plant& plant = _plants[i];
+        plant.shadowVersion = retainedState.shadowVersion[i];
+        plant.state.restore(retainedState.state[i]);
+        _control.restore(plant.channel, plant.state.reportedHumidityRange(), plant.state.servoAngle());
+    }
+    return true;
+}
 
+// Un escaneo al despertar decide si hace falta encender el WiFi. Sin estado
+// en RTC o en el ciclo de sincronización se piden los shadows como al
+// arrancar.
+bool AppLogic::dutyCycleNeedsNetwork(bool resumed) {
+    _control.step();
+    bool sampled = _control.pollSamples();
+    _getOnConnect = !resumed || retainedState.cycles % DUTY_CYCLE_SYNC_EVERY == 0;
+    bool needed = _getOnConnect || !_outbox.empty();
+    for (uint8_t i = 0; i < _plantCount; i++) {
+        Plant& plant = _plants[i];
+        if (sampled) {
+            plant.state.setMoisture(_control.sample(plant.channel).rawValue, _control.sample(plant.channel).percentage);
+            plant.state.setHumidityRange(_control.sample(plant.channel).range);
+        }
+        if (plant.shadowVersion == 0) _getOnConnect = true;
+        needed = needed || _getOnConnect || plant.state.dirty() != 0;
+    }
+    for (uint8_t i = 0; i < _plantCount; i++) {
+        Plant& plant = _plants[i];
+        LOGI("APP", "Wake %lu%s%s: moisture %d%% %s, dirty 0x%02x%s.", (unsigned long)retainedState.cycles,
+             plant.name[0] ? " " : "", plant.name, plant.state.moisturePercent(),
+             MoistureSensor::rangeToString(plant.state.humidityRange()), plant.state.dirty(),
+             _getOnConnect ? ", shadow sync" : "");
+    }
+    return needed;
+}
+
+void AppLogic::enterDeepSleep() {
+    // Lo que quede sin PUBACK vuelve a quedar sucio antes de guardar el estado.
+    if (_mqtt.connected()) _mqtt.disconnect();
+    for (uint8_t i = 0; i < _plantCount; i++) {
+        retainedState.shadowVersion[i] = _plants[i].shadowVersion;
+        _plants[i].state.save(retainedState.state[i]);
+    }
+    LOGI("APP", "Cycle done in %lu ms. Sleeping %lu s.", millis() - _wakeMillis, DUTY_CYCLE_SLEEP_MS / 1000);
+    _net.end();
+    Log::flush();
+    esp_sleep_enable_timer_wakeup((uint64_t)DUTY_CYCLE_SLEEP_MS * 1000ULL);
+    esp_deep_sleep_start();
+}
+
+void AppLogic::networkTaskEntry(void* param) {
+    AppLogic* self = static_cast<AppLogic*>(param);
+    for (;;) {
+        self->runNetwork(self->_maxIdle);
+    }
+}
+
+// Una vuelta del lado de red: atiende los escaneos de los sensores, ejecuta
+// lo vencido y espera hasta el siguiente plazo, un mensaje MQTT o un escaneo.
+// La telemetría se toma de los escaneos, así sigue el ritmo del muestreo.
+void AppLogic::runNetwork(unsigned long maxIdle) {
+    unsigned long start = micros();
+    if (_control.pollSamples()) {
+        _metrics.increment(Metrics::SENSOR_SCANS);
+        for (uint8_t i = 0; i < _plantCount; i++) {
+            Plant& plant = _plants[i];
+            plant.state.setMoisture(_control.sample(plant.channel).rawValue, _control.sample(plant.channel).percentage);
+            plant.state.setHumidityRange(_control.sample(plant.channel).range);
+        }
+        checkRangeReports();
+        // El ciclo de trabajo no lleva telemetría: su reporte ya va con la humedad.
+        if (_runMode != RUN_DUTY_CYCLE) sampleTelemetry();
+    }
+    uint8_t settled = _control.pollServo();
+    for (uint8_t i = 0; settled != 0 && i < _plantCount; i++) {
+        if (settled & (1 << _plants[i].channel)) servoSettled(_plants[i]);
+    }
+    unsigned long idle = _scheduler.run();
+    _metrics.record(Metrics::LOOP_US, micros() - start);
+    // El log se vacía mientras se espera, a lo que admita la FIFO de la UART;
+    // con la tarea de log en marcha esto solo le adelanta trabajo.
+    Log::drain();
+    if (idle > maxIdle) idle = maxIdle;
+    if (idle > _maxIdle) idle = _maxIdle;
+    // En un solo bucle los servos avanzan desde aquí: una trama por vuelta.
+    if (_runMode != RUN_DUAL_CORE && _control.anyServoMoving() && idle > EmotionalServo::FRAME_MS) {
+        idle = EmotionalServo::FRAME_MS;
+    }
+    if (idle > 0 && _mqtt.waitForInput(idle, [this]() {
+            Log::drain();
+            return _control.hasSamples() || _control.hasServoUpdates();
+        })) {
+        _scheduler.runIn(_mqttTask, 0);
+    }
+}
+
+// Sin red el sensor, el servo y la telemetría siguen funcionando; solo se
+// aplaza todo lo que necesita MQTT.
+void AppLogic::updateNetwork() {
+    bool wasOnline = _net.online();
+    _net.update();
+    if (_net.online() && !wasOnline) {
+        _scheduler.runIn(_reconnectTask, _mqttRetry.waitTime(millis()));
+    } else if (!_net.online() && wasOnline) {
+        if (_mqtt.connected()) _mqtt.disconnect();
+        _scheduler.cancel(_reconnectTask);
+    }
+}
+
+void AppLogic::serviceMQTT() {
     if (!_mqtt.connected()) {
-        if (millis() - _lastReconnectAttempt > _reconnectInterval) {
-            Serial.println("Attempting to reconnect MQTT...");
-            if (_mqtt.connect()) {
-                 Serial.println("MQTT reconnected successfully.");
-                 Serial.println("Requesting current shadow state (GET) after reconnect...");
-                if (!_mqtt.publish(_shadowGetTopic, "")) {
-                    Serial.println("Failed to publish GET request post-reconnect.");
+        if (_mqttWasConnected) {
+            // Si cae el broker caen todos los dispositivos a la vez: el primer
+            // reintento también lleva jitter.
+            _mqttWasConnected = false;
+            unsigned long retryIn = _mqttRetry.lost(millis());
+            LOGW("APP", "MQTT connection lost. Reconnecting in %lu ms.", retryIn);
+        }
+        if (_net.online()) {
+            _scheduler.runWithin(_reconnectTask, _mqttRetry.waitTime(millis()));
+        }
+        return;
+    }
+    _mqtt.update();
+    // El reporte encolado deja de contar cuando llega su PUBACK.
+    for (uint8_t i = 0; i < _plantCount; i++) {
+        Plant& plant = _plants[i];
+        if (plant.queuedFields != 0 && !_outbox.contains(Outbox::SHADOW_REPORT, plant.shadowUpdateTopic)) {
+            plant.queuedFields = 0;
+        }
+    }
+    if (!_outbox.empty()) {
+        _scheduler.runWithin(_outboxTask, _outboxDrainInterval);
+    }
+}
+
+void AppLogic::reconnectMQTT() {
+    if (!_net.online() || _mqtt.connected()) {
+        return;
+    }
+    unsigned long wait = _mqttRetry.waitTime(millis());
+    if (wait > 0) {
+        _scheduler.runIn(_reconnectTask, wait);
+        return;
+    }
+    LOGD("APP", "Attempting to reconnect MQTT...");
+    _mqttRetry.attempt(millis());
+    if (_mqtt.connect()) {
+        _mqttRetry.success();
+        _mqttWasConnected = true;
+        if (_getOnConnect) {
+            LOGI("APP", "MQTT reconnected. Requesting current shadow state.");
+            _scheduler.runIn(_shadowReportTask, SHADOW_REPORT_TIMEOUT_MS);
+        } else {
+            // Versión y estado de la memoria RTC: se reporta directamente, con
+            // versión, en lugar del reporte encolado. Si la nube cambió
+            // mientras dormía, el 409 lleva al GET.
+            LOGI("APP", "MQTT reconnected. Reporting from retained state.");
+        }
+        for (uint8_t i = 0; i < _plantCount; i++) {
+            Plant& plant = _plants[i];
+            // La respuesta a un reporte de la sesión anterior ya no llegará.
+            plant.reports.reset();
+            if (_getOnConnect) {
+                plant.reports.waitForSync(millis());
+                if (!_mqtt.publish(plant.shadowGetTopic, "")) {
+                    LOGW("SHADOW", "Failed to publish GET request post-reconnect.");
                 }
-            } else {
-                Serial.println("MQTT reconnection failed.");
+            } else if (plant.state.dirty() != 0 || plant.queuedFields != 0 || plant.reports.hasPending()) {
+                LOGD("SHADOW", "Report from retained state, version %lu.", plant.shadowVersion);
+                if (!publishShadowReport(plant, plant.state.dirty())) {
+                    LOGW("SHADOW", "Report from retained state FAILED.");
+                }
+            } else if (!_outbox.contains(Outbox::SHADOW_REPORT, plant.shadowUpdateTopic)) {
+                plant.cycleSynced = true;
             }
-            _lastReconnectAttempt = millis();
+            // Si no, el reporte de un ciclo anterior sale del outbox y el
+            // ciclo espera su update/accepted.
         }
+        if (!_outbox.empty()) _scheduler.runIn(_outboxTask, _outboxDrainInterval);
     } else {
-      _mqtt.update(); 
+        unsigned long retryIn = _mqttRetry.failure(millis());
+        LOGW("APP", "MQTT reconnection failed (%u in a row, %s). Next attempt in %lu ms.",
+             (unsigned int)_mqttRetry.consecutiveFailures(), ReconnectPolicy::stateName(_mqttRetry.state()), retryIn);
+        _scheduler.runIn(_reconnectTask, retryIn);
     }
+}
 
-    _sensor.update(); 
+void AppLogic::drainOutbox() {
+    if (!_mqtt.connected() || _outbox.empty()) return;
+    _outbox.drain(_mqtt, MQTT_INFLIGHT_WINDOW);
+    if (!_outbox.empty()) _scheduler.runIn(_outboxTask, _outboxDrainInterval);
+}
 
-    HumidityRange currentSensorRange = _sensor.getCurrentRange();
+// Los reportes parciales dependen de que la nube tenga lo que creemos que
+// tiene; cada cierto tiempo se manda todo para corregir cualquier desvío.
+void AppLogic::publishFullReport() {
+    for (uint8_t i = 0; i < _plantCount; i++) {
+        Plant& plant = _plants[i];
+        if (!_mqtt.connected() || plant.shadowVersion == 0) {
+            plant.state.markAllDirty(); // Irá completo en el próximo reporte.
+            continue;
+        }
+        LOGI("SHADOW", "Publishing periodic full shadow report.");
+        if (!publishShadowReport(plant, DeviceState::FIELD_ALL)) {
+            plant.state.markAllDirty();
+        }
+    }
+}
 
+void AppLogic::applyServoAngle(Plant& plant, int angle, Emotion emotion) {
+    if (_control.servoAngle(plant.channel) != angle) _control.setServoAngle(plant.channel, angle);
+    plant.targetEmotion = emotion;
+    if (!_control.servoMoving(plant.channel)) {
+        plant.state.setServoAngle(angle);
+        plant.state.setEmotion(emotion);
+    }
+}
 
-    if (!_reportJustSentByCallback) {
-        if (_mqtt.connected() && currentSensorRange != _lastReportedHumidityRange && currentSensorRange != RANGE_UNKNOWN) {
+// El muestreo se aplica en la tarea de control; el estado ya lleva la
+// política recortada a los límites, que es la que se reporta.
+void AppLogic::applySampling(Plant& plant, const AdaptiveSampler::Policy& sampling) {
+    AdaptiveSampler::Policy clamped = AdaptiveSampler::clamp(sampling);
+    if (clamped == plant.state.sampling()) return;
+    if (!_control.setSamplingPolicy(plant.channel, clamped)) return;
+    plant.state.setSampling(clamped);
+    LOGI("SAMPLING", "Sampling every %lu-%lu ms, fast above %.1f %%/min.", (unsigned long)clamped.fastIntervalMs,
+         (unsigned long)clamped.slowIntervalMs, clamped.slopeThreshold);
+}
 
-            const unsigned long minIntervalBetweenRangeReports = 10000; // 10 segundos
-            if (millis() - _lastTelemetryMillis > minIntervalBetweenRangeReports) {
+// El servo llegó al último ángulo pedido: pasa al estado y sale el reporte
+// que se aplazó mientras se movía.
+void AppLogic::servoSettled(Plant& plant) {
+    int angle = _control.settledServoAngle(plant.channel);
+    plant.state.setServoAngle(angle);
+    plant.state.setEmotion(plant.targetEmotion);
+    LOGD("SERVO", "Settled at %d.", angle);
+    if (!plant.settleReportPending) return;
+    uint8_t fields = plant.state.dirty() | plant.settleReportFields;
+    bool clearDesired = plant.settleClearDesired;
+    plant.settleReportPending = false;
+    plant.settleReportFields = 0;
+    plant.settleClearDesired = false;
+    if (fields == 0 && !clearDesired) {
+        plant.cycleSynced = true;
+        return;
+    }
+    if (!publishShadowReport(plant, fields, clearDesired)) {
+        LOGW("SHADOW", "Report after servo motion FAILED.");
+    }
+}
 
-                Serial.print("Loop: Humidity range changed. Old: ");
-                Serial.print(MoistureSensor::rangeToString(_lastReportedHumidityRange));
-                Serial.print(" New: "); Serial.println(MoistureSensor::rangeToString(currentSensorRange));
+// Publica ya si el servo está quieto; si no, el reporte sale al detenerse.
+bool AppLogic::reportWhenSettled(Plant& plant, uint8_t touched, bool clearDesired) {
+    if (!_control.servoMoving(plant.channel)) {
+        return publishShadowReport(plant, plant.state.dirty() | touched, clearDesired);
+    }
+    plant.settleReportPending = true;
+    plant.settleReportFields |= touched;
+    plant.settleClearDesired = plant.settleClearDesired || clearDesired;
+    LOGD("SHADOW", "Servo moving to %d. Report deferred until it settles.", _control.servoAngle(plant.channel));
+    return true;
+}
 
-                if (_currentShadowVersion > 0) { 
-                    if (publishShadowReport()) {
-                        _lastReportedHumidityRange = currentSensorRange; 
-                        _lastTelemetryMillis = millis(); 
-                    } else {
-                        Serial.println("Loop: Report due to humidity range change FAILED.");
-                    }
-                } else {
-                    Serial.println("Loop: Report due to humidity range change SKIPPED, _currentShadowVersion is 0. Waiting for GET.");
-                    if (millis() - _lastReconnectAttempt > 60000 && !_mqtt.publish(_shadowGetTopic, "")) {
-                        Serial.println("Loop: Attempting GET due to missing version for range change report.");
-                    }
-                }
-            } else {
-                Serial.println("Loop: Humidity range changed, but report rate limited. Will try later.");
-            }
-        }
+void AppLogic::checkRangeReports() {
+    for (uint8_t i = 0; i < _plantCount; i++) {
+        checkRangeReport(_plants[i]);
     }
+}
 
+void AppLogic::checkRangeReport(Plant& plant) {
+    HumidityRange currentSensorRange = plant.state.humidityRange();
+    if (!plant.state.isDirty(DeviceState::FIELD_HUMIDITY_RANGE) || currentSensorRange == RANGE_UNKNOWN) {
+        return;
+    }
 
-    if (_reportJustSentByCallback) {
-        _lastReportedHumidityRange = _sensor.getCurrentRange();
-        _lastTelemetryMillis = millis();
-        _reportJustSentByCallback = false; 
-        Serial.println("Loop: _reportJustSentByCallback was true. Resetting. _lastReportedHumidityRange and _lastTelemetryMillis updated.");
+    unsigned long sinceLastReport = millis() - plant.lastReportMillis;
+    if (sinceLastReport <= _minRangeReportInterval) {
+        if (!_scheduler.scheduled(_reportTask)) {
+            LOGD("SHADOW", "Humidity range changed, but report rate limited. Will try later.");
+        }
+        _scheduler.runWithin(_reportTask, _minRangeReportInterval - sinceLastReport + 1);
+        return;
     }
 
-    delay(100); // Pequeña pausa
+    LOGI("SHADOW", "Humidity range changed. Old: %s New: %s",
+         MoistureSensor::rangeToString(plant.state.reportedHumidityRange()),
+         MoistureSensor::rangeToString(currentSensorRange));
+
+    if (!_mqtt.connected()) {
+        // Sin conexión: el cambio queda en el outbox hasta reconectar.
+        queueShadowReport(plant);
+    } else if (plant.shadowVersion > 0) {
+        if (!publishShadowReport(plant, plant.state.dirty())) {
+            LOGW("SHADOW", "Report due to humidity range change FAILED.");
+        }
+    } else {
+        LOGD("SHADOW", "Report due to humidity range change SKIPPED, shadowVersion is 0. Waiting for GET.");
+        if (millis() - _mqttRetry.lastAttemptMillis() > 60000 && !_mqtt.publish(plant.shadowGetTopic, "")) {
+            LOGW("SHADOW", "GET for missing version failed.");
+        }
+    }
 }
 
 
-void AppLogic::handleMQTTMessage(const String& topic, const String& payload) {
-    Serial.println("\n--- AppLogic::handleMQTTMessage ---");
-    Serial.print("Topic: "); Serial.println(topic);
+void AppLogic::handleMQTTMessage(uint8_t routeId, char* payload, size_t length) {
+    uint8_t plantIndex = routeId / TOPIC_SHADOW_COUNT;
+    uint8_t topicId = routeId % TOPIC_SHADOW_COUNT;
+    if (topicId == TOPIC_SHADOW_UPDATE_DOCUMENTS || plantIndex >= _plantCount) {
+        return; // Llega por la suscripción con comodín; no se usa.
+    }
+    Plant& plant = _plants[plantIndex];
+    LOGD("SHADOW", "Message on %s: %.*s", shadowTopicName(topicId), (int)length, payload);
+
+    if (topicId == TOPIC_SHADOW_GET_REJECTED) {
+        // Se registra antes de parsear: el parseo in situ modifica el buffer.
+        LOGW("SHADOW", "GET request REJECTED: %.*s", (int)length, payload);
+    }
 
-    StaticJsonDocument<1024> doc;
-    DeserializationError error = deserializeJson(doc, payload);
+    // Modo zero-copy de ArduinoJson: con un char* mutable las cadenas del
+    // documento apuntan al buffer de PubSubClient en vez de copiarse. El
+    // filtro deja fuera metadata y claves desconocidas, así el documento no
+    // crece con el tamaño del shadow.
+    StaticJsonDocument<384> doc;
+    DeserializationError error = deserializeJson(doc, payload, length, DeserializationOption::Filter(_shadowFilter));
 
     if (error) {
-        Serial.print("deserializeJson() failed: ");
-        Serial.println(error.f_str());
+        _metrics.increment(Metrics::SHADOW_PARSE_ERRORS);
+        LOGE("SHADOW", "deserializeJson() failed: %s", error.c_str());
         return;
     }
 
     if (doc.containsKey("version")) {
         unsigned long newVersionInPayload = doc["version"].as<unsigned long>();
-        if (topic == _shadowUpdateAcceptedTopic) {
-            _currentShadowVersion = newVersionInPayload;
-            Serial.print("INFO (UPDATE_ACCEPTED Specific): _currentShadowVersion DEFINITIVELY updated to: "); Serial.println(_currentShadowVersion);
-        } else if (topic == _shadowDeltaTopic) {
-             _currentShadowVersion = newVersionInPayload;
-             Serial.print("INFO (DELTA Specific): _currentShadowVersion set to DELTA document version: "); Serial.println(_currentShadowVersion);
-        } else if (topic == _shadowGetAcceptedTopic) {
-            if (newVersionInPayload > _currentShadowVersion || _currentShadowVersion == 0) {
-                _currentShadowVersion = newVersionInPayload;
-                Serial.print("INFO (GET_ACCEPTED): _currentShadowVersion updated to: "); Serial.println(_currentShadowVersion);
+        if (topicId == TOPIC_SHADOW_UPDATE_ACCEPTED) {
+            // También llegan los de otros clientes, no necesariamente en orden.
+            if (newVersionInPayload > plant.shadowVersion) {
+                plant.shadowVersion = newVersionInPayload;
+                LOGD("SHADOW", "UPDATE_ACCEPTED: shadowVersion updated to: %lu", plant.shadowVersion);
+            }
+        } else if (topicId == TOPIC_SHADOW_DELTA) {
+             plant.shadowVersion = newVersionInPayload;
+             LOGD("SHADOW", "DELTA: shadowVersion set to DELTA document version: %lu", plant.shadowVersion);
+        } else if (topicId == TOPIC_SHADOW_GET_ACCEPTED) {
+            if (newVersionInPayload > plant.shadowVersion || plant.shadowVersion == 0) {
+                plant.shadowVersion = newVersionInPayload;
+                LOGD("SHADOW", "GET_ACCEPTED: shadowVersion updated to: %lu", plant.shadowVersion);
             } else {
-                 Serial.print("INFO (GET_ACCEPTED): Received version "); Serial.print(newVersionInPayload);
-                 Serial.print(" is not newer than current _currentShadowVersion "); Serial.println(_currentShadowVersion);
+                 LOGD("SHADOW", "GET_ACCEPTED: Received version %lu is not newer than current shadowVersion %lu",
+                      newVersionInPayload, plant.shadowVersion);
             }
         }
     } else {
-        if (topic == _shadowDeltaTopic || topic == _shadowGetAcceptedTopic || topic == _shadowUpdateAcceptedTopic) {
-            Serial.print("WARN: Message on topic "); Serial.print(topic); Serial.println(" did not contain 'version'. Version sync might be impacted.");
+        if (topicId == TOPIC_SHADOW_DELTA || topicId == TOPIC_SHADOW_GET_ACCEPTED || topicId == TOPIC_SHADOW_UPDATE_ACCEPTED) {
+            LOGW("SHADOW", "Message on topic %s did not contain 'version'. Version sync might be impacted.", shadowTopicName(topicId));
         }
     }
 
-    if (topic == _shadowDeltaTopic) {
-        Serial.println("Processing Shadow DELTA...");
+    if (topicId == TOPIC_SHADOW_DELTA) {
         if (!doc.containsKey("version")) {
-             Serial.println("CRITICAL (DELTA): Delta message did not contain 'version'. Aborting.");
+             LOGE("SHADOW", "DELTA: Delta message did not contain 'version'. Aborting.");
              return;
         }
+        uint8_t touched = 0;
         if (doc.containsKey("state")) {
-            handleShadowDelta(doc["state"].as<JsonObjectConst>());
+            touched = handleShadowDelta(plant, doc["state"].as<JsonObjectConst>());
         } else {
-            Serial.println("DELTA: Message does not contain 'state' object.");
+            LOGW("SHADOW", "DELTA: Message does not contain 'state' object.");
         }
-        Serial.println("DELTA: Attempting to publish shadow report to clear delta.");
-        if (publishShadowReport()) {
-
-            _reportJustSentByCallback = true; 
-            Serial.print("DELTA: Report SUCCESS. Expected new cloud version post-accept: ");
-            Serial.println(_currentShadowVersion + 1);
+        if (reportWhenSettled(plant, touched, true)) {
+            LOGD("SHADOW", "DELTA: Report SUCCESS. Expected new cloud version post-accept: %lu", plant.shadowVersion + 1);
         } else {
-             Serial.println("DELTA: Report FAILED after processing delta. Delta might persist.");
+             LOGW("SHADOW", "DELTA: Report FAILED after processing delta. Delta might persist.");
         }
 
-    } else if (topic == _shadowGetAcceptedTopic) {
-        Serial.println("Processing Shadow GET_ACCEPTED...");
-        handleShadowGetAccepted(doc.as<JsonObjectConst>()); 
+    } else if (topicId == TOPIC_SHADOW_GET_ACCEPTED) {
+        handleShadowGetAccepted(plant, doc.as<JsonObjectConst>());
 
-    } else if (topic == _shadowGetRejectedTopic) {
-        Serial.print("Shadow GET request REJECTED: "); Serial.println(payload);
+    } else if (topicId == TOPIC_SHADOW_GET_REJECTED) {
         if (doc.containsKey("code") && doc["code"] == 404) {
-            Serial.println("GET_REJECTED: Shadow not found (404). Initial report might be needed if `isInitialReportScenario` triggers in GET_ACCEPTED logic.");
+            LOGW("SHADOW", "GET_REJECTED: Shadow not found (404).");
         }
-    } else if (topic == _shadowUpdateAcceptedTopic) {
-        Serial.println("Processing Shadow UPDATE_ACCEPTED...");
-        handleShadowUpdateAccepted(doc.as<JsonObjectConst>());
-    } else if (topic == _shadowUpdateRejectedTopic) {
-        Serial.println("Processing Shadow UPDATE_REJECTED...");
-        handleShadowUpdateRejected(doc.as<JsonObjectConst>());
+    } else if (topicId == TOPIC_SHADOW_UPDATE_ACCEPTED) {
+        handleShadowUpdateAccepted(plant, doc.as<JsonObjectConst>());
+    } else if (topicId == TOPIC_SHADOW_UPDATE_REJECTED) {
+        handleShadowUpdateRejected(plant, doc.as<JsonObjectConst>());
     }
 }
 
-void AppLogic::handleShadowDelta(JsonObjectConst deltaState) {
-    bool stateChangedByDelta = false;
-    String desiredEmotion = _lastProcessedEmotion; 
+// Aplica el estado deseado y devuelve los campos que tocó, que van en el
+// reporte aunque ya coincidieran con lo reportado.
+uint8_t AppLogic::handleShadowDelta(Plant& plant, JsonObjectConst deltaState) {
+    uint8_t touched = 0;
+    uint8_t dirtyBefore = plant.state.dirty();
 
-    if (deltaState.containsKey("servoAngle")) {
-        int desiredAngle = deltaState["servoAngle"];
-        Serial.print("Delta State: Desired servoAngle: "); Serial.println(desiredAngle);
-        if (_servo.getCurrentAngle() != desiredAngle) {
-            _servo.setAngle(desiredAngle);
-            stateChangedByDelta = true;
-            if (!deltaState.containsKey("emotion")) { 
-                if (desiredAngle == SERVO_HAPPY_ANGLE) desiredEmotion = "FELIZ";
-                else if (desiredAngle == SERVO_SAD_ANGLE) desiredEmotion = "TRISTE";
-                else if (desiredAngle == SERVO_NEUTRAL_ANGLE) desiredEmotion = "NEUTRAL";
-                else desiredEmotion = "CUSTOM";
-            }
+    // Si llegan ambos manda la emoción, igual que antes.
+    if (deltaState.containsKey("emotion")) {
+        const char* emotionValue = deltaState["emotion"] | "";
+        LOGD("SHADOW", "Desired emotion: %s", emotionValue);
+        Emotion emotion;
+        if (DeviceState::parseEmotion(emotionValue, emotion)) {
+            applyServoAngle(plant, DeviceState::angleForEmotion(emotion, _config.servoAngles), emotion);
+            touched |= DeviceState::FIELD_EMOTION | DeviceState::FIELD_SERVO_ANGLE;
+        } else {
+            LOGW("SHADOW", "Unknown emotion value: %s", emotionValue);
         }
     }
 
-    if (deltaState.containsKey("emotion")) {
-        String emotionValue = deltaState["emotion"].as<String>();
-        Serial.print("Delta State: Desired emotion: "); Serial.println(emotionValue);
-        
-        if (emotionValue != _lastProcessedEmotion || 
-            (emotionValue == "FELIZ" && _servo.getCurrentAngle() != SERVO_HAPPY_ANGLE) ||
-            (emotionValue == "TRISTE" && _servo.getCurrentAngle() != SERVO_SAD_ANGLE) ||
-            (emotionValue == "NEUTRAL" && _servo.getCurrentAngle() != SERVO_NEUTRAL_ANGLE) ) {
-            
-            if (emotionValue == "FELIZ") { _servo.setHappy(); desiredEmotion = "FELIZ"; stateChangedByDelta = true;}
-            else if (emotionValue == "TRISTE") { _servo.setSad(); desiredEmotion = "TRISTE"; stateChangedByDelta = true;}
-            else if (emotionValue == "NEUTRAL") { _servo.setNeutral(); desiredEmotion = "NEUTRAL"; stateChangedByDelta = true;}
-            else {
-                Serial.print("Delta State: Unknown emotion value: "); Serial.println(emotionValue);
-            }
-        }
+    if (deltaState.containsKey("servoAngle") && !(touched & DeviceState::FIELD_SERVO_ANGLE)) {
+        int desiredAngle = deltaState["servoAngle"];
+        LOGD("SHADOW", "Desired servoAngle: %d", desiredAngle);
+        applyServoAngle(plant, desiredAngle, DeviceState::emotionForAngle(desiredAngle, _config.servoAngles));
+        touched |= DeviceState::FIELD_EMOTION | DeviceState::FIELD_SERVO_ANGLE;
     }
 
-    if (stateChangedByDelta) {
-        _lastProcessedEmotion = desiredEmotion;
-        Serial.print("Delta State: Local device state changed. _lastProcessedEmotion set to: "); Serial.println(_lastProcessedEmotion);
+    // Las claves que falten conservan su valor actual.
+    AdaptiveSampler::Policy sampling = plant.state.sampling();
+    if (DeviceState::parseSampling(deltaState["sampling"].as<JsonObjectConst>(), sampling)) {
+        applySampling(plant, sampling);
+        touched |= DeviceState::FIELD_SAMPLING;
+    }
+
+    if ((plant.state.dirty() & ~dirtyBefore & touched) || (touched && _control.servoMoving(plant.channel))) {
+        LOGI("SHADOW", "Desired state applied. Emotion set to: %s", DeviceState::emotionName(plant.targetEmotion));
     } else {
-        Serial.println("Delta State: No local device state changes made by delta.");
+        LOGD("SHADOW", "No local device state changes made by delta.");
     }
+    return touched;
 }
 
-void AppLogic::handleShadowGetAccepted(JsonObjectConst shadowDocument) {
-    Serial.print("GET_ACCEPTED: Current _currentShadowVersion is: "); Serial.println(_currentShadowVersion);
-    bool needsReportAfterGet = false;
+void AppLogic::handleShadowGetAccepted(Plant& plant, JsonObjectConst shadowDocument) {
+    LOGD("SHADOW", "GET_ACCEPTED: Current shadowVersion is: %lu", plant.shadowVersion);
+    // loadReported recalcula lo que le falta a la nube: lo pendiente sobra.
+    plant.reports.synced();
     bool appliedDesired = false;
-    bool isInitialReportScenario = false;
-
-    if (shadowDocument.containsKey("state")) {
-        JsonObjectConst state = shadowDocument["state"];
-        if (state.containsKey("reported")) {
-            JsonObjectConst reportedState = state["reported"];
-            Serial.println("GET_ACCEPTED: Processing 'reported' state from shadow.");
-            if (reportedState.containsKey("emotion")) {
-                 String reportedEmotion = reportedState["emotion"].as<String>();
-                 if (_lastProcessedEmotion != reportedEmotion && (reportedEmotion == "FELIZ" || reportedEmotion == "TRISTE" || reportedEmotion == "NEUTRAL")) {
-                     _lastProcessedEmotion = reportedEmotion;
-                     Serial.print("GET_ACCEPTED: Synced _lastProcessedEmotion from shadow's reported to: "); Serial.println(_lastProcessedEmotion);
-                     if (reportedEmotion == "FELIZ" && _servo.getCurrentAngle() != SERVO_HAPPY_ANGLE) _servo.setHappy();
-                     else if (reportedEmotion == "TRISTE" && _servo.getCurrentAngle() != SERVO_SAD_ANGLE) _servo.setSad();
-                     else if (reportedEmotion == "NEUTRAL" && _servo.getCurrentAngle() != SERVO_NEUTRAL_ANGLE) _servo.setNeutral();
-                 }
-            }
-            if (reportedState.containsKey("servoAngle")) {
-                int reportedAngle = reportedState["servoAngle"];
-                if (_servo.getCurrentAngle() != reportedAngle) {
-                    Serial.print("GET_ACCEPTED: Syncing servoAngle from reported: "); Serial.println(reportedAngle);
-                    _servo.setAngle(reportedAngle);
-                }
-            }
-            if (reportedState.containsKey("humidityRange")) {
-                String reportedRangeStr = reportedState["humidityRange"].as<String>();
-                HumidityRange shadowRange = MoistureSensor::stringToRange(reportedRangeStr);
-                if (shadowRange != RANGE_UNKNOWN && _lastReportedHumidityRange != shadowRange) {
-                    _lastReportedHumidityRange = shadowRange; // <<<--- ACTUALIZAR ESTO
-                    Serial.print("GET_ACCEPTED: Synced _lastReportedHumidityRange from shadow's reported to: ");
-                    Serial.println(reportedRangeStr);
-                }
-            } else {
-
-                 if (_sensor.getCurrentRange() != RANGE_UNKNOWN) {
-                     Serial.println("GET_ACCEPTED: No 'humidityRange' in reported shadow, but sensor has a range. Flagging for initial report.");
-                     isInitialReportScenario = true; 
-                     needsReportAfterGet = true;
-                 }
-            }
-        } else {
-             Serial.println("GET_ACCEPTED: No 'reported' state in shadow. Will report current device state.");
-             isInitialReportScenario = true;
-             needsReportAfterGet = true;
-        }
-
-        if (state.containsKey("desired")) {
-            JsonObjectConst desiredState = state["desired"];
-            Serial.println("GET_ACCEPTED: Processing 'desired' state from shadow.");
-            if (!desiredState.isNull() && desiredState.size() > 0) {
-                handleShadowDelta(desiredState);
-                needsReportAfterGet = true;
-                appliedDesired = true;
-            } else {
-                Serial.println("GET_ACCEPTED: 'desired' state is null or empty.");
-            }
+    uint8_t touched = 0;
+
+    JsonObjectConst state = shadowDocument["state"];
+    JsonObjectConst reportedState = state["reported"];
+    if (!reportedState.isNull()) {
+        // Tras un reinicio el servo recupera la posición que tenía la nube.
+        Emotion reportedEmotion;
+        if (DeviceState::parseEmotion(reportedState["emotion"] | "", reportedEmotion)) {
+            applyServoAngle(plant, DeviceState::angleForEmotion(reportedEmotion, _config.servoAngles), reportedEmotion);
+        } else if (reportedState.containsKey("servoAngle")) {
+            int reportedAngle = reportedState["servoAngle"];
+            applyServoAngle(plant, reportedAngle, DeviceState::emotionForAngle(reportedAngle, _config.servoAngles));
+        }
+        AdaptiveSampler::Policy sampling = plant.state.sampling();
+        if (DeviceState::parseSampling(reportedState["sampling"].as<JsonObjectConst>(), sampling)) {
+            applySampling(plant, sampling);
         }
+        LOGI("SHADOW", "GET_ACCEPTED: Synced emotion from shadow's reported to: %s", DeviceState::emotionName(plant.targetEmotion));
     } else {
-        Serial.println("GET_ACCEPTED: Shadow is empty or has no 'state' object. Will report current device state.");
-        isInitialReportScenario = true;
-        needsReportAfterGet = true;
-    }
-
-    if (needsReportAfterGet) {
-        Serial.print("GET_ACCEPTED: Needs to publish a shadow report. Applied desired: "); Serial.print(appliedDesired);
-        Serial.print(" | Initial report scenario: "); Serial.println(isInitialReportScenario);
-        if (publishShadowReport()) {
-            _reportJustSentByCallback = true; 
-            Serial.print("GET_ACCEPTED: Report SUCCESS. Expected new cloud version post-accept: ");
-            Serial.println(_currentShadowVersion + 1);
+        LOGI("SHADOW", "GET_ACCEPTED: No 'reported' state in shadow. Will report current device state.");
+    }
+    // Lo que falte o difiera en la nube queda sucio y va en el reporte.
+    plant.state.loadReported(reportedState);
+
+    JsonObjectConst desiredState = state["desired"];
+    if (!desiredState.isNull() && desiredState.size() > 0) {
+        touched = handleShadowDelta(plant, desiredState);
+        appliedDesired = true;
+    }
+
+    if (plant.state.dirty() != 0 || appliedDesired) {
+        LOGD("SHADOW", "GET_ACCEPTED: Needs to publish a shadow report. Applied desired: %d | Dirty fields: 0x%02x",
+             appliedDesired, plant.state.dirty());
+        if (reportWhenSettled(plant, touched, appliedDesired)) {
+            LOGD("SHADOW", "GET_ACCEPTED: Report SUCCESS. Expected new cloud version post-accept: %lu", plant.shadowVersion + 1);
         } else {
-            Serial.println("GET_ACCEPTED: Report FAILED after processing GET_ACCEPTED.");
+            LOGW("SHADOW", "GET_ACCEPTED: Report FAILED after processing GET_ACCEPTED.");
         }
     } else {
-        Serial.println("GET_ACCEPTED: No report needed after processing.");
-        _lastTelemetryMillis = millis();
+        LOGD("SHADOW", "GET_ACCEPTED: No report needed after processing.");
+        plant.lastReportMillis = millis();
+        plant.cycleSynced = true;
     }
 }
 
-bool AppLogic::publishShadowReport() {
-    Serial.println("\n--- publishShadowReport called ---");
-    if (!_mqtt.connected()) {
-        Serial.println("PUBLISH: MQTT not connected. Cannot publish.");
-        return false;
+void AppLogic::buildShadowReport(const Plant& plant, JsonDocument& doc, uint8_t fields, bool includeVersion,
+                                 bool clearDesired) {
+    if (includeVersion) {
+        doc["version"] = plant.shadowVersion;
     }
-    StaticJsonDocument<512> doc;
-    doc["version"] = _currentShadowVersion;
-    Serial.print("PUBLISH: Publishing with _currentShadowVersion: "); Serial.println(_currentShadowVersion);
 
     JsonObject stateObj = doc.createNestedObject("state");
-    JsonObject reportedObj = stateObj.createNestedObject("reported");
+    plant.state.writeReported(stateObj.createNestedObject("reported"), fields);
+    if (clearDesired) {
+        stateObj["desired"] = nullptr;
+    }
+}
 
-    reportedObj["rawSoilMoisture"] = _sensor.getRawValue();
-    reportedObj["soilMoisturePercent"] = _sensor.getPercentage();
-    reportedObj["humidityRange"] = _sensor.getRangeString(); 
-    reportedObj["servoAngle"] = _servo.getCurrentAngle();
+bool AppLogic::publishShadowReport(Plant& plant, uint8_t fields, bool clearDesired) {
+    if (!_mqtt.connected()) {
+        LOGW("SHADOW", "MQTT not connected. Cannot publish report.");
+        return false;
+    }
+    // Este reporte sustituye al encolado, así que lleva también sus campos.
+    fields |= plant.queuedFields;
+    if (fields == 0 && !clearDesired && !plant.reports.hasPending()) {
+        LOGD("SHADOW", "Nothing changed since last report.");
+        return true;
+    }
+    plant.reports.request(fields, clearDesired);
+    if (!plant.reports.ready()) {
+        // Con otro en vuelo, un segundo update con la misma versión acabaría
+        // en 409: el cambio sale en el siguiente, tras su respuesta.
+        _metrics.increment(Metrics::SHADOW_REPORTS_MERGED);
+        LOGD("SHADOW", "Report r%lu in flight. Fields 0x%02x wait for the next one.",
+             (unsigned long)plant.reports.token(), plant.reports.pendingFields());
+        return true;
+    }
+    return sendShadowReport(plant);
+}
 
-    if (_lastProcessedEmotion == "FELIZ" || _lastProcessedEmotion == "TRISTE" || _lastProcessedEmotion == "NEUTRAL") {
-        reportedObj["emotion"] = _lastProcessedEmotion;
+// Envía todo lo pendiente con la versión actual. El clientToken distingue la
+// respuesta de las de otros clientes del mismo shadow.
+bool AppLogic::sendShadowReport(Plant& plant) {
+    uint32_t token = plant.reports.start(plant.state.dirty() | plant.queuedFields, plant.shadowVersion, millis());
+    uint8_t fields = plant.reports.inFlightFields();
+    StaticJsonDocument<REPORT_PAYLOAD_SIZE> doc;
+    buildShadowReport(plant, doc, fields, true, plant.reports.inFlightClearDesired());
+    char clientToken[12];
+    ReportCoordinator::formatToken(token, clientToken, sizeof(clientToken));
+    doc["clientToken"] = (const char*)clientToken;
+
+    char payload[REPORT_PAYLOAD_SIZE];
+    size_t payloadLength = serializeJson(doc, payload, sizeof(payload));
+    LOGD("SHADOW", "Report for version %lu: %.*s", plant.shadowVersion, (int)payloadLength, payload);
+    // QoS 1: si no llega el PUBACK el reporte se da por no entregado y todo
+    // queda sucio para el siguiente. Solo con la ventana llena sale con QoS 0
+    // (update/accepted lo confirma igualmente); si falla la escritura no se
+    // repite en el mismo socket y queda sucio abajo. La captura (this,
+    // maceta y token) cabe en el std::function sin reservar memoria.
+    uint8_t index = plant.channel;
+    bool success;
+    if (_mqtt.canPublishReliable()) {
+        success = _mqtt.publishReliable(plant.shadowUpdateTopic, (const uint8_t*)payload, payloadLength,
+                                        [this, index, token](bool delivered, const char*, const uint8_t*, size_t) {
+                                            if (delivered) return;
+                                            LOGW("SHADOW", "Shadow report not acknowledged. Marking state dirty.");
+                                            _metrics.increment(Metrics::SHADOW_REPORT_FAILURES);
+                                            _plants[index].state.markAllDirty();
+                                            _plants[index].reports.lost(token);
+                                            _scheduler.runIn(_shadowReportTask, 0);
+                                        });
     } else {
-        int currentAngle = _servo.getCurrentAngle();
-        if (currentAngle == SERVO_HAPPY_ANGLE) reportedObj["emotion"] = "FELIZ";
-        else if (currentAngle == SERVO_SAD_ANGLE) reportedObj["emotion"] = "TRISTE";
-        else if (currentAngle == SERVO_NEUTRAL_ANGLE) reportedObj["emotion"] = "NEUTRAL";
-        else reportedObj["emotion"] = "CUSTOM";
+        success = _mqtt.publish(plant.shadowUpdateTopic, (const uint8_t*)payload, payloadLength);
     }
-    Serial.print("PUBLISH: Reporting emotion as: "); Serial.println(reportedObj["emotion"].as<String>());
-    Serial.print("PUBLISH: Reporting humidityRange as: "); Serial.println(reportedObj["humidityRange"].as<String>());
-
-
-    stateObj["desired"] = nullptr;
-    String payloadStr;
-    serializeJson(doc, payloadStr);
-    Serial.print("PUBLISH: Publishing Payload: "); Serial.println(payloadStr);
-    bool success = _mqtt.publish(_shadowUpdateTopic, payloadStr);
 
     if(success) {
-        Serial.print("PUBLISH: Shadow Report SUCCEEDED for version "); Serial.println(_currentShadowVersion);
+        _metrics.increment(Metrics::SHADOW_REPORTS);
+        // Un reporte pendiente ya quedó obsoleto.
+        _outbox.discard(Outbox::SHADOW_REPORT, plant.shadowUpdateTopic);
+        plant.state.markReported(fields);
+        plant.queuedFields = 0;
+        plant.lastReportMillis = millis();
+        _scheduler.runWithin(_shadowReportTask, SHADOW_REPORT_TIMEOUT_MS);
         return true;
     } else {
-        Serial.println("PUBLISH: Shadow Report FAILED (MQTTManager::publish returned false).");
+        LOGW("SHADOW", "Shadow report FAILED (not connected or write failed).");
+        _metrics.increment(Metrics::SHADOW_REPORT_FAILURES);
+        plant.reports.lost(token);
         return false;
     }
 }
 
-void AppLogic::handleShadowUpdateAccepted(JsonObjectConst acceptedPayload) {
-    Serial.println("UPDATE_ACCEPTED: Shadow update was ACCEPTED by AWS IoT.");
-    Serial.print("UPDATE_ACCEPTED: Confirmed version is now: "); Serial.println(_currentShadowVersion);
+// Sin respuesta al reporte en vuelo (o al GET tras un 409) en
+// SHADOW_REPORT_TIMEOUT_MS: lo que llevaba se reenvía con la versión actual.
+// Una sola tarea para todas las macetas, programada a la espera más corta.
+void AppLogic::serviceShadowReports() {
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < _plantCount; i++) {
+        Plant& plant = _plants[i];
+        if (plant.reports.expire(now)) {
+            LOGW("SHADOW", "No response to shadow report in %lu ms. Sending again.", SHADOW_REPORT_TIMEOUT_MS);
+            _metrics.increment(Metrics::SHADOW_REPORT_FAILURES);
+        } else if (plant.reports.state() != ReportCoordinator::IDLE) {
+            _scheduler.runWithin(_shadowReportTask, plant.reports.timeUntilExpiry(now));
+            continue;
+        }
+        if (plant.reports.ready() && _mqtt.connected() && plant.shadowVersion > 0 && !sendShadowReport(plant)) {
+            LOGW("SHADOW", "Pending shadow report FAILED.");
+        }
+    }
+}
+
+// El reporte encolado va sin "version": al vaciarse más tarde la versión ya no
+// sería la vigente y AWS lo rechazaría con 409. reportedAt conserva el momento
+// real del cambio.
+bool AppLogic::queueShadowReport(Plant& plant) {
+    uint8_t fields = plant.state.dirty() | plant.queuedFields;
+    if (fields == 0) return true;
+    StaticJsonDocument<REPORT_PAYLOAD_SIZE> doc;
+    buildShadowReport(plant, doc, fields, false, false);
+    time_t now = time(nullptr);
+    if (now > 1000000000L) {
+        doc["state"]["reported"]["reportedAt"] = (unsigned long)now;
+    }
+
+    char payload[REPORT_PAYLOAD_SIZE];
+    size_t payloadLength = serializeJson(doc, payload, sizeof(payload));
+    bool queued = _outbox.push(Outbox::SHADOW_REPORT, plant.shadowUpdateTopic, (const uint8_t*)payload, payloadLength);
+    LOGI("OUTBOX", "Shadow report %s. Pending: %u", queued ? "queued" : "NOT queued", (unsigned int)_outbox.size());
+    if (queued) {
+        plant.state.markReported(fields);
+        plant.queuedFields = fields;
+        plant.lastReportMillis = millis();
+    }
+    return queued;
+}
+
+// Con la humedad quieta una muestra cada TELEMETRY_SAMPLE_INTERVAL_MS como
+// mucho (el escaneo suele ir más espaciado); mientras se mueve, cada escaneo,
+// y el lote se llena y se publica antes.
+void AppLogic::sampleTelemetry() {
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < _plantCount; i++) {
+        Plant& plant = _plants[i];
+        const DeviceControl::SensorSample& sample = _control.sample(plant.channel);
+        if (sample.range == RANGE_UNKNOWN || (!sample.active && !plant.telemetry.sampleDue(now))) continue;
+        plant.telemetry.addSample(now, sample.rawValue, sample.percentage);
+        if (plant.telemetry.batchReady()) {
+            publishTelemetryBatch(plant);
+        }
+    }
+}
+
+// El lote se envía una vez con QoS 1: si no hay conexión, la ventana está
+// llena o no llega el PUBACK va al outbox, que descarta telemetría antigua
+// antes que reportes del shadow.
+bool AppLogic::publishTelemetryBatch(Plant& plant) {
+    uint8_t payload[TelemetryBatcher::MAX_ENCODED_SIZE];
+    size_t payloadLength = plant.telemetry.encode(payload, sizeof(payload));
+    // Solo para LOGD, que con FLOR_LOG_LEVEL por debajo de debug desaparece.
+    [[maybe_unused]] uint8_t samples = plant.telemetry.count();
+    plant.telemetry.clear();
+    if (payloadLength == 0) return false;
+
+    auto requeue = [this](bool delivered, const char* topic, const uint8_t* payload, size_t length) {
+        if (delivered) return;
+        bool queued = _outbox.push(Outbox::TELEMETRY, topic, payload, length);
+        LOGI("TELEMETRY", "Batch not acknowledged, %s. Pending: %u", queued ? "queued" : "DROPPED",
+             (unsigned int)_outbox.size());
+    };
+    if (_mqtt.connected() && _mqtt.publishReliable(plant.telemetryTopic, payload, payloadLength, requeue)) {
+        LOGD("TELEMETRY", "Published batch of %u samples (%u bytes).", samples, (unsigned int)payloadLength);
+        return true;
+    }
+
+    bool queued = _outbox.push(Outbox::TELEMETRY, plant.telemetryTopic, payload, payloadLength);
+    LOGI("TELEMETRY", "Batch %s. Pending: %u", queued ? "queued" : "DROPPED", (unsigned int)_outbox.size());
+    return queued;
+}
+
+// Sin conexión no se encola: los contadores son acumulados y el siguiente
+// envío los incluye; los histogramas siguen acumulando hasta entonces.
+void AppLogic::publishMetrics() {
+    _metrics.set(Metrics::HEAP_FREE, ESP.getFreeHeap());
+    _metrics.set(Metrics::HEAP_MIN_FREE, ESP.getMinFreeHeap());
+    _metrics.set(Metrics::OUTBOX_PENDING, _outbox.size());
+    _metrics.set(Metrics::WIFI_RSSI, _net.online() ? WiFi.RSSI() : 0);
+    _metrics.set(Metrics::WIFI_OUTAGES, _net.outages());
+    if (!_mqtt.connected()) return;
+
+    char payload[1536];
+    size_t payloadLength = _metrics.serialize(payload, sizeof(payload), millis());
+    if (payloadLength == 0) {
+        LOGE("METRICS", "Payload does not fit in buffer.");
+        return;
+    }
+    if (_mqtt.publish(_metricsTopic, (const uint8_t*)payload, payloadLength)) {
+        _metrics.resetHistograms();
+    }
 }
 
-void AppLogic::handleShadowUpdateRejected(JsonObjectConst rejectedPayload) {
-    Serial.print("UPDATE_REJECTED: Shadow update was REJECTED. Payload: ");
-    String rejectedPayloadStr;
-    serializeJson(rejectedPayload, rejectedPayloadStr);
-    Serial.println(rejectedPayloadStr);
-    if (rejectedPayload.containsKey("code") && rejectedPayload["code"] == 409) {
-        Serial.println("UPDATE_REJECTED: Version conflict (409). Requesting current shadow to re-sync.");
-        if (!_mqtt.publish(_shadowGetTopic, "")) {
-            Serial.println("Failed to publish GET request after 409.");
+void AppLogic::handleShadowUpdateAccepted(Plant& plant, JsonObjectConst acceptedPayload) {
+    const char* clientToken = acceptedPayload["clientToken"] | "";
+    uint32_t token;
+    if (ReportCoordinator::parseToken(clientToken, token)) {
+        if (!plant.reports.accepted(token)) {
+            LOGD("SHADOW", "UPDATE_ACCEPTED: Late response to report %s ignored.", clientToken);
+            return;
+        }
+        if (plant.reports.ready()) {
+            // Lo acumulado mientras tanto sale ya sobre la versión confirmada.
+            LOGD("SHADOW", "UPDATE_ACCEPTED: Sending merged report on version %lu.", plant.shadowVersion);
+            if (!sendShadowReport(plant)) {
+                LOGW("SHADOW", "Merged shadow report FAILED.");
+            }
+            return;
         }
-    } else if (rejectedPayload.containsKey("code")) {
-        Serial.print("UPDATE_REJECTED: Shadow update rejected with code: ");
-        Serial.println(rejectedPayload["code"].as<int>());
+    } else if (clientToken[0] != '\0') {
+        return; // Update de otro cliente: solo cuenta su versión.
+    }
+    plant.cycleSynced = true;
+    if (_firstReportMillis == 0) {
+        _firstReportMillis = millis();
+        LOGI("SHADOW", "Boot-to-first-report %lu ms (network online at %lu ms).", _firstReportMillis, _net.firstOnlineMillis());
     }
-}
\ No newline at end of file
+    LOGD("SHADOW", "UPDATE_ACCEPTED: Confirmed version is now: %lu", plant.shadowVersion);
+}
+
+void AppLogic::handleShadowUpdateRejected(Plant& plant, JsonObjectConst rejectedPayload) {
+    _metrics.increment(Metrics::SHADOW_REJECTED);
+    int code = rejectedPayload["code"] | 0;
+    LOGW("SHADOW", "UPDATE_REJECTED: code %d, %s", code, rejectedPayload["message"] | "");
+    if (code == 409) {
+        _metrics.increment(Metrics::SHADOW_CONFLICTS);
+    }
+    const char* clientToken = rejectedPayload["clientToken"] | "";
+    uint32_t token;
+    if (ReportCoordinator::parseToken(clientToken, token)) {
+        if (!plant.reports.rejected(token, code == 409)) {
+            return; // Respuesta tardía a un reporte ya reenviado.
+        }
+        if (code != 409) {
+            // Se repetiría igual: se descarta y sigue lo acumulado, si lo hay.
+            if (plant.reports.ready() && !sendShadowReport(plant)) {
+                LOGW("SHADOW", "Merged shadow report FAILED.");
+            }
+            return;
+        }
+        // El 409 no trae la versión vigente, pero si ya llegó otra más nueva
+        // (update/accepted de otro cliente, delta) basta con reenviar.
+        if (plant.shadowVersion > plant.reports.sentVersion()) {
+            LOGI("SHADOW", "UPDATE_REJECTED: Version conflict (409) on %lu. Sending again on version %lu.",
+                 plant.reports.sentVersion(), plant.shadowVersion);
+            if (!sendShadowReport(plant)) {
+                LOGW("SHADOW", "Shadow report after 409 FAILED.");
+            }
+            return;
+        }
+    } else if (clientToken[0] != '\0' || code != 409) {
+        return;
+    }
+    LOGI("SHADOW", "UPDATE_REJECTED: Version conflict (409). Requesting current shadow to re-sync.");
+    plant.reports.waitForSync(millis());
+    _scheduler.runWithin(_shadowReportTask, SHADOW_REPORT_TIMEOUT_MS);
+    if (!_mqtt.publish(plant.shadowGetTopic, "")) {
+        LOGW("SHADOW", "Failed to publish GET request after 409.");
+    }
+}
@@ -1,50 +1,165 @@
 #ifndef AppLogic_h
 #define AppLogic_h
 
+#include "ConnectivityManager.h"
+#include "DeviceControl.h"
+#include "DeviceState.h"
+#include "Metrics.h"
 #include "MQTTManager.h"
 #include "MoistureSensor.h" 
-#include "EmotionalServo.h"
+#include "Outbox.h"
+#include "ReconnectPolicy.h"
+#include "ReportCoordinator.h"
+#include "Scheduler.h"
+#include "TelemetryBatcher.h"
+#include "aws_iot_config.h"
 #include <ArduinoJson.h>
 
+enum ShadowTopic : uint8_t {
+    TOPIC_SHADOW_DELTA,
+    TOPIC_SHADOW_GET_ACCEPTED,
+    TOPIC_SHADOW_GET_REJECTED,
+    TOPIC_SHADOW_UPDATE_ACCEPTED,
+    TOPIC_SHADOW_UPDATE_REJECTED,
+    TOPIC_SHADOW_UPDATE_DOCUMENTS,
+    TOPIC_SHADOW_COUNT
+};
+
 class AppLogic {
   public:
-    AppLogic();
-    void setup();
+    // RUN_DUAL_CORE reparte red y control en dos tareas FreeRTOS; con
+    // RUN_SINGLE_LOOP ambos lados avanzan desde loop() con las mismas colas.
+    // RUN_DUTY_CYCLE es un solo bucle que mide al despertar, publica si hace
+    // falta y vuelve a deep sleep (ver DUTY_CYCLE_* en aws_iot_config.h).
+    enum RunMode : uint8_t {
+        RUN_SINGLE_LOOP,
+        RUN_DUAL_CORE,
+        RUN_DUTY_CYCLE
+    };
+
+    explicit AppLogic(const DeviceConfig& config = DEFAULT_DEVICE_CONFIG);
+    void setup(RunMode mode = RUN_DUAL_CORE);
     void loop();
 
   private:
+    DeviceConfig _config;
+    ConnectivityManager _net;
     MQTTManager _mqtt;
-    MoistureSensor _sensor;
-    EmotionalServo _servo;
+    DeviceControl _control;
+
+    // Topics en buffers fijos, formados una vez en setup().
+    static const size_t TOPIC_SIZE = MQTTManager::MAX_TOPIC_LENGTH + 1;
+
+    // Una maceta: su canal en DeviceControl y su shadow (el clásico o uno con
+    // nombre), con su versión, su estado y su reporte en vuelo. La conexión
+    // MQTT, el outbox y las métricas son comunes.
+    struct Plant {
+        uint8_t channel;
+        const char* name;
+        char shadowTopicPrefix[TOPIC_SIZE];
+        char shadowUpdateTopic[TOPIC_SIZE];
+        char shadowGetTopic[TOPIC_SIZE];
+        char telemetryTopic[TOPIC_SIZE];
+        unsigned long shadowVersion;
+        // Estado publicado en el shadow; los reportes solo llevan lo que cambió.
+        DeviceState state;
+        // Campos que lleva el reporte pendiente en el outbox. Un reporte nuevo
+        // sustituye al encolado, así que debe incluirlos también.
+        uint8_t queuedFields;
+        // Un reporte en vuelo; los cambios de mientras van en el siguiente,
+        // con la versión que confirme la respuesta.
+        ReportCoordinator reports;
+        unsigned long lastReportMillis;
+        // El shadow solo recibe el ángulo en el que el servo se detiene: los
+        // reportes de una orden se aplazan hasta entonces y se juntan.
+        Emotion targetEmotion;
+        bool settleReportPending;
+        uint8_t settleReportFields;
+        bool settleClearDesired;
+        TelemetryBatcher telemetry;
+        // Ciclo de trabajo: la nube confirmó el estado de esta maceta.
+        bool cycleSynced;
+
+        Plant();
+    };
+
+    Plant _plants[MAX_PLANTS];
+    uint8_t _plantCount;
+    char _metricsTopic[TOPIC_SIZE];
+    // Claves de los documentos del shadow que se usan; el resto (metadata,
+    // delta de get/accepted, campos desconocidos) se salta al parsear.
+    StaticJsonDocument<384> _shadowFilter;
+
+    // Reintentos de MQTT: espera exponencial con jitter y cortocircuito.
+    ReconnectPolicy _mqttRetry;
+    bool _mqttWasConnected;
+    const unsigned long _minRangeReportInterval = 10000;
+
+    unsigned long _firstReportMillis;
 
-    String _shadowUpdateTopic;
-    String _shadowDeltaTopic;
-    String _shadowGetTopic;
-    String _shadowGetAcceptedTopic;
-    String _shadowGetRejectedTopic;
-    String _shadowUpdateAcceptedTopic;
-    String _shadowUpdateRejectedTopic;
+    Outbox _outbox;
+    const unsigned long _outboxDrainInterval = 250;
+    // Tamaño máximo de un reporte de shadow serializado.
+    static const size_t REPORT_PAYLOAD_SIZE = 512;
 
-    unsigned long _lastTelemetryMillis;
-    unsigned long _lastReconnectAttempt;
-    const long _reconnectInterval = 5000;
+    Metrics _metrics;
 
-    unsigned long _currentShadowVersion;
-    HumidityRange _lastReportedHumidityRange;
-    String _lastProcessedEmotion; 
+    Scheduler _scheduler;
+    Scheduler::TaskId _netTask;
+    Scheduler::TaskId _mqttTask;
+    Scheduler::TaskId _reconnectTask;
+    Scheduler::TaskId _reportTask;
+    Scheduler::TaskId _outboxTask;
+    Scheduler::TaskId _fullReportTask;
+    Scheduler::TaskId _metricsTask;
+    Scheduler::TaskId _shadowReportTask;
+    const unsigned long _netInterval = 250;
+    const unsigned long _mqttServiceInterval = 1000;
+    const unsigned long _maxIdle = 1000;
+    RunMode _runMode;
 
-    bool _reportJustSentByCallback;
+    // Ciclo de trabajo: al conectar se pide el shadow salvo que la versión y
+    // lo reportado vengan de la memoria RTC; el ciclo acaba cuando la nube
+    // confirma el reporte de cada maceta y el outbox queda vacío.
+    bool _getOnConnect;
+    unsigned long _wakeMillis;
 
-    void connectWiFi();
-    void syncNTPTime();
     void setupAWSMQTT();
-    void generateShadowTopics();
-    void handleMQTTMessage(const String& topic, const String& payload);
-    void handleShadowDelta(JsonObjectConst deltaState);
-    void handleShadowGetAccepted(JsonObjectConst shadowState);
-    bool publishShadowReport();
-    void handleShadowUpdateAccepted(JsonObjectConst acceptedPayload);
-    void handleShadowUpdateRejected(JsonObjectConst rejectedPayload);
+    void setupTasks();
+    void updateNetwork();
+    void serviceMQTT();
+    void reconnectMQTT();
+    void runNetwork(unsigned long maxIdle);
+    bool restoreRetained();
+    bool dutyCycleNeedsNetwork(bool resumed);
+    bool cycleDone() const;
+    void enterDeepSleep();
+    static void networkTaskEntry(void* param);
+    void checkRangeReports();
+    void checkRangeReport(Plant& plant);
+    void drainOutbox();
+    void publishFullReport();
+    void publishMetrics();
+    void applyServoAngle(Plant& plant, int angle, Emotion emotion);
+    void applySampling(Plant& plant, const AdaptiveSampler::Policy& sampling);
+    void servoSettled(Plant& plant);
+    bool reportWhenSettled(Plant& plant, uint8_t touched, bool clearDesired);
+    void generateTopics();
+    void buildShadowFilter();
+    void handleMQTTMessage(uint8_t routeId, char* payload, size_t length);
+    static const char* shadowTopicName(uint8_t topicId);
+    uint8_t handleShadowDelta(Plant& plant, JsonObjectConst deltaState);
+    void handleShadowGetAccepted(Plant& plant, JsonObjectConst shadowState);
+    void buildShadowReport(const Plant& plant, JsonDocument& doc, uint8_t fields, bool includeVersion,
+                           bool clearDesired);
+    bool publishShadowReport(Plant& plant, uint8_t fields, bool clearDesired = false);
+    bool sendShadowReport(Plant& plant);
+    void serviceShadowReports();
+    bool queueShadowReport(Plant& plant);
+    void sampleTelemetry();
+    bool publishTelemetryBatch(Plant& plant);
+    void handleShadowUpdateAccepted(Plant& plant, JsonObjectConst acceptedPayload);
+    void handleShadowUpdateRejected(Plant& plant, JsonObjectConst rejectedPayload);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "ConnectivityManager.h"
+#include "Log.h"
+#include <time.h>
+
+ConnectivityManager::ConnectivityManager(const char* ssid, const char* passphrase)
+  : _ssid(ssid),
+    _passphrase(passphrase),
+    _state(WIFI_IDLE),
+    _stateSinceMillis(0),
+    _joinRetry(MIN_RETRY_DELAY_MS, MAX_RETRY_DELAY_MS),
+    _timeConfigured(false),
+    _linkLost(false),
+    _lastDisconnectReason(0),
+    _firstOnlineMillis(0),
+    _outageStartMillis(0),
+    _outages(0),
+    _lastOutageMillis(0),
+    _joinFailures(0) {}
+
+const char* ConnectivityManager::stateName(State state) {
+    switch (state) {
+        case WIFI_IDLE: return "WIFI_IDLE";
+        case WIFI_JOINING: return "WIFI_JOINING";
+        case TIME_SYNCING: return "TIME_SYNCING";
+        case ONLINE: return "ONLINE";
+        default: return "UNKNOWN";
+    }
+}
+
+void ConnectivityManager::begin() {
+    WiFi.mode(WIFI_STA);
+    // Los reintentos los lleva esta clase, con espera creciente y aleatoria.
+    WiFi.setAutoReconnect(false);
+    // Se ejecuta en la tarea de eventos de WiFi: solo se marcan banderas.
+    WiFi.onEvent([this](arduino_event_id_t, arduino_event_info_t info) {
+        _lastDisconnectReason = info.wifi_sta_disconnected.reason;
+        _linkLost = true;
+    }, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+    startJoin();
+}
+
+void ConnectivityManager::end() {
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_OFF);
+    _linkLost = false;
+    enter(WIFI_IDLE);
+}
+
+void ConnectivityManager::enter(State state) {
+    if (state == _state) return;
+    LOGI("NET", "%s -> %s", stateName(_state), stateName(state));
+    _state = state;
+    _stateSinceMillis = millis();
+}
+
+void ConnectivityManager::startJoin() {
+    LOGI("NET", "Connecting to WiFi...");
+    _joinRetry.attempt(millis());
+    _linkLost = false;
+    WiFi.begin(_ssid, _passphrase);
+    enter(WIFI_JOINING);
+}
+
+void ConnectivityManager::linkDown() {
+    unsigned long retryIn;
+    if (_state == TIME_SYNCING || _state == ONLINE) {
+        _outages++;
+        _outageStartMillis = millis();
+        LOGW("NET", "WiFi link lost (reason %u).", (unsigned int)_lastDisconnectReason);
+        retryIn = _joinRetry.lost(millis());
+    } else {
+        retryIn = _joinRetry.failure(millis());
+    }
+    WiFi.disconnect();
+    _linkLost = false;
+    LOGI("NET", "Retrying WiFi in %lu ms.", retryIn);
+    enter(WIFI_IDLE);
+}
+
+bool ConnectivityManager::timeValid() {
+    return time(nullptr) > 1000000000L;
+}
+
+void ConnectivityManager::update() {
+    unsigned long now = millis();
+
+    if (_state != WIFI_IDLE && _state != WIFI_JOINING) {
+        if (_linkLost || WiFi.status() != WL_CONNECTED) {
+            linkDown();
+            return;
+        }
+    }
+
+    switch (_state) {
+        case WIFI_IDLE:
+            if (_joinRetry.due(now)) {
+                startJoin();
+            }
+            break;
+
+        case WIFI_JOINING:
+            if (WiFi.status() == WL_CONNECTED) {
+                LOGI("NET", "WiFi connected, IP Address: %s", WiFi.localIP().toString().c_str());
+                _joinRetry.success();
+                if (!_timeConfigured) {
+                    // SNTP sigue activo después; basta con configurarlo una vez.
+                    configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+                    _timeConfigured = true;
+                }
+                enter(TIME_SYNCING);
+            } else if (now - _stateSinceMillis >= JOIN_TIMEOUT_MS) {
+                _joinFailures++;
+                LOGW("NET", "WiFi join timed out.");
+                linkDown();
+            }
+            break;
+
+        case TIME_SYNCING:
+            if (timeValid()) {
+                if (_firstOnlineMillis == 0) {
+                    _firstOnlineMillis = now > 0 ? now : 1;
+                    time_t epoch = time(nullptr);
+                    struct tm timeinfo;
+                    gmtime_r(&epoch, &timeinfo);
+                    char timeText[32];
+                    strftime(timeText, sizeof(timeText), "%Y-%m-%d %H:%M:%S", &timeinfo);
+                    LOGI("NET", "NTP time synchronized. Current UTC time: %s", timeText);
+                }
+                if (_outageStartMillis != 0) {
+                    _lastOutageMillis = now - _outageStartMillis;
+                    _outageStartMillis = 0;
+                    LOGI("NET", "Back online after %lu ms.", _lastOutageMillis);
+                }
+                enter(ONLINE);
+            } else if (now - _stateSinceMillis >= NTP_TIMEOUT_MS) {
+                LOGW("NET", "NTP sync timed out, retrying.");
+                configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+                _stateSinceMillis = now;
+            }
+            break;
+
+        case ONLINE:
+            break;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef ConnectivityManager_h
+#define ConnectivityManager_h
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "ReconnectPolicy.h"
+
+// Máquina de estados no bloqueante para WiFi y hora NTP. update() se llama en
+// cada loop() y nunca espera: solo mira el estado del enlace y del reloj y
+// decide el siguiente paso. Los eventos de WiFi solo marcan banderas para que
+// la caída se atienda en la siguiente vuelta sin esperar a un sondeo.
+class ConnectivityManager {
+  public:
+    enum State : uint8_t {
+        WIFI_IDLE,      // Sin enlace; se reintenta al acabar la espera
+        WIFI_JOINING,   // WiFi.begin() en curso
+        TIME_SYNCING,   // Enlace listo, esperando la hora NTP
+        ONLINE          // Enlace y hora listos: se puede abrir TLS
+    };
+
+    ConnectivityManager(const char* ssid, const char* passphrase);
+    void begin();
+    void update();
+    // Apaga la radio sin contarlo como caída (antes de un deep sleep).
+    void end();
+
+    State state() const { return _state; }
+    bool online() const { return _state == ONLINE; }
+    bool wifiConnected() const { return _state == TIME_SYNCING || _state == ONLINE; }
+    static const char* stateName(State state);
+
+    // Métricas: tiempo hasta el primer ONLINE y caídas de enlace.
+    unsigned long firstOnlineMillis() const { return _firstOnlineMillis; }
+    unsigned long outages() const { return _outages; }
+    unsigned long lastOutageMillis() const { return _lastOutageMillis; }
+    unsigned long joinFailures() const { return _joinFailures; }
+    const ReconnectPolicy& joinRetry() const { return _joinRetry; }
+
+  private:
+    const char* _ssid;
+    const char* _passphrase;
+    State _state;
+    unsigned long _stateSinceMillis;
+    ReconnectPolicy _joinRetry;
+    bool _timeConfigured;
+    volatile bool _linkLost;
+    volatile uint8_t _lastDisconnectReason;
+
+    unsigned long _firstOnlineMillis;
+    unsigned long _outageStartMillis;
+    unsigned long _outages;
+    unsigned long _lastOutageMillis;
+    unsigned long _joinFailures;
+
+    static const unsigned long JOIN_TIMEOUT_MS = 10000;
+    static const unsigned long NTP_TIMEOUT_MS = 10000;
+    static const unsigned long MIN_RETRY_DELAY_MS = 1000;
+    static const unsigned long MAX_RETRY_DELAY_MS = 30000;
+
+    void enter(State state);
+    void startJoin();
+    void linkDown();
+    static bool timeValid();
+};
+
+#endif
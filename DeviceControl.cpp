@@ -0,0 +1,267 @@
+#include "DeviceControl.h"
+#include "Log.h"
+
+DeviceControl::Channel::Channel(const PlantConfig& plant, int restAngle, const AdaptiveSampler::Policy& sampling)
+  : sensor(plant.soilMoisturePin, plant.soilDryValue, plant.soilWetValue),
+    servo(plant.servoPin, restAngle),
+    sampler(sampling),
+    appliedSequence(0),
+    notifiedSequence(0) {}
+
+DeviceControl::DeviceControl(const PlantConfig* plants, uint8_t count, int restAngle,
+                             const AdaptiveSampler::Policy& sampling)
+  : _channelCount(count > MAX_CHANNELS ? MAX_CHANNELS : count),
+    _sampleTask(Scheduler::INVALID_TASK),
+    _motionTask(Scheduler::INVALID_TASK),
+    _task(nullptr),
+    _stopRequested(false),
+    _taskRunning(false),
+    _droppedSamples(0),
+    _pendingScan{},
+    _scanPending(false),
+    _lastScan{},
+    _droppedCommands(0) {
+    _channels.reserve(_channelCount);
+    for (uint8_t i = 0; i < _channelCount; i++) {
+        _channels.emplace_back(plants[i], restAngle, sampling);
+        _servoAngle[i] = _channels[i].servo.getCurrentAngle();
+        _settledAngle[i] = _servoAngle[i];
+        _commandSequence[i] = 0;
+        _settledSequence[i] = 0;
+        _lastScan.samples[i].range = RANGE_UNKNOWN;
+        _lastScan.samples[i].active = false;
+    }
+}
+
+void DeviceControl::restore(uint8_t channel, HumidityRange range, int servoAngle) {
+    if (channel >= _channelCount) return;
+    _channels[channel].sensor.restoreRange(range);
+    _servoAngle[channel] = constrain(servoAngle, 0, 180);
+    _settledAngle[channel] = _servoAngle[channel];
+}
+
+void DeviceControl::begin() {
+    for (uint8_t i = 0; i < _channelCount; i++) {
+        Channel& channel = _channels[i];
+        channel.sensor.configure(SOIL_OVERSAMPLE, SOIL_EMA_TAU_MS, SOIL_HYSTERESIS_PERCENT);
+        channel.servo.configure(SERVO_MAX_SPEED_DPS, SERVO_ACCEL_DPS2, SERVO_DETACH_AFTER_MS);
+        // Neutral salvo que restore() haya dicho otra cosa.
+        channel.servo.attach(_servoAngle[i]);
+    }
+#if FLOR_ADC_CONTINUOUS
+    // El driver recorre todos los pines en cada bloque DMA y promedia
+    // SOIL_OVERSAMPLE conversiones por pin.
+    uint8_t pins[MAX_CHANNELS];
+    for (uint8_t i = 0; i < _channelCount; i++) pins[i] = (uint8_t)_channels[i].sensor.getPin();
+    analogContinuous(pins, _channelCount, SOIL_OVERSAMPLE, 20000, nullptr);
+    analogContinuousStart();
+#endif
+    _sampleTask = _scheduler.add([this]() { sampleSensors(); });
+    _motionTask = _scheduler.add([this]() { moveServos(); });
+    _scheduler.runIn(_sampleTask, 0);
+    // Cuenta el tiempo para soltar el PWM si no llega ninguna orden.
+    _scheduler.runIn(_motionTask, 0);
+}
+
+unsigned long DeviceControl::step() {
+    Command command;
+    while (_commands.pop(command)) {
+        applyCommand(command);
+    }
+    flushScan();
+    return _scheduler.run();
+}
+
+void DeviceControl::taskEntry(void* param) {
+    DeviceControl* self = static_cast<DeviceControl*>(param);
+    while (!self->_stopRequested.load()) {
+        unsigned long idle = self->step();
+        if (idle > MAX_IDLE_MS) idle = MAX_IDLE_MS;
+        // Una orden nueva despierta la tarea antes del plazo.
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(idle));
+    }
+    self->_taskRunning.store(false);
+    vTaskDelete(nullptr);
+}
+
+bool DeviceControl::startTask(BaseType_t core) {
+    _stopRequested.store(false);
+    _taskRunning.store(true);
+    if (xTaskCreatePinnedToCore(taskEntry, "control", 4096, this, 2, &_task, core) == pdPASS) return true;
+    _taskRunning.store(false);
+    _task = nullptr;
+    return false;
+}
+
+void DeviceControl::stopTask() {
+    if (_task == nullptr) return;
+    _stopRequested.store(true);
+    xTaskNotifyGive(_task);
+    // Hasta que salga del step() en curso nadie más puede tocar las colas.
+    while (_taskRunning.load()) vTaskDelay(1);
+    _task = nullptr;
+}
+
+// Un escaneo: todos los sensores seguidos y un solo mensaje hacia la red. El
+// siguiente va cuando lo pida el canal con la señal más movida. Con el ADC
+// continuo el DMA sigue convirtiendo; lo que se ahorra es leer y filtrar.
+void DeviceControl::sampleSensors() {
+    SensorScan scan;
+    scan.millis = millis();
+    unsigned long soonest = 0;
+#if FLOR_ADC_CONTINUOUS
+    adc_continuous_data_t* result = nullptr;
+    bool scanned = analogContinuousRead(&result, 0) && result != nullptr;
+#endif
+    for (uint8_t i = 0; i < _channelCount; i++) {
+        MoistureSensor& sensor = _channels[i].sensor;
+#if FLOR_ADC_CONTINUOUS
+        // Sin bloque nuevo el canal conserva su última lectura.
+        if (scanned) sensor.update(result[i].avg_read_raw);
+#else
+        sensor.update();
+#endif
+        AdaptiveSampler& sampler = _channels[i].sampler;
+        unsigned long next = sampler.update(scan.millis, sensor.getFilteredPercentage());
+        if (soonest == 0 || next < soonest) soonest = next;
+        SensorSample& sample = scan.samples[i];
+        sample.millis = scan.millis;
+        sample.rawValue = sensor.getRawValue();
+        sample.percentage = sensor.getPercentage();
+        sample.range = sensor.getCurrentRange();
+        sample.active = sampler.active();
+    }
+    _scheduler.runIn(_sampleTask, soonest);
+    // Con la red atrasada y la cola llena, el escaneo nuevo espera en
+    // _pendingScan (sustituyendo al que esperase) y step() lo entrega al
+    // vaciarse la cola: pollSamples() siempre acaba con la última lectura,
+    // también con el muestreo lento.
+    if (_scanPending) _droppedSamples++;
+    _pendingScan = scan;
+    _scanPending = true;
+    flushScan();
+}
+
+void DeviceControl::flushScan() {
+    if (_scanPending && _scans.push(_pendingScan)) _scanPending = false;
+}
+
+// Un paso del planificador de movimiento para todos los servos. Al quedar
+// quieto un servo avisa a la red del ángulo final, una vez por orden
+// aplicada. La tarea vuelve cuando lo pida el servo más urgente.
+void DeviceControl::moveServos() {
+    unsigned long soonest = 0;
+    for (uint8_t i = 0; i < _channelCount; i++) {
+        Channel& channel = _channels[i];
+        unsigned long next = channel.servo.update();
+        if (!channel.servo.moving() && channel.notifiedSequence != channel.appliedSequence) {
+            ServoSettled settled;
+            settled.channel = i;
+            settled.angle = channel.servo.getCurrentAngle();
+            settled.sequence = channel.appliedSequence;
+            if (_settled.push(settled)) {
+                channel.notifiedSequence = channel.appliedSequence;
+            } else if (next == 0 || next > EmotionalServo::FRAME_MS) {
+                next = EmotionalServo::FRAME_MS; // Cola llena: se reintenta.
+            }
+        }
+        if (next > 0 && (soonest == 0 || next < soonest)) soonest = next;
+    }
+    if (soonest > 0) _scheduler.runIn(_motionTask, soonest);
+}
+
+void DeviceControl::applyCommand(const Command& command) {
+    if (command.channel >= _channelCount) return;
+    switch (command.type) {
+        case Command::SET_ANGLE:
+            _channels[command.channel].servo.setAngle(command.angle);
+            _channels[command.channel].appliedSequence = command.sequence;
+            moveServos(); // Primera trama ya; el resto desde el planificador.
+            break;
+        case Command::SET_SAMPLING:
+            // Vuelve al ritmo rápido: el siguiente escaneo no espera al tope
+            // anterior.
+            _channels[command.channel].sampler.configure(command.sampling);
+            _scheduler.runWithin(_sampleTask, _channels[command.channel].sampler.interval());
+            break;
+    }
+}
+
+bool DeviceControl::pushCommand(const Command& command) {
+    if (_commands.push(command)) return true;
+    _droppedCommands++;
+    LOGW("CONTROL", "Command queue full, command dropped.");
+    return false;
+}
+
+void DeviceControl::wakeControl() {
+    if (_task) {
+        xTaskNotifyGive(_task);
+    } else {
+        // Sin tarea propia (un solo bucle) se aplica en el acto, como haría la
+        // tarea de control en el otro núcleo.
+        Command command;
+        while (_commands.pop(command)) applyCommand(command);
+    }
+}
+
+bool DeviceControl::setServoAngle(uint8_t channel, int angle) {
+    if (channel >= _channelCount) return false;
+    Command command;
+    command.type = Command::SET_ANGLE;
+    command.channel = channel;
+    command.angle = constrain(angle, 0, 180);
+    command.sequence = _commandSequence[channel] + 1;
+    if (!pushCommand(command)) return false;
+    // Copia local del ángulo: el servo aplica la misma restricción 0-180.
+    _servoAngle[channel] = command.angle;
+    _commandSequence[channel] = command.sequence;
+    wakeControl();
+    return true;
+}
+
+bool DeviceControl::setSamplingPolicy(uint8_t channel, const AdaptiveSampler::Policy& sampling) {
+    if (channel >= _channelCount) return false;
+    Command command;
+    command.type = Command::SET_SAMPLING;
+    command.channel = channel;
+    command.angle = 0;
+    command.sequence = 0;
+    command.sampling = sampling;
+    if (!pushCommand(command)) return false;
+    wakeControl();
+    return true;
+}
+
+bool DeviceControl::anyServoMoving() const {
+    for (uint8_t i = 0; i < _channelCount; i++) {
+        if (servoMoving(i)) return true;
+    }
+    return false;
+}
+
+bool DeviceControl::pollSamples() {
+    bool received = false;
+    SensorScan scan;
+    while (_scans.pop(scan)) {
+        _lastScan = scan;
+        received = true;
+    }
+    return received;
+}
+
+uint8_t DeviceControl::pollServo() {
+    uint8_t settled = 0;
+    ServoSettled update;
+    while (_settled.pop(update)) {
+        if (update.channel >= _channelCount) continue;
+        _settledAngle[update.channel] = update.angle;
+        _settledSequence[update.channel] = update.sequence;
+        if (servoMoving(update.channel)) {
+            settled &= ~(1 << update.channel);
+        } else {
+            settled |= 1 << update.channel;
+        }
+    }
+    return settled;
+}
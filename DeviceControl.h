@@ -0,0 +1,151 @@
+#ifndef DeviceControl_h
+#define DeviceControl_h
+
+#include <Arduino.h>
+#include <atomic>
+#include <vector>
+#include "AdaptiveSampler.h"
+#include "EmotionalServo.h"
+#include "MoistureSensor.h"
+#include "Scheduler.h"
+#include "SpscQueue.h"
+#include "aws_iot_config.h"
+
+// Sobremuestreo con el ADC continuo (DMA) de arduino-esp32 3.x en lugar de
+// una ráfaga de analogRead() por sensor: un solo escaneo recorre todos los
+// pines.
+#ifndef FLOR_ADC_CONTINUOUS
+#define FLOR_ADC_CONTINUOUS 0
+#endif
+
+// Lado de control: un canal (sensor y servo) por maceta con su propio
+// planificador, pensado para correr en su propia tarea y núcleo. La parte de
+// red solo habla con él a través de colas SPSC: órdenes hacia los servos y
+// el muestreo, y escaneos de los sensores y ángulos en los que un servo se
+// detuvo de vuelta. Los métodos están separados por el lado que puede
+// llamarlos.
+//
+// Cada canal lleva un AdaptiveSampler; el escaneo se repite al ritmo del
+// canal que más prisa tenga.
+class DeviceControl {
+  public:
+    static const uint8_t MAX_CHANNELS = MAX_PLANTS;
+
+    struct Command {
+        enum Type : uint8_t { SET_ANGLE, SET_SAMPLING };
+        Type type;
+        uint8_t channel;
+        int16_t angle;
+        uint16_t sequence;
+        AdaptiveSampler::Policy sampling;
+    };
+
+    // El servo del canal quedó quieto en `angle` tras aplicar la orden
+    // `sequence`.
+    struct ServoSettled {
+        uint8_t channel;
+        int16_t angle;
+        uint16_t sequence;
+    };
+
+    struct SensorSample {
+        uint32_t millis;
+        int16_t rawValue;
+        int8_t percentage;
+        HumidityRange range;
+        bool active;    // la humedad se está moviendo (muestreo rápido)
+    };
+
+    // Todos los canales medidos en una pasada.
+    struct SensorScan {
+        uint32_t millis;
+        SensorSample samples[MAX_CHANNELS];
+    };
+
+    DeviceControl(const PlantConfig* plants, uint8_t count, int restAngle, const AdaptiveSampler::Policy& sampling);
+
+    uint8_t channels() const { return _channelCount; }
+
+    // --- Tarea de control ---
+    // Antes de begin(), al despertar de un deep sleep: rango del sensor
+    // (histéresis) y posición en la que quedó el servo.
+    void restore(uint8_t channel, HumidityRange range, int servoAngle);
+    void begin();
+    // Aplica las órdenes pendientes y ejecuta lo vencido; devuelve los ms
+    // hasta el siguiente plazo.
+    unsigned long step();
+    // Arranca la tarea de control fijada a un núcleo (FreeRTOS).
+    bool startTask(BaseType_t core);
+    // Para la tarea y espera a que termine; después step() se puede llamar
+    // desde otro bucle. Se llama desde la tarea que la arrancó.
+    void stopTask();
+
+    // --- Tarea de red ---
+    bool setServoAngle(uint8_t channel, int angle);
+    bool setSamplingPolicy(uint8_t channel, const AdaptiveSampler::Policy& sampling);
+    // Último ángulo pedido.
+    int servoAngle(uint8_t channel) const { return _servoAngle[channel]; }
+    // Consume los avisos de los servos; devuelve una máscara (bit = canal)
+    // de los que acaban de quedar quietos en el último ángulo pedido.
+    uint8_t pollServo();
+    bool servoMoving(uint8_t channel) const { return _settledSequence[channel] != _commandSequence[channel]; }
+    bool anyServoMoving() const;
+    int settledServoAngle(uint8_t channel) const { return _settledAngle[channel]; }
+    bool hasServoUpdates() const { return !_settled.empty(); }
+    // Consume los escaneos recibidos; true si llegó alguno nuevo.
+    bool pollSamples();
+    bool hasSamples() const { return !_scans.empty(); }
+    const SensorSample& sample(uint8_t channel) const { return _lastScan.samples[channel]; }
+    unsigned long droppedCommands() const { return _droppedCommands; }
+
+  private:
+    struct Channel {
+        MoistureSensor sensor;
+        EmotionalServo servo;
+        AdaptiveSampler sampler;
+        uint16_t appliedSequence;
+        uint16_t notifiedSequence;
+
+        Channel(const PlantConfig& plant, int restAngle, const AdaptiveSampler::Policy& sampling);
+    };
+
+    uint8_t _channelCount;
+
+    // Lado de control
+    std::vector<Channel> _channels;
+    Scheduler _scheduler;
+    Scheduler::TaskId _sampleTask;
+    Scheduler::TaskId _motionTask;
+    TaskHandle_t _task;
+    std::atomic<bool> _stopRequested;
+    std::atomic<bool> _taskRunning;
+    unsigned long _droppedSamples;
+    // Escaneo que no cupo en _scans; se entrega en cuanto haya hueco.
+    SensorScan _pendingScan;
+    bool _scanPending;
+
+    // Compartido: solo las colas
+    SpscQueue<Command, 8> _commands;
+    SpscQueue<SensorScan, 4> _scans;
+    SpscQueue<ServoSettled, 8> _settled;
+
+    // Lado de red
+    int _servoAngle[MAX_CHANNELS];
+    int _settledAngle[MAX_CHANNELS];
+    uint16_t _commandSequence[MAX_CHANNELS];
+    uint16_t _settledSequence[MAX_CHANNELS];
+    SensorScan _lastScan;
+    unsigned long _droppedCommands;
+
+    static const unsigned long MAX_IDLE_MS = 1000;
+
+    void sampleSensors();
+    void flushScan();
+    void moveServos();
+    void applyCommand(const Command& command);
+    bool pushCommand(const Command& command);
+    void wakeControl();
+    static void taskEntry(void* param);
+};
+
+#endif
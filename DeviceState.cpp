@@ -0,0 +1,181 @@
+#include "DeviceState.h"
+#include "aws_iot_config.h"
+
+DeviceState::DeviceState() : _known(0), _dirty(FIELD_ALL) {
+    _current.rawMoisture = 0;
+    _current.moisturePercent = 0;
+    _current.humidityRange = RANGE_UNKNOWN;
+    _current.servoAngle = SERVO_NEUTRAL_ANGLE;
+    _current.emotion = EMOTION_NEUTRAL;
+    _current.sampling = DEFAULT_SAMPLING_POLICY;
+    _reported = _current;
+}
+
+void DeviceState::refresh(uint8_t fields) {
+    uint8_t differs = 0;
+    int percentDelta = abs(_current.moisturePercent - _reported.moisturePercent);
+    if (percentDelta >= MOISTURE_DEADBAND_PERCENT) differs |= FIELD_RAW_MOISTURE | FIELD_MOISTURE_PERCENT;
+    if (_current.humidityRange != _reported.humidityRange) differs |= FIELD_HUMIDITY_RANGE;
+    if (_current.servoAngle != _reported.servoAngle) differs |= FIELD_SERVO_ANGLE;
+    if (_current.emotion != _reported.emotion) differs |= FIELD_EMOTION;
+    if (_current.sampling != _reported.sampling) differs |= FIELD_SAMPLING;
+    differs |= FIELD_ALL & ~_known;
+    _dirty = (_dirty & ~fields) | (differs & fields);
+}
+
+void DeviceState::setMoisture(int rawValue, int percentage) {
+    _current.rawMoisture = rawValue;
+    _current.moisturePercent = percentage;
+    refresh(FIELD_RAW_MOISTURE | FIELD_MOISTURE_PERCENT);
+}
+
+void DeviceState::setHumidityRange(HumidityRange range) {
+    _current.humidityRange = range;
+    refresh(FIELD_HUMIDITY_RANGE);
+}
+
+void DeviceState::setServoAngle(int angle) {
+    _current.servoAngle = angle;
+    refresh(FIELD_SERVO_ANGLE);
+}
+
+void DeviceState::setEmotion(Emotion emotion) {
+    _current.emotion = emotion;
+    refresh(FIELD_EMOTION);
+}
+
+void DeviceState::setSampling(const AdaptiveSampler::Policy& sampling) {
+    _current.sampling = sampling;
+    refresh(FIELD_SAMPLING);
+}
+
+void DeviceState::markReported(uint8_t fields) {
+    if (fields & FIELD_RAW_MOISTURE) _reported.rawMoisture = _current.rawMoisture;
+    if (fields & FIELD_MOISTURE_PERCENT) _reported.moisturePercent = _current.moisturePercent;
+    if (fields & FIELD_HUMIDITY_RANGE) _reported.humidityRange = _current.humidityRange;
+    if (fields & FIELD_SERVO_ANGLE) _reported.servoAngle = _current.servoAngle;
+    if (fields & FIELD_EMOTION) _reported.emotion = _current.emotion;
+    if (fields & FIELD_SAMPLING) _reported.sampling = _current.sampling;
+    _known |= fields;
+    refresh(FIELD_ALL);
+}
+
+void DeviceState::markAllDirty() {
+    _known = 0;
+    refresh(FIELD_ALL);
+}
+
+void DeviceState::loadReported(JsonObjectConst reported) {
+    _known = 0;
+    if (reported.containsKey("rawSoilMoisture")) {
+        _reported.rawMoisture = reported["rawSoilMoisture"];
+        _known |= FIELD_RAW_MOISTURE;
+    }
+    if (reported.containsKey("soilMoisturePercent")) {
+        _reported.moisturePercent = reported["soilMoisturePercent"];
+        _known |= FIELD_MOISTURE_PERCENT;
+    }
+    HumidityRange range = MoistureSensor::stringToRange(reported["humidityRange"] | "");
+    if (range != RANGE_UNKNOWN) {
+        _reported.humidityRange = range;
+        _known |= FIELD_HUMIDITY_RANGE;
+    }
+    if (reported.containsKey("servoAngle")) {
+        _reported.servoAngle = reported["servoAngle"];
+        _known |= FIELD_SERVO_ANGLE;
+    }
+    const char* emotionValue = reported["emotion"] | "";
+    if (parseEmotion(emotionValue, _reported.emotion) || strcmp(emotionValue, "CUSTOM") == 0) {
+        if (strcmp(emotionValue, "CUSTOM") == 0) _reported.emotion = EMOTION_CUSTOM;
+        _known |= FIELD_EMOTION;
+    }
+    _reported.sampling = DEFAULT_SAMPLING_POLICY;
+    if (parseSampling(reported["sampling"].as<JsonObjectConst>(), _reported.sampling)) {
+        _known |= FIELD_SAMPLING;
+    }
+    refresh(FIELD_ALL);
+}
+
+void DeviceState::save(Snapshot& snapshot) const {
+    snapshot.reported = _reported;
+    snapshot.servoAngle = _current.servoAngle;
+    snapshot.emotion = _current.emotion;
+    snapshot.sampling = _current.sampling;
+    snapshot.known = _known;
+}
+
+void DeviceState::restore(const Snapshot& snapshot) {
+    _reported = snapshot.reported;
+    _current = snapshot.reported;
+    _current.servoAngle = snapshot.servoAngle;
+    _current.emotion = snapshot.emotion;
+    _current.sampling = snapshot.sampling;
+    _known = snapshot.known;
+    refresh(FIELD_ALL);
+}
+
+void DeviceState::writeReported(JsonObject reported, uint8_t fields) const {
+    if (fields & FIELD_RAW_MOISTURE) reported["rawSoilMoisture"] = _current.rawMoisture;
+    if (fields & FIELD_MOISTURE_PERCENT) reported["soilMoisturePercent"] = _current.moisturePercent;
+    if ((fields & FIELD_HUMIDITY_RANGE) && _current.humidityRange != RANGE_UNKNOWN) {
+        reported["humidityRange"] = MoistureSensor::rangeToString(_current.humidityRange);
+    }
+    if (fields & FIELD_SERVO_ANGLE) reported["servoAngle"] = _current.servoAngle;
+    if (fields & FIELD_EMOTION) reported["emotion"] = emotionName(_current.emotion);
+    if (fields & FIELD_SAMPLING) {
+        JsonObject sampling = reported.createNestedObject("sampling");
+        sampling["fastMs"] = _current.sampling.fastIntervalMs;
+        sampling["slowMs"] = _current.sampling.slowIntervalMs;
+        sampling["slope"] = _current.sampling.slopeThreshold;
+    }
+}
+
+const char* DeviceState::emotionName(Emotion emotion) {
+    switch (emotion) {
+        case EMOTION_HAPPY: return "FELIZ";
+        case EMOTION_SAD: return "TRISTE";
+        case EMOTION_NEUTRAL: return "NEUTRAL";
+        default: return "CUSTOM";
+    }
+}
+
+bool DeviceState::parseEmotion(const char* name, Emotion& emotion) {
+    if (name == nullptr) return false;
+    if (strcmp(name, "FELIZ") == 0) { emotion = EMOTION_HAPPY; return true; }
+    if (strcmp(name, "TRISTE") == 0) { emotion = EMOTION_SAD; return true; }
+    if (strcmp(name, "NEUTRAL") == 0) { emotion = EMOTION_NEUTRAL; return true; }
+    return false;
+}
+
+Emotion DeviceState::emotionForAngle(int angle, const ServoAngles& angles) {
+    if (angle == angles.happy) return EMOTION_HAPPY;
+    if (angle == angles.sad) return EMOTION_SAD;
+    if (angle == angles.neutral) return EMOTION_NEUTRAL;
+    return EMOTION_CUSTOM;
+}
+
+bool DeviceState::parseSampling(JsonObjectConst json, AdaptiveSampler::Policy& sampling) {
+    if (json.isNull()) return false;
+    bool found = false;
+    if (json.containsKey("fastMs")) {
+        sampling.fastIntervalMs = json["fastMs"].as<uint32_t>();
+        found = true;
+    }
+    if (json.containsKey("slowMs")) {
+        sampling.slowIntervalMs = json["slowMs"].as<uint32_t>();
+        found = true;
+    }
+    if (json.containsKey("slope")) {
+        sampling.slopeThreshold = json["slope"].as<float>();
+        found = true;
+    }
+    return found;
+}
+
+int DeviceState::angleForEmotion(Emotion emotion, const ServoAngles& angles) {
+    switch (emotion) {
+        case EMOTION_HAPPY: return angles.happy;
+        case EMOTION_SAD: return angles.sad;
+        default: return angles.neutral;
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef DeviceState_h
+#define DeviceState_h
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "AdaptiveSampler.h"
+#include "MoistureSensor.h"
+
+struct ServoAngles;
+
+enum Emotion : uint8_t {
+    EMOTION_NEUTRAL,
+    EMOTION_HAPPY,
+    EMOTION_SAD,
+    EMOTION_CUSTOM
+};
+
+// Estado del dispositivo tal como se publica en el shadow. Guarda el valor
+// actual de cada campo y el último que conoce la nube; un campo está "sucio"
+// cuando difieren, y los reportes solo llevan los campos sucios.
+class DeviceState {
+  public:
+    enum Field : uint8_t {
+        FIELD_RAW_MOISTURE = 1 << 0,
+        FIELD_MOISTURE_PERCENT = 1 << 1,
+        FIELD_HUMIDITY_RANGE = 1 << 2,
+        FIELD_SERVO_ANGLE = 1 << 3,
+        FIELD_EMOTION = 1 << 4,
+        FIELD_SAMPLING = 1 << 5,
+        FIELD_ALL = 0x3F
+    };
+
+    // La humedad cruda y el porcentaje solo se reportan si el porcentaje se
+    // mueve al menos esto desde el último reporte.
+    static const uint8_t MOISTURE_DEADBAND_PERCENT = 5;
+
+  private:
+    struct Values {
+        int rawMoisture;
+        int moisturePercent;
+        HumidityRange humidityRange;
+        int servoAngle;
+        Emotion emotion;
+        AdaptiveSampler::Policy sampling;
+    };
+
+  public:
+    // Lo que conoce la nube más el servo, la emoción y el muestreo actuales,
+    // para guardarlo en memoria RTC durante el deep sleep.
+    struct Snapshot {
+        Values reported;
+        int servoAngle;
+        Emotion emotion;
+        AdaptiveSampler::Policy sampling;
+        uint8_t known;
+    };
+
+    DeviceState();
+
+    void setMoisture(int rawValue, int percentage);
+    void setHumidityRange(HumidityRange range);
+    void setServoAngle(int angle);
+    void setEmotion(Emotion emotion);
+    void setSampling(const AdaptiveSampler::Policy& sampling);
+
+    int rawMoisture() const { return _current.rawMoisture; }
+    int moisturePercent() const { return _current.moisturePercent; }
+    HumidityRange humidityRange() const { return _current.humidityRange; }
+    int servoAngle() const { return _current.servoAngle; }
+    Emotion emotion() const { return _current.emotion; }
+    const AdaptiveSampler::Policy& sampling() const { return _current.sampling; }
+    HumidityRange reportedHumidityRange() const { return _reported.humidityRange; }
+
+    uint8_t dirty() const { return _dirty; }
+    bool isDirty(Field field) const { return (_dirty & field) != 0; }
+    // Los campos indicados ya están en la nube con el valor actual.
+    void markReported(uint8_t fields);
+    // Fuerza el siguiente reporte completo (reconciliación).
+    void markAllDirty();
+    // Toma como "conocido por la nube" lo que trae state.reported de un GET;
+    // lo que falte queda sucio.
+    void loadReported(JsonObjectConst reported);
+    void save(Snapshot& snapshot) const;
+    // La humedad actual queda igual a la reportada hasta la siguiente
+    // muestra, así solo lo que cambie al medir queda sucio.
+    void restore(const Snapshot& snapshot);
+
+    void writeReported(JsonObject reported, uint8_t fields) const;
+
+    static const char* emotionName(Emotion emotion);
+    static bool parseEmotion(const char* name, Emotion& emotion);
+    // Los ángulos de cada emoción son los de la unidad (DeviceConfig).
+    static Emotion emotionForAngle(int angle, const ServoAngles& angles);
+    static int angleForEmotion(Emotion emotion, const ServoAngles& angles);
+    // Lee sampling de desired o reported sobre `sampling`: las claves que
+    // falten conservan su valor. Devuelve false si no trae ninguna.
+    static bool parseSampling(JsonObjectConst json, AdaptiveSampler::Policy& sampling);
+
+  private:
+    Values _current;
+    Values _reported;
+    uint8_t _known;   // campos cuyo valor en la nube conocemos
+    uint8_t _dirty;
+
+    void refresh(uint8_t fields);
+};
+
+#endif
@@ -1,35 +1,122 @@
 #include "EmotionalServo.h"
-#include "aws_iot_config.h" 
+#include "Log.h"
 #include <Arduino.h>
 
-EmotionalServo::EmotionalServo(int pin) : _pin(pin), _currentAngle(SERVO_NEUTRAL_ANGLE) {
+EmotionalServo::EmotionalServo(int pin, int restAngle)
+  : _pin(pin),
+    _currentAngle(constrain(restAngle, 0, 180)),
+    _targetAngle(_currentAngle),
+    _position(_currentAngle),
+    _velocity(0),
+    _maxSpeed(0),
+    _acceleration(0),
+    _detachAfterMs(0),
+    _attached(false),
+    _moving(false),
+    _lastStepMillis(0),
+    _settledMillis(0) {
 
 }
 
-void EmotionalServo::attach() {
-    _servo.attach(_pin);
-    setAngle(_currentAngle); 
+void EmotionalServo::configure(float maxSpeed, float acceleration, unsigned long detachAfterMs) {
+    _maxSpeed = maxSpeed > 0 ? maxSpeed : 0;
+    _acceleration = acceleration > 0 ? acceleration : 0;
+    _detachAfterMs = detachAfterMs;
 }
 
-void EmotionalServo::setHappy() {
-  setAngle(SERVO_HAPPY_ANGLE);
+// La posición de arranque se escribe sin movimiento: no se sabe dónde está
+// el eje, así que no hay desde dónde interpolar.
+void EmotionalServo::attach(int angle) {
+    _currentAngle = constrain(angle, 0, 180);
+    _targetAngle = _currentAngle;
+    _position = _currentAngle;
+    _velocity = 0;
+    _servo.attach(_pin);
+    _attached = true;
+    _servo.write(_currentAngle);
+    settle();
+    LOGD("SERVO", "Attached at %d", _currentAngle);
 }
 
-void EmotionalServo::setSad() {
-  setAngle(SERVO_SAD_ANGLE);
+void EmotionalServo::setAngle(int angle) {
+  _targetAngle = constrain(angle, 0, 180);
+  if (_targetAngle == _currentAngle && !_moving) return;
+  if (!_moving) {
+      // La primera trama ya avanza: el servo arranca en cuanto se llama a update().
+      _moving = true;
+      _lastStepMillis = millis() - FRAME_MS;
+  }
+  LOGD("SERVO", "Target %d (at %d)", _targetAngle, _currentAngle);
 }
 
-void EmotionalServo::setNeutral() {
-  setAngle(SERVO_NEUTRAL_ANGLE);
+unsigned long EmotionalServo::update() {
+  unsigned long now = millis();
+  if (!_moving) {
+      if (!_attached || _detachAfterMs == 0) return 0;
+      unsigned long idle = now - _settledMillis;
+      if (idle < _detachAfterMs) return _detachAfterMs - idle;
+      _servo.detach();
+      _attached = false;
+      LOGD("SERVO", "Detached at %d", _currentAngle);
+      return 0;
+  }
+
+  float dt = (now - _lastStepMillis) / 1000.0f;
+  _lastStepMillis = now;
+  float error = _targetAngle - _position;
+  float distance = fabsf(error);
+  float direction = error >= 0 ? 1.0f : -1.0f;
+  // Velocidad hacia el objetivo; negativa si el objetivo cambió de lado.
+  float speed = _velocity * direction;
+
+  if (_maxSpeed == 0) {
+      _position = _targetAngle;
+  } else {
+      if (_acceleration == 0) {
+          speed = _maxSpeed;
+      } else if (speed > 0 && speed * speed / (2 * _acceleration) >= distance) {
+          // Frenada; nunca por debajo de un paso de aceleración, así llega.
+          speed = fmaxf(speed - _acceleration * dt, _acceleration * dt);
+      } else {
+          speed = fminf(speed + _acceleration * dt, _maxSpeed);
+      }
+      float step = speed * dt;
+      if (speed > 0 && step >= distance) {
+          _position = _targetAngle;
+      } else {
+          _position += direction * step;
+          _velocity = direction * speed;
+      }
+  }
+
+  write((int)lroundf(_position));
+  if (_position == _targetAngle) {
+      settle();
+      LOGD("SERVO", "Settled at %d", _currentAngle);
+      return _attached && _detachAfterMs > 0 ? _detachAfterMs : 0;
+  }
+  return FRAME_MS;
 }
 
-void EmotionalServo::setAngle(int angle) {
-  _currentAngle = constrain(angle, 0, 180);
+void EmotionalServo::write(int angle) {
+  if (!_attached) {
+      // attach() arranca el PWM en el pulso por defecto de la librería (unos
+      // 90°): se fija enseguida el ángulo que el servo estaba aguantando.
+      _servo.attach(_pin);
+      _attached = true;
+      _servo.write(_currentAngle);
+  }
+  if (angle == _currentAngle) return;
+  _currentAngle = angle;
   _servo.write(_currentAngle);
-  Serial.print("Servo angle set to: ");
-  Serial.println(_currentAngle);
+}
+
+void EmotionalServo::settle() {
+  _moving = false;
+  _velocity = 0;
+  _settledMillis = millis();
 }
 
 int EmotionalServo::getCurrentAngle() const {
   return _currentAngle;
-}
\ No newline at end of file
+}
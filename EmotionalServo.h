@@ -3,20 +3,48 @@
 
 #include <ESP32Servo.h>
 
+// Servo con planificador de movimiento: setAngle() solo fija el objetivo y
+// update(), llamado desde el planificador, avanza un paso por trama PWM con
+// un perfil trapezoidal (acelera hasta la velocidad máxima y frena a tiempo
+// de parar en el objetivo). Quieto durante detachAfterMs suelta el PWM: el
+// engranaje aguanta la posición y el servo deja de consumir y vibrar.
 class EmotionalServo {
   public:
-    EmotionalServo(int pin);
-    void attach(); 
-    void setHappy();
-    void setSad();
-    void setNeutral();
+    // Un paso por periodo de la señal del servo (50 Hz).
+    static const unsigned long FRAME_MS = 20;
+
+    // restAngle: posición hasta el primer attach() (neutral).
+    EmotionalServo(int pin, int restAngle);
+    // Grados/s y grados/s²; maxSpeed 0 salta directo al objetivo y
+    // acceleration 0 mueve a velocidad constante. detachAfterMs 0 no suelta.
+    void configure(float maxSpeed, float acceleration, unsigned long detachAfterMs);
+    void attach(int angle);
     void setAngle(int angle);
+    // Avanza el movimiento; devuelve los ms hasta la siguiente llamada, o 0
+    // si no queda nada pendiente (quieto y sin PWM).
+    unsigned long update();
+    bool moving() const { return _moving; }
+    bool attached() const { return _attached; }
     int getCurrentAngle() const;
-    
+    int getTargetAngle() const { return _targetAngle; }
+
   private:
     Servo _servo;
     int _pin;
     int _currentAngle;
+    int _targetAngle;
+    float _position;
+    float _velocity;  // grados/s, con signo
+    float _maxSpeed;
+    float _acceleration;
+    unsigned long _detachAfterMs;
+    bool _attached;
+    bool _moving;
+    unsigned long _lastStepMillis;
+    unsigned long _settledMillis;
+
+    void write(int angle);
+    void settle();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,199 @@
+#include "EspTlsClient.h"
+
+#if FLOR_TLS_SESSION_RESUMPTION
+
+#include <string.h>
+
+EspTlsClient::EspTlsClient()
+    : _tls(nullptr),
+      _session(nullptr),
+      _caCert(),
+      _clientCert(),
+      _privateKey(),
+      _handshakeTimeoutMs(10000),
+      _lastError(0),
+      _tcpMillis(0),
+      _tlsMillis(0),
+      _sessionOffered(false),
+      _rxPos(0),
+      _rxLen(0) {}
+
+EspTlsClient::~EspTlsClient() {
+    stop();
+    clearSession();
+}
+
+void EspTlsClient::setCredentials(const TlsCredentials& credentials) {
+    _caCert = credentials.rootCa;
+    _clientCert = credentials.certificate;
+    _privateKey = credentials.privateKey;
+}
+
+void EspTlsClient::clearSession() {
+    if (_session != nullptr) {
+        esp_tls_free_client_session(_session);
+        _session = nullptr;
+    }
+}
+
+int EspTlsClient::lastError(char* buf, const size_t size) {
+    if (buf != nullptr && size > 0) {
+        snprintf(buf, size, _lastError ? "esp-tls error %d" : "no error", _lastError);
+    }
+    return _lastError;
+}
+
+int EspTlsClient::connect(IPAddress ip, uint16_t port) {
+    // Sin nombre no hay SNI ni se puede validar el certificado del servidor.
+    return connect(ip.toString().c_str(), port);
+}
+
+// Conexión asíncrona sondeada: así se separa el tiempo de TCP (hasta que
+// esp-tls pasa a ESP_TLS_HANDSHAKE) del de TLS.
+int EspTlsClient::connect(const char* host, uint16_t port) {
+    stop();
+    _tls = esp_tls_init();
+    if (_tls == nullptr) {
+        _lastError = ESP_FAIL;
+        return 0;
+    }
+
+    esp_tls_cfg_t cfg = {};
+    // PEM con el terminador incluido o DER: mbedtls distingue por el
+    // contenido, así que basta con la longitud exacta.
+    if (!_caCert.empty()) {
+        cfg.cacert_buf = (const unsigned char*)_caCert.data;
+        cfg.cacert_bytes = _caCert.length;
+    }
+    if (!_clientCert.empty() && !_privateKey.empty()) {
+        cfg.clientcert_buf = (const unsigned char*)_clientCert.data;
+        cfg.clientcert_bytes = _clientCert.length;
+        cfg.clientkey_buf = (const unsigned char*)_privateKey.data;
+        cfg.clientkey_bytes = _privateKey.length;
+    }
+    cfg.non_block = true;
+    cfg.timeout_ms = (int)_handshakeTimeoutMs;
+    cfg.client_session = _session;
+    _sessionOffered = _session != nullptr;
+
+    unsigned long start = millis();
+    unsigned long tcpDone = 0;
+    int ret;
+    while ((ret = esp_tls_conn_new_async(host, strlen(host), port, &cfg, _tls)) == 0) {
+        esp_tls_conn_state_t state;
+        if (tcpDone == 0 && esp_tls_get_conn_state(_tls, &state) == ESP_OK && state == ESP_TLS_HANDSHAKE) {
+            tcpDone = millis();
+        }
+        if (millis() - start >= _handshakeTimeoutMs) {
+            ret = -1;
+            break;
+        }
+        delay(1);
+    }
+    unsigned long end = millis();
+    bool reachedHandshake = tcpDone != 0;
+    if (!reachedHandshake) tcpDone = start;
+    _tcpMillis = tcpDone - start;
+    _tlsMillis = end - tcpDone;
+
+    if (ret != 1) {
+        _lastError = ret;
+        stop();
+        // Una sesión que el servidor ya no acepta no debe bloquear el
+        // siguiente intento; si ni siquiera conectó TCP se conserva.
+        if (reachedHandshake) clearSession();
+        return 0;
+    }
+    _lastError = 0;
+    clearSession();
+    _session = esp_tls_get_client_session(_tls);
+    return 1;
+}
+
+size_t EspTlsClient::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t EspTlsClient::write(const uint8_t* buf, size_t size) {
+    if (_tls == nullptr) return 0;
+    size_t written = 0;
+    unsigned long start = millis();
+    while (written < size) {
+        ssize_t ret = esp_tls_conn_write(_tls, buf + written, size - written);
+        if (ret > 0) {
+            written += ret;
+        } else if (ret == ESP_TLS_ERR_SSL_WANT_READ || ret == ESP_TLS_ERR_SSL_WANT_WRITE) {
+            if (millis() - start >= _handshakeTimeoutMs) break;
+            delay(1);
+        } else {
+            _lastError = (int)ret;
+            stop();
+            break;
+        }
+    }
+    return written;
+}
+
+bool EspTlsClient::fill() {
+    if (_rxPos < _rxLen) return true;
+    if (_tls == nullptr) return false;
+    ssize_t ret = esp_tls_conn_read(_tls, _rx, sizeof(_rx));
+    if (ret > 0) {
+        _rxPos = 0;
+        _rxLen = ret;
+        return true;
+    }
+    if (ret != ESP_TLS_ERR_SSL_WANT_READ && ret != ESP_TLS_ERR_SSL_WANT_WRITE) {
+        // 0: el servidor cerró; negativo: error de TLS o del socket.
+        _lastError = (int)ret;
+        stop();
+    }
+    return false;
+}
+
+int EspTlsClient::available() {
+    if (!fill()) return 0;
+    ssize_t pending = esp_tls_get_bytes_avail(_tls);
+    return (int)(_rxLen - _rxPos) + (pending > 0 ? (int)pending : 0);
+}
+
+int EspTlsClient::read() {
+    if (!fill()) return -1;
+    return _rx[_rxPos++];
+}
+
+int EspTlsClient::read(uint8_t* buf, size_t size) {
+    size_t count = 0;
+    while (count < size && fill()) {
+        size_t chunk = _rxLen - _rxPos;
+        if (chunk > size - count) chunk = size - count;
+        memcpy(buf + count, _rx + _rxPos, chunk);
+        _rxPos += chunk;
+        count += chunk;
+    }
+    return count > 0 ? (int)count : -1;
+}
+
+int EspTlsClient::peek() {
+    if (!fill()) return -1;
+    return _rx[_rxPos];
+}
+
+void EspTlsClient::stop() {
+    if (_tls != nullptr) {
+        esp_tls_conn_destroy(_tls);
+        _tls = nullptr;
+    }
+    _rxPos = 0;
+    _rxLen = 0;
+}
+
+uint8_t EspTlsClient::connected() {
+    if (_tls == nullptr) return 0;
+    if (_rxPos < _rxLen) return 1;
+    // Un read sin datos devuelve WANT_READ; 0 o un error indican cierre.
+    fill();
+    return _tls != nullptr ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef EspTlsClient_h
+#define EspTlsClient_h
+
+#include <Arduino.h>
+#include <Client.h>
+#include "TlsCredentials.h"
+
+// Reanudación de sesión TLS: necesita que esp-tls se haya compilado con
+// CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS. Sin ella MQTTManager usa
+// WiFiClientSecure y cada conexión hace el handshake completo.
+#ifndef FLOR_TLS_SESSION_RESUMPTION
+#if defined(CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS) && CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+#define FLOR_TLS_SESSION_RESUMPTION 1
+#else
+#define FLOR_TLS_SESSION_RESUMPTION 0
+#endif
+#endif
+
+#if FLOR_TLS_SESSION_RESUMPTION
+
+#include <esp_tls.h>
+
+// Client de Arduino sobre esp-tls que guarda la sesión de la última conexión
+// (en RAM) y la ofrece en la siguiente: tras un corte de WiFi el servidor
+// reanuda la sesión y se evita la criptografía de clave pública del
+// handshake mutuo completo. Mismos setters que WiFiClientSecure (PEM) y
+// setCredentials(), que acepta también DER.
+class EspTlsClient : public Client {
+  public:
+    EspTlsClient();
+    ~EspTlsClient() override;
+
+    void setCACert(const char* rootCA) { _caCert = pem(rootCA); }
+    void setCertificate(const char* clientCert) { _clientCert = pem(clientCert); }
+    void setPrivateKey(const char* privateKey) { _privateKey = pem(privateKey); }
+    // Los buffers deben vivir mientras se use el cliente.
+    void setCredentials(const TlsCredentials& credentials);
+    void setHandshakeTimeout(unsigned long seconds) { _handshakeTimeoutMs = seconds * 1000; }
+    int lastError(char* buf, const size_t size);
+    // Olvida la sesión guardada; la siguiente conexión hará handshake completo.
+    void clearSession();
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override {}
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return connected(); }
+
+    using Print::write;
+
+    // Fases de la última conexión. sessionOffered() indica que se ofreció una
+    // sesión guardada; si el servidor la aceptó se nota en tlsMillis().
+    unsigned long tcpMillis() const { return _tcpMillis; }
+    unsigned long tlsMillis() const { return _tlsMillis; }
+    bool sessionOffered() const { return _sessionOffered; }
+
+  private:
+    static const size_t RX_BUFFER_SIZE = 256;
+
+    esp_tls_t* _tls;
+    esp_tls_client_session_t* _session;
+    TlsCredential _caCert;
+    TlsCredential _clientCert;
+    TlsCredential _privateKey;
+    unsigned long _handshakeTimeoutMs;
+    int _lastError;
+    unsigned long _tcpMillis;
+    unsigned long _tlsMillis;
+    bool _sessionOffered;
+
+    // esp_tls_conn_read descifra registros enteros; lo que sobra de una
+    // lectura queda aquí para available()/peek().
+    uint8_t _rx[RX_BUFFER_SIZE];
+    size_t _rxPos;
+    size_t _rxLen;
+
+    bool fill();
+    static TlsCredential pem(const char* text) { return {text, text != nullptr ? strlen(text) + 1 : 0}; }
+};
+
+#endif
+
+#endif
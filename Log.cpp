@@ -0,0 +1,115 @@
+#include "Log.h"
+#include <stdarg.h>
+#include <string.h>
+
+// Con la FIFO de 128 bytes a 115200 baudios se vacía en ~11 ms; la tarea
+// vuelve antes de que se quede sin datos.
+static const TickType_t DRAIN_PERIOD_TICKS = pdMS_TO_TICKS(5);
+static const char LEVEL_CHARS[] = "-EWID";
+
+Print* Log::_out = nullptr;
+uint8_t Log::_level = FLOR_LOG_LEVEL;
+char Log::_buffer[Log::BUFFER_SIZE];
+size_t Log::_head = 0;
+size_t Log::_size = 0;
+unsigned long Log::_dropped = 0;
+unsigned long Log::_droppedUnreported = 0;
+std::mutex Log::_mutex;
+TaskHandle_t Log::_task = nullptr;
+
+void Log::begin(Print& out) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _out = &out;
+}
+
+void Log::write(uint8_t level, const char* tag, const char* format, ...) {
+    if (level > _level || level == FLOR_LOG_NONE) return;
+
+    char line[LINE_SIZE];
+    int prefix = snprintf(line, sizeof(line), "%lu %c %s: ", millis(), LEVEL_CHARS[level], tag);
+    if (prefix < 0) return;
+    va_list args;
+    va_start(args, format);
+    int body = vsnprintf(line + prefix, sizeof(line) - prefix, format, args);
+    va_end(args);
+    // Las líneas largas (payloads) se cortan; siempre queda sitio para '\n'.
+    size_t length = prefix + (body > 0 ? body : 0);
+    if (length > sizeof(line) - 1) length = sizeof(line) - 1;
+    line[length++] = '\n';
+
+    bool wasEmpty;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        wasEmpty = _size == 0;
+        if (_droppedUnreported > 0) {
+            char note[48];
+            int noteLength = snprintf(note, sizeof(note), "%lu W LOG: %lu line(s) dropped\n",
+                                      millis(), _droppedUnreported);
+            if (push(note, noteLength)) _droppedUnreported = 0;
+        }
+        if (!push(line, length)) {
+            _dropped++;
+            _droppedUnreported++;
+        }
+    }
+    if (_task != nullptr && wasEmpty) xTaskNotifyGive(_task);
+}
+
+bool Log::push(const char* line, size_t length) {
+    if (length > BUFFER_SIZE - _size) return false;
+    size_t tail = (_head + _size) % BUFFER_SIZE;
+    size_t first = BUFFER_SIZE - tail < length ? BUFFER_SIZE - tail : length;
+    memcpy(_buffer + tail, line, first);
+    memcpy(_buffer, line + first, length - first);
+    _size += length;
+    return true;
+}
+
+size_t Log::drainLocked(size_t limit) {
+    while (limit > 0 && _size > 0) {
+        size_t chunk = BUFFER_SIZE - _head;
+        if (chunk > _size) chunk = _size;
+        if (chunk > limit) chunk = limit;
+        _out->write((const uint8_t*)_buffer + _head, chunk);
+        _head = (_head + chunk) % BUFFER_SIZE;
+        _size -= chunk;
+        limit -= chunk;
+    }
+    return _size;
+}
+
+size_t Log::drain() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_out == nullptr || _size == 0) return _size;
+    int room = _out->availableForWrite();
+    if (room <= 0) return _size;
+    return drainLocked(room);
+}
+
+void Log::flush() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_out == nullptr) return;
+    drainLocked(_size);
+    _out->flush();
+}
+
+size_t Log::pending() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _size;
+}
+
+bool Log::startTask(int core) {
+    if (_task != nullptr) return true;
+    // Prioridad baja: el log nunca debe quitarle tiempo al control.
+    return xTaskCreatePinnedToCore(taskEntry, "log", 2048, nullptr, 1, &_task, core) == pdPASS;
+}
+
+void Log::taskEntry(void*) {
+    for (;;) {
+        if (drain() == 0) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        } else {
+            vTaskDelay(DRAIN_PERIOD_TICKS);
+        }
+    }
+}
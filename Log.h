@@ -0,0 +1,92 @@
+#ifndef Log_h
+#define Log_h
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <mutex>
+
+// Niveles de log. FLOR_LOG_LEVEL fija en compilación el nivel más detallado
+// que se incluye; las llamadas por encima de él desaparecen del binario (ni
+// se formatean ni se evalúan sus argumentos).
+#define FLOR_LOG_NONE 0
+#define FLOR_LOG_ERROR 1
+#define FLOR_LOG_WARN 2
+#define FLOR_LOG_INFO 3
+#define FLOR_LOG_DEBUG 4
+
+#ifndef FLOR_LOG_LEVEL
+#define FLOR_LOG_LEVEL FLOR_LOG_INFO
+#endif
+
+#if FLOR_LOG_LEVEL >= FLOR_LOG_ERROR
+#define LOGE(tag, ...) Log::write(FLOR_LOG_ERROR, tag, __VA_ARGS__)
+#else
+#define LOGE(tag, ...) do {} while (0)
+#endif
+
+#if FLOR_LOG_LEVEL >= FLOR_LOG_WARN
+#define LOGW(tag, ...) Log::write(FLOR_LOG_WARN, tag, __VA_ARGS__)
+#else
+#define LOGW(tag, ...) do {} while (0)
+#endif
+
+#if FLOR_LOG_LEVEL >= FLOR_LOG_INFO
+#define LOGI(tag, ...) Log::write(FLOR_LOG_INFO, tag, __VA_ARGS__)
+#else
+#define LOGI(tag, ...) do {} while (0)
+#endif
+
+#if FLOR_LOG_LEVEL >= FLOR_LOG_DEBUG
+#define LOGD(tag, ...) Log::write(FLOR_LOG_DEBUG, tag, __VA_ARGS__)
+#else
+#define LOGD(tag, ...) do {} while (0)
+#endif
+
+// Log con etiqueta por módulo. write() formatea la línea en la pila y la
+// copia a un buffer circular; nunca espera a la UART. drain() pasa a la
+// salida solo lo que cabe en la FIFO de transmisión, desde una tarea de baja
+// prioridad (startTask) o desde el bucle principal. Si el buffer se llena se
+// descartan líneas enteras y se avisa de cuántas al vaciarse.
+class Log {
+  public:
+    static const size_t BUFFER_SIZE = 2048;
+    static const size_t LINE_SIZE = 160;
+
+    static void begin(Print& out);
+    // Nivel en tiempo de ejecución, limitado por FLOR_LOG_LEVEL.
+    static void setLevel(uint8_t level) { _level = level; }
+    static uint8_t level() { return _level; }
+
+    static void write(uint8_t level, const char* tag, const char* format, ...)
+        __attribute__((format(printf, 3, 4)));
+
+    // Escribe sin bloquear lo que admite la salida; devuelve lo que queda.
+    static size_t drain();
+    // Escribe todo lo pendiente esperando a la salida (antes de reiniciar o
+    // dormir).
+    static void flush();
+    // Tarea que vacía el buffer en segundo plano; sin ella hay que llamar a
+    // drain() desde el bucle.
+    static bool startTask(int core);
+
+    static size_t pending();
+    static unsigned long dropped() { return _dropped; }
+
+  private:
+    static Print* _out;
+    static uint8_t _level;
+    static char _buffer[BUFFER_SIZE];
+    static size_t _head;
+    static size_t _size;
+    static unsigned long _dropped;
+    static unsigned long _droppedUnreported;
+    static std::mutex _mutex;
+    static TaskHandle_t _task;
+
+    static bool push(const char* line, size_t length);
+    static size_t drainLocked(size_t limit);
+    static void taskEntry(void* param);
+};
+
+#endif
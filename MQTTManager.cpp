@@ -1,106 +1,349 @@
 #include "MQTTManager.h"
+#include "Log.h"
 #include <Arduino.h>
 
-MQTTManager::MQTTManager(const char* mqttServer, int mqttPort, const char* clientId)
-  : _mqttServer(mqttServer), _mqttPort(mqttPort), _clientId(clientId) {
-    
-    _mqttClient.setClient(_wifiClientSecure);
+MQTTManager::MQTTManager(const char* mqttServer, int mqttPort, const char* clientId, uint16_t bufferSize)
+  : _mqttServer(mqttServer), _mqttPort(mqttPort), _clientId(clientId),
+    _ackClient(_tlsClient),
+    _metrics(nullptr), _connectTiming(), _connects(0), _resumedConnects(0),
+    _inFlightCount(0), _window(1), _ackTimeoutMs(5000), _maxAttempts(3), _nextPacketId(0) {
+
+    for (uint8_t i = 0; i < MAX_IN_FLIGHT; i++) _inFlight[i].used = false;
+    _mqttClient.setClient(_ackClient);
     _mqttClient.setServer(_mqttServer, _mqttPort);
     _mqttClient.setCallback([this](char* topic, byte* payload, unsigned int length) {
         this->mqttCallback(topic, payload, length);
     });
-    _mqttClient.setBufferSize(1024);
+    _mqttClient.setBufferSize(bufferSize);
+}
+
+void MQTTManager::setPublishWindow(uint8_t window, unsigned long ackTimeoutMs, uint8_t maxAttempts, size_t maxPayload) {
+    _window = constrain(window, 1, MAX_IN_FLIGHT);
+    _ackTimeoutMs = ackTimeoutMs;
+    _maxAttempts = maxAttempts > 0 ? maxAttempts : 1;
+    // Con menos de _window en vuelo siempre queda libre uno de los primeros
+    // _window huecos: basta con reservar esos.
+    if (maxPayload > 0) {
+        for (uint8_t i = 0; i < _window; i++) _inFlight[i].packet.reserve(1 + 4 + 2 + MAX_TOPIC_LENGTH + 2 + maxPayload);
+    }
 }
 
-void MQTTManager::setCertificates(const char* caCert, const char* clientCert, const char* privateKey) {
-    _wifiClientSecure.setCACert(caCert);
-    _wifiClientSecure.setCertificate(clientCert);
-    _wifiClientSecure.setPrivateKey(privateKey);
+bool MQTTManager::setCertificates(const TlsCredentials& credentials) {
+#if FLOR_TLS_SESSION_RESUMPTION
+    _tlsClient.setCredentials(credentials);
+    return true;
+#else
+    // setCACert() y compañía toman texto terminado en '\0'.
+    if (!credentials.rootCa.isPem() || !credentials.certificate.isPem() || !credentials.privateKey.isPem()) {
+        LOGE("MQTT", "WiFiClientSecure needs PEM credentials; build with esp-tls session tickets for DER");
+        return false;
+    }
+    _tlsClient.setCACert(credentials.rootCa.data);
+    _tlsClient.setCertificate(credentials.certificate.data);
+    _tlsClient.setPrivateKey(credentials.privateKey.data);
+    return true;
+#endif
 }
 
 bool MQTTManager::connect() {
     if (_mqttClient.connected()) {
         return true;
     }
+    // Con clean session el broker no guarda nada de la sesión anterior.
+    failInFlight();
+    unsigned long start = millis();
+    bool connected = connectSession();
+    if (_metrics != nullptr) {
+        _metrics->increment(connected ? Metrics::MQTT_CONNECTS : Metrics::MQTT_CONNECT_FAILURES);
+        _metrics->record(Metrics::CONNECT_MS, millis() - start);
+    }
+    return connected;
+}
 
-    Serial.print("Attempting MQTT connection to ");
-    Serial.print(_mqttServer);
-    Serial.print(" as ");
-    Serial.println(_clientId);
+bool MQTTManager::connectSession() {
+    LOGI("MQTT", "Connecting to %s as %s", _mqttServer, _clientId);
 
     if (WiFi.status() != WL_CONNECTED) {
-        Serial.println("WiFi not connected. Cannot connect to MQTT.");
+        LOGW("MQTT", "WiFi not connected. Cannot connect to MQTT.");
+        return false;
+    }
+
+    // DNS, TCP+TLS y CONNECT por separado para poder medir cada fase.
+    // PubSubClient no vuelve a conectar el socket si ya está abierto, y el
+    // cliente TLS resuelve el nombre desde la caché de lwIP.
+    ConnectTiming timing = {};
+    unsigned long phaseStart = millis();
+    IPAddress endpointAddress;
+    if (!WiFi.hostByName(_mqttServer, endpointAddress)) {
+        LOGW("MQTT", "DNS lookup for MQTT endpoint failed.");
+        return false;
+    }
+    timing.dnsMs = millis() - phaseStart;
+
+    phaseStart = millis();
+    if (!_ackClient.connect(_mqttServer, _mqttPort)) {
+        char lastError[100];
+        _tlsClient.lastError(lastError, 100);
+        LOGW("MQTT", "TLS connection failed: %s", lastError);
         return false;
     }
+#if FLOR_TLS_SESSION_RESUMPTION
+    timing.tcpMs = _tlsClient.tcpMillis();
+    timing.tlsMs = _tlsClient.tlsMillis();
+    timing.sessionResumed = _tlsClient.sessionOffered();
+#else
+    timing.tlsMs = millis() - phaseStart;
+#endif
 
+    phaseStart = millis();
     if (_mqttClient.connect(_clientId)) {
-        Serial.println("MQTT connected!");
-        for (const auto& sub : _subscriptions) {
-            Serial.print("Resubscribing to: ");
-            Serial.println(sub.topic);
-            _mqttClient.subscribe(sub.topic.c_str());
+        timing.mqttMs = millis() - phaseStart;
+        _connectTiming = timing;
+        _connects++;
+        if (timing.sessionResumed) _resumedConnects++;
+        LOGI("MQTT", "Connected.");
+        printConnectTiming();
+        for (const auto& topicFilter : _subscriptions) {
+            LOGD("MQTT", "Resubscribing to: %s", topicFilter.c_str());
+            _mqttClient.subscribe(topicFilter.c_str());
         }
         return true;
     } else {
-        Serial.print("MQTT connect failed, rc=");
-        Serial.print(_mqttClient.state());
         char lastError[100];
-        _wifiClientSecure.lastError(lastError, 100); 
-        Serial.print(", WiFiClientSecure last error: ");
-        Serial.println(lastError);
+        _tlsClient.lastError(lastError, 100); 
+        LOGW("MQTT", "MQTT connect failed, rc=%d, TLS client last error: %s", _mqttClient.state(), lastError);
         return false;
     }
 }
 
+void MQTTManager::printConnectTiming() {
+    LOGI("MQTT", "Connect timing: dns %lu ms, tcp %lu ms, tls %lu ms (%s), mqtt %lu ms",
+         _connectTiming.dnsMs, _connectTiming.tcpMs, _connectTiming.tlsMs,
+         _connectTiming.sessionResumed ? "resumed" : "full", _connectTiming.mqttMs);
+}
+
+void MQTTManager::countPublish(bool success, unsigned long startMicros) {
+    if (_metrics == nullptr) return;
+    _metrics->increment(success ? Metrics::MQTT_PUBLISHES : Metrics::MQTT_PUBLISH_FAILURES);
+    _metrics->record(Metrics::PUBLISH_US, micros() - startMicros);
+}
+
 void MQTTManager::disconnect() {
     _mqttClient.disconnect();
-    Serial.println("MQTT disconnected.");
+    failInFlight();
+    LOGI("MQTT", "Disconnected.");
 }
 
-bool MQTTManager::publish(const String& topic, const String& message, bool retained) {
+bool MQTTManager::publish(const char* topic, const char* message, bool retained) {
     if (!connected()) {
-        Serial.println("MQTT not connected. Cannot publish.");
+        LOGW("MQTT", "MQTT not connected. Cannot publish.");
         return false; 
     }
     
     // El método publish de PubSubClient devuelve un booleano
-    bool success = _mqttClient.publish(topic.c_str(), message.c_str(), retained);
+    unsigned long start = micros();
+    bool success = _mqttClient.publish(topic, message, retained);
+    countPublish(success, start);
     
     if (success) {
-        Serial.print("Successfully published to "); Serial.print(topic); Serial.print(": "); Serial.println(message);
+        LOGD("MQTT", "Published to %s: %s", topic, message);
     } else {
-        Serial.print("Failed to publish to topic: "); Serial.println(topic);
+        LOGW("MQTT", "Failed to publish to topic: %s", topic);
     }
     return success; 
 }
 
-void MQTTManager::subscribe(const String& topic, MessageCallback callback) {
-    _subscriptions.push_back({topic, callback}); 
+bool MQTTManager::publish(const char* topic, const uint8_t* payload, size_t length, bool retained) {
+    if (!connected()) {
+        LOGW("MQTT", "MQTT not connected. Cannot publish.");
+        return false; 
+    }
+
+    unsigned long start = micros();
+    bool success = _mqttClient.publish(topic, payload, length, retained);
+    countPublish(success, start);
+
+    if (success) {
+        LOGD("MQTT", "Published %u bytes to %s", (unsigned int)length, topic);
+    } else {
+        LOGW("MQTT", "Failed to publish to topic: %s", topic);
+    }
+    return success; 
+}
+
+bool MQTTManager::publishReliable(const char* topic, const uint8_t* payload, size_t length, PublishCallback done) {
+    if (!connected() || _inFlightCount >= _window) return false;
+    size_t topicLength = strlen(topic);
+    if (topicLength > MAX_TOPIC_LENGTH) {
+        LOGE("MQTT", "Topic too long for a QoS 1 publish: %s", topic);
+        return false;
+    }
+    InFlight* message = nullptr;
+    for (uint8_t i = 0; i < MAX_IN_FLIGHT && message == nullptr; i++) {
+        if (!_inFlight[i].used) message = &_inFlight[i];
+    }
+    if (message == nullptr) return false;
+
+    // PUBLISH QoS 1: cabecera fija, longitud restante, topic, packet id y
+    // payload. El vector conserva su capacidad entre usos del hueco.
+    size_t remaining = 2 + topicLength + 2 + length;
+    std::vector<uint8_t>& packet = message->packet;
+    packet.clear();
+    packet.push_back(MQTTPUBLISH | MQTTQOS1);
+    do {
+        uint8_t digit = remaining % 128;
+        remaining /= 128;
+        packet.push_back(remaining > 0 ? digit | 0x80 : digit);
+    } while (remaining > 0);
+    message->packetId = nextPacketId();
+    packet.push_back((uint8_t)(topicLength >> 8));
+    packet.push_back((uint8_t)(topicLength & 0xFF));
+    packet.insert(packet.end(), (const uint8_t*)topic, (const uint8_t*)topic + topicLength);
+    packet.push_back((uint8_t)(message->packetId >> 8));
+    packet.push_back((uint8_t)(message->packetId & 0xFF));
+    message->payloadOffset = packet.size();
+    packet.insert(packet.end(), payload, payload + length);
+    memcpy(message->topic, topic, topicLength + 1);
+    message->attempts = 0;
+    message->done = std::move(done);
+
+    unsigned long start = micros();
+    bool success = send(*message);
+    countPublish(success, start);
+    if (!success) {
+        LOGW("MQTT", "Failed to publish to topic: %s", topic);
+        return false;
+    }
+    message->used = true;
+    message->firstSentMillis = message->sentMillis;
+    _inFlightCount++;
+    LOGD("MQTT", "Published %u bytes to %s (QoS 1, id %u, %u in flight)", (unsigned int)length, topic,
+         (unsigned int)message->packetId, (unsigned int)_inFlightCount);
+    return true;
+}
+
+// Ids propios, sin el 0 y sin repetir uno que siga a la espera.
+uint16_t MQTTManager::nextPacketId() {
+    for (;;) {
+        if (++_nextPacketId == 0) _nextPacketId = 1;
+        bool taken = false;
+        for (uint8_t i = 0; i < MAX_IN_FLIGHT; i++) {
+            if (_inFlight[i].used && _inFlight[i].packetId == _nextPacketId) taken = true;
+        }
+        if (!taken) return _nextPacketId;
+    }
+}
+
+bool MQTTManager::send(InFlight& message) {
+    if (message.attempts > 0) message.packet[0] |= 0x08; // DUP
+    message.attempts++;
+    message.sentMillis = millis();
+    return _ackClient.write(message.packet.data(), message.packet.size()) == message.packet.size();
+}
+
+void MQTTManager::processAcks() {
+    uint16_t packetId;
+    while (_ackClient.popAck(packetId)) {
+        for (uint8_t i = 0; i < MAX_IN_FLIGHT; i++) {
+            InFlight& message = _inFlight[i];
+            if (!message.used || message.packetId != packetId) continue;
+            if (_metrics != nullptr) _metrics->record(Metrics::PUBACK_MS, millis() - message.firstSentMillis);
+            complete(message, true);
+            break;
+        }
+    }
+}
+
+void MQTTManager::checkAckTimeouts() {
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < MAX_IN_FLIGHT; i++) {
+        InFlight& message = _inFlight[i];
+        if (!message.used || now - message.sentMillis < _ackTimeoutMs) continue;
+        if (message.attempts >= _maxAttempts) {
+            LOGW("MQTT", "No PUBACK for id %u on %s after %u attempts.", (unsigned int)message.packetId,
+                 message.topic, (unsigned int)message.attempts);
+            complete(message, false);
+            continue;
+        }
+        if (_metrics != nullptr) _metrics->increment(Metrics::MQTT_PUBACK_RETRIES);
+        LOGD("MQTT", "PUBACK timeout for id %u. Resending.", (unsigned int)message.packetId);
+        if (!send(message)) {
+            complete(message, false);
+        }
+    }
+}
+
+// done puede volver a publicar: cuenta ya como hueco libre, pero este no se
+// reutiliza hasta que vuelva, porque le pasa su topic y su payload.
+void MQTTManager::complete(InFlight& message, bool delivered) {
+    _inFlightCount--;
+    if (!delivered && _metrics != nullptr) _metrics->increment(Metrics::MQTT_PUBLISH_UNACKED);
+    PublishCallback done = std::move(message.done);
+    message.done = nullptr;
+    if (done) {
+        done(delivered, message.topic, message.packet.data() + message.payloadOffset,
+             message.packet.size() - message.payloadOffset);
+    }
+    message.used = false;
+}
+
+void MQTTManager::failInFlight() {
+    for (uint8_t i = 0; i < MAX_IN_FLIGHT; i++) {
+        if (_inFlight[i].used) complete(_inFlight[i], false);
+    }
+}
+
+void MQTTManager::subscribe(const char* topicFilter) {
+    _subscriptions.push_back(String(topicFilter));
     
     if (connected()) {
-        if (_mqttClient.subscribe(topic.c_str())) {
-            Serial.print("Subscribed to: "); Serial.println(topic);
+        if (_mqttClient.subscribe(topicFilter)) {
+            LOGI("MQTT", "Subscribed to: %s", topicFilter);
         } else {
-            Serial.print("Failed to subscribe to: "); Serial.println(topic);
+            LOGW("MQTT", "Failed to subscribe to: %s", topicFilter);
         }
     } else {
-        Serial.print("MQTT not connected. Subscription to '"); 
-        Serial.print(topic); 
-        Serial.println("' will activate on next connection.");
+        LOGD("MQTT", "MQTT not connected. Subscription to '%s' will activate on next connection.", topicFilter);
+    }
+}
+
+void MQTTManager::subscribe(const char* topicFilter, uint8_t topicId, MessageCallback callback) {
+    route(topicFilter, topicId, callback);
+    subscribe(topicFilter);
+}
+
+// Registra un handler sin suscribirse en el broker, para topics ya cubiertos
+// por una suscripción con comodines.
+bool MQTTManager::route(const char* topicFilter, uint8_t topicId, MessageCallback callback) {
+    if (!_router.add(topicFilter, (int)_routes.size())) {
+        LOGE("MQTT", "Invalid topic filter for route: %s", topicFilter);
+        return false;
     }
+    _routes.push_back({topicId, callback});
+    return true;
 }
 
 void MQTTManager::update() {
     if (WiFi.status() != WL_CONNECTED) {
         if (_mqttClient.connected()) {
             _mqttClient.disconnect();
-            Serial.println("WiFi lost, MQTT disconnected.");
+            LOGW("MQTT", "WiFi lost, MQTT disconnected.");
         }
+        failInFlight();
         return;
     }
 
     if (_mqttClient.connected()) {
         _mqttClient.loop();
+        for (uint8_t i = 1; i < MAX_PACKETS_PER_UPDATE && _mqttClient.connected() && _tlsClient.available() > 0; i++) {
+            _mqttClient.loop();
+        }
+    }
+    processAcks();
+    if (!_mqttClient.connected()) {
+        failInFlight();
+    } else if (_inFlightCount > 0) {
+        checkAckTimeouts();
     }
 }
 
@@ -108,19 +351,30 @@ bool MQTTManager::connected() {
     return _mqttClient.connected();
 }
 
-void MQTTManager::mqttCallback(char* topicChar, byte* payload, unsigned int length) {
-    String message;
-    message.reserve(length);
-    for (unsigned int i = 0; i < length; i++) {
-        message += (char)payload[i];
+// Espera en tramos cortos: delay() cede la CPU a la tarea idle de FreeRTOS y
+// entre tramos se mira si el socket tiene datos (o si wake() pide despertar),
+// así un mensaje entrante no espera al siguiente plazo del planificador.
+bool MQTTManager::waitForInput(unsigned long timeoutMs, std::function<bool()> wake) {
+    unsigned long start = millis();
+    while (true) {
+        if (_tlsClient.available() > 0) return true;
+        if (wake && wake()) return true;
+        unsigned long elapsed = millis() - start;
+        if (elapsed >= timeoutMs) return false;
+        unsigned long slice = timeoutMs - elapsed;
+        delay(slice < INPUT_POLL_SLICE_MS ? slice : INPUT_POLL_SLICE_MS);
     }
-    
-    String topicStr(topicChar);
-    for (const auto& sub : _subscriptions) {
-        if (topicStr == sub.topic) {
-            sub.callback(topicStr, message);
-            return;
-        }
+}
+
+void MQTTManager::mqttCallback(char* topicChar, byte* payload, unsigned int length) {
+    if (_metrics != nullptr) _metrics->increment(Metrics::MQTT_MESSAGES);
+    int routeIndex = _router.match(topicChar);
+    if (routeIndex == TopicRouter::NO_ROUTE) {
+        if (_metrics != nullptr) _metrics->increment(Metrics::MQTT_UNROUTED);
+        LOGW("MQTT", "No callback registered for MQTT topic: %s", topicChar);
+        return;
     }
-    Serial.print("No callback registered for MQTT topic: "); Serial.println(topicStr);
+
+    const Route& route = _routes[routeIndex];
+    route.callback(route.topicId, (char*)payload, length);
 }
\ No newline at end of file
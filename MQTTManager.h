@@ -6,36 +6,136 @@
 #include <WiFi.h>
 #include <functional>
 #include <vector> 
+#include "EspTlsClient.h"
+#include "Metrics.h"
+#include "PubAckClient.h"
+#include "TlsCredentials.h"
+#include "TopicRouter.h"
 
 class MQTTManager {
   public:
-    using MessageCallback = std::function<void(const String& topic, const String& message)>;
+    // payload apunta al buffer de recepción de PubSubClient: es válido solo
+    // durante la llamada y el handler puede modificarlo (p. ej. parseo in situ).
+    using MessageCallback = std::function<void(uint8_t topicId, char* payload, size_t length)>;
+    // Fin de una publicación QoS 1: delivered es false si se agotaron los
+    // intentos o se cerró la sesión antes del PUBACK. topic y payload son los
+    // del mensaje y valen solo durante la llamada (p. ej. para encolarlo).
+    // Una captura de hasta dos punteros cabe en el propio std::function: así
+    // publicar no reserva memoria.
+    using PublishCallback = std::function<void(bool delivered, const char* topic, const uint8_t* payload, size_t length)>;
+
+    // Duración de cada fase del último connect() correcto. Con WiFiClientSecure
+    // TCP y TLS no se pueden separar y todo cuenta como tlsMs.
+    struct ConnectTiming {
+        unsigned long dnsMs;
+        unsigned long tcpMs;
+        unsigned long tlsMs;
+        unsigned long mqttMs;
+        bool sessionResumed;
+    };
     
-    MQTTManager(const char* mqttServer, int mqttPort, const char* clientId);
+    // bufferSize acota el mensaje más grande que se puede recibir: PubSubClient
+    // descarta sin avisar los que no caben.
+    MQTTManager(const char* mqttServer, int mqttPort, const char* clientId, uint16_t bufferSize = 1024);
     
-    void setCertificates(const char* caCert, const char* clientCert, const char* privateKey);
+    // PEM o DER con EspTlsClient; WiFiClientSecure solo acepta PEM y con DER
+    // devuelve false. Los buffers deben vivir tanto como el MQTTManager.
+    bool setCertificates(const TlsCredentials& credentials);
+    // Registro donde se cuentan conexiones, publicaciones y mensajes (opcional).
+    void setMetrics(Metrics* metrics) { _metrics = metrics; }
+    // Ventana de publicaciones QoS 1 sin confirmar (hasta MAX_IN_FLIGHT),
+    // espera de cada PUBACK y envíos por mensaje antes de darlo por perdido.
+    // Cada hueco de la ventana reserva ya un paquete de maxPayload bytes con
+    // el topic más largo, así publicar hasta ese tamaño no pide memoria.
+    void setPublishWindow(uint8_t window, unsigned long ackTimeoutMs, uint8_t maxAttempts, size_t maxPayload = 0);
     
     bool connect();
     void disconnect();
-    bool publish(const String& topic, const String& message, bool retained = false); 
-    void subscribe(const String& topic, MessageCallback callback);
+    bool publish(const char* topic, const char* message, bool retained = false);
+    bool publish(const char* topic, const uint8_t* payload, size_t length, bool retained = false);
+    // Publica con QoS 1 sin esperar el PUBACK: done se llama desde update()
+    // al confirmarse o agotarse los reintentos, o desde connect()/disconnect()
+    // si la sesión se cerró antes. false (y done no se llama) si no hay
+    // conexión, la ventana está llena (canPublishReliable()), el topic pasa
+    // de MAX_TOPIC_LENGTH o la escritura en el socket falla o queda a medias.
+    bool publishReliable(const char* topic, const uint8_t* payload, size_t length, PublishCallback done);
+    bool canPublishReliable() const { return _inFlightCount < _window; }
+    uint8_t inFlight() const { return _inFlightCount; }
+    void subscribe(const char* topicFilter);
+    void subscribe(const char* topicFilter, uint8_t topicId, MessageCallback callback);
+    bool route(const char* topicFilter, uint8_t topicId, MessageCallback callback);
     void update();
     bool connected();
+    bool waitForInput(unsigned long timeoutMs, std::function<bool()> wake = nullptr);
+
+    const ConnectTiming& lastConnectTiming() const { return _connectTiming; }
+    unsigned long connects() const { return _connects; }
+    unsigned long resumedConnects() const { return _resumedConnects; }
     
+    static const uint8_t MAX_IN_FLIGHT = 8;
+    // Topic más largo que se publica con QoS 1; los buffers de topic del
+    // sketch usan el mismo tamaño.
+    static const size_t MAX_TOPIC_LENGTH = 160;
+
   private:
-    struct Subscription {
-        String topic;
+    struct Route {
+        uint8_t topicId;
         MessageCallback callback;
     };
+
+    // Publicación QoS 1 a la espera de su PUBACK. El paquete entero se guarda
+    // para reenviarlo (con DUP) sin volver a construirlo.
+    struct InFlight {
+        bool used;
+        uint16_t packetId;
+        uint8_t attempts;
+        unsigned long firstSentMillis;
+        unsigned long sentMillis;
+        char topic[MAX_TOPIC_LENGTH + 1];
+        std::vector<uint8_t> packet;
+        size_t payloadOffset;
+        PublishCallback done;
+    };
     
+    static const unsigned long INPUT_POLL_SLICE_MS = 5;
+    // Paquetes que update() lee como mucho por llamada: los PUBACK de una
+    // ventana llena llegan juntos.
+    static const uint8_t MAX_PACKETS_PER_UPDATE = 8;
+
     const char* _mqttServer;
     int _mqttPort;
     const char* _clientId;
     
-    WiFiClientSecure _wifiClientSecure;
+#if FLOR_TLS_SESSION_RESUMPTION
+    EspTlsClient _tlsClient;
+#else
+    WiFiClientSecure _tlsClient;
+#endif
+    PubAckClient _ackClient;
     PubSubClient _mqttClient;
-    std::vector<Subscription> _subscriptions;
+    std::vector<String> _subscriptions;
+    std::vector<Route> _routes;
+    TopicRouter _router;
+    Metrics* _metrics;
+    ConnectTiming _connectTiming;
+    unsigned long _connects;
+    unsigned long _resumedConnects;
+    InFlight _inFlight[MAX_IN_FLIGHT];
+    uint8_t _inFlightCount;
+    uint8_t _window;
+    unsigned long _ackTimeoutMs;
+    uint8_t _maxAttempts;
+    uint16_t _nextPacketId;
     
+    void printConnectTiming();
+    bool connectSession();
+    void countPublish(bool success, unsigned long startMicros);
+    uint16_t nextPacketId();
+    bool send(InFlight& message);
+    void processAcks();
+    void checkAckTimeouts();
+    void complete(InFlight& message, bool delivered);
+    void failInFlight();
     void mqttCallback(char* topic, byte* payload, unsigned int length);
 };
 
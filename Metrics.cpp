@@ -0,0 +1,121 @@
+#include "Metrics.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+Metrics::Metrics() {
+    memset(_counters, 0, sizeof(_counters));
+    memset(_gauges, 0, sizeof(_gauges));
+    memset(_histograms, 0, sizeof(_histograms));
+}
+
+void Metrics::record(Histogram histogram, uint32_t value) {
+    HistogramData& data = _histograms[histogram];
+    uint8_t bucket = value == 0 ? 0 : 32 - __builtin_clz(value);
+    if (bucket >= HISTOGRAM_BUCKETS) bucket = HISTOGRAM_BUCKETS - 1;
+    data.buckets[bucket]++;
+    data.count++;
+    data.sum += value;
+    if (value > data.max) data.max = value;
+}
+
+void Metrics::resetHistograms() {
+    memset(_histograms, 0, sizeof(_histograms));
+}
+
+const char* Metrics::counterName(Counter counter) {
+    switch (counter) {
+        case MQTT_CONNECTS: return "mqtt_connects";
+        case MQTT_CONNECT_FAILURES: return "mqtt_connect_failures";
+        case MQTT_PUBLISHES: return "mqtt_publishes";
+        case MQTT_PUBLISH_FAILURES: return "mqtt_publish_failures";
+        case MQTT_MESSAGES: return "mqtt_messages";
+        case MQTT_UNROUTED: return "mqtt_unrouted";
+        case MQTT_PUBACK_RETRIES: return "mqtt_puback_retries";
+        case MQTT_PUBLISH_UNACKED: return "mqtt_publish_unacked";
+        case SHADOW_PARSE_ERRORS: return "shadow_parse_errors";
+        case SHADOW_REPORTS: return "shadow_reports";
+        case SHADOW_REPORT_FAILURES: return "shadow_report_failures";
+        case SHADOW_REJECTED: return "shadow_rejected";
+        case SHADOW_CONFLICTS: return "shadow_conflicts";
+        case SHADOW_REPORTS_MERGED: return "shadow_reports_merged";
+        case SENSOR_SCANS: return "sensor_scans";
+        default: return "unknown";
+    }
+}
+
+const char* Metrics::gaugeName(Gauge gauge) {
+    switch (gauge) {
+        case HEAP_FREE: return "heap_free";
+        case HEAP_MIN_FREE: return "heap_min_free";
+        case OUTBOX_PENDING: return "outbox_pending";
+        case WIFI_RSSI: return "wifi_rssi";
+        case WIFI_OUTAGES: return "wifi_outages";
+        default: return "unknown";
+    }
+}
+
+const char* Metrics::histogramName(Histogram histogram) {
+    switch (histogram) {
+        case LOOP_US: return "loop_us";
+        case MESSAGE_US: return "message_us";
+        case PUBLISH_US: return "publish_us";
+        case CONNECT_MS: return "connect_ms";
+        case PUBACK_MS: return "puback_ms";
+        default: return "unknown";
+    }
+}
+
+namespace {
+
+// Añade texto con formato a buffer; tras un desbordamiento deja de escribir.
+struct JsonWriter {
+    char* buffer;
+    size_t size;
+    size_t length;
+    bool overflow;
+
+    void append(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        if (overflow) return;
+        va_list args;
+        va_start(args, format);
+        int written = vsnprintf(buffer + length, size - length, format, args);
+        va_end(args);
+        if (written < 0 || (size_t)written >= size - length) {
+            overflow = true;
+            return;
+        }
+        length += written;
+    }
+};
+
+}
+
+// {"uptime":s,"c":{...},"g":{...},"h":{"loop_us":{"n":..,"sum":..,"max":..,"b":[..]}}}
+// Los cubos se cortan tras el último no vacío.
+size_t Metrics::serialize(char* buffer, size_t size, unsigned long uptimeMs) const {
+    if (buffer == nullptr || size == 0) return 0;
+    JsonWriter out = {buffer, size, 0, false};
+    out.append("{\"uptime\":%lu,\"c\":{", uptimeMs / 1000);
+    for (uint8_t i = 0; i < COUNTER_COUNT; i++) {
+        out.append("%s\"%s\":%lu", i ? "," : "", counterName((Counter)i), (unsigned long)_counters[i]);
+    }
+    out.append("},\"g\":{");
+    for (uint8_t i = 0; i < GAUGE_COUNT; i++) {
+        out.append("%s\"%s\":%ld", i ? "," : "", gaugeName((Gauge)i), (long)_gauges[i]);
+    }
+    out.append("},\"h\":{");
+    for (uint8_t i = 0; i < HISTOGRAM_COUNT; i++) {
+        const HistogramData& data = _histograms[i];
+        out.append("%s\"%s\":{\"n\":%lu,\"sum\":%llu,\"max\":%lu,\"b\":[", i ? "," : "", histogramName((Histogram)i),
+                   (unsigned long)data.count, (unsigned long long)data.sum, (unsigned long)data.max);
+        uint8_t used = HISTOGRAM_BUCKETS;
+        while (used > 0 && data.buckets[used - 1] == 0) used--;
+        for (uint8_t b = 0; b < used; b++) {
+            out.append("%s%lu", b ? "," : "", (unsigned long)data.buckets[b]);
+        }
+        out.append("]}");
+    }
+    out.append("}}");
+    return out.overflow ? 0 : out.length;
+}
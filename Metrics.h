@@ -0,0 +1,88 @@
+#ifndef Metrics_h
+#define Metrics_h
+
+#include <Arduino.h>
+
+// Registro de métricas de tamaño fijo: contadores, gauges e histogramas con
+// cubos logarítmicos (potencias de 2). Registrar no reserva memoria ni
+// bloquea. Se registra y se publica desde la tarea de red.
+//
+// Los contadores son acumulados desde el arranque (el backend calcula las
+// diferencias y no le afecta perder un envío); los histogramas cubren solo el
+// intervalo desde la última publicación.
+class Metrics {
+  public:
+    enum Counter : uint8_t {
+        MQTT_CONNECTS,
+        MQTT_CONNECT_FAILURES,
+        MQTT_PUBLISHES,
+        MQTT_PUBLISH_FAILURES,
+        MQTT_MESSAGES,
+        MQTT_UNROUTED,
+        MQTT_PUBACK_RETRIES,    // Reenvíos QoS 1 por PUBACK vencido
+        MQTT_PUBLISH_UNACKED,   // Publicaciones QoS 1 dadas por perdidas
+        SHADOW_PARSE_ERRORS,
+        SHADOW_REPORTS,
+        SHADOW_REPORT_FAILURES,
+        SHADOW_REJECTED,
+        SHADOW_CONFLICTS,
+        SHADOW_REPORTS_MERGED,  // Cambios que esperaron al reporte en vuelo
+        SENSOR_SCANS,           // Escaneos de los sensores recibidos
+        COUNTER_COUNT
+    };
+
+    enum Gauge : uint8_t {
+        HEAP_FREE,
+        HEAP_MIN_FREE,
+        OUTBOX_PENDING,
+        WIFI_RSSI,
+        WIFI_OUTAGES,       // Copia del contador de ConnectivityManager
+        GAUGE_COUNT
+    };
+
+    enum Histogram : uint8_t {
+        LOOP_US,            // Una vuelta del lado de red
+        MESSAGE_US,         // Parseo y tratamiento de un mensaje del shadow
+        PUBLISH_US,         // MQTTManager::publish
+        CONNECT_MS,         // MQTTManager::connect completo
+        PUBACK_MS,          // Del primer envío QoS 1 a su PUBACK
+        HISTOGRAM_COUNT
+    };
+
+    // Cubo i: valores en [2^(i-1), 2^i); el 0 va al cubo 0 y el último
+    // recoge todo lo que no cabe.
+    static const uint8_t HISTOGRAM_BUCKETS = 20;
+
+    struct HistogramData {
+        uint32_t count;
+        uint32_t max;
+        uint64_t sum;
+        uint32_t buckets[HISTOGRAM_BUCKETS];
+    };
+
+    Metrics();
+
+    void increment(Counter counter, uint32_t by = 1) { _counters[counter] += by; }
+    void set(Gauge gauge, int32_t value) { _gauges[gauge] = value; }
+    void record(Histogram histogram, uint32_t value);
+
+    uint32_t counter(Counter counter) const { return _counters[counter]; }
+    int32_t gauge(Gauge gauge) const { return _gauges[gauge]; }
+    const HistogramData& histogram(Histogram histogram) const { return _histograms[histogram]; }
+
+    // JSON compacto con todas las métricas; devuelve la longitud o 0 si no
+    // cabe en el buffer.
+    size_t serialize(char* buffer, size_t size, unsigned long uptimeMs) const;
+    void resetHistograms();
+
+    static const char* counterName(Counter counter);
+    static const char* gaugeName(Gauge gauge);
+    static const char* histogramName(Histogram histogram);
+
+  private:
+    uint32_t _counters[COUNTER_COUNT];
+    int32_t _gauges[GAUGE_COUNT];
+    HistogramData _histograms[HISTOGRAM_COUNT];
+};
+
+#endif
@@ -1,40 +1,96 @@
 #include "MoistureSensor.h"
 
+// Límites superiores (%) de MUY_SECO, SECO, OPTIMO y HUMEDO.
+static const int RANGE_LIMITS[] = {20, 40, 70, 90};
+
 MoistureSensor::MoistureSensor(int pin, int dryValue, int wetValue)
   : _pin(pin), _dryValue(dryValue), _wetValue(wetValue),
-    _rawValue(0), _percentage(0), _currentRange(RANGE_UNKNOWN) {
+    _rawValue(0), _percentage(0), _currentRange(RANGE_UNKNOWN),
+    _oversample(1), _emaTauMs(0), _hysteresisPercent(0),
+    _filteredRaw(0), _filteredPercentage(0), _filterPrimed(false), _lastSampleMillis(0) {
     pinMode(_pin, INPUT);
 }
 
+void MoistureSensor::configure(uint8_t oversample, unsigned long emaTauMs, uint8_t hysteresisPercent) {
+    _oversample = constrain(oversample, 1, MAX_OVERSAMPLE);
+    _emaTauMs = emaTauMs;
+    _hysteresisPercent = hysteresisPercent;
+}
+
 void MoistureSensor::update() {
-  _rawValue = analogRead(_pin);
-  _percentage = map(_rawValue, _dryValue, _wetValue, 0, 100);
-  _percentage = constrain(_percentage, 0, 100);
-  determineRange();
+  update(readMedian());
 }
 
+void MoistureSensor::update(int sample) {
+  unsigned long now = millis();
+  if (!_filterPrimed || _emaTauMs == 0) {
+      _filteredRaw = sample;
+      _filterPrimed = true;
+  } else {
+      // Equivale a filtrar con la constante de tiempo _emaTauMs lo ocurrido
+      // entre las dos muestras.
+      float alpha = 1.0f - expf(-(float)(now - _lastSampleMillis) / (float)_emaTauMs);
+      _filteredRaw += alpha * (sample - _filteredRaw);
+  }
+  _lastSampleMillis = now;
+  _rawValue = (int)(_filteredRaw + 0.5f);
+
+  float percentage = (_filteredRaw - _dryValue) * 100.0f / (_wetValue - _dryValue);
+  percentage = constrain(percentage, 0.0f, 100.0f);
+  _filteredPercentage = percentage;
+  _percentage = (int)(percentage + 0.5f);
+  determineRange(percentage);
+}
+
+int MoistureSensor::readMedian() {
+    uint16_t samples[MAX_OVERSAMPLE];
+    for (uint8_t i = 0; i < _oversample; i++) {
+        // Inserción ordenada: como mucho 16 lecturas.
+        uint16_t value = analogRead(_pin);
+        uint8_t j = i;
+        while (j > 0 && samples[j - 1] > value) {
+            samples[j] = samples[j - 1];
+            j--;
+        }
+        samples[j] = value;
+    }
+    if (_oversample % 2 == 1) return samples[_oversample / 2];
+    return (samples[_oversample / 2 - 1] + samples[_oversample / 2] + 1) / 2;
+}
+
+void MoistureSensor::restoreRange(HumidityRange range) {
+    _currentRange = range;
+}
+
+int MoistureSensor::getPin() const { return _pin; }
 int MoistureSensor::getRawValue() const { return _rawValue; }
 int MoistureSensor::getPercentage() const { return _percentage; }
+float MoistureSensor::getFilteredPercentage() const { return _filteredPercentage; }
 HumidityRange MoistureSensor::getCurrentRange() const { return _currentRange; }
 
-void MoistureSensor::determineRange() {
-    if (_percentage <= 20) {
-        _currentRange = RANGE_VERY_DRY;
-    } else if (_percentage <= 40) {
-        _currentRange = RANGE_DRY;
-    } else if (_percentage <= 70) {
-        _currentRange = RANGE_OPTIMAL;
-    } else if (_percentage <= 90) {
-        _currentRange = RANGE_WET;
-    } else {
-        _currentRange = RANGE_VERY_WET;
+HumidityRange MoistureSensor::rangeFor(float percentage) {
+    if (percentage <= RANGE_LIMITS[0]) return RANGE_VERY_DRY;
+    if (percentage <= RANGE_LIMITS[1]) return RANGE_DRY;
+    if (percentage <= RANGE_LIMITS[2]) return RANGE_OPTIMAL;
+    if (percentage <= RANGE_LIMITS[3]) return RANGE_WET;
+    return RANGE_VERY_WET;
+}
+
+void MoistureSensor::determineRange(float percentage) {
+    if (_currentRange != RANGE_UNKNOWN) {
+        // Banda del rango actual ampliada con la histéresis por ambos lados.
+        int index = _currentRange - RANGE_VERY_DRY;
+        float lower = index > 0 ? RANGE_LIMITS[index - 1] - (float)_hysteresisPercent : -1.0f;
+        float upper = index < 4 ? RANGE_LIMITS[index] + (float)_hysteresisPercent : 101.0f;
+        if (percentage > lower && percentage <= upper) return;
     }
+    _currentRange = rangeFor(percentage);
 }
-String MoistureSensor::getRangeString() const {
+const char* MoistureSensor::getRangeString() const {
     return MoistureSensor::rangeToString(_currentRange);
 }
 
-String MoistureSensor::rangeToString(HumidityRange range) {
+const char* MoistureSensor::rangeToString(HumidityRange range) {
     switch (range) {
         case RANGE_VERY_DRY: return "MUY_SECO";
         case RANGE_DRY: return "SECO";
@@ -45,11 +101,12 @@ String MoistureSensor::rangeToString(HumidityRange range) {
     }
 }
 
-HumidityRange MoistureSensor::stringToRange(const String& rangeStr) {
-    if (rangeStr == "MUY_SECO") return RANGE_VERY_DRY;
-    if (rangeStr == "SECO") return RANGE_DRY;
-    if (rangeStr == "OPTIMO") return RANGE_OPTIMAL;
-    if (rangeStr == "HUMEDO") return RANGE_WET;
-    if (rangeStr == "MUY_HUMEDO") return RANGE_VERY_WET;
+HumidityRange MoistureSensor::stringToRange(const char* rangeStr) {
+    if (rangeStr == nullptr) return RANGE_UNKNOWN;
+    if (strcmp(rangeStr, "MUY_SECO") == 0) return RANGE_VERY_DRY;
+    if (strcmp(rangeStr, "SECO") == 0) return RANGE_DRY;
+    if (strcmp(rangeStr, "OPTIMO") == 0) return RANGE_OPTIMAL;
+    if (strcmp(rangeStr, "HUMEDO") == 0) return RANGE_WET;
+    if (strcmp(rangeStr, "MUY_HUMEDO") == 0) return RANGE_VERY_WET;
     return RANGE_UNKNOWN;
 }
\ No newline at end of file
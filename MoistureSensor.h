@@ -12,16 +12,36 @@ enum HumidityRange {
     RANGE_VERY_WET
 };
 
+// Cada update() toma una ráfaga de lecturas, se queda con la mediana, la
+// suaviza con una media exponencial y decide el rango con histéresis: para
+// salir de un rango el porcentaje tiene que pasar el límite en más de
+// hysteresisPercent. update(rawSample) hace lo mismo con una lectura tomada
+// fuera (el escaneo del ADC continuo de DeviceControl). La media tiene una
+// constante de tiempo fija, emaTauMs: el peso de cada muestra sale del tiempo
+// desde la anterior, así el filtro responde igual de rápido midiendo cada
+// segundo que cada minuto (AdaptiveSampler cambia el intervalo).
 class MoistureSensor {
   public:
+    static const uint8_t MAX_OVERSAMPLE = 16;
+
     MoistureSensor(int pin, int dryValue, int wetValue);
+    // emaTauMs 0 no filtra.
+    void configure(uint8_t oversample, unsigned long emaTauMs, uint8_t hysteresisPercent);
     void update();
+    void update(int rawSample);
+    // Tras un deep sleep: el rango anterior conserva la histéresis. El
+    // filtro arranca de cero, la muestra previa tiene minutos.
+    void restoreRange(HumidityRange range);
+    int getPin() const;
     int getRawValue() const;
     int getPercentage() const;
+    // Porcentaje del filtro sin redondear, para medir pendientes pequeñas.
+    float getFilteredPercentage() const;
     HumidityRange getCurrentRange() const;
-    String getRangeString() const;
-    static String rangeToString(HumidityRange range); 
-    static HumidityRange stringToRange(const String& rangeStr); 
+    const char* getRangeString() const;
+    // Nombre del rango tal como va en el shadow (texto constante).
+    static const char* rangeToString(HumidityRange range);
+    static HumidityRange stringToRange(const char* rangeStr); 
 
   private:
     int _pin;
@@ -30,7 +50,18 @@ class MoistureSensor {
     int _rawValue;
     int _percentage;
     HumidityRange _currentRange;
-    void determineRange();
+
+    uint8_t _oversample;
+    unsigned long _emaTauMs;
+    uint8_t _hysteresisPercent;
+    float _filteredRaw;
+    float _filteredPercentage;
+    bool _filterPrimed;
+    unsigned long _lastSampleMillis;
+
+    int readMedian();
+    static HumidityRange rangeFor(float percentage);
+    void determineRange(float percentage);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,241 @@
+#include "Outbox.h"
+#include "Log.h"
+#include <LittleFS.h>
+
+namespace {
+const uint32_t OUTBOX_MAGIC = 0x3158424F; // "OBX1"
+const size_t MAX_TOPIC_LENGTH = 256;
+
+bool writeExact(File& file, const void* data, size_t length) {
+    return file.write((const uint8_t*)data, length) == length;
+}
+
+bool readExact(File& file, void* data, size_t length) {
+    return file.read((uint8_t*)data, length) == length;
+}
+}
+
+Outbox::Outbox(const char* path, uint8_t maxEntries, size_t maxBytes)
+  : _path(path), _maxEntries(maxEntries), _maxBytes(maxBytes),
+    _bytes(0), _dropped(0), _storageReady(false), _nextId(0) {}
+
+bool Outbox::begin() {
+    _storageReady = LittleFS.begin(true);
+    if (!_storageReady) {
+        LOGE("OUTBOX", "LittleFS mount failed. Pending messages will only be kept in RAM.");
+        return false;
+    }
+    if (!load()) {
+        LOGW("OUTBOX", "Stored outbox is corrupt. Discarding it.");
+        _entries.clear();
+        _bytes = 0;
+        LittleFS.remove(_path);
+        return false;
+    }
+    if (!_entries.empty()) {
+        LOGI("OUTBOX", "Restored %u pending message(s) from flash.", (unsigned int)_entries.size());
+    }
+    return true;
+}
+
+bool Outbox::push(Kind kind, const char* topic, const uint8_t* payload, size_t length) {
+    size_t topicLength = strlen(topic);
+    if (topicLength + length > _maxBytes || topicLength > MAX_TOPIC_LENGTH || length > 0xFFFF) {
+        LOGW("OUTBOX", "Message too large for the outbox. Dropped.");
+        _dropped++;
+        return false;
+    }
+
+    if (kind == SHADOW_REPORT) {
+        for (size_t i = 0; i < _entries.size(); i++) {
+            if (_entries[i].kind == SHADOW_REPORT && !_entries[i].stale && _entries[i].topic == topic) {
+                retire(i); // El reporte nuevo sustituye al pendiente.
+                break;
+            }
+        }
+    }
+
+    makeRoom(topicLength + length);
+    Entry entry;
+    entry.kind = kind;
+    entry.topic = topic;
+    entry.payload.assign(payload, payload + length);
+    entry.id = ++_nextId;
+    entry.inFlight = false;
+    entry.stale = false;
+    _entries.push_back(entry);
+    _bytes += topicLength + length;
+    save();
+    return true;
+}
+
+void Outbox::discard(Kind kind, const char* topic) {
+    bool changed = false;
+    for (size_t i = _entries.size(); i > 0; i--) {
+        const Entry& entry = _entries[i - 1];
+        if (entry.kind == kind && !entry.stale && (topic == nullptr || entry.topic == topic)) {
+            retire(i - 1);
+            changed = true;
+        }
+    }
+    if (changed) save();
+}
+
+bool Outbox::contains(Kind kind, const char* topic) const {
+    for (size_t i = 0; i < _entries.size(); ++i) {
+        const Entry& entry = _entries[i];
+        if (entry.kind == kind && !entry.stale && (topic == nullptr || entry.topic == topic)) return true;
+    }
+    return false;
+}
+
+uint8_t Outbox::drain(MQTTManager& mqtt, uint8_t maxMessages) {
+    uint8_t sent = 0;
+    for (size_t i = 0; i < _entries.size() && sent < maxMessages && mqtt.canPublishReliable(); i++) {
+        Entry& entry = _entries[i];
+        if (entry.inFlight || !oldestOfTopic(i)) continue;
+        uint16_t id = entry.id;
+        if (!mqtt.publishReliable(entry.topic.c_str(), entry.payload.data(), entry.payload.size(),
+                                  [this, id](bool delivered, const char*, const uint8_t*, size_t) {
+                                      acknowledge(id, delivered);
+                                  })) {
+            break;
+        }
+        entry.inFlight = true;
+        sent++;
+    }
+    return sent;
+}
+
+// Una entrada sustituida o descartada mientras esperaba sale con su
+// resultado, entregada o no: el mensaje que la sustituye ya está detrás.
+void Outbox::acknowledge(uint16_t id, bool delivered) {
+    for (size_t i = 0; i < _entries.size(); i++) {
+        if (_entries[i].id != id) continue;
+        if (delivered || _entries[i].stale) {
+            bool persisted = !_entries[i].stale;
+            erase(i);
+            if (persisted) save();
+        } else {
+            _entries[i].inFlight = false;
+        }
+        return;
+    }
+}
+
+bool Outbox::oldestOfTopic(size_t index) const {
+    for (size_t i = 0; i < index; i++) {
+        if (_entries[i].topic == _entries[index].topic) return false;
+    }
+    return true;
+}
+
+void Outbox::retire(size_t index) {
+    if (_entries[index].inFlight) {
+        _entries[index].stale = true;
+    } else {
+        erase(index);
+    }
+}
+
+void Outbox::erase(size_t index) {
+    _bytes -= _entries[index].topic.length() + _entries[index].payload.size();
+    _entries.erase(_entries.begin() + index);
+}
+
+void Outbox::makeRoom(size_t length) {
+    // Lo que espera PUBACK no se descarta: MQTTManager lo seguiría
+    // reenviando. Si todo está en vuelo la cola se pasa del límite hasta que
+    // lleguen los resultados.
+    while (_entries.size() >= _maxEntries || _bytes + length > _maxBytes) {
+        size_t victim = _entries.size();
+        for (size_t i = 0; i < _entries.size(); i++) {
+            if (_entries[i].inFlight) continue;
+            if (victim == _entries.size()) victim = i;
+            if (_entries[i].kind == TELEMETRY) {
+                victim = i;
+                break;
+            }
+        }
+        if (victim == _entries.size()) return;
+        erase(victim);
+        _dropped++;
+    }
+}
+
+// Formato: magic, número de entradas y por entrada
+// [kind u8][topicLength u16][payloadLength u16][topic][payload].
+bool Outbox::load() {
+    if (!LittleFS.exists(_path)) return true;
+    File file = LittleFS.open(_path, FILE_READ);
+    if (!file) return false;
+
+    uint32_t magic = 0;
+    uint8_t count = 0;
+    if (!readExact(file, &magic, sizeof(magic)) || magic != OUTBOX_MAGIC || !readExact(file, &count, 1)) {
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t kind = 0;
+        uint16_t topicLength = 0;
+        uint16_t payloadLength = 0;
+        if (!readExact(file, &kind, 1) || !readExact(file, &topicLength, 2) || !readExact(file, &payloadLength, 2)) {
+            return false;
+        }
+        if (kind > TELEMETRY || topicLength > MAX_TOPIC_LENGTH || topicLength + payloadLength > _maxBytes) return false;
+
+        char topic[MAX_TOPIC_LENGTH + 1];
+        Entry entry;
+        entry.kind = (Kind)kind;
+        entry.payload.resize(payloadLength);
+        if (!readExact(file, topic, topicLength) || !readExact(file, entry.payload.data(), payloadLength)) {
+            return false;
+        }
+        topic[topicLength] = '\0';
+        entry.topic = topic;
+        entry.id = ++_nextId;
+        entry.inFlight = false;
+        entry.stale = false;
+        makeRoom(topicLength + payloadLength);
+        _entries.push_back(entry);
+        _bytes += topicLength + payloadLength;
+    }
+    return true;
+}
+
+// Las entradas sustituidas o descartadas no se guardan: tras un reinicio no
+// hay nada que esperar de ellas.
+bool Outbox::save() {
+    if (!_storageReady) return false;
+    uint8_t count = 0;
+    for (const Entry& entry : _entries) {
+        if (!entry.stale) count++;
+    }
+    if (count == 0) {
+        if (LittleFS.exists(_path)) LittleFS.remove(_path);
+        return true;
+    }
+
+    // Se escribe en un temporal y se renombra para no dejar un fichero a medias.
+    String tmpPath = String(_path) + ".tmp";
+    File file = LittleFS.open(tmpPath.c_str(), FILE_WRITE);
+    if (!file) return false;
+
+    bool ok = writeExact(file, &OUTBOX_MAGIC, sizeof(OUTBOX_MAGIC));
+    ok = ok && writeExact(file, &count, 1);
+    for (const Entry& entry : _entries) {
+        if (entry.stale) continue;
+        uint8_t kind = entry.kind;
+        uint16_t topicLength = entry.topic.length();
+        uint16_t payloadLength = entry.payload.size();
+        ok = ok && writeExact(file, &kind, 1) && writeExact(file, &topicLength, 2) && writeExact(file, &payloadLength, 2) &&
+             writeExact(file, entry.topic.c_str(), topicLength) && writeExact(file, entry.payload.data(), payloadLength);
+    }
+    file.close();
+    if (!ok) {
+        LittleFS.remove(tmpPath.c_str());
+        return false;
+    }
+    LittleFS.remove(_path);
+    return LittleFS.rename(tmpPath.c_str(), _path);
+}
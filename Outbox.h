@@ -0,0 +1,69 @@
+#ifndef Outbox_h
+#define Outbox_h
+
+#include <Arduino.h>
+#include <vector>
+#include "MQTTManager.h"
+
+// Cola acotada de mensajes que no se pudieron publicar por estar MQTT caído.
+// Se persiste en LittleFS (un fichero en el build de host) para sobrevivir a
+// un reinicio y se vacía en orden, a ritmo controlado, al reconectar.
+// Un reporte de shadow nuevo sustituye al pendiente para el mismo topic; la
+// telemetría se conserva entera y es lo primero que se descarta si no cabe.
+// Se publica con QoS 1 y un mensaje solo sale de la cola con su PUBACK; sin
+// él vuelve a enviarse en el siguiente vaciado. Por topic se conserva el
+// orden: una entrada solo se envía cuando es la más antigua de su topic, así
+// un reenvío nunca llega detrás de un mensaje posterior del mismo topic.
+class Outbox {
+  public:
+    enum Kind : uint8_t {
+        SHADOW_REPORT = 0,
+        TELEMETRY = 1
+    };
+
+    Outbox(const char* path, uint8_t maxEntries, size_t maxBytes);
+    bool begin();
+    bool push(Kind kind, const char* topic, const uint8_t* payload, size_t length);
+    // Con topic solo cuentan las entradas de ese topic (el shadow de una
+    // maceta). Las que esperan PUBACK no se pueden retirar de MQTTManager:
+    // quedan marcadas y salen de la cola con su resultado, sin reenviarse.
+    void discard(Kind kind, const char* topic = nullptr);
+    bool contains(Kind kind, const char* topic = nullptr) const;
+    // Publica hasta maxMessages entradas que no estén ya a la espera de
+    // PUBACK, mientras quede ventana; devuelve cuántas salieron.
+    uint8_t drain(MQTTManager& mqtt, uint8_t maxMessages);
+
+    size_t size() const { return _entries.size(); }
+    bool empty() const { return _entries.empty(); }
+    unsigned long dropped() const { return _dropped; }
+
+  private:
+    struct Entry {
+        Kind kind;
+        String topic;
+        std::vector<uint8_t> payload;
+        uint16_t id;        // Solo en RAM: casa el PUBACK con la entrada
+        bool inFlight;
+        bool stale;         // Sustituida o descartada mientras esperaba PUBACK
+    };
+
+    const char* _path;
+    uint8_t _maxEntries;
+    size_t _maxBytes;
+    size_t _bytes;
+    unsigned long _dropped;
+    bool _storageReady;
+    uint16_t _nextId;
+    std::vector<Entry> _entries;
+
+    void acknowledge(uint16_t id, bool delivered);
+    void erase(size_t index);
+    // Retira la entrada, o la marca si espera PUBACK.
+    void retire(size_t index);
+    void makeRoom(size_t length);
+    bool oldestOfTopic(size_t index) const;
+    bool load();
+    bool save();
+};
+
+#endif
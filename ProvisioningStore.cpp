@@ -0,0 +1,428 @@
+#include "ProvisioningStore.h"
+#include "EspTlsClient.h"
+#include "Log.h"
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+
+namespace {
+const char PROVISION_DIR[] = "/provision";
+const char DEVICE_PATH[] = "/provision/device.json";
+// Sin extensión: se busca .der y .pem.
+const char ROOT_CA_NAME[] = "/provision/root_ca";
+const char CERTIFICATE_NAME[] = "/provision/certificate";
+const char PRIVATE_KEY_NAME[] = "/provision/private_key";
+const char CERTIFICATE_LABEL[] = "CERTIFICATE";
+
+// Formato en el que este build usa las credenciales: DER solo con esp-tls.
+#if FLOR_TLS_SESSION_RESUMPTION
+const bool STORE_DER = true;
+#else
+const bool STORE_DER = false;
+#endif
+
+// Un device.json con cuatro macetas usa unos 40 valores.
+const size_t DEVICE_DOC_SIZE = 768;
+
+// Copia la cadena si está y cabe entera; si no, deja out como estaba.
+bool copyString(JsonVariantConst value, char* out, size_t size) {
+    const char* text = value.as<const char*>();
+    if (text == nullptr) return false;
+    size_t length = strlen(text);
+    if (length >= size) {
+        LOGW("PROV", "Provisioned value too long (%u characters). Ignored.", (unsigned int)length);
+        return false;
+    }
+    memcpy(out, text, length + 1);
+    return true;
+}
+
+const char BASE64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// La cabecera PEM de una clave depende de su estructura: PKCS#8
+// (SEQUENCE { INTEGER, SEQUENCE algoritmo, ... }), PKCS#1 RSA
+// (SEQUENCE { INTEGER, INTEGER, ... }) o SEC1 EC (SEQUENCE { INTEGER, OCTET
+// STRING, ... }).
+const char* privateKeyLabel(const uint8_t* der, size_t length) {
+    size_t pos = (der[1] & 0x80) ? 2 + (der[1] & 0x7F) : 2;
+    if (pos + 2 >= length || der[pos] != 0x02) return nullptr;
+    pos += 2 + der[pos + 1];
+    if (pos >= length) return nullptr;
+    if (der[pos] == 0x30) return "PRIVATE KEY";
+    if (der[pos] == 0x02) return "RSA PRIVATE KEY";
+    if (der[pos] == 0x04) return "EC PRIVATE KEY";
+    return nullptr;
+}
+
+void credentialPath(char* path, size_t size, const char* name, bool der) {
+    snprintf(path, size, "%s%s", name, der ? ".der" : ".pem");
+}
+
+int base64Value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+}
+
+ProvisioningStore::ProvisioningStore()
+  : _config(),
+    _thingName{},
+    _endpoint{},
+    _wifiSsid{},
+    _wifiPass{},
+    _shadowNames{},
+    _rootCa(),
+    _certificate(),
+    _privateKey(),
+    _deviceProvisioned(false),
+    _credentialsProvisioned(false),
+    _missing(nullptr) {}
+
+const char* ProvisioningStore::missingIdentity(const DeviceConfig& config) {
+    if (config.thingName == nullptr || config.thingName[0] == '\0') return "thingName";
+    if (config.wifiSsid == nullptr || config.wifiSsid[0] == '\0') return "wifi";
+    const TlsCredentials& credentials = config.credentials;
+    if (credentials.rootCa.empty() || credentials.certificate.empty() || credentials.privateKey.empty()) {
+        return "credentials";
+    }
+    return nullptr;
+}
+
+const DeviceConfig& ProvisioningStore::load(const DeviceConfig& fallback) {
+    _config = fallback;
+    _deviceProvisioned = false;
+    _credentialsProvisioned = false;
+    // Sin formatear: un fallo pasajero al montar no debe borrar la identidad.
+    if (!LittleFS.begin(false)) {
+        _missing = missingIdentity(fallback) != nullptr ? "storage" : nullptr;
+        LOGE("PROV", "LittleFS mount failed.%s", _missing ? " Device stays unprovisioned." : "");
+        return _config;
+    }
+    _deviceProvisioned = loadDevice(fallback);
+    _credentialsProvisioned = loadCredentials();
+    _missing = missingIdentity(_config);
+    if (_missing != nullptr) {
+        LOGE("PROV", "Device not provisioned: no %s.", _missing);
+    } else if (!_deviceProvisioned || !_credentialsProvisioned) {
+        LOGW("PROV", "Device %s uses the built-in development identity.", _config.thingName);
+    } else {
+        LOGI("PROV", "Device %s provisioned, %s credentials.", _config.thingName, STORE_DER ? "DER" : "PEM");
+    }
+    return _config;
+}
+
+bool ProvisioningStore::loadDevice(const DeviceConfig& fallback) {
+    if (!LittleFS.exists(DEVICE_PATH)) return false;
+    File file = LittleFS.open(DEVICE_PATH, FILE_READ);
+    if (!file) return false;
+    // Se parsea en su sitio: las cadenas del documento apuntan a buffer.
+    char buffer[MAX_DEVICE_FILE_SIZE];
+    size_t length = file.size();
+    if (length >= sizeof(buffer)) {
+        LOGW("PROV", "%s is larger than %u bytes. Ignored.", DEVICE_PATH, (unsigned int)sizeof(buffer));
+        return false;
+    }
+    length = file.read((uint8_t*)buffer, length);
+    buffer[length] = '\0';
+    file.close();
+
+    StaticJsonDocument<DEVICE_DOC_SIZE> doc;
+    DeserializationError error = deserializeJson(doc, buffer, length);
+    if (error) {
+        LOGW("PROV", "%s: %s. Ignored.", DEVICE_PATH, error.c_str());
+        return false;
+    }
+
+    if (copyString(doc["thingName"], _thingName, sizeof(_thingName))) _config.thingName = _thingName;
+    if (copyString(doc["endpoint"], _endpoint, sizeof(_endpoint))) _config.endpoint = _endpoint;
+    if (copyString(doc["wifiSsid"], _wifiSsid, sizeof(_wifiSsid))) _config.wifiSsid = _wifiSsid;
+    if (copyString(doc["wifiPass"], _wifiPass, sizeof(_wifiPass))) _config.wifiPass = _wifiPass;
+    _config.port = doc["port"] | fallback.port;
+
+    JsonObjectConst servo = doc["servo"].as<JsonObjectConst>();
+    if (!servo.isNull()) {
+        _config.servoAngles.sad = servo["sad"] | fallback.servoAngles.sad;
+        _config.servoAngles.happy = servo["happy"] | fallback.servoAngles.happy;
+        _config.servoAngles.neutral = servo["neutral"] | fallback.servoAngles.neutral;
+    }
+
+    // Las macetas provisionadas sustituyen a las de fallback; cada una toma de
+    // la suya (o de la primera) lo que no traiga, salvo los pines de una
+    // maceta que fallback no tiene.
+    JsonArrayConst plants = doc["plants"].as<JsonArrayConst>();
+    if (!plants.isNull() && plants.size() > 0) {
+        uint8_t count = 0;
+        for (size_t i = 0; i < plants.size() && i < MAX_PLANTS; i++) {
+            JsonObjectConst plant = plants[i].as<JsonObjectConst>();
+            const PlantConfig& base = fallback.plants[i < fallback.plantCount ? i : 0];
+            if (i >= fallback.plantCount && (!plant.containsKey("soilPin") || !plant.containsKey("servoPin"))) {
+                LOGW("PROV", "Plant %u has no pins. Ignored.", (unsigned int)i);
+                break;
+            }
+            PlantConfig& config = _config.plants[i];
+            config.shadowName = copyString(plant["shadowName"], _shadowNames[i], sizeof(_shadowNames[i]))
+                                    ? _shadowNames[i]
+                                    : base.shadowName;
+            config.soilMoisturePin = plant["soilPin"] | base.soilMoisturePin;
+            config.servoPin = plant["servoPin"] | base.servoPin;
+            config.soilDryValue = plant["dry"] | base.soilDryValue;
+            config.soilWetValue = plant["wet"] | base.soilWetValue;
+            count++;
+        }
+        if (plants.size() > MAX_PLANTS) {
+            LOGW("PROV", "Only the first %u plants are used.", (unsigned int)MAX_PLANTS);
+        }
+        _config.plantCount = count;
+    }
+    return true;
+}
+
+// Las tres o ninguna: un certificado nuevo con la clave vieja no conecta.
+bool ProvisioningStore::loadCredentials() {
+    char path[48];
+    bool anyPresent = false;
+    const char* names[] = {ROOT_CA_NAME, CERTIFICATE_NAME, PRIVATE_KEY_NAME};
+    for (const char* name : names) {
+        credentialPath(path, sizeof(path), name, true);
+        anyPresent |= LittleFS.exists(path);
+        credentialPath(path, sizeof(path), name, false);
+        anyPresent |= LittleFS.exists(path);
+    }
+    if (!anyPresent) return false;
+    if (!readCredential(ROOT_CA_NAME, _rootCa) || !readCredential(CERTIFICATE_NAME, _certificate) ||
+        !readCredential(PRIVATE_KEY_NAME, _privateKey)) {
+        LOGW("PROV", "Provisioned credentials are incomplete. Ignored.");
+        return false;
+    }
+    _config.credentials.rootCa = {(const char*)_rootCa.data, _rootCa.length};
+    _config.credentials.certificate = {(const char*)_certificate.data, _certificate.length};
+    _config.credentials.privateKey = {(const char*)_privateKey.data, _privateKey.length};
+    return true;
+}
+
+// Se prefiere el formato del build; el otro se convierte al cargar, así los
+// mismos ficheros valen para los dos clientes TLS.
+bool ProvisioningStore::readCredential(const char* name, CredentialBuffer& buffer) {
+    char path[48];
+    bool der = STORE_DER;
+    credentialPath(path, sizeof(path), name, der);
+    if (!LittleFS.exists(path)) {
+        der = !der;
+        credentialPath(path, sizeof(path), name, der);
+    }
+    File file = LittleFS.open(path, FILE_READ);
+    if (!file) return false;
+    // Un PEM necesita sitio para el terminador.
+    size_t capacity = der ? sizeof(buffer.data) : sizeof(buffer.data) - 1;
+    size_t length = file.size();
+    if (length == 0 || length > capacity) {
+        LOGW("PROV", "%s: %u bytes, expected 1 to %u.", path, (unsigned int)length, (unsigned int)capacity);
+        return false;
+    }
+    uint8_t* target = buffer.data;
+    uint8_t converted[MAX_CREDENTIAL_SIZE];
+    if (der && !STORE_DER) target = converted;
+    length = file.read(target, length);
+    file.close();
+
+    if (!der) {
+        buffer.data[length] = '\0';
+        buffer.length = length + 1;
+        if (!TlsCredential{(const char*)buffer.data, buffer.length}.isPem()) {
+            LOGW("PROV", "%s is not PEM.", path);
+            return false;
+        }
+        return true;
+    }
+    if (!isDer(target, length)) {
+        LOGW("PROV", "%s is not DER.", path);
+        return false;
+    }
+    if (STORE_DER) {
+        buffer.length = length;
+        return true;
+    }
+    const char* label = name == PRIVATE_KEY_NAME ? privateKeyLabel(target, length) : CERTIFICATE_LABEL;
+    buffer.length = label ? derToPem(target, length, label, (char*)buffer.data, sizeof(buffer.data)) : 0;
+    if (buffer.length == 0) {
+        LOGW("PROV", "Cannot convert %s to PEM.", path);
+        return false;
+    }
+    return true;
+}
+
+bool ProvisioningStore::save(const DeviceConfig& config) {
+    // Provisionar es el único caso en que se formatea una partición que no
+    // monta.
+    if (!LittleFS.begin(true)) {
+        LOGE("PROV", "LittleFS mount failed. Nothing provisioned.");
+        return false;
+    }
+    LittleFS.mkdir(PROVISION_DIR);
+    StaticJsonDocument<DEVICE_DOC_SIZE> doc;
+    doc["thingName"] = config.thingName;
+    doc["endpoint"] = config.endpoint;
+    doc["port"] = config.port;
+    doc["wifiSsid"] = config.wifiSsid;
+    doc["wifiPass"] = config.wifiPass;
+    JsonObject servo = doc.createNestedObject("servo");
+    servo["sad"] = config.servoAngles.sad;
+    servo["happy"] = config.servoAngles.happy;
+    servo["neutral"] = config.servoAngles.neutral;
+    JsonArray plants = doc.createNestedArray("plants");
+    for (uint8_t i = 0; i < config.plantCount && i < MAX_PLANTS; i++) {
+        const PlantConfig& plant = config.plants[i];
+        JsonObject entry = plants.createNestedObject();
+        entry["shadowName"] = plant.shadowName ? plant.shadowName : "";
+        entry["soilPin"] = plant.soilMoisturePin;
+        entry["servoPin"] = plant.servoPin;
+        entry["dry"] = plant.soilDryValue;
+        entry["wet"] = plant.soilWetValue;
+    }
+    char buffer[MAX_DEVICE_FILE_SIZE];
+    size_t length = serializeJson(doc, buffer, sizeof(buffer));
+    if (length == 0 || length >= sizeof(buffer) - 1) {
+        LOGE("PROV", "Device config does not fit in %u bytes.", (unsigned int)sizeof(buffer));
+        return false;
+    }
+
+    bool ok = writeFile(DEVICE_PATH, (const uint8_t*)buffer, length);
+    ok = ok && saveCredential(ROOT_CA_NAME, CERTIFICATE_LABEL, config.credentials.rootCa);
+    ok = ok && saveCredential(CERTIFICATE_NAME, CERTIFICATE_LABEL, config.credentials.certificate);
+    ok = ok && saveCredential(PRIVATE_KEY_NAME, nullptr, config.credentials.privateKey);
+    if (ok) LOGI("PROV", "Provisioned %s.", config.thingName);
+    return ok;
+}
+
+// Se guarda solo en el formato del build y se borra el otro, para que
+// load() no encuentre dos versiones. pemLabel nulo: se deduce de la clave.
+bool ProvisioningStore::saveCredential(const char* name, const char* pemLabel, const TlsCredential& credential) {
+    char path[48];
+    char other[48];
+    credentialPath(path, sizeof(path), name, STORE_DER);
+    credentialPath(other, sizeof(other), name, !STORE_DER);
+    LittleFS.remove(other);
+    if (credential.empty()) {
+        LittleFS.remove(path);
+        return true;
+    }
+    bool pem = credential.isPem();
+    if (!pem && !isDer((const uint8_t*)credential.data, credential.length)) {
+        LOGE("PROV", "Credential for %s is neither PEM nor DER.", name);
+        return false;
+    }
+    if (pem != STORE_DER) {
+        // Ya está en el formato del build; un PEM se guarda sin terminador.
+        return writeFile(path, (const uint8_t*)credential.data, pem ? credential.length - 1 : credential.length);
+    }
+    uint8_t converted[MAX_CREDENTIAL_SIZE];
+    size_t length = 0;
+    if (pem) {
+        length = pemToDer(credential, converted, sizeof(converted));
+    } else {
+        const uint8_t* der = (const uint8_t*)credential.data;
+        const char* label = pemLabel ? pemLabel : privateKeyLabel(der, credential.length);
+        // Se escribe sin el terminador.
+        length = label ? derToPem(der, credential.length, label, (char*)converted, sizeof(converted)) : 0;
+        if (length > 0) length--;
+    }
+    if (length == 0) {
+        LOGE("PROV", "Cannot convert the credential for %s to %s.", name, STORE_DER ? "DER" : "PEM");
+        return false;
+    }
+    return writeFile(path, converted, length);
+}
+
+// Se escribe en un temporal y se renombra para no dejar un fichero a medias.
+bool ProvisioningStore::writeFile(const char* path, const uint8_t* data, size_t length) {
+    char tmpPath[48];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+    File file = LittleFS.open(tmpPath, FILE_WRITE);
+    if (!file) return false;
+    bool ok = file.write(data, length) == length;
+    file.close();
+    if (!ok) {
+        LittleFS.remove(tmpPath);
+        return false;
+    }
+    LittleFS.remove(path);
+    return LittleFS.rename(tmpPath, path);
+}
+
+// Sin cabeceras de PEM cifrado (Proc-Type, DEK-Info): la clave del
+// dispositivo va en claro, como en aws_iot_config.cpp.
+size_t ProvisioningStore::pemToDer(const TlsCredential& pem, uint8_t* der, size_t capacity) {
+    if (!pem.isPem()) return 0;
+    const char* p = strstr(pem.data, "-----BEGIN ");
+    p = strchr(p, '\n');
+    if (p == nullptr) return 0;
+    const char* end = strstr(p, "-----END ");
+    if (end == nullptr) return 0;
+
+    uint32_t accumulator = 0;
+    int bits = 0;
+    size_t length = 0;
+    for (p++; p < end; p++) {
+        char c = *p;
+        if (c == '\r' || c == '\n' || c == ' ' || c == '\t') continue;
+        if (c == '=') break;
+        int value = base64Value(c);
+        if (value < 0) return 0;
+        accumulator = (accumulator << 6) | (uint32_t)value;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            if (length >= capacity) return 0;
+            der[length++] = (uint8_t)(accumulator >> bits);
+            accumulator &= (1u << bits) - 1;
+        }
+    }
+    return isDer(der, length) ? length : 0;
+}
+
+size_t ProvisioningStore::derToPem(const uint8_t* der, size_t length, const char* label, char* pem, size_t capacity) {
+    int written = snprintf(pem, capacity, "-----BEGIN %s-----\n", label);
+    if (written < 0 || (size_t)written >= capacity) return 0;
+    size_t pos = written;
+    size_t column = 0;
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t chunk = (uint32_t)der[i] << 16;
+        if (i + 1 < length) chunk |= (uint32_t)der[i + 1] << 8;
+        if (i + 2 < length) chunk |= der[i + 2];
+        char quad[4] = {BASE64[(chunk >> 18) & 0x3F], BASE64[(chunk >> 12) & 0x3F],
+                        i + 1 < length ? BASE64[(chunk >> 6) & 0x3F] : '=', i + 2 < length ? BASE64[chunk & 0x3F] : '='};
+        if (pos + 5 >= capacity) return 0;
+        memcpy(pem + pos, quad, 4);
+        pos += 4;
+        column += 4;
+        // Líneas de 64 caracteres, como las escribe openssl.
+        if (column == 64) {
+            pem[pos++] = '\n';
+            column = 0;
+        }
+    }
+    if (column > 0) {
+        if (pos + 1 >= capacity) return 0;
+        pem[pos++] = '\n';
+    }
+    written = snprintf(pem + pos, capacity - pos, "-----END %s-----\n", label);
+    if (written < 0 || pos + written >= capacity) return 0;
+    return pos + written + 1;
+}
+
+bool ProvisioningStore::isDer(const uint8_t* data, size_t length) {
+    if (data == nullptr || length < 2 || data[0] != 0x30) return false;
+    size_t header = 2;
+    size_t content = data[1];
+    if (content & 0x80) {
+        uint8_t lengthBytes = content & 0x7F;
+        if (lengthBytes == 0 || lengthBytes > 3 || length < header + lengthBytes) return false;
+        content = 0;
+        for (uint8_t i = 0; i < lengthBytes; i++) content = (content << 8) | data[header + i];
+        header += lengthBytes;
+    }
+    return header + content == length;
+}
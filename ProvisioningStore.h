@@ -0,0 +1,80 @@
+#ifndef ProvisioningStore_h
+#define ProvisioningStore_h
+
+#include <Arduino.h>
+#include "aws_iot_config.h"
+
+// Configuración por unidad guardada en LittleFS, para flashear el mismo
+// firmware en toda la flota y provisionar cada placa aparte:
+//  - /provision/device.json: thingName, endpoint, port, wifiSsid, wifiPass,
+//    servo {sad, happy, neutral} y plants [{shadowName, soilPin, servoPin,
+//    dry, wet}]. Todas las claves son opcionales.
+//  - /provision/root_ca, certificate y private_key: credenciales TLS, cada
+//    una en .der o .pem. Con esp-tls (EspTlsClient) se guardan en DER, ya sin
+//    base64, y el handshake no vuelve a decodificar PEM en cada reconexión;
+//    WiFiClientSecure solo acepta PEM y en ese build se guardan en PEM.
+// La contraseña WiFi queda en texto plano en la flash, como antes en el
+// binario. Los ficheros son la única identidad de la unidad: load() nunca
+// formatea la partición; solo save() lo hace si no se puede montar.
+class ProvisioningStore {
+  public:
+    static const size_t MAX_CREDENTIAL_SIZE = 2048;
+    static const size_t MAX_DEVICE_FILE_SIZE = 1024;
+
+    ProvisioningStore();
+
+    // Lee la configuración provisionada; lo que falte o no se pueda leer sale
+    // de fallback (las credenciales van las tres juntas o ninguna). La
+    // referencia, y las cadenas y credenciales a las que apunta, valen
+    // mientras viva el ProvisioningStore. Si al resultado le falta identidad
+    // la unidad no está provisionada: ready() es false.
+    const DeviceConfig& load(const DeviceConfig& fallback);
+    // Escribe config entero, con las credenciales en el formato que usa este
+    // build (se convierte PEM <-> DER si hace falta).
+    bool save(const DeviceConfig& config);
+
+    bool ready() const { return _missing == nullptr; }
+    // Qué impide conectar tras load(): "storage", "thingName", "wifi" o
+    // "credentials"; nullptr si nada.
+    const char* missing() const { return _missing; }
+    bool deviceProvisioned() const { return _deviceProvisioned; }
+    bool credentialsProvisioned() const { return _credentialsProvisioned; }
+
+    // Lo que le falta a config para conectar por su cuenta, o nullptr.
+    static const char* missingIdentity(const DeviceConfig& config);
+    // Decodifica el primer bloque de un PEM; devuelve los bytes DER escritos,
+    // o 0 si no es PEM o no cabe en capacity.
+    static size_t pemToDer(const TlsCredential& pem, uint8_t* der, size_t capacity);
+    // PEM con su terminador (incluido en la longitud devuelta) y la cabecera
+    // label; 0 si no cabe.
+    static size_t derToPem(const uint8_t* der, size_t length, const char* label, char* pem, size_t capacity);
+    // Un SEQUENCE ASN.1 cuya longitud coincide con la del buffer.
+    static bool isDer(const uint8_t* data, size_t length);
+
+  private:
+    struct CredentialBuffer {
+        uint8_t data[MAX_CREDENTIAL_SIZE];
+        size_t length;
+    };
+
+    DeviceConfig _config;
+    char _thingName[129];
+    char _endpoint[129];
+    char _wifiSsid[33];
+    char _wifiPass[65];
+    char _shadowNames[MAX_PLANTS][65];
+    CredentialBuffer _rootCa;
+    CredentialBuffer _certificate;
+    CredentialBuffer _privateKey;
+    bool _deviceProvisioned;
+    bool _credentialsProvisioned;
+    const char* _missing;
+
+    bool loadDevice(const DeviceConfig& fallback);
+    bool loadCredentials();
+    bool readCredential(const char* name, CredentialBuffer& buffer);
+    bool saveCredential(const char* name, const char* pemLabel, const TlsCredential& credential);
+    static bool writeFile(const char* path, const uint8_t* data, size_t length);
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include "PubAckClient.h"
+
+namespace {
+const uint8_t PACKET_PUBACK = 4;
+}
+
+PubAckClient::PubAckClient(Client& inner)
+  : _inner(inner), _ackHead(0), _ackCount(0), _droppedAcks(0) {
+    reset();
+}
+
+int PubAckClient::connect(IPAddress ip, uint16_t port) {
+    reset();
+    _ackCount = 0;
+    return _inner.connect(ip, port);
+}
+
+int PubAckClient::connect(const char* host, uint16_t port) {
+    reset();
+    _ackCount = 0;
+    return _inner.connect(host, port);
+}
+
+void PubAckClient::stop() {
+    _inner.stop();
+    reset();
+}
+
+int PubAckClient::read() {
+    int c = _inner.read();
+    if (c >= 0) feed((uint8_t)c);
+    return c;
+}
+
+int PubAckClient::read(uint8_t* buf, size_t size) {
+    int n = _inner.read(buf, size);
+    for (int i = 0; i < n; i++) feed(buf[i]);
+    return n;
+}
+
+bool PubAckClient::popAck(uint16_t& packetId) {
+    if (_ackCount == 0) return false;
+    packetId = _acks[_ackHead];
+    _ackHead = (_ackHead + 1) % MAX_ACKS;
+    _ackCount--;
+    return true;
+}
+
+void PubAckClient::reset() {
+    _state = READ_HEADER;
+    _header = 0;
+    _remaining = 0;
+    _multiplier = 1;
+    _packetId = 0;
+    _bodyPos = 0;
+}
+
+// Cabecera fija, longitud restante (1-4 bytes, 7 bits por byte) y cuerpo;
+// del cuerpo solo interesan los dos bytes del packet id de un PUBACK.
+void PubAckClient::feed(uint8_t c) {
+    switch (_state) {
+        case READ_HEADER:
+            _header = c;
+            _remaining = 0;
+            _multiplier = 1;
+            _state = READ_LENGTH;
+            break;
+        case READ_LENGTH:
+            _remaining += (uint32_t)(c & 0x7F) * _multiplier;
+            _multiplier *= 128;
+            if (c & 0x80) break;
+            _bodyPos = 0;
+            _packetId = 0;
+            if (_remaining == 0) {
+                packetDone();
+            } else {
+                _state = READ_BODY;
+            }
+            break;
+        case READ_BODY:
+            if (_bodyPos < 2) _packetId = (uint16_t)((_packetId << 8) | c);
+            if (++_bodyPos == _remaining) packetDone();
+            break;
+    }
+}
+
+void PubAckClient::packetDone() {
+    if ((_header >> 4) == PACKET_PUBACK && _remaining == 2) {
+        if (_ackCount == MAX_ACKS) {
+            _droppedAcks++; // MQTTManager no los recoge; el reintento lo cubre.
+        } else {
+            _acks[(_ackHead + _ackCount) % MAX_ACKS] = _packetId;
+            _ackCount++;
+        }
+    }
+    _state = READ_HEADER;
+}
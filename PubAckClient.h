@@ -0,0 +1,57 @@
+#ifndef PubAckClient_h
+#define PubAckClient_h
+
+#include <Arduino.h>
+#include <Client.h>
+
+// Client que se pone entre PubSubClient y el socket TLS. PubSubClient solo
+// publica con QoS 0 y descarta los PUBACK que recibe; este envoltorio sigue
+// el entramado MQTT de lo que lee PubSubClient y guarda el packet id de cada
+// PUBACK para que MQTTManager cierre sus publicaciones QoS 1. Todo lo demás
+// pasa tal cual.
+class PubAckClient : public Client {
+  public:
+    explicit PubAckClient(Client& inner);
+
+    // Saca el siguiente PUBACK recibido; false si no queda ninguno.
+    bool popAck(uint16_t& packetId);
+    unsigned long droppedAcks() const { return _droppedAcks; }
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    size_t write(uint8_t c) override { return _inner.write(c); }
+    size_t write(const uint8_t* buf, size_t size) override { return _inner.write(buf, size); }
+    int available() override { return _inner.available(); }
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override { return _inner.peek(); }
+    void flush() override { _inner.flush(); }
+    void stop() override;
+    uint8_t connected() override { return _inner.connected(); }
+    operator bool() override { return _inner.connected(); }
+
+    using Print::write;
+
+  private:
+    enum State : uint8_t { READ_HEADER, READ_LENGTH, READ_BODY };
+
+    static const uint8_t MAX_ACKS = 16;
+
+    Client& _inner;
+    State _state;
+    uint8_t _header;
+    uint32_t _remaining;
+    uint32_t _multiplier;
+    uint16_t _packetId;
+    uint32_t _bodyPos;
+    uint16_t _acks[MAX_ACKS];
+    uint8_t _ackHead;
+    uint8_t _ackCount;
+    unsigned long _droppedAcks;
+
+    void reset();
+    void feed(uint8_t c);
+    void packetDone();
+};
+
+#endif
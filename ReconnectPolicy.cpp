@@ -0,0 +1,87 @@
+#include "ReconnectPolicy.h"
+
+ReconnectPolicy::ReconnectPolicy(unsigned long baseDelayMs, unsigned long maxDelayMs,
+                                 uint8_t breakerThreshold, unsigned long breakerCooldownMs)
+  : _baseDelayMs(baseDelayMs),
+    _maxDelayMs(maxDelayMs),
+    _breakerThreshold(breakerThreshold),
+    _breakerCooldownMs(breakerCooldownMs),
+    _state(READY),
+    _waitStartMillis(0),
+    _delayMs(0),
+    _consecutiveFailures(0),
+    _attempts(0),
+    _failures(0),
+    _circuitOpens(0),
+    _lastAttemptMillis(0) {}
+
+const char* ReconnectPolicy::stateName(State state) {
+    switch (state) {
+        case READY: return "READY";
+        case BACKING_OFF: return "BACKING_OFF";
+        case CIRCUIT_OPEN: return "CIRCUIT_OPEN";
+        default: return "UNKNOWN";
+    }
+}
+
+bool ReconnectPolicy::due(unsigned long now) const {
+    return waitTime(now) == 0;
+}
+
+unsigned long ReconnectPolicy::waitTime(unsigned long now) const {
+    if (_state == READY) return 0;
+    unsigned long elapsed = now - _waitStartMillis;
+    return elapsed >= _delayMs ? 0 : _delayMs - elapsed;
+}
+
+void ReconnectPolicy::attempt(unsigned long now) {
+    _attempts++;
+    _lastAttemptMillis = now;
+}
+
+void ReconnectPolicy::success() {
+    _consecutiveFailures = 0;
+    _state = READY;
+}
+
+unsigned long ReconnectPolicy::failure(unsigned long now) {
+    _failures++;
+    if (_consecutiveFailures < 255) _consecutiveFailures++;
+
+    if (_breakerThreshold > 0 && _consecutiveFailures >= _breakerThreshold) {
+        if (_state != CIRCUIT_OPEN) _circuitOpens++;
+        return backOff(now, CIRCUIT_OPEN, _breakerCooldownMs);
+    }
+
+    // base * 2^(fallos - 1), sin desbordar antes de llegar al tope.
+    unsigned long delayMs = _baseDelayMs;
+    for (uint8_t i = 1; i < _consecutiveFailures && delayMs < _maxDelayMs; i++) {
+        delayMs = delayMs > _maxDelayMs / 2 ? _maxDelayMs : delayMs * 2;
+    }
+    if (delayMs > _maxDelayMs) delayMs = _maxDelayMs;
+    return backOff(now, BACKING_OFF, delayMs);
+}
+
+unsigned long ReconnectPolicy::lost(unsigned long now) {
+    _consecutiveFailures = 0;
+    return backOff(now, BACKING_OFF, _baseDelayMs);
+}
+
+void ReconnectPolicy::reset() {
+    _consecutiveFailures = 0;
+    _state = READY;
+}
+
+unsigned long ReconnectPolicy::backOff(unsigned long now, State state, unsigned long delayMs) {
+    _state = state;
+    _waitStartMillis = now;
+    _delayMs = jitter(delayMs);
+    return _delayMs;
+}
+
+// Entre la mitad y el total: conserva el crecimiento exponencial y reparte
+// los reintentos de muchos dispositivos.
+unsigned long ReconnectPolicy::jitter(unsigned long delayMs) {
+    unsigned long half = delayMs / 2;
+    return half + (unsigned long)random(0, (long)(delayMs - half) + 1);
+}
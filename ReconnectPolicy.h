@@ -0,0 +1,66 @@
+#ifndef ReconnectPolicy_h
+#define ReconnectPolicy_h
+
+#include <Arduino.h>
+
+// Cuándo reintentar una conexión (WiFi, MQTT). La espera crece al doble con
+// cada fallo seguido hasta un tope y se elige al azar entre la mitad y el
+// total, así los dispositivos que cayeron a la vez no reintentan a la vez.
+// Con breakerThreshold > 0, tras ese número de fallos seguidos el circuito se
+// abre y se espera breakerCooldownMs antes de probar otra vez; si la prueba
+// falla se vuelve a abrir. La política solo decide el momento: quien la usa
+// hace el intento y le cuenta el resultado.
+class ReconnectPolicy {
+  public:
+    enum State : uint8_t {
+        READY,          // Se puede intentar ya
+        BACKING_OFF,    // Esperando tras un fallo o una caída
+        CIRCUIT_OPEN    // Demasiados fallos seguidos: pausa larga
+    };
+
+    ReconnectPolicy(unsigned long baseDelayMs, unsigned long maxDelayMs,
+                    uint8_t breakerThreshold = 0, unsigned long breakerCooldownMs = 0);
+
+    bool due(unsigned long now) const;
+    // Milisegundos hasta el siguiente intento permitido (0 si ya toca).
+    unsigned long waitTime(unsigned long now) const;
+
+    void attempt(unsigned long now);
+    void success();
+    // Devuelven la espera elegida hasta el siguiente intento.
+    unsigned long failure(unsigned long now);
+    // Se perdió una conexión que estaba hecha: primera espera corta, sin
+    // contar como intento fallido.
+    unsigned long lost(unsigned long now);
+    void reset();
+
+    State state() const { return _state; }
+    static const char* stateName(State state);
+
+    unsigned long attempts() const { return _attempts; }
+    unsigned long failures() const { return _failures; }
+    uint8_t consecutiveFailures() const { return _consecutiveFailures; }
+    unsigned long circuitOpens() const { return _circuitOpens; }
+    unsigned long lastDelayMs() const { return _delayMs; }
+    unsigned long lastAttemptMillis() const { return _lastAttemptMillis; }
+
+  private:
+    const unsigned long _baseDelayMs;
+    const unsigned long _maxDelayMs;
+    const uint8_t _breakerThreshold;
+    const unsigned long _breakerCooldownMs;
+
+    State _state;
+    unsigned long _waitStartMillis;
+    unsigned long _delayMs;
+    uint8_t _consecutiveFailures;
+    unsigned long _attempts;
+    unsigned long _failures;
+    unsigned long _circuitOpens;
+    unsigned long _lastAttemptMillis;
+
+    unsigned long backOff(unsigned long now, State state, unsigned long delayMs);
+    static unsigned long jitter(unsigned long delayMs);
+};
+
+#endif
@@ -0,0 +1,101 @@
+#include "ReportCoordinator.h"
+
+ReportCoordinator::ReportCoordinator(unsigned long timeoutMs)
+  : _timeoutMs(timeoutMs),
+    _state(IDLE),
+    _token(0),
+    _sentVersion(0),
+    _sentMillis(0),
+    _inFlightFields(0),
+    _inFlightClearDesired(false),
+    _pendingFields(0),
+    _pendingClearDesired(false) {}
+
+void ReportCoordinator::request(uint8_t fields, bool clearDesired) {
+    _pendingFields |= fields;
+    _pendingClearDesired = _pendingClearDesired || clearDesired;
+}
+
+uint32_t ReportCoordinator::start(uint8_t extraFields, unsigned long version, unsigned long now) {
+    _inFlightFields = _pendingFields | extraFields;
+    _inFlightClearDesired = _pendingClearDesired;
+    _pendingFields = 0;
+    _pendingClearDesired = false;
+    _sentVersion = version;
+    _sentMillis = now;
+    _state = IN_FLIGHT;
+    if (++_token == 0) _token = 1;
+    return _token;
+}
+
+bool ReportCoordinator::accepted(uint32_t token) {
+    if (_state != IN_FLIGHT || token != _token) return false;
+    _state = IDLE;
+    _inFlightFields = 0;
+    _inFlightClearDesired = false;
+    return true;
+}
+
+bool ReportCoordinator::rejected(uint32_t token, bool retry) {
+    if (_state != IN_FLIGHT || token != _token) return false;
+    if (retry) requeueInFlight();
+    _inFlightFields = 0;
+    _inFlightClearDesired = false;
+    _state = IDLE;
+    return true;
+}
+
+void ReportCoordinator::waitForSync(unsigned long now) {
+    if (_state == IN_FLIGHT) requeueInFlight();
+    _sentMillis = now;
+    _state = WAITING_SYNC;
+}
+
+void ReportCoordinator::synced() {
+    _inFlightFields = 0;
+    _inFlightClearDesired = false;
+    _pendingFields = 0;
+    _pendingClearDesired = false;
+    _state = IDLE;
+}
+
+void ReportCoordinator::reset() {
+    if (_state == IN_FLIGHT) requeueInFlight();
+    _state = IDLE;
+}
+
+void ReportCoordinator::lost(uint32_t token) {
+    if (_state == IN_FLIGHT && token == _token) reset();
+}
+
+bool ReportCoordinator::expire(unsigned long now) {
+    if (_state == IDLE || now - _sentMillis < _timeoutMs) return false;
+    reset();
+    return true;
+}
+
+unsigned long ReportCoordinator::timeUntilExpiry(unsigned long now) const {
+    unsigned long elapsed = now - _sentMillis;
+    return elapsed >= _timeoutMs ? 0 : _timeoutMs - elapsed;
+}
+
+void ReportCoordinator::requeueInFlight() {
+    _pendingFields |= _inFlightFields;
+    _pendingClearDesired = _pendingClearDesired || _inFlightClearDesired;
+    _inFlightFields = 0;
+    _inFlightClearDesired = false;
+}
+
+// clientToken "r<n>": el prefijo lo distingue de los de otros clientes.
+bool ReportCoordinator::parseToken(const char* clientToken, uint32_t& token) {
+    if (clientToken == nullptr || clientToken[0] != 'r' || clientToken[1] == '\0') return false;
+    char* end = nullptr;
+    unsigned long value = strtoul(clientToken + 1, &end, 10);
+    if (*end != '\0') return false;
+    token = (uint32_t)value;
+    return true;
+}
+
+void ReportCoordinator::formatToken(uint32_t token, char* buffer, size_t size) {
+    snprintf(buffer, size, "r%lu", (unsigned long)token);
+}
@@ -0,0 +1,81 @@
+#ifndef ReportCoordinator_h
+#define ReportCoordinator_h
+
+#include <Arduino.h>
+
+// Un solo update del shadow en vuelo. Lo que haya que reportar mientras
+// tanto se junta en el siguiente reporte, que sale cuando llega la respuesta
+// del que está en vuelo (update/accepted o update/rejected con su
+// clientToken). El rechazo 409 de AWS no trae la versión vigente: se reenvía
+// con la última vista en update/accepted o delta y, si no hay ninguna más
+// nueva que la enviada, se espera al get/accepted. Como ReconnectPolicy, solo
+// decide: quien lo usa publica y le cuenta lo que pasó.
+class ReportCoordinator {
+  public:
+    enum State : uint8_t {
+        IDLE,           // Nada en vuelo
+        IN_FLIGHT,      // Esperando la respuesta del reporte con token()
+        WAITING_SYNC    // 409 sin versión más nueva: esperando un GET
+    };
+
+    explicit ReportCoordinator(unsigned long timeoutMs);
+
+    // Añade campos (y el borrado de desired) al siguiente reporte.
+    void request(uint8_t fields, bool clearDesired);
+    // Hay algo pendiente y se puede enviar ya.
+    bool ready() const { return _state == IDLE && hasPending(); }
+    bool hasPending() const { return _pendingFields != 0 || _pendingClearDesired; }
+    bool idle() const { return _state == IDLE && !hasPending(); }
+    uint8_t pendingFields() const { return _pendingFields; }
+    bool pendingClearDesired() const { return _pendingClearDesired; }
+
+    // Lo pendiente (más extraFields) sale ahora con la versión indicada;
+    // devuelve el clientToken del reporte.
+    uint32_t start(uint8_t extraFields, unsigned long version, unsigned long now);
+
+    // Respuesta al reporte con este token; false si no es el que está en
+    // vuelo (otro cliente, o una respuesta tardía ya descartada).
+    bool accepted(uint32_t token);
+    // Rechazado; con retry lo que llevaba vuelve a lo pendiente (un 409), si
+    // no se descarta (un 400 se repetiría igual).
+    bool rejected(uint32_t token, bool retry);
+    // Se pidió el shadow (tras un 409 sin versión más nueva o al conectar):
+    // no sale nada hasta synced() o hasta que venza la espera.
+    void waitForSync(unsigned long now);
+    // Llegó el shadow: lo que falta en la nube se recalcula con él, así que
+    // lo pendiente se descarta.
+    void synced();
+    // La sesión MQTT se cerró: lo que estuviera en vuelo ya no tendrá
+    // respuesta y vuelve a lo pendiente.
+    void reset();
+    // El reporte con este token no llegó al broker (sin PUBACK).
+    void lost(uint32_t token);
+    // Vence la espera del reporte en vuelo o del GET: lo que llevaba vuelve a
+    // lo pendiente. true si se liberó.
+    bool expire(unsigned long now);
+    unsigned long timeUntilExpiry(unsigned long now) const;
+
+    State state() const { return _state; }
+    uint32_t token() const { return _token; }
+    unsigned long sentVersion() const { return _sentVersion; }
+    uint8_t inFlightFields() const { return _inFlightFields; }
+    bool inFlightClearDesired() const { return _inFlightClearDesired; }
+
+    static bool parseToken(const char* clientToken, uint32_t& token);
+    static void formatToken(uint32_t token, char* buffer, size_t size);
+
+  private:
+    const unsigned long _timeoutMs;
+    State _state;
+    uint32_t _token;
+    unsigned long _sentVersion;
+    unsigned long _sentMillis;
+    uint8_t _inFlightFields;
+    bool _inFlightClearDesired;
+    uint8_t _pendingFields;
+    bool _pendingClearDesired;
+
+    void requeueInFlight();
+};
+
+#endif
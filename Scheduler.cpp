@@ -0,0 +1,124 @@
+#include "Scheduler.h"
+
+Scheduler::Scheduler() : _taskCount(0), _heapSize(0) {}
+
+Scheduler::TaskId Scheduler::add(Task task, unsigned long periodMs) {
+    if (_taskCount >= MAX_TASKS) return INVALID_TASK;
+    TaskId id = _taskCount++;
+    _slots[id].task = task;
+    _slots[id].due = 0;
+    _slots[id].period = periodMs;
+    _slots[id].heapIndex = -1;
+    return id;
+}
+
+// Comparación con resta para que el desbordamiento de millis() no afecte.
+bool Scheduler::earlier(uint8_t a, uint8_t b) const {
+    return (long)(_slots[_heap[a]].due - _slots[_heap[b]].due) < 0;
+}
+
+void Scheduler::place(uint8_t heapIndex, TaskId id) {
+    _heap[heapIndex] = id;
+    _slots[id].heapIndex = heapIndex;
+}
+
+void Scheduler::siftUp(uint8_t heapIndex) {
+    while (heapIndex > 0) {
+        uint8_t parent = (heapIndex - 1) / 2;
+        if (!earlier(heapIndex, parent)) break;
+        TaskId moved = _heap[parent];
+        place(parent, _heap[heapIndex]);
+        place(heapIndex, moved);
+        heapIndex = parent;
+    }
+}
+
+void Scheduler::siftDown(uint8_t heapIndex) {
+    while (true) {
+        uint8_t left = heapIndex * 2 + 1;
+        uint8_t right = left + 1;
+        uint8_t smallest = heapIndex;
+        if (left < _heapSize && earlier(left, smallest)) smallest = left;
+        if (right < _heapSize && earlier(right, smallest)) smallest = right;
+        if (smallest == heapIndex) break;
+        TaskId moved = _heap[smallest];
+        place(smallest, _heap[heapIndex]);
+        place(heapIndex, moved);
+        heapIndex = smallest;
+    }
+}
+
+void Scheduler::schedule(TaskId id, unsigned long due) {
+    Slot& slot = _slots[id];
+    slot.due = due;
+    if (slot.heapIndex < 0) {
+        place(_heapSize++, id);
+    }
+    siftUp(slot.heapIndex);
+    siftDown(slot.heapIndex);
+}
+
+void Scheduler::remove(TaskId id) {
+    int8_t heapIndex = _slots[id].heapIndex;
+    if (heapIndex < 0) return;
+    _slots[id].heapIndex = -1;
+    _heapSize--;
+    if (heapIndex == _heapSize) return;
+    TaskId moved = _heap[_heapSize];
+    place(heapIndex, moved);
+    siftUp(heapIndex);
+    siftDown(_slots[moved].heapIndex);
+}
+
+void Scheduler::runIn(TaskId id, unsigned long delayMs) {
+    if (id < 0 || id >= _taskCount) return;
+    schedule(id, millis() + delayMs);
+}
+
+void Scheduler::runWithin(TaskId id, unsigned long delayMs) {
+    if (id < 0 || id >= _taskCount) return;
+    unsigned long due = millis() + delayMs;
+    if (_slots[id].heapIndex >= 0 && (long)(_slots[id].due - due) <= 0) return;
+    schedule(id, due);
+}
+
+void Scheduler::setPeriod(TaskId id, unsigned long periodMs) {
+    if (id < 0 || id >= _taskCount) return;
+    _slots[id].period = periodMs;
+}
+
+void Scheduler::cancel(TaskId id) {
+    if (id < 0 || id >= _taskCount) return;
+    remove(id);
+}
+
+bool Scheduler::scheduled(TaskId id) const {
+    return id >= 0 && id < _taskCount && _slots[id].heapIndex >= 0;
+}
+
+unsigned long Scheduler::run() {
+    // Como mucho una pasada por tarea: una tarea que se reprograma a 0 ms no
+    // puede acaparar el bucle.
+    for (uint8_t budget = _taskCount; budget > 0 && _heapSize > 0; budget--) {
+        TaskId id = _heap[0];
+        Slot& slot = _slots[id];
+        unsigned long now = millis();
+        if ((long)(slot.due - now) > 0) break;
+
+        if (slot.period > 0) {
+            // Sin ráfagas de recuperación si la tarea se ha retrasado.
+            unsigned long next = slot.due + slot.period;
+            schedule(id, (long)(next - now) > 0 ? next : now + slot.period);
+        } else {
+            remove(id);
+        }
+        slot.task();
+    }
+    return idleTime();
+}
+
+unsigned long Scheduler::idleTime() const {
+    if (_heapSize == 0) return IDLE_FOREVER;
+    long remaining = (long)(_slots[_heap[0]].due - millis());
+    return remaining > 0 ? (unsigned long)remaining : 0;
+}
@@ -0,0 +1,59 @@
+#ifndef Scheduler_h
+#define Scheduler_h
+
+#include <Arduino.h>
+#include <functional>
+
+// Planificador cooperativo: cada tarea tiene un plazo (millis) y las tareas
+// programadas se guardan en un min-heap, así run() solo mira la raíz para
+// saber si hay algo pendiente y cuánto se puede dormir hasta el siguiente
+// plazo. Las tareas no se interrumpen entre sí; deben volver rápido.
+class Scheduler {
+  public:
+    using Task = std::function<void()>;
+    typedef int8_t TaskId;
+
+    static const uint8_t MAX_TASKS = 12;
+    static const TaskId INVALID_TASK = -1;
+    static const unsigned long IDLE_FOREVER = 0xFFFFFFFFUL;
+
+    Scheduler();
+
+    // Registra una tarea sin programarla. periodMs = 0 la hace de un solo uso.
+    TaskId add(Task task, unsigned long periodMs = 0);
+    // Programa la siguiente ejecución dentro de delayMs; si ya estaba
+    // programada se adelanta o retrasa.
+    void runIn(TaskId id, unsigned long delayMs);
+    // Como runIn, pero solo si no hay una ejecución anterior ya programada.
+    void runWithin(TaskId id, unsigned long delayMs);
+    void setPeriod(TaskId id, unsigned long periodMs);
+    void cancel(TaskId id);
+    bool scheduled(TaskId id) const;
+
+    // Ejecuta las tareas vencidas y devuelve los ms hasta el siguiente plazo
+    // (IDLE_FOREVER si no queda ninguna programada).
+    unsigned long run();
+    unsigned long idleTime() const;
+
+  private:
+    struct Slot {
+        Task task;
+        unsigned long due;
+        unsigned long period;
+        int8_t heapIndex;   // -1: no programada
+    };
+
+    Slot _slots[MAX_TASKS];
+    TaskId _heap[MAX_TASKS];
+    uint8_t _taskCount;
+    uint8_t _heapSize;
+
+    bool earlier(uint8_t a, uint8_t b) const;
+    void place(uint8_t heapIndex, TaskId id);
+    void siftUp(uint8_t heapIndex);
+    void siftDown(uint8_t heapIndex);
+    void schedule(TaskId id, unsigned long due);
+    void remove(TaskId id);
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef SpscQueue_h
+#define SpscQueue_h
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Cola circular sin bloqueos para un único productor y un único consumidor
+// (cada uno en su propia tarea o núcleo). El productor solo escribe _head y
+// el consumidor solo _tail; el orden acquire/release basta para publicar el
+// elemento antes que el índice. Capacity debe ser potencia de dos; caben
+// Capacity - 1 elementos.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+  public:
+    SpscQueue() : _head(0), _tail(0) {}
+
+    // Solo desde el productor.
+    bool push(const T& item) {
+        size_t head = _head.load(std::memory_order_relaxed);
+        size_t next = (head + 1) & (Capacity - 1);
+        if (next == _tail.load(std::memory_order_acquire)) return false;
+        _items[head] = item;
+        _head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Solo desde el consumidor.
+    bool pop(T& item) {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire)) return false;
+        item = _items[tail];
+        _tail.store((tail + 1) & (Capacity - 1), std::memory_order_release);
+        return true;
+    }
+
+    // Desde cualquiera de los dos lados; el valor puede quedar obsoleto enseguida.
+    bool empty() const {
+        return _tail.load(std::memory_order_acquire) == _head.load(std::memory_order_acquire);
+    }
+
+    size_t size() const {
+        return (_head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire)) & (Capacity - 1);
+    }
+
+    static size_t capacity() { return Capacity - 1; }
+
+  private:
+    T _items[Capacity];
+    // En líneas distintas para que productor y consumidor no se pisen la caché.
+    alignas(32) std::atomic<size_t> _head;
+    alignas(32) std::atomic<size_t> _tail;
+};
+
+#endif
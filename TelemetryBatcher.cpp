@@ -0,0 +1,73 @@
+#include "TelemetryBatcher.h"
+#include <time.h>
+
+namespace {
+size_t putVarint(uint8_t* out, size_t pos, size_t capacity, uint32_t value) {
+    do {
+        if (pos >= capacity) return 0;
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        if (value != 0) byte |= 0x80;
+        out[pos++] = byte;
+    } while (value != 0);
+    return pos;
+}
+
+size_t putZigzag(uint8_t* out, size_t pos, size_t capacity, int32_t value) {
+    return putVarint(out, pos, capacity, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+}
+
+TelemetryBatcher::TelemetryBatcher(unsigned long sampleIntervalMs, uint8_t batchSize)
+  : _count(0), _hasSampled(false), _lastSampleMillis(0), _firstSampleEpoch(0) {
+    configure(sampleIntervalMs, batchSize);
+}
+
+void TelemetryBatcher::configure(unsigned long sampleIntervalMs, uint8_t batchSize) {
+    _sampleIntervalMs = sampleIntervalMs > 0 ? sampleIntervalMs : 1;
+    _batchSize = constrain(batchSize, 1, MAX_BATCH_SIZE);
+}
+
+bool TelemetryBatcher::sampleDue(unsigned long now) const {
+    return !_hasSampled || now - _lastSampleMillis >= _sampleIntervalMs;
+}
+
+void TelemetryBatcher::addSample(unsigned long now, int rawValue, int percentage) {
+    if (_count >= MAX_BATCH_SIZE) return;
+    if (_count == 0) {
+        time_t epoch = time(nullptr);
+        _firstSampleEpoch = epoch > 1000000000L ? (uint32_t)epoch : 0;
+    }
+    _samples[_count].millis = now;
+    _samples[_count].rawValue = (uint16_t)constrain(rawValue, 0, 0xFFFF);
+    _samples[_count].percentage = (uint8_t)constrain(percentage, 0, 100);
+    _count++;
+    _hasSampled = true;
+    _lastSampleMillis = now;
+}
+
+size_t TelemetryBatcher::encode(uint8_t* out, size_t capacity) const {
+    if (_count == 0 || capacity == 0) return 0;
+
+    size_t pos = 0;
+    out[pos++] = FORMAT_VERSION;
+    pos = putVarint(out, pos, capacity, _firstSampleEpoch);
+    if (pos) pos = putVarint(out, pos, capacity, _sampleIntervalMs);
+    if (pos) pos = putVarint(out, pos, capacity, _count);
+    if (pos) pos = putVarint(out, pos, capacity, _samples[0].rawValue);
+    if (pos && pos < capacity) out[pos++] = _samples[0].percentage;
+    else return 0;
+
+    for (uint8_t i = 1; i < _count && pos; i++) {
+        const Sample& prev = _samples[i - 1];
+        const Sample& cur = _samples[i];
+        pos = putZigzag(out, pos, capacity, (int32_t)(cur.millis - prev.millis) - (int32_t)_sampleIntervalMs);
+        if (pos) pos = putZigzag(out, pos, capacity, (int32_t)cur.rawValue - (int32_t)prev.rawValue);
+        if (pos) pos = putZigzag(out, pos, capacity, (int32_t)cur.percentage - (int32_t)prev.percentage);
+    }
+    return pos;
+}
+
+void TelemetryBatcher::clear() {
+    _count = 0;
+}
@@ -0,0 +1,52 @@
+#ifndef TelemetryBatcher_h
+#define TelemetryBatcher_h
+
+#include <Arduino.h>
+
+// Acumula muestras de humedad en RAM y las codifica en lotes binarios
+// compactos para publicarlas en un topic de telemetría propio.
+//
+// Formato (v1), enteros en varint LEB128 y diferencias en zigzag:
+//   u8      versión del formato (1)
+//   varint  epoch en segundos de la primera muestra (0 si no hay hora NTP)
+//   varint  intervalo nominal de muestreo en ms
+//   varint  número de muestras N
+//   varint  raw de la primera muestra
+//   u8      porcentaje de la primera muestra
+//   N-1 veces:
+//     zigzag  (ms desde la muestra anterior) - intervalo nominal
+//     zigzag  raw - raw anterior
+//     zigzag  porcentaje - porcentaje anterior
+class TelemetryBatcher {
+  public:
+    static const uint8_t MAX_BATCH_SIZE = 64;
+    static const size_t MAX_ENCODED_SIZE = 1 + 5 + 5 + 5 + 5 + 1 + (MAX_BATCH_SIZE - 1) * (5 + 3 + 2);
+    static const uint8_t FORMAT_VERSION = 1;
+
+    TelemetryBatcher(unsigned long sampleIntervalMs, uint8_t batchSize);
+    void configure(unsigned long sampleIntervalMs, uint8_t batchSize);
+
+    bool sampleDue(unsigned long now) const;
+    void addSample(unsigned long now, int rawValue, int percentage);
+    bool batchReady() const { return _count >= _batchSize; }
+    uint8_t count() const { return _count; }
+    size_t encode(uint8_t* out, size_t capacity) const;
+    void clear();
+
+  private:
+    struct Sample {
+        unsigned long millis;
+        uint16_t rawValue;
+        uint8_t percentage;
+    };
+
+    unsigned long _sampleIntervalMs;
+    uint8_t _batchSize;
+    uint8_t _count;
+    bool _hasSampled;
+    unsigned long _lastSampleMillis;
+    uint32_t _firstSampleEpoch;
+    Sample _samples[MAX_BATCH_SIZE];
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef TlsCredentials_h
+#define TlsCredentials_h
+
+#include <stddef.h>
+#include <string.h>
+
+// Certificado o clave para el handshake TLS, como lo recibe mbedtls: texto
+// PEM con su terminador incluido en length, o DER (binario, ya sin base64).
+// Con DER el handshake se ahorra decodificar el base64 en cada conexión.
+struct TlsCredential {
+    const char* data;
+    size_t length;
+
+    bool empty() const { return data == nullptr || length == 0; }
+    // Mismo criterio que mbedtls_x509_crt_parse: PEM si termina en '\0' y
+    // lleva la cabecera; si no, DER.
+    bool isPem() const { return !empty() && data[length - 1] == '\0' && strstr(data, "-----BEGIN ") != nullptr; }
+};
+
+struct TlsCredentials {
+    TlsCredential rootCa;
+    TlsCredential certificate;
+    TlsCredential privateKey;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "TopicRouter.h"
+#include <string.h>
+
+TopicRouter::TopicRouter() {
+    clear();
+}
+
+void TopicRouter::clear() {
+    _nodes.clear();
+    _nodes.push_back({String(), -1, -1, NO_ROUTE});
+}
+
+bool TopicRouter::add(const char* filter, int route) {
+    if (filter == nullptr || filter[0] == '\0' || route < 0) return false;
+
+    int16_t node = 0;
+    const char* level = filter;
+    while (true) {
+        const char* end = strchr(level, '/');
+        size_t length = end ? (size_t)(end - level) : strlen(level);
+        bool isHash = length == 1 && level[0] == '#';
+        if (isHash && end != nullptr) {
+            return false; // '#' solo puede ir al final
+        }
+        int16_t child = findChild(node, level, length);
+        if (child < 0) {
+            child = addChild(node, level, length);
+            if (child < 0) return false;
+        }
+        node = child;
+        if (end == nullptr) break;
+        level = end + 1;
+    }
+    _nodes[node].route = route;
+    return true;
+}
+
+int TopicRouter::match(const char* topic) const {
+    if (topic == nullptr || topic[0] == '\0') return NO_ROUTE;
+    return matchFrom(0, topic);
+}
+
+int16_t TopicRouter::findChild(int16_t parent, const char* level, size_t length) const {
+    for (int16_t child = _nodes[parent].firstChild; child >= 0; child = _nodes[child].nextSibling) {
+        const String& name = _nodes[child].level;
+        if (name.length() == length && strncmp(name.c_str(), level, length) == 0) {
+            return child;
+        }
+    }
+    return -1;
+}
+
+int16_t TopicRouter::addChild(int16_t parent, const char* level, size_t length) {
+    if (_nodes.size() >= INT16_MAX) return -1;
+    int16_t index = (int16_t)_nodes.size();
+    _nodes.push_back({String(level, length), -1, _nodes[parent].firstChild, NO_ROUTE});
+    _nodes[parent].firstChild = index;
+    return index;
+}
+
+int TopicRouter::routeOf(int16_t node, bool topicEnds) const {
+    if (!topicEnds) return NO_ROUTE;
+    if (_nodes[node].route != NO_ROUTE) return _nodes[node].route;
+    // "a/#" también coincide con "a".
+    int16_t hash = findChild(node, "#", 1);
+    return hash >= 0 ? _nodes[hash].route : NO_ROUTE;
+}
+
+int TopicRouter::matchFrom(int16_t node, const char* level) const {
+    const char* end = strchr(level, '/');
+    size_t length = end ? (size_t)(end - level) : strlen(level);
+    const char* next = end ? end + 1 : nullptr;
+    // Los comodines del primer nivel no coinciden con topics que empiezan por '$' (MQTT 3.1.1 4.7.2).
+    bool wildcardsAllowed = !(node == 0 && level[0] == '$');
+
+    int16_t exact = findChild(node, level, length);
+    if (exact >= 0) {
+        int route = next ? matchFrom(exact, next) : routeOf(exact, true);
+        if (route != NO_ROUTE) return route;
+    }
+    if (!wildcardsAllowed) return NO_ROUTE;
+
+    int16_t plus = findChild(node, "+", 1);
+    if (plus >= 0) {
+        int route = next ? matchFrom(plus, next) : routeOf(plus, true);
+        if (route != NO_ROUTE) return route;
+    }
+    int16_t hash = findChild(node, "#", 1);
+    if (hash >= 0) return _nodes[hash].route;
+    return NO_ROUTE;
+}
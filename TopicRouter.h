@@ -0,0 +1,35 @@
+#ifndef TopicRouter_h
+#define TopicRouter_h
+
+#include <Arduino.h>
+#include <vector>
+
+// Trie sobre los niveles de un topic MQTT. Los filtros admiten los comodines
+// '+' (un nivel) y '#' (resto del topic); match() resuelve un topic al índice de
+// ruta registrado con add() en un solo recorrido y sin reservar memoria.
+class TopicRouter {
+  public:
+    static const int NO_ROUTE = -1;
+
+    TopicRouter();
+    bool add(const char* filter, int route);
+    int match(const char* topic) const;
+    void clear();
+
+  private:
+    struct Node {
+        String level;
+        int16_t firstChild;
+        int16_t nextSibling;
+        int16_t route;
+    };
+
+    std::vector<Node> _nodes;
+
+    int16_t findChild(int16_t parent, const char* level, size_t length) const;
+    int16_t addChild(int16_t parent, const char* level, size_t length);
+    int matchFrom(int16_t node, const char* level) const;
+    int routeOf(int16_t node, bool topicEnds) const;
+};
+
+#endif
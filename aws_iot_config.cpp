@@ -1,8 +1,10 @@
 #include "aws_iot_config.h" 
 
+#if FLOR_DEV_CREDENTIALS
+
 // ========= CONFIGURACIÓN WIFI =========
-const char* WIFI_SSID = "Flia. Salvatierra."; 
-const char* WIFI_PASS = "R4mir3zZ73"; 
+const char WIFI_SSID[] = "Flia. Salvatierra."; 
+const char WIFI_PASS[] = "R4mir3zZ73"; 
 
 // ========= CERTIFICADOS =========
 const char AWS_ROOT_CA[] PROGMEM = R"EOF(
@@ -81,12 +83,103 @@ DPd/yuBB0S7IVxVtcPT5ackI9mk9GZ9d50j9ljvr34WcgGm80q8=
 -----END RSA PRIVATE KEY-----
 )KEY";
 
-// Soil moisture calibration values
+#endif
+
+// Soil moisture calibration values y ángulos del servo (los de la unidad por
+// defecto; van antes de DEFAULT_DEVICE_CONFIG para que siga siendo una
+// constante)
 
 const int SOIL_DRY_VALUE = 4095;
 const int SOIL_WET_VALUE = 2400;
-
-// Servo angles
 const int SERVO_SAD_ANGLE = 0;
 const int SERVO_HAPPY_ANGLE = 180;
-const int SERVO_NEUTRAL_ANGLE = 90;
\ No newline at end of file
+const int SERVO_NEUTRAL_ANGLE = 90;
+
+// Solo direcciones y constantes: se inicializa antes que cualquier objeto
+// global (el AppLogic del sketch la copia en su constructor). Una maceta en el
+// shadow clásico; para más, una entrada por maceta con su shadowName. Sin
+// FLOR_DEV_CREDENTIALS no trae identidad (cosa, WiFi, credenciales): la da
+// ProvisioningStore. Las credenciales de desarrollo son PEM y su longitud
+// incluye el terminador.
+const DeviceConfig DEFAULT_DEVICE_CONFIG = {
+#if FLOR_DEV_CREDENTIALS
+    THING_NAME,
+    AWS_IOT_ENDPOINT,
+    8883,
+    WIFI_SSID,
+    WIFI_PASS,
+    {
+        {AWS_ROOT_CA, sizeof(AWS_ROOT_CA)},
+        {DEVICE_CERTIFICATE, sizeof(DEVICE_CERTIFICATE)},
+        {DEVICE_PRIVATE_KEY, sizeof(DEVICE_PRIVATE_KEY)},
+    },
+#else
+    "",
+    AWS_IOT_ENDPOINT,
+    8883,
+    "",
+    "",
+    {},
+#endif
+    {SERVO_SAD_ANGLE, SERVO_HAPPY_ANGLE, SERVO_NEUTRAL_ANGLE},
+    1,
+    {
+        {"", SOIL_MOISTURE_PIN, SERVO_PIN, SOIL_DRY_VALUE, SOIL_WET_VALUE},
+    }
+};
+
+const uint16_t MQTT_BUFFER_SIZE = 4096;
+
+// 2 s, 4 s, 8 s... hasta 2 minutos; tras 10 fallos seguidos, 10 minutos
+const unsigned long MQTT_RECONNECT_BASE_MS = 2000;
+const unsigned long MQTT_RECONNECT_MAX_MS = 120000;
+const uint8_t MQTT_BREAKER_THRESHOLD = 10;
+const unsigned long MQTT_BREAKER_COOLDOWN_MS = 600000;
+
+// AWS IoT confirma en decenas de ms; 3 s cubre una red lenta
+const uint8_t MQTT_INFLIGHT_WINDOW = 4;
+const unsigned long MQTT_PUBACK_TIMEOUT_MS = 3000;
+const uint8_t MQTT_PUBLISH_MAX_ATTEMPTS = 3;
+
+// Lecturas por muestra (se toma la mediana), constante de tiempo de la media
+// exponencial (la de un peso 0.3 midiendo cada segundo) y margen en %
+// alrededor de los límites de rango
+const uint8_t SOIL_OVERSAMPLE = 8;
+const unsigned long SOIL_EMA_TAU_MS = 2800;
+const uint8_t SOIL_HYSTERESIS_PERCENT = 3;
+
+// Perfil de movimiento del servo
+const float SERVO_MAX_SPEED_DPS = 180.0f;
+const float SERVO_ACCEL_DPS2 = 720.0f;
+const unsigned long SERVO_DETACH_AFTER_MS = 500;
+
+// Un riego se sigue segundo a segundo; una maceta quieta se lee cada minuto.
+// Un riego pasa de largo los 5 %/min y el secado no llega a 1 %/min
+const AdaptiveSampler::Policy DEFAULT_SAMPLING_POLICY = {1000, 60000, 5.0f};
+
+// Reporte completo del shadow una vez por hora
+const unsigned long FULL_REPORT_INTERVAL_MS = 3600000;
+
+// La respuesta del shadow tarda décimas de segundo; 3 s cubren una pérdida
+const unsigned long SHADOW_REPORT_TIMEOUT_MS = 3000;
+
+// Una medida cada 5 minutos; el shadow se consulta una vez por hora
+const unsigned long DUTY_CYCLE_SLEEP_MS = 300000;
+const uint16_t DUTY_CYCLE_SYNC_EVERY = 12;
+const unsigned long DUTY_CYCLE_AWAKE_MAX_MS = 20000;
+
+// La pila WiFi corre en el núcleo 0; el control va en el 1 salvo en chips de
+// un solo núcleo
+const int NETWORK_TASK_CORE = 0;
+#if CONFIG_FREERTOS_UNICORE
+const int CONTROL_TASK_CORE = 0;
+#else
+const int CONTROL_TASK_CORE = 1;
+#endif
+
+// Telemetría: una muestra cada 5 s, publicada en lotes de 60 (5 minutos)
+const unsigned long TELEMETRY_SAMPLE_INTERVAL_MS = 5000;
+const int TELEMETRY_BATCH_SIZE = 60;
+
+// Métricas cada 5 minutos
+const unsigned long METRICS_INTERVAL_MS = 300000;
@@ -2,15 +2,30 @@
 #define AWS_IOT_CONFIG_H
 
 #include <Arduino.h> 
+#include "AdaptiveSampler.h"
+#include "TlsCredentials.h"
 
-// ========= CONFIGURACIÓN WIFI =========
-
-extern const char* WIFI_SSID;
-extern const char* WIFI_PASS;
+// Identidad de desarrollo compilada en el binario (WiFi, THING_NAME y
+// certificados), solo para pruebas en la mesa: todas las unidades que arranquen
+// con ella comparten clientId y certificado y se echan unas a otras del
+// broker. Sin ella el firmware no lleva secretos y cada unidad necesita su
+// /provision en LittleFS (ProvisioningStore).
+#ifndef FLOR_DEV_CREDENTIALS
+#define FLOR_DEV_CREDENTIALS 0
+#endif
 
 // ========= CONFIGURACIÓN AWS IOT CORE =========
 
+// El endpoint es el de la cuenta, común a toda la flota.
 #define AWS_IOT_ENDPOINT "a2ji0g9lxroj8h-ats.iot.us-east-2.amazonaws.com"
+
+#if FLOR_DEV_CREDENTIALS
+
+// ========= CONFIGURACIÓN WIFI =========
+
+extern const char WIFI_SSID[];
+extern const char WIFI_PASS[];
+
 #define THING_NAME "objeto_plantita_feliz"
 
 // ========= CERTIFICADOS =========
@@ -19,17 +34,129 @@ extern const char AWS_ROOT_CA[] PROGMEM;
 extern const char DEVICE_CERTIFICATE[] PROGMEM;
 extern const char DEVICE_PRIVATE_KEY[] PROGMEM;
 
+#endif
+
+// Buffer de PubSubClient: un get/accepted con metadata de todos los campos
+// pasa de 1 KB
+extern const uint16_t MQTT_BUFFER_SIZE;
+
+// Reintentos de conexión MQTT: espera base y tope de la espera exponencial;
+// tras MQTT_BREAKER_THRESHOLD fallos seguidos se pausa MQTT_BREAKER_COOLDOWN_MS
+extern const unsigned long MQTT_RECONNECT_BASE_MS;
+extern const unsigned long MQTT_RECONNECT_MAX_MS;
+extern const uint8_t MQTT_BREAKER_THRESHOLD;
+extern const unsigned long MQTT_BREAKER_COOLDOWN_MS;
+
+// Publicaciones QoS 1 (reportes del shadow, telemetría, outbox): cuántas
+// pueden esperar PUBACK a la vez, cuánto se espera cada uno y envíos por
+// mensaje antes de darlo por perdido
+extern const uint8_t MQTT_INFLIGHT_WINDOW;
+extern const unsigned long MQTT_PUBACK_TIMEOUT_MS;
+extern const uint8_t MQTT_PUBLISH_MAX_ATTEMPTS;
+
 // ========= PIN CONFIGURATION =========
 #define SOIL_MOISTURE_PIN 32
 #define SERVO_PIN 18
 
+// ========= CONFIGURACIÓN POR DISPOSITIVO =========
+// Lo que distingue a una unidad de otra. El firmware la lee de flash con
+// ProvisioningStore y usa DEFAULT_DEVICE_CONFIG (los valores de arriba) para
+// lo que no esté provisionado; sin identidad (cosa, WiFi y credenciales) la
+// unidad no conecta y se queda sin provisionar. El simulador de flota crea
+// una por dispositivo. Las cadenas y credenciales deben vivir tanto como el
+// AppLogic.
+
+// Una maceta: sensor y servo propios, con la calibración de su sensor. Con
+// shadowName vacío usa el shadow clásico de la cosa; si no, el shadow con
+// ese nombre. Todas comparten la conexión MQTT (y la sesión TLS).
+struct PlantConfig {
+    const char* shadowName;
+    int soilMoisturePin;
+    int servoPin;
+    int soilDryValue;
+    int soilWetValue;
+};
+
+static const uint8_t MAX_PLANTS = 4;
+
+// Ángulos del servo para cada emoción; dependen de cómo se montó la flor.
+struct ServoAngles {
+    int sad;
+    int happy;
+    int neutral;
+};
+
+struct DeviceConfig {
+    const char* thingName;
+    const char* endpoint;
+    uint16_t port;
+    const char* wifiSsid;
+    const char* wifiPass;
+    TlsCredentials credentials;
+    ServoAngles servoAngles;
+    uint8_t plantCount;
+    PlantConfig plants[MAX_PLANTS];
+};
 
 extern const int SOIL_DRY_VALUE;
 extern const int SOIL_WET_VALUE;
 
-// Servo angles
+extern const DeviceConfig DEFAULT_DEVICE_CONFIG;
+
+// Filtrado del sensor de humedad
+extern const uint8_t SOIL_OVERSAMPLE;
+extern const unsigned long SOIL_EMA_TAU_MS;
+extern const uint8_t SOIL_HYSTERESIS_PERCENT;
+
+// Servo angles (los de DEFAULT_DEVICE_CONFIG)
 extern const int SERVO_SAD_ANGLE;
 extern const int SERVO_HAPPY_ANGLE;
 extern const int SERVO_NEUTRAL_ANGLE;
+// Perfil de movimiento del servo (grados/s, grados/s²) y tiempo quieto tras
+// el que se suelta el PWM
+extern const float SERVO_MAX_SPEED_DPS;
+extern const float SERVO_ACCEL_DPS2;
+extern const unsigned long SERVO_DETACH_AFTER_MS;
+
+// Muestreo del sensor de humedad (AdaptiveSampler): cada fastIntervalMs
+// mientras la humedad se mueve más de slopeThreshold % por minuto; con la
+// señal plana la espera se dobla hasta slowIntervalMs. Cada maceta puede
+// cambiarlo desde su shadow con desired.sampling (fastMs, slowMs, slope).
+extern const AdaptiveSampler::Policy DEFAULT_SAMPLING_POLICY;
+
+// Los reportes del shadow solo llevan los campos cambiados; cada tanto se
+// manda el estado completo para reconciliar
+extern const unsigned long FULL_REPORT_INTERVAL_MS;
+
+// Solo hay un update del shadow en vuelo a la vez; si en este tiempo no llega
+// su update/accepted o update/rejected (o el GET tras un 409) se reenvía
+extern const unsigned long SHADOW_REPORT_TIMEOUT_MS;
+
+// Ciclo de trabajo con deep sleep (AppLogic::RUN_DUTY_CYCLE): despierta cada
+// DUTY_CYCLE_SLEEP_MS, mide y solo enciende el WiFi si el rango o el
+// porcentaje se movieron; cada DUTY_CYCLE_SYNC_EVERY ciclos conecta igual y
+// pide el shadow para recoger cambios de desired. Ningún ciclo pasa más de
+// DUTY_CYCLE_AWAKE_MAX_MS despierto.
+extern const unsigned long DUTY_CYCLE_SLEEP_MS;
+extern const uint16_t DUTY_CYCLE_SYNC_EVERY;
+extern const unsigned long DUTY_CYCLE_AWAKE_MAX_MS;
+
+// Núcleos de las tareas de red y de control (sensor y servo)
+extern const int NETWORK_TASK_CORE;
+extern const int CONTROL_TASK_CORE;
+
+// ========= TELEMETRÍA =========
+// Tópicos: TELEMETRY_TOPIC_PREFIX + thingName + sufijo; las macetas con
+// shadow con nombre añaden "/" + shadowName antes del sufijo
+#define TELEMETRY_TOPIC_PREFIX "dt/florv3/"
+#define TELEMETRY_TOPIC_SUFFIX "/moisture"
+
+extern const unsigned long TELEMETRY_SAMPLE_INTERVAL_MS;
+extern const int TELEMETRY_BATCH_SIZE;
+
+// Métricas del dispositivo (contadores, gauges, histogramas) en JSON
+#define METRICS_TOPIC_SUFFIX "/metrics"
+
+extern const unsigned long METRICS_INTERVAL_MS;
 
 #endif 
\ No newline at end of file
@@ -1,11 +1,34 @@
 #include "AppLogic.h"
+#include "Log.h"
+#include "ProvisioningStore.h"
 
-AppLogic app;
+// La configuración de la unidad está en la flash (ProvisioningStore): se lee
+// en setup() y solo entonces se construye AppLogic. Una unidad sin identidad
+// provisionada no arranca AppLogic: se queda avisando por el puerto serie.
+const unsigned long UNPROVISIONED_NOTICE_MS = 30000;
+
+ProvisioningStore provisioning;
+AppLogic* app = nullptr;
 
 void setup() {
-  app.setup();
+  Serial.begin(115200);
+  Log::begin(Serial);
+  const DeviceConfig& config = provisioning.load(DEFAULT_DEVICE_CONFIG);
+  if (!provisioning.ready()) {
+    LOGE("APP", "Device not provisioned (%s). Upload /provision to LittleFS and reset.", provisioning.missing());
+    return;
+  }
+  static AppLogic instance(config);
+  app = &instance;
+  app->setup();
 }
 
 void loop() {
-  app.loop();
-}
\ No newline at end of file
+  if (app == nullptr) {
+    Log::flush();
+    delay(UNPROVISIONED_NOTICE_MS);
+    LOGW("APP", "Still unprovisioned (%s).", provisioning.missing());
+    return;
+  }
+  app->loop();
+}
@@ -0,0 +1,69 @@
+#ifndef BenchStats_h
+#define BenchStats_h
+
+// Shared helpers for the host benchmarks: latency sample collection with
+// percentile reporting, and tiny "--name value" argument parsing.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+class LatencySamples {
+  public:
+    void reserve(size_t n) { _samples.reserve(n); }
+    void add(uint64_t micros) { _samples.push_back(micros); _sorted = false; }
+    size_t count() const { return _samples.size(); }
+
+    uint64_t percentile(double p) {
+        if (_samples.empty()) return 0;
+        sort();
+        size_t idx = static_cast<size_t>(p / 100.0 * (_samples.size() - 1) + 0.5);
+        return _samples[std::min(idx, _samples.size() - 1)];
+    }
+
+    double mean() const {
+        if (_samples.empty()) return 0.0;
+        double sum = 0.0;
+        for (uint64_t s : _samples) sum += static_cast<double>(s);
+        return sum / _samples.size();
+    }
+
+    void print(const char* label) {
+        std::printf("%-22s n=%-8zu mean=%9.1fus p50=%7lluus p90=%7lluus p99=%7lluus p99.9=%7lluus max=%7lluus\n",
+                    label, count(), mean(),
+                    static_cast<unsigned long long>(percentile(50)),
+                    static_cast<unsigned long long>(percentile(90)),
+                    static_cast<unsigned long long>(percentile(99)),
+                    static_cast<unsigned long long>(percentile(99.9)),
+                    static_cast<unsigned long long>(percentile(100)));
+    }
+
+  private:
+    std::vector<uint64_t> _samples;
+    bool _sorted = false;
+
+    void sort() {
+        if (_sorted) return;
+        std::sort(_samples.begin(), _samples.end());
+        _sorted = true;
+    }
+};
+
+inline long argValue(int argc, char** argv, const char* name, long fallback) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::strcmp(argv[i], name) == 0) return std::strtol(argv[i + 1], nullptr, 10);
+    }
+    return fallback;
+}
+
+inline bool argFlag(int argc, char** argv, const char* name) {
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], name) == 0) return true;
+    }
+    return false;
+}
+
+#endif
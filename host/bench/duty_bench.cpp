@@ -0,0 +1,202 @@
+// Deep-sleep duty cycle against the Device Shadow service stand-in.
+//
+// Runs AppLogic in RUN_DUTY_CYCLE mode for --hours of simulated time. Every
+// esp_deep_sleep_start() lets the sleep pass on the virtual clock and throws;
+// the bench then builds a fresh AppLogic, as the reset would, while the
+// RTC_DATA_ATTR state carries over. Soil moisture follows a sine over the
+// calibration range with period --drift-hours; with --desired-every-min a
+// cloud application changes desired.emotion while the device sleeps.
+//
+// Reported per wake cycle, split by what the cycle did (sample only, report
+// from retained state, shadow GET):
+//  - awake time, radio-on time and wake-to-publish (wake until the device's
+//    shadow/update or shadow/get reaches the broker)
+//  - energy from a current model: --cpu-ma while awake, --radio-ma on top
+//    while the radio is on, --sleep-ua in deep sleep, at --volts
+// plus the average current, battery life on --battery-mah, and the same
+// figures for staying awake with WiFi on.
+//
+//   duty_bench [--hours H] [--drift-hours H] [--desired-every-min M]
+//              [--latency-ms MS] [--join-ms MS] [--tls-full-ms MS]
+//              [--cpu-ma MA] [--radio-ma MA] [--sleep-ua UA] [--volts V10]
+//              [--battery-mah MAH] [--serial]
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+#include "AppLogic.h"
+#include "BenchStats.h"
+#include "HostSim.h"
+#include "ShadowService.h"
+#include "SimBroker.h"
+#include "aws_iot_config.h"
+
+namespace {
+
+const std::string kShadowPrefix = std::string("$aws/things/") + THING_NAME + "/shadow";
+
+enum CycleKind { CYCLE_SAMPLE_ONLY, CYCLE_RETAINED_REPORT, CYCLE_SHADOW_GET, CYCLE_KINDS };
+
+const char* const kCycleNames[CYCLE_KINDS] = {"sample only", "retained report", "shadow GET"};
+
+struct CycleStats {
+    unsigned long cycles = 0;
+    LatencySamples awake;
+    LatencySamples radio;
+    LatencySamples toPublish;
+    double energyMj = 0.0;
+};
+
+struct Cycle {
+    uint64_t wakeUs = 0;
+    uint64_t firstPublishUs = 0;
+    bool reported = false;
+    bool requestedShadow = false;
+};
+
+struct SyncTracker {
+    explicit SyncTracker(ShadowService& shadowService) : service(shadowService) {}
+
+    ShadowService& service;
+    uint64_t pendingSinceUs = 0;
+    LatencySamples toSync;
+
+    void check() {
+        if (pendingSinceUs == 0 || !service.delta(THING_NAME).empty()) return;
+        toSync.add(hostsim::nowMicros() - pendingSinceUs);
+        pendingSinceUs = 0;
+    }
+};
+
+void scheduleEvery(uint64_t atUs, uint64_t everyUs, std::function<void()> fn) {
+    hostsim::scheduleEvent(atUs, [atUs, everyUs, fn]() {
+        fn();
+        scheduleEvery(atUs + everyUs, everyUs, fn);
+    });
+}
+
+}
+
+int main(int argc, char** argv) {
+    const long hours = argValue(argc, argv, "--hours", 24);
+    const double driftHours = static_cast<double>(argValue(argc, argv, "--drift-hours", 12));
+    const long desiredEveryMin = argValue(argc, argv, "--desired-every-min", 0);
+    const double cpuMa = static_cast<double>(argValue(argc, argv, "--cpu-ma", 40));
+    const double radioMa = static_cast<double>(argValue(argc, argv, "--radio-ma", 100));
+    const double sleepUa = static_cast<double>(argValue(argc, argv, "--sleep-ua", 10));
+    const double volts = argValue(argc, argv, "--volts", 33) / 10.0;
+    const double batteryMah = static_cast<double>(argValue(argc, argv, "--battery-mah", 2000));
+
+    hostsim::Board& board = hostsim::board();
+    board.serialSink = argFlag(argc, argv, "--serial") ? hostsim::SerialSink::Stdout : hostsim::SerialSink::Discard;
+    board.joinDelayMs = static_cast<unsigned long>(argValue(argc, argv, "--join-ms", 1500));
+    board.dnsMs = 40;
+    board.tcpConnectMs = 60;
+    board.tlsFullHandshakeMs = static_cast<unsigned long>(argValue(argc, argv, "--tls-full-ms", 2500));
+    board.tlsResumedHandshakeMs = 150;
+    const double driftMs = driftHours * 3600000.0;
+    hostsim::setAnalogSignal(SOIL_MOISTURE_PIN, [driftMs](unsigned long ms) {
+        const double mid = (SOIL_DRY_VALUE + SOIL_WET_VALUE) / 2.0;
+        const double amplitude = std::abs(SOIL_DRY_VALUE - SOIL_WET_VALUE) / 2.0;
+        return static_cast<int>(mid + amplitude * std::sin(ms / driftMs * 2.0 * M_PI)) +
+               static_cast<int>(random(-8, 9));
+    });
+
+    SimBroker& broker = SimBroker::shared();
+    ShadowService service(broker);
+    ShadowService::Options options;
+    options.latencyMs = static_cast<unsigned long>(argValue(argc, argv, "--latency-ms", 50));
+    options.jitterMs = 20;
+    service.setOptions(options);
+    Cycle cycle;
+    broker.setPublishHook([&service, &cycle](const std::string& clientId, const std::string& topic,
+                                             const std::string& payload) {
+        if (clientId == THING_NAME) {
+            if (cycle.firstPublishUs == 0) cycle.firstPublishUs = hostsim::nowMicros();
+            if (topic == kShadowPrefix + "/update") cycle.reported = true;
+            if (topic == kShadowPrefix + "/get") cycle.requestedShadow = true;
+        }
+        service.handlePublish(clientId, topic, payload);
+    });
+    service.update(THING_NAME, "", "{\"state\":{\"reported\":{\"emotion\":\"NEUTRAL\",\"servoAngle\":90}}}");
+    SyncTracker sync(service);
+    service.setUpdateObserver([&sync](const std::string&, uint64_t) { sync.check(); });
+
+    const uint64_t startUs = hostsim::nowMicros();
+    const uint64_t endUs = startUs + static_cast<uint64_t>(hours) * 3600000000ULL;
+    unsigned long desiredCount = 0;
+    if (desiredEveryMin > 0) {
+        const uint64_t everyUs = static_cast<uint64_t>(desiredEveryMin) * 60000000ULL;
+        scheduleEvery(startUs + everyUs, everyUs, [&service, &sync, &desiredCount]() {
+            static const char* const kEmotions[] = {"FELIZ", "TRISTE", "NEUTRAL"};
+            if (sync.pendingSinceUs == 0) sync.pendingSinceUs = hostsim::nowMicros();
+            service.update(THING_NAME, "", std::string("{\"state\":{\"desired\":{\"emotion\":\"") +
+                                               kEmotions[desiredCount++ % 3] + "\"}}}");
+        });
+    }
+
+    CycleStats stats[CYCLE_KINDS];
+    double totalEnergyMj = 0.0;
+    uint64_t sleptUs = 0;
+    while (hostsim::nowMicros() < endUs) {
+        cycle = Cycle();
+        cycle.wakeUs = hostsim::nowMicros();
+        const uint64_t radioBefore = hostsim::radioOnMicros();
+        uint64_t sleepUs = 0;
+        try {
+            AppLogic app;
+            app.setup(AppLogic::RUN_DUTY_CYCLE);
+            for (;;) app.loop();
+        } catch (const hostsim::DeepSleepRequested& sleep) {
+            sleepUs = sleep.sleptUs;
+        }
+        const uint64_t awakeUs = hostsim::nowMicros() - sleepUs - cycle.wakeUs;
+        const uint64_t radioUs = hostsim::radioOnMicros() - radioBefore;
+        const CycleKind kind = cycle.requestedShadow ? CYCLE_SHADOW_GET
+                               : cycle.reported      ? CYCLE_RETAINED_REPORT
+                                                     : CYCLE_SAMPLE_ONLY;
+        // mA * V * s = mJ
+        const double energyMj = volts * (cpuMa * awakeUs + radioMa * radioUs + sleepUa / 1000.0 * sleepUs) / 1e6;
+        CycleStats& s = stats[kind];
+        s.cycles++;
+        s.awake.add(awakeUs);
+        s.radio.add(radioUs);
+        if (cycle.firstPublishUs != 0) s.toPublish.add(cycle.firstPublishUs - cycle.wakeUs);
+        s.energyMj += energyMj;
+        totalEnergyMj += energyMj;
+        sleptUs += sleepUs;
+        if (sleepUs == 0) break;  // no wakeup source: it would never wake
+    }
+
+    const double simulatedS = static_cast<double>(hostsim::nowMicros() - startUs) / 1e6;
+    const ShadowService::Stats serviceStats = service.stats();
+    std::printf("duty_bench: %.1f h simulated, sleep %lu s, shadow sync every %u cycles, moisture period %.0f h, "
+                "desired every %ld min\n",
+                simulatedS / 3600.0, DUTY_CYCLE_SLEEP_MS / 1000, (unsigned int)DUTY_CYCLE_SYNC_EVERY, driftHours,
+                desiredEveryMin);
+    for (int kind = 0; kind < CYCLE_KINDS; kind++) {
+        CycleStats& s = stats[kind];
+        if (s.cycles == 0) continue;
+        std::printf("%-16s cycles=%-5lu awake p50=%6.0fms p99=%6.0fms  radio p50=%6.0fms  "
+                    "wake-to-publish p50=%6.0fms  energy/cycle %.1f mJ\n",
+                    kCycleNames[kind], s.cycles, s.awake.percentile(50) / 1000.0, s.awake.percentile(99) / 1000.0,
+                    s.radio.percentile(50) / 1000.0, s.toPublish.percentile(50) / 1000.0, s.energyMj / s.cycles);
+    }
+    const double averageMa = totalEnergyMj / volts / simulatedS;
+    const double awakeMa = cpuMa + radioMa;
+    std::printf("deep sleep %.1f%% of the time  average current %.3f mA  %.0f days on %.0f mAh\n",
+                100.0 * sleptUs / 1e6 / simulatedS, averageMa, batteryMah / averageMa / 24.0, batteryMah);
+    std::printf("always awake with WiFi: %.0f mA  %.1f days on %.0f mAh\n", awakeMa, batteryMah / awakeMa / 24.0,
+                batteryMah);
+    std::printf("shadow updates accepted/rejected: %llu/%llu  409 conflicts: %llu  GETs: %llu\n",
+                static_cast<unsigned long long>(serviceStats.updatesAccepted),
+                static_cast<unsigned long long>(serviceStats.updatesRejected),
+                static_cast<unsigned long long>(serviceStats.conflicts),
+                static_cast<unsigned long long>(serviceStats.gets));
+    if (desiredEveryMin > 0) {
+        sync.toSync.print("desired-to-sync");
+        std::printf("desired changes: %lu\n", desiredCount);
+    }
+    return 0;
+}
@@ -0,0 +1,418 @@
+// Many devices in one process against the Device Shadow service stand-in.
+//
+// Runs --devices AppLogic instances in RUN_SINGLE_LOOP mode, one thread and
+// one hostsim::Board each (own ADC signal, servo, LittleFS root and UART), on
+// the real-time clock. Each device gets its own DeviceConfig: thing name
+// "<--prefix>-NNN" and the default pins. ShadowService answers the whole
+// fleet with --latency-ms, --jitter-ms and --loss-pct applied to every
+// request and response; deferred work runs on a timer thread. With
+// --provisioned each config is written to the device's LittleFS root through
+// ProvisioningStore (credentials as DER) and the device boots from it, as the
+// sketch does.
+//
+// Devices boot spread over --boot-spread-ms and get --warmup-s to connect
+// before measuring for --seconds. Soil moisture follows --curve per device:
+//  - sine: full calibration range, period --period-s scaled 0.5x..1.5x and
+//    random phase per device
+//  - walk: random walk, --walk-step raw counts per sample
+//  - step: dry and wet alternating every half period
+//  - flat: constant mid-range reading
+// plus --adc-noise raw counts. A cloud application changes desired.emotion
+// on a random device --churn-per-s times a second (fleet total).
+//
+// Reported:
+//  - delta-to-report: real time from a desired change until that device's
+//    shadow has no delta left. A change replaced by the next one on the same
+//    device before syncing counts as superseded.
+//  - aggregate device reports/s on shadow/update and service counters.
+//  - telemetry and metrics publishes, devices that reported at least once.
+//
+//   fleet_bench [--devices N] [--seconds S] [--warmup-s S] [--boot-spread-ms MS]
+//               [--churn-per-s N] [--curve sine|walk|step|flat] [--period-s S]
+//               [--walk-step N] [--adc-noise N] [--latency-ms MS] [--jitter-ms MS]
+//               [--loss-pct P] [--seed N] [--prefix NAME] [--provisioned] [--log-level L]
+//               [--serial]
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AppLogic.h"
+#include "BenchStats.h"
+#include "HostSim.h"
+#include "Log.h"
+#include "ProvisioningStore.h"
+#include "ShadowService.h"
+#include "SimBroker.h"
+#include "aws_iot_config.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// ShadowService's default deferral runs on the virtual clock; with real-time
+// device threads the latency has to elapse on a thread of its own.
+class TimerThread {
+  public:
+    TimerThread() : _thread([this]() { run(); }) {}
+
+    ~TimerThread() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _wake.notify_all();
+        _thread.join();
+    }
+
+    void post(unsigned long delayMs, std::function<void()> fn) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _timers.emplace(Clock::now() + std::chrono::milliseconds(delayMs), std::move(fn));
+        }
+        _wake.notify_one();
+    }
+
+  private:
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::multimap<Clock::time_point, std::function<void()>> _timers;
+    bool _stop = false;
+    std::thread _thread;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (!_stop) {
+            if (_timers.empty()) {
+                _wake.wait(lock);
+                continue;
+            }
+            const Clock::time_point due = _timers.begin()->first;
+            if (Clock::now() < due) {
+                _wake.wait_until(lock, due);
+                continue;
+            }
+            std::function<void()> fn = std::move(_timers.begin()->second);
+            _timers.erase(_timers.begin());
+            lock.unlock();
+            fn();
+            lock.lock();
+        }
+    }
+};
+
+enum Curve { CURVE_SINE, CURVE_WALK, CURVE_STEP, CURVE_FLAT };
+
+Curve parseCurve(const char* name) {
+    if (std::strcmp(name, "walk") == 0) return CURVE_WALK;
+    if (std::strcmp(name, "step") == 0) return CURVE_STEP;
+    if (std::strcmp(name, "flat") == 0) return CURVE_FLAT;
+    return CURVE_SINE;
+}
+
+const char* argString(int argc, char** argv, const char* name, const char* fallback) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::strcmp(argv[i], name) == 0) return argv[i + 1];
+    }
+    return fallback;
+}
+
+// Evaluated from the device's own thread only.
+std::function<int(unsigned long)> moistureCurve(Curve curve, double periodMs, long walkStep, long noise,
+                                                uint32_t seed) {
+    const double mid = (SOIL_DRY_VALUE + SOIL_WET_VALUE) / 2.0;
+    const double amplitude = std::abs(SOIL_DRY_VALUE - SOIL_WET_VALUE) / 2.0;
+    auto random = std::make_shared<std::mt19937>(seed);
+    const double phase = std::uniform_real_distribution<double>(0.0, 2.0 * M_PI)(*random);
+    auto noiseAt = [random, noise]() {
+        return static_cast<int>(std::uniform_int_distribution<long>(-noise, noise)(*random));
+    };
+    switch (curve) {
+        case CURVE_WALK: {
+            auto level = std::make_shared<double>(mid);
+            return [=](unsigned long) {
+                *level += static_cast<double>(std::uniform_int_distribution<long>(-walkStep, walkStep)(*random));
+                *level = std::max(mid - amplitude, std::min(mid + amplitude, *level));
+                return static_cast<int>(*level) + noiseAt();
+            };
+        }
+        case CURVE_STEP:
+            return [=](unsigned long ms) {
+                const bool dry = std::fmod(ms + phase / (2.0 * M_PI) * periodMs, periodMs) < periodMs / 2.0;
+                return SOIL_DRY_VALUE + (dry ? 0 : SOIL_WET_VALUE - SOIL_DRY_VALUE) + noiseAt();
+            };
+        case CURVE_FLAT:
+            return [=](unsigned long) { return static_cast<int>(mid) + noiseAt(); };
+        case CURVE_SINE:
+        default:
+            return [=](unsigned long ms) {
+                return static_cast<int>(mid + amplitude * std::sin(ms / periodMs * 2.0 * M_PI + phase)) + noiseAt();
+            };
+    }
+}
+
+struct Device {
+    std::string thingName;
+    DeviceConfig config;
+    hostsim::Board board;
+    unsigned long bootDelayMs = 0;
+    bool provisioned = false;
+    std::thread thread;
+    std::atomic<bool> booted{false};
+
+    // Cloud side, guarded by Fleet::mutex.
+    unsigned long desiredCount = 0;
+    uint64_t pendingSinceUs = 0;
+    bool armed = false;  // the pending change has shown up as a delta
+    unsigned long reports = 0;
+};
+
+struct Fleet {
+    std::mutex mutex;
+    std::deque<Device> devices;
+    std::map<std::string, size_t> byName;
+    bool measuring = false;
+    unsigned long changes = 0;
+    unsigned long superseded = 0;
+    unsigned long reports = 0;
+    unsigned long telemetry = 0;
+    unsigned long metrics = 0;
+    LatencySamples toReport;
+
+    uint64_t nowUs() const { return hostsim::nowMicros(); }
+
+    // Before the desired update goes to the service: a device report landing
+    // in between must not count as syncing a change it has not seen.
+    void changed(Device& device) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (device.pendingSinceUs != 0 && measuring) superseded++;
+        device.pendingSinceUs = measuring ? nowUs() : 0;
+        device.armed = false;
+        if (measuring) changes++;
+    }
+
+    // From the service's update observer, after every accepted update.
+    void updated(const std::string& key, ShadowService& service) {
+        auto it = byName.find(key);
+        if (it == byName.end()) return;
+        const bool inSync = service.delta(key).empty();
+        std::lock_guard<std::mutex> lock(mutex);
+        Device& device = devices[it->second];
+        if (device.pendingSinceUs == 0) return;
+        if (!inSync) {
+            device.armed = true;
+            return;
+        }
+        if (!device.armed) return;
+        toReport.add(nowUs() - device.pendingSinceUs);
+        device.pendingSinceUs = 0;
+    }
+
+    void published(const std::string& clientId, const std::string& topic) {
+        auto it = byName.find(clientId);
+        if (it == byName.end()) return;
+        const std::string& name = it->first;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (topic.compare(0, 11, "$aws/things") == 0) {
+            if (topic.size() > 7 && topic.compare(topic.size() - 7, 7, "/update") == 0) {
+                devices[it->second].reports++;
+                if (measuring) reports++;
+            }
+        } else if (measuring && topic == TELEMETRY_TOPIC_PREFIX + name + TELEMETRY_TOPIC_SUFFIX) {
+            telemetry++;
+        } else if (measuring && topic == TELEMETRY_TOPIC_PREFIX + name + METRICS_TOPIC_SUFFIX) {
+            metrics++;
+        }
+    }
+};
+
+void runDevice(Device* device, const std::atomic<bool>* stop) {
+    hostsim::setBoard(&device->board);
+    std::this_thread::sleep_for(std::chrono::milliseconds(device->bootDelayMs));
+    // The store owns the strings and credentials the loaded config points to.
+    std::unique_ptr<ProvisioningStore> store;
+    const DeviceConfig* config = &device->config;
+    if (device->provisioned) {
+        store.reset(new ProvisioningStore());
+        config = &store->load(DEFAULT_DEVICE_CONFIG);
+    }
+    AppLogic app(*config);
+    app.setup(AppLogic::RUN_SINGLE_LOOP);
+    device->booted = true;
+    while (!stop->load(std::memory_order_relaxed)) app.loop();
+}
+
+}
+
+int main(int argc, char** argv) {
+    const long deviceCount = std::max(1L, argValue(argc, argv, "--devices", 100));
+    const long seconds = argValue(argc, argv, "--seconds", 60);
+    const long warmupS = argValue(argc, argv, "--warmup-s", 15);
+    const long bootSpreadMs = argValue(argc, argv, "--boot-spread-ms", 5000);
+    const long churnPerS = argValue(argc, argv, "--churn-per-s", 20);
+    const char* curveName = argString(argc, argv, "--curve", "sine");
+    const Curve curve = parseCurve(curveName);
+    const long periodS = std::max(1L, argValue(argc, argv, "--period-s", 120));
+    const long walkStep = argValue(argc, argv, "--walk-step", 40);
+    const long adcNoise = argValue(argc, argv, "--adc-noise", 8);
+    const uint32_t seed = static_cast<uint32_t>(argValue(argc, argv, "--seed", 1));
+    const std::string prefix = argString(argc, argv, "--prefix", "flor");
+    const bool serial = argFlag(argc, argv, "--serial");
+    const bool provisioned = argFlag(argc, argv, "--provisioned");
+
+    hostsim::useRealtimeClock(true);
+    Log::setLevel(static_cast<uint8_t>(argValue(argc, argv, "--log-level", serial ? FLOR_LOG_INFO : FLOR_LOG_NONE)));
+
+    SimBroker& broker = SimBroker::shared();
+    ShadowService service(broker);
+    ShadowService::Options options;
+    options.latencyMs = static_cast<unsigned long>(argValue(argc, argv, "--latency-ms", 50));
+    options.jitterMs = static_cast<unsigned long>(argValue(argc, argv, "--jitter-ms", 20));
+    options.lossRate = argValue(argc, argv, "--loss-pct", 0) / 100.0;
+    options.seed = seed;
+    service.setOptions(options);
+    TimerThread timers;
+    service.setDefer([&timers](unsigned long delayMs, std::function<void()> fn) {
+        if (delayMs == 0) {
+            fn();
+            return;
+        }
+        timers.post(delayMs, std::move(fn));
+    });
+
+    Fleet fleet;
+    std::mt19937 random(seed);
+    const double basePeriodMs = periodS * 1000.0;
+    for (long i = 0; i < deviceCount; i++) {
+        fleet.devices.emplace_back();
+        Device& device = fleet.devices.back();
+        char name[64];
+        std::snprintf(name, sizeof(name), "%s-%03ld", prefix.c_str(), i);
+        device.thingName = name;
+        device.config = DEFAULT_DEVICE_CONFIG;
+        device.config.thingName = device.thingName.c_str();
+        device.bootDelayMs = bootSpreadMs > 0 ? static_cast<unsigned long>(random() % bootSpreadMs) : 0;
+
+        hostsim::Board& board = device.board;
+        board.serialSink = serial ? hostsim::SerialSink::Stdout : hostsim::SerialSink::Discard;
+        board.fsRoot = "fleet_fs/" + device.thingName;
+        board.joinDelayMs = 1500;
+        board.dnsMs = 40;
+        board.tcpConnectMs = 60;
+        board.tlsFullHandshakeMs = 2500;
+        board.tlsResumedHandshakeMs = 150;
+        const double periodMs = basePeriodMs * std::uniform_real_distribution<double>(0.5, 1.5)(random);
+        board.analogSignals[device.config.plants[0].soilMoisturePin] =
+            moistureCurve(curve, periodMs, walkStep, adcNoise, static_cast<uint32_t>(random()));
+
+        if (provisioned) {
+            hostsim::setBoard(&board);
+            std::unique_ptr<ProvisioningStore> store(new ProvisioningStore());
+            device.provisioned = store->save(device.config);
+            hostsim::setBoard(nullptr);
+            if (!device.provisioned) {
+                std::fprintf(stderr, "fleet_bench: cannot provision %s\n", device.thingName.c_str());
+                return 1;
+            }
+        }
+
+        fleet.byName[device.thingName] = fleet.devices.size() - 1;
+        service.update(device.thingName, "",
+                       "{\"state\":{\"reported\":{\"emotion\":\"NEUTRAL\",\"servoAngle\":90}}}");
+    }
+
+    broker.setPublishHook([&service, &fleet](const std::string& clientId, const std::string& topic,
+                                             const std::string& payload) {
+        fleet.published(clientId, topic);
+        service.handlePublish(clientId, topic, payload);
+    });
+    service.setUpdateObserver([&service, &fleet](const std::string& key, uint64_t) { fleet.updated(key, service); });
+
+    const std::clock_t cpuStart = std::clock();
+    std::atomic<bool> stop{false};
+    for (Device& device : fleet.devices) device.thread = std::thread(runDevice, &device, &stop);
+    std::this_thread::sleep_for(std::chrono::seconds(warmupS));
+
+    const ShadowService::Stats before = service.stats();
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point end = start + std::chrono::seconds(seconds);
+    {
+        std::lock_guard<std::mutex> lock(fleet.mutex);
+        fleet.measuring = true;
+    }
+    // Never the device's previous desired value: the change always needs a
+    // report, unless a later one supersedes it.
+    static const char* const kEmotions[] = {"FELIZ", "TRISTE", "NEUTRAL"};
+    unsigned long cloudUpdates = 0;
+    Clock::time_point next = start;
+    while (Clock::now() < end) {
+        if (churnPerS <= 0) {
+            std::this_thread::sleep_until(end);
+            break;
+        }
+        Device& device = fleet.devices[random() % fleet.devices.size()];
+        const char* emotion = kEmotions[device.desiredCount++ % 3];
+        fleet.changed(device);
+        service.update(device.thingName, "", std::string("{\"state\":{\"desired\":{\"emotion\":\"") + emotion + "\"}}}");
+        cloudUpdates++;
+        next += std::chrono::microseconds(1000000 / churnPerS);
+        std::this_thread::sleep_until(next);
+    }
+    const double elapsedS = std::chrono::duration<double>(Clock::now() - start).count();
+    {
+        std::lock_guard<std::mutex> lock(fleet.mutex);
+        fleet.measuring = false;
+    }
+    const ShadowService::Stats stats = service.stats();
+
+    stop = true;
+    for (Device& device : fleet.devices) device.thread.join();
+    // Responses still waiting on the timer thread must not reach the fleet.
+    service.setUpdateObserver(nullptr);
+    broker.setPublishHook(nullptr);
+    const double cpuS = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+
+    std::lock_guard<std::mutex> lock(fleet.mutex);
+    unsigned long booted = 0;
+    unsigned long reported = 0;
+    unsigned long pending = 0;
+    for (const Device& device : fleet.devices) {
+        if (device.booted) booted++;
+        if (device.reports > 0) reported++;
+        if (device.pendingSinceUs != 0) pending++;
+    }
+    std::printf("fleet_bench: %ld devices, %.0f s measured after %ld s warm-up, churn %ld/s, curve %s (period %ld s), "
+                "latency %lu+%lu ms, loss %.0f%%\n",
+                deviceCount, elapsedS, warmupS, churnPerS, curveName, periodS, options.latencyMs, options.jitterMs,
+                options.lossRate * 100.0);
+    fleet.toReport.print("delta-to-report");
+    std::printf("desired changes: %lu  synced: %zu  superseded: %lu  pending at end: %lu\n", fleet.changes,
+                fleet.toReport.count(), fleet.superseded, pending);
+    std::printf("device reports: %lu (%.1f/s fleet, %.3f/s per device)  telemetry batches: %lu  metrics: %lu\n",
+                fleet.reports, fleet.reports / elapsedS, fleet.reports / elapsedS / deviceCount, fleet.telemetry,
+                fleet.metrics);
+    std::printf("updates accepted/rejected: %llu/%llu (cloud %lu)  409 conflicts: %llu  GETs: %llu  "
+                "deltas sent: %llu  messages lost: %llu\n",
+                static_cast<unsigned long long>(stats.updatesAccepted - before.updatesAccepted),
+                static_cast<unsigned long long>(stats.updatesRejected - before.updatesRejected), cloudUpdates,
+                static_cast<unsigned long long>(stats.conflicts - before.conflicts),
+                static_cast<unsigned long long>(stats.gets - before.gets),
+                static_cast<unsigned long long>(stats.deltas - before.deltas),
+                static_cast<unsigned long long>(stats.lost - before.lost));
+    std::printf("devices booted: %lu/%ld  reported at least once: %lu  host CPU: %.1f s (%.1f ms per device-second)\n",
+                booted, deviceCount, reported, cpuS, cpuS * 1000.0 / deviceCount / (elapsedS + warmupS));
+    return 0;
+}
@@ -0,0 +1,267 @@
+// AppLogic::loop() latency, reaction time and idle behaviour on the host build.
+//
+// Runs the real sketch sources against the simulated board and the in-process
+// broker for --seconds of simulated time. A minimal cloud responder answers
+// shadow GET/UPDATE requests, and a desired-state delta is injected every
+// --delta-every-ms at a random point, usually while the firmware sleeps.
+//
+// Reported:
+//  - loop() latency: host CPU time for the call plus modelled blocking time
+//    (UART back-pressure). delay() advances the virtual clock and is not
+//    counted.
+//  - delta-to-servo: virtual time from the delta reaching the broker to the
+//    servo write it causes, i.e. the start of the motion.
+//  - servo writes and the share of time the servo PWM was attached.
+//  - wakeups and CPU busy share per simulated second.
+//
+// --outage-at takes the access point away at that second for --outage-ms;
+// loop() latency inside the outage is reported separately.
+//
+//   loop_bench [--seconds S] [--delta-every-ms MS] [--baud B] [--serial]
+//              [--join-ms MS] [--outage-at S] [--outage-ms MS] [--adc-noise N]
+//              [--drift-period-s S]
+
+#include <chrono>
+#include <cmath>
+#include <string>
+
+#include "AppLogic.h"
+#include "BenchStats.h"
+#include "HostSim.h"
+#include "Log.h"
+#include "SimBroker.h"
+#include "aws_iot_config.h"
+
+namespace {
+
+const std::string kShadowPrefix = std::string("$aws/things/") + THING_NAME + "/shadow";
+const std::string kMetricsTopic = TELEMETRY_TOPIC_PREFIX THING_NAME METRICS_TOPIC_SUFFIX;
+
+struct CloudShadow {
+    unsigned long version = 1;
+    unsigned long reports = 0;
+    unsigned long firstReportMillis = 0;
+    std::string humidityRange;
+    unsigned long rangeChanges = 0;
+    unsigned long long reportBytes = 0;
+    unsigned long metricsMessages = 0;
+    std::string lastMetrics;
+    unsigned long outageEndMillis = 0;
+    unsigned long recoveryMillis = 0;
+};
+
+std::string reportedField(const std::string& payload, const std::string& key) {
+    const std::string needle = "\"" + key + "\":\"";
+    const size_t start = payload.find(needle);
+    if (start == std::string::npos) return std::string();
+    const size_t end = payload.find('"', start + needle.size());
+    return payload.substr(start + needle.size(), end - start - needle.size());
+}
+
+// A get/accepted document as AWS sends it: per-field metadata timestamps and
+// a few keys the firmware does not use push it well past 1 KB.
+std::string getAcceptedDocument(unsigned long version) {
+    static const char* const kFields[] = {"rawSoilMoisture", "soilMoisturePercent", "humidityRange",
+                                          "servoAngle", "emotion", "firmware", "location", "notes"};
+    std::string metadata;
+    for (const char* field : kFields) {
+        if (!metadata.empty()) metadata += ",";
+        metadata += std::string("\"") + field + "\":{\"timestamp\":1760000000}";
+    }
+    return "{\"state\":{\"desired\":{\"firmware\":\"3.1.0\",\"location\":\"living room\"},"
+           "\"reported\":{\"emotion\":\"NEUTRAL\",\"servoAngle\":90,\"firmware\":\"3.0.2\","
+           "\"location\":\"kitchen\",\"notes\":\"repotted in spring, water from below\"},"
+           "\"delta\":{\"firmware\":\"3.1.0\",\"location\":\"living room\"}},"
+           "\"metadata\":{\"desired\":{" + metadata + "},\"reported\":{" + metadata + "}},"
+           "\"version\":" + std::to_string(version) + ",\"timestamp\":1760000000,"
+           "\"clientToken\":\"f3c1a2b4-5d6e-47f8-9a0b-1c2d3e4f5a6b\"}";
+}
+
+void installCloudResponder(SimBroker& broker, CloudShadow& cloud) {
+    broker.setPublishHook([&broker, &cloud](const std::string&, const std::string& topic, const std::string& payload) {
+        if (topic == kShadowPrefix + "/get") {
+            broker.publish(kShadowPrefix + "/get/accepted", getAcceptedDocument(cloud.version));
+        } else if (topic == kMetricsTopic) {
+            cloud.metricsMessages++;
+            cloud.lastMetrics = payload;
+        } else if (topic == kShadowPrefix + "/update") {
+            cloud.version++;
+            cloud.reports++;
+            cloud.reportBytes += payload.size();
+            if (cloud.outageEndMillis != 0 && cloud.recoveryMillis == 0) {
+                cloud.recoveryMillis = millis() - cloud.outageEndMillis;
+            }
+            if (cloud.firstReportMillis == 0) cloud.firstReportMillis = millis();
+            const std::string range = reportedField(payload, "humidityRange");
+            if (!range.empty() && range != cloud.humidityRange) {
+                if (!cloud.humidityRange.empty()) cloud.rangeChanges++;
+                cloud.humidityRange = range;
+            }
+            // Like AWS, the response echoes the request's clientToken.
+            const std::string clientToken = reportedField(payload, "clientToken");
+            broker.publish(kShadowPrefix + "/update/accepted",
+                           "{\"state\":{},\"version\":" + std::to_string(cloud.version) +
+                               (clientToken.empty() ? "" : ",\"clientToken\":\"" + clientToken + "\"") + "}");
+        }
+    });
+}
+
+long g_adcNoise = 8;
+double g_driftPeriodMs = 60000.0;
+
+// Slow drift across the whole calibration range plus ADC noise.
+int moistureSignal(unsigned long ms) {
+    const double phase = static_cast<double>(ms) / g_driftPeriodMs * 2.0 * M_PI;
+    const double mid = (SOIL_DRY_VALUE + SOIL_WET_VALUE) / 2.0;
+    const double amplitude = std::abs(SOIL_DRY_VALUE - SOIL_WET_VALUE) / 2.0;
+    return static_cast<int>(mid + amplitude * std::sin(phase)) + static_cast<int>(random(-g_adcNoise, g_adcNoise + 1));
+}
+
+struct DeltaInjector {
+    SimBroker& broker;
+    CloudShadow& cloud;
+    unsigned long everyMs;
+    unsigned long count = 0;
+    uint64_t pendingSinceUs = 0;
+    bool arrived = false;
+
+    void scheduleNext(uint64_t windowStartUs) {
+        const uint64_t atUs = windowStartUs + static_cast<uint64_t>(random(0, static_cast<long>(everyMs))) * 1000;
+        hostsim::scheduleEvent(atUs, [this, windowStartUs]() {
+            static const char* const kEmotions[] = {"FELIZ", "TRISTE", "NEUTRAL"};
+            cloud.version++;
+            broker.publish(kShadowPrefix + "/update/delta",
+                           std::string("{\"version\":") + std::to_string(cloud.version) +
+                               ",\"state\":{\"emotion\":\"" + kEmotions[count % 3] + "\"}}");
+            count++;
+            // A delta sent while the device is offline is never delivered.
+            pendingSinceUs = hostsim::board().linkUp ? hostsim::nowMicros() : 0;
+            arrived = true;
+            scheduleNext(windowStartUs + static_cast<uint64_t>(everyMs) * 1000);
+        });
+    }
+};
+
+}
+
+int main(int argc, char** argv) {
+    const unsigned long seconds = static_cast<unsigned long>(argValue(argc, argv, "--seconds", 600));
+    const unsigned long deltaEveryMs = static_cast<unsigned long>(argValue(argc, argv, "--delta-every-ms", 5000));
+    const long outageAt = argValue(argc, argv, "--outage-at", -1);
+    g_adcNoise = argValue(argc, argv, "--adc-noise", 8);
+    g_driftPeriodMs = argValue(argc, argv, "--drift-period-s", 60) * 1000.0;
+    const unsigned long outageMs = static_cast<unsigned long>(argValue(argc, argv, "--outage-ms", 30000));
+    const long brokerOutageAt = argValue(argc, argv, "--broker-outage-at", -1);
+    const unsigned long brokerOutageMs = static_cast<unsigned long>(argValue(argc, argv, "--broker-outage-ms", 300000));
+
+    hostsim::Board& board = hostsim::board();
+    board.serialSink = argFlag(argc, argv, "--serial") ? hostsim::SerialSink::Stdout : hostsim::SerialSink::Discard;
+    board.serialBaud = static_cast<unsigned long>(argValue(argc, argv, "--baud", 115200));
+    board.joinDelayMs = static_cast<unsigned long>(argValue(argc, argv, "--join-ms", 1500));
+    // Typical ESP32 figures: RSA-2048 mutual auth costs seconds of CPU, an
+    // abbreviated handshake a few round trips.
+    board.dnsMs = static_cast<unsigned long>(argValue(argc, argv, "--dns-ms", 40));
+    board.tcpConnectMs = static_cast<unsigned long>(argValue(argc, argv, "--tcp-ms", 60));
+    board.tlsFullHandshakeMs = static_cast<unsigned long>(argValue(argc, argv, "--tls-full-ms", 2500));
+    board.tlsResumedHandshakeMs = static_cast<unsigned long>(argValue(argc, argv, "--tls-resumed-ms", 150));
+    hostsim::setAnalogSignal(SOIL_MOISTURE_PIN, moistureSignal);
+
+    SimBroker& broker = SimBroker::shared();
+    CloudShadow cloud;
+    installCloudResponder(broker, cloud);
+
+    AppLogic app;
+    const unsigned long bootMillis = millis();
+    app.setup(AppLogic::RUN_SINGLE_LOOP);
+    while (millis() - bootMillis < 10000) app.loop();
+
+    const uint64_t startUs = hostsim::nowMicros();
+    const uint64_t endUs = startUs + static_cast<uint64_t>(seconds) * 1000000;
+    DeltaInjector deltas{broker, cloud, deltaEveryMs};
+    if (deltaEveryMs > 0) deltas.scheduleNext(startUs);
+    bool outageActive = false;
+    if (outageAt >= 0) {
+        const uint64_t outageStartUs = startUs + static_cast<uint64_t>(outageAt) * 1000000;
+        hostsim::scheduleEvent(outageStartUs, [&outageActive]() {
+            hostsim::setWiFiAvailable(false);
+            outageActive = true;
+        });
+        hostsim::scheduleEvent(outageStartUs + static_cast<uint64_t>(outageMs) * 1000, [&outageActive, &cloud]() {
+            hostsim::setWiFiAvailable(true);
+            outageActive = false;
+            cloud.outageEndMillis = millis();
+        });
+    }
+
+    if (brokerOutageAt >= 0) {
+        const uint64_t brokerOutageStartUs = startUs + static_cast<uint64_t>(brokerOutageAt) * 1000000;
+        hostsim::scheduleEvent(brokerOutageStartUs, [&broker]() { broker.setOnline(false); });
+        hostsim::scheduleEvent(brokerOutageStartUs + static_cast<uint64_t>(brokerOutageMs) * 1000, [&broker, &cloud]() {
+            broker.setOnline(true);
+            cloud.outageEndMillis = millis();
+        });
+    }
+
+    const int servoPin = SERVO_PIN;
+    LatencySamples all;
+    LatencySamples withDelta;
+    LatencySamples inOutage;
+    LatencySamples reaction;
+    uint64_t busyUs = 0;
+    unsigned long loops = 0;
+    const uint64_t serialBytesBefore = board.serialBytes;
+    const unsigned long servoWritesAtStart = board.servos[servoPin].writes;
+    const uint64_t pwmBeforeUs = board.servos[servoPin].attachedMicros(hostsim::nowMicros());
+
+    while (hostsim::nowMicros() < endUs) {
+        const bool deltaArrived = deltas.arrived;
+        deltas.arrived = false;
+        const unsigned long servoWritesBefore = board.servos[servoPin].writes;
+        const uint64_t stallBefore = board.stallUs;
+        const auto start = std::chrono::steady_clock::now();
+        app.loop();
+        const auto cpu = std::chrono::duration_cast<std::chrono::microseconds>(
+                             std::chrono::steady_clock::now() - start).count();
+        const uint64_t latency = static_cast<uint64_t>(cpu) + (board.stallUs - stallBefore);
+        loops++;
+        busyUs += latency;
+        all.add(latency);
+        if (deltaArrived) withDelta.add(latency);
+        if (outageActive) inOutage.add(latency);
+
+        const hostsim::ServoOutput& servo = board.servos[servoPin];
+        if (deltas.pendingSinceUs != 0 && servo.writes != servoWritesBefore && servo.lastWriteUs >= deltas.pendingSinceUs) {
+            reaction.add(servo.lastWriteUs - deltas.pendingSinceUs);
+            deltas.pendingSinceUs = 0;
+        }
+    }
+
+    const double simulatedS = static_cast<double>(hostsim::nowMicros() - startUs) / 1e6;
+    const SimBroker::Stats stats = broker.stats();
+    std::printf("loop_bench: %.0f s simulated, delta every %lu ms, %lu loop() calls (%.1f/s), busy %.3f%%\n",
+                simulatedS, deltaEveryMs, loops, loops / simulatedS, 100.0 * busyUs / (simulatedS * 1e6));
+    all.print("loop() all");
+    withDelta.print("loop() with delta");
+    if (inOutage.count() > 0) inOutage.print("loop() in outage");
+    reaction.print("delta-to-servo");
+    const hostsim::ServoOutput& servo = board.servos[servoPin];
+    std::printf("servo writes: %lu  PWM attached %.1f%% of the time\n", servo.writes - servoWritesAtStart,
+                100.0 * (servo.attachedMicros(hostsim::nowMicros()) - pwmBeforeUs) / (simulatedS * 1e6));
+    std::printf("boot-to-first-report: %lu ms  humidityRange changes reported: %lu\n",
+                cloud.firstReportMillis ? cloud.firstReportMillis - bootMillis : 0UL, cloud.rangeChanges);
+    std::printf("TLS handshakes full/resumed: %lu/%lu",
+                board.tlsFullHandshakes, board.tlsResumedHandshakes);
+    if (cloud.outageEndMillis != 0) std::printf("  outage-end-to-report: %lu ms", cloud.recoveryMillis);
+    std::printf("  connections refused: %llu", static_cast<unsigned long long>(stats.refused));
+    std::printf("\n");
+    std::printf("serial bytes: %llu  log lines dropped: %lu  shadow reports accepted: %lu (avg %.0f bytes)  broker publishes in/out: %llu/%llu\n",
+                static_cast<unsigned long long>(board.serialBytes - serialBytesBefore), Log::dropped(), cloud.reports,
+                cloud.reports ? static_cast<double>(cloud.reportBytes) / cloud.reports : 0.0,
+                static_cast<unsigned long long>(stats.publishesIn),
+                static_cast<unsigned long long>(stats.publishesOut));
+    std::printf("metrics messages: %lu (last %zu bytes)\n", cloud.metricsMessages, cloud.lastMetrics.size());
+    if (argFlag(argc, argv, "--print-metrics") && !cloud.lastMetrics.empty()) {
+        std::printf("%s\n", cloud.lastMetrics.c_str());
+    }
+    return 0;
+}
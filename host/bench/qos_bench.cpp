@@ -0,0 +1,108 @@
+// QoS 1 publish pipeline against the in-process broker.
+//
+// Publishes --messages payloads of --bytes through
+// MQTTManager::publishReliable(), keeping the in-flight window of --window
+// full from a loop shaped like AppLogic's: wait for input, update(), top up.
+// The broker answers each PUBLISH with a PUBACK --ack-latency-ms later on the
+// virtual clock and loses --loss-pct of them; missing PUBACKs are resent
+// after --timeout-ms, up to --attempts sends per message.
+//
+// Reported:
+//  - delivered messages per second of virtual time and total run time
+//  - publish-to-PUBACK latency (first send to acknowledgement)
+//  - resends, duplicates seen by the broker and messages given up
+//
+// Run with --window 1 for stop-and-wait, the QoS 1 behaviour without a window.
+//
+//   qos_bench [--messages N] [--bytes B] [--window W] [--ack-latency-ms MS]
+//             [--loss-pct P] [--timeout-ms MS] [--attempts N] [--seed N]
+//             [--serial]
+
+#include <cstdio>
+#include <vector>
+
+#include "BenchStats.h"
+#include "HostSim.h"
+#include "MQTTManager.h"
+#include "Metrics.h"
+#include "SimBroker.h"
+#include "WiFi.h"
+#include "aws_iot_config.h"
+
+namespace {
+
+const char* const kTopic = TELEMETRY_TOPIC_PREFIX THING_NAME TELEMETRY_TOPIC_SUFFIX;
+
+}
+
+int main(int argc, char** argv) {
+    const long messages = argValue(argc, argv, "--messages", 1000);
+    const size_t bytes = static_cast<size_t>(argValue(argc, argv, "--bytes", 200));
+    const uint8_t window = static_cast<uint8_t>(argValue(argc, argv, "--window", MQTT_INFLIGHT_WINDOW));
+    const unsigned long ackLatencyMs = static_cast<unsigned long>(argValue(argc, argv, "--ack-latency-ms", 80));
+    const double lossRate = argValue(argc, argv, "--loss-pct", 0) / 100.0;
+    const unsigned long timeoutMs = static_cast<unsigned long>(argValue(argc, argv, "--timeout-ms", MQTT_PUBACK_TIMEOUT_MS));
+    const uint8_t attempts = static_cast<uint8_t>(argValue(argc, argv, "--attempts", MQTT_PUBLISH_MAX_ATTEMPTS));
+
+    hostsim::Board& board = hostsim::board();
+    board.serialSink = argFlag(argc, argv, "--serial") ? hostsim::SerialSink::Stdout : hostsim::SerialSink::Discard;
+    Serial.begin(115200);
+    SimBroker& broker = SimBroker::shared();
+    broker.setPubAckOptions(ackLatencyMs, lossRate, static_cast<uint32_t>(argValue(argc, argv, "--seed", 1)));
+
+    WiFi.begin(WIFI_SSID, WIFI_PASS);
+    while (WiFi.status() != WL_CONNECTED) delay(10);
+    Metrics metrics;
+    MQTTManager mqtt(DEFAULT_DEVICE_CONFIG.endpoint, DEFAULT_DEVICE_CONFIG.port, DEFAULT_DEVICE_CONFIG.thingName);
+    mqtt.setMetrics(&metrics);
+    mqtt.setPublishWindow(window, timeoutMs, attempts);
+    if (!mqtt.connect()) {
+        std::fprintf(stderr, "qos_bench: cannot connect to the broker\n");
+        return 1;
+    }
+
+    std::vector<uint8_t> payload(bytes, 'x');
+    long sent = 0;
+    long delivered = 0;
+    long failed = 0;
+    const uint64_t startUs = hostsim::nowMicros();
+    auto done = [&delivered, &failed](bool ok, const char*, const uint8_t*, size_t) {
+        if (ok) {
+            delivered++;
+        } else {
+            failed++;
+        }
+    };
+    while (delivered + failed < messages) {
+        while (sent < messages && mqtt.canPublishReliable() &&
+               mqtt.publishReliable(kTopic, payload.data(), payload.size(), done)) {
+            sent++;
+        }
+        if (!mqtt.connected()) {
+            std::fprintf(stderr, "qos_bench: connection lost\n");
+            return 1;
+        }
+        mqtt.waitForInput(100);
+        mqtt.update();
+    }
+    const double elapsedS = static_cast<double>(hostsim::nowMicros() - startUs) / 1e6;
+
+    const Metrics::HistogramData& histogram = metrics.histogram(Metrics::PUBACK_MS);
+    const SimBroker::Stats stats = broker.stats();
+    std::printf("qos_bench: %ld messages of %zu bytes, window %u, PUBACK latency %lu ms, loss %.0f%%, "
+                "timeout %lu ms, %u attempts\n",
+                messages, bytes, (unsigned int)window, ackLatencyMs, lossRate * 100.0, timeoutMs,
+                (unsigned int)attempts);
+    std::printf("delivered: %ld in %.2f s (%.1f msg/s)  given up: %ld\n", delivered, elapsedS,
+                elapsedS > 0 ? delivered / elapsedS : 0.0, failed);
+    std::printf("publish-to-PUBACK: mean %.1f ms  max %lu ms\n",
+                histogram.count ? static_cast<double>(histogram.sum) / histogram.count : 0.0,
+                (unsigned long)histogram.max);
+    std::printf("resends: %lu  broker publishes in: %llu (duplicates %llu)  PUBACKs lost: %llu\n",
+                (unsigned long)metrics.counter(Metrics::MQTT_PUBACK_RETRIES),
+                static_cast<unsigned long long>(stats.publishesIn),
+                static_cast<unsigned long long>(stats.duplicatesIn),
+                static_cast<unsigned long long>(stats.pubacksLost));
+    mqtt.disconnect();
+    return 0;
+}
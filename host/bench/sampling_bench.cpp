@@ -0,0 +1,221 @@
+// Adaptive sensor sampling over watering cycles.
+//
+// Runs AppLogic in RUN_SINGLE_LOOP mode against ShadowService for --hours of
+// simulated time. Soil moisture follows a sawtooth: every --water-every-min
+// the plant is watered and moisture climbs from 30 % to 70 % in --water-s,
+// then dries linearly back to 30 % until the next watering; --adc-noise adds
+// uniform noise to every ADC reading. --fast-ms, --slow-ms and --slope set
+// desired.sampling before the device boots, so the policy arrives through the
+// shadow like any remote change; --slow-ms equal to --fast-ms is fixed-rate
+// sampling.
+//
+// Reported:
+//  - sensor scans and ADC conversions, per hour and inside watering windows
+//    (from the start of a watering until 30 s after moisture stops rising)
+//  - telemetry batches, samples and bytes
+//  - watering-to-report: virtual time from the start of a watering until a
+//    shadow report carries the humidityRange it leads to
+//
+//   sampling_bench [--hours H] [--water-every-min M] [--water-s S]
+//                  [--adc-noise N] [--fast-ms MS] [--slow-ms MS] [--slope P]
+//                  [--serial]
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+#include "AppLogic.h"
+#include "BenchStats.h"
+#include "HostSim.h"
+#include "ShadowService.h"
+#include "SimBroker.h"
+#include "aws_iot_config.h"
+
+namespace {
+
+const std::string kShadowPrefix = std::string("$aws/things/") + THING_NAME + "/shadow";
+const std::string kTelemetryTopic = TELEMETRY_TOPIC_PREFIX THING_NAME TELEMETRY_TOPIC_SUFFIX;
+const double kLowPercent = 30.0;
+const double kHighPercent = 70.0;
+
+struct Watering {
+    double cycleMs = 0;
+    double riseMs = 0;
+    long noise = 0;
+
+    double percentAt(unsigned long ms) const {
+        const double t = std::fmod(static_cast<double>(ms), cycleMs);
+        if (t < riseMs) return kLowPercent + (kHighPercent - kLowPercent) * t / riseMs;
+        return kHighPercent - (kHighPercent - kLowPercent) * (t - riseMs) / (cycleMs - riseMs);
+    }
+
+    int raw(unsigned long ms) const {
+        const double percent = percentAt(ms);
+        return static_cast<int>(SOIL_DRY_VALUE + (SOIL_WET_VALUE - SOIL_DRY_VALUE) * percent / 100.0) +
+               static_cast<int>(random(-noise, noise + 1));
+    }
+};
+
+std::string reportedField(const std::string& payload, const std::string& key) {
+    const std::string needle = "\"" + key + "\":\"";
+    const size_t start = payload.find(needle);
+    if (start == std::string::npos) return std::string();
+    const size_t end = payload.find('"', start + needle.size());
+    return payload.substr(start + needle.size(), end - start - needle.size());
+}
+
+// Sample count from a TelemetryBatcher v1 header: version, then varints for
+// epoch, interval and count.
+unsigned long batchSamples(const std::string& payload) {
+    size_t pos = 1;
+    unsigned long value = 0;
+    for (int field = 0; field < 3 && pos < payload.size(); field++) {
+        value = 0;
+        int shift = 0;
+        while (pos < payload.size()) {
+            const uint8_t byte = static_cast<uint8_t>(payload[pos++]);
+            value |= static_cast<unsigned long>(byte & 0x7F) << shift;
+            shift += 7;
+            if (!(byte & 0x80)) break;
+        }
+    }
+    return value;
+}
+
+struct Telemetry {
+    unsigned long batches = 0;
+    unsigned long samples = 0;
+    unsigned long long bytes = 0;
+};
+
+struct WateringTracker {
+    uint64_t startUs = 0;
+    std::string rangeBefore;
+    std::string lastRange;
+    LatencySamples toReport;
+
+    void started() {
+        startUs = hostsim::nowMicros();
+        rangeBefore = lastRange;
+    }
+
+    void reported(const std::string& range) {
+        lastRange = range;
+        if (startUs == 0 || range == rangeBefore) return;
+        toReport.add(hostsim::nowMicros() - startUs);
+        startUs = 0;
+    }
+};
+
+void scheduleEvery(uint64_t atUs, uint64_t everyUs, std::function<void()> fn) {
+    hostsim::scheduleEvent(atUs, [atUs, everyUs, fn]() {
+        fn();
+        scheduleEvery(atUs + everyUs, everyUs, fn);
+    });
+}
+
+}
+
+int main(int argc, char** argv) {
+    const long hours = argValue(argc, argv, "--hours", 6);
+    const long waterEveryMin = argValue(argc, argv, "--water-every-min", 120);
+    const long waterS = argValue(argc, argv, "--water-s", 40);
+    AdaptiveSampler::Policy policy = DEFAULT_SAMPLING_POLICY;
+    policy.fastIntervalMs = static_cast<uint32_t>(argValue(argc, argv, "--fast-ms", policy.fastIntervalMs));
+    policy.slowIntervalMs = static_cast<uint32_t>(argValue(argc, argv, "--slow-ms", policy.slowIntervalMs));
+    policy.slopeThreshold = static_cast<float>(argValue(argc, argv, "--slope", static_cast<long>(policy.slopeThreshold)));
+
+    hostsim::Board& board = hostsim::board();
+    board.serialSink = argFlag(argc, argv, "--serial") ? hostsim::SerialSink::Stdout : hostsim::SerialSink::Discard;
+    board.joinDelayMs = 1500;
+    board.dnsMs = 40;
+    board.tcpConnectMs = 60;
+    board.tlsFullHandshakeMs = 2500;
+    board.tlsResumedHandshakeMs = 150;
+
+    // Waterings start half a cycle in, after the device has settled.
+    Watering watering;
+    watering.cycleMs = waterEveryMin * 60000.0;
+    watering.riseMs = waterS * 1000.0;
+    watering.noise = argValue(argc, argv, "--adc-noise", 8);
+    const unsigned long offsetMs = static_cast<unsigned long>(watering.cycleMs / 2);
+    hostsim::setAnalogSignal(SOIL_MOISTURE_PIN, [watering, offsetMs](unsigned long ms) {
+        return watering.raw(ms + offsetMs);
+    });
+
+    SimBroker& broker = SimBroker::shared();
+    ShadowService service(broker);
+    ShadowService::Options options;
+    options.latencyMs = 50;
+    options.jitterMs = 20;
+    service.setOptions(options);
+    Telemetry telemetry;
+    WateringTracker tracker;
+    broker.setPublishHook([&service, &telemetry, &tracker](const std::string& clientId, const std::string& topic,
+                                                           const std::string& payload) {
+        if (clientId == THING_NAME && topic == kTelemetryTopic) {
+            telemetry.batches++;
+            telemetry.samples += batchSamples(payload);
+            telemetry.bytes += payload.size();
+        } else if (clientId == THING_NAME && topic == kShadowPrefix + "/update") {
+            const std::string range = reportedField(payload, "humidityRange");
+            if (!range.empty()) tracker.reported(range);
+        }
+        service.handlePublish(clientId, topic, payload);
+    });
+    service.update(THING_NAME, "",
+                   "{\"state\":{\"reported\":{\"emotion\":\"NEUTRAL\",\"servoAngle\":90},"
+                   "\"desired\":{\"sampling\":{\"fastMs\":" + std::to_string(policy.fastIntervalMs) +
+                       ",\"slowMs\":" + std::to_string(policy.slowIntervalMs) +
+                       ",\"slope\":" + std::to_string(policy.slopeThreshold) + "}}}}");
+
+    AppLogic app;
+    const unsigned long bootMillis = millis();
+    app.setup(AppLogic::RUN_SINGLE_LOOP);
+    while (millis() - bootMillis < 10000) app.loop();
+
+    const uint64_t startUs = hostsim::nowMicros();
+    const uint64_t endUs = startUs + static_cast<uint64_t>(hours) * 3600000000ULL;
+    const uint64_t readsBefore = board.analogReads;
+    const Telemetry telemetryBefore = telemetry;
+
+    // Scans inside watering windows, from the ADC conversion count.
+    uint64_t wateringReads = 0;
+    uint64_t windowReads = 0;
+    unsigned long waterings = 0;
+    const uint64_t cycleMs = static_cast<uint64_t>(watering.cycleMs);
+    const uint64_t windowUs = static_cast<uint64_t>(watering.riseMs + 30000.0) * 1000;
+    // A watering starts where (millis() + offsetMs) wraps around the cycle.
+    const uint64_t firstUs = startUs + (cycleMs - (millis() + offsetMs) % cycleMs) * 1000;
+    scheduleEvery(firstUs, cycleMs * 1000, [&board, &tracker, &windowReads]() {
+        tracker.started();
+        windowReads = board.analogReads;
+    });
+    scheduleEvery(firstUs + windowUs, cycleMs * 1000, [&board, &windowReads, &wateringReads, &waterings]() {
+        wateringReads += board.analogReads - windowReads;
+        waterings++;
+    });
+
+    while (hostsim::nowMicros() < endUs) app.loop();
+
+    const double simulatedH = static_cast<double>(hostsim::nowMicros() - startUs) / 3.6e9;
+    const uint64_t reads = board.analogReads - readsBefore;
+    const double scans = static_cast<double>(reads) / SOIL_OVERSAMPLE;
+    const double wateringScans = static_cast<double>(wateringReads) / SOIL_OVERSAMPLE;
+    const ShadowService::Stats stats = service.stats();
+    std::printf("sampling_bench: %.1f h simulated, sampling %lu-%lu ms above %.1f %%/min, watering every %ld min "
+                "(%.0f%% to %.0f%% in %ld s), ADC noise %ld\n",
+                simulatedH, (unsigned long)policy.fastIntervalMs, (unsigned long)policy.slowIntervalMs,
+                policy.slopeThreshold, waterEveryMin, kLowPercent, kHighPercent, waterS, watering.noise);
+    std::printf("sensor scans: %.0f (%.0f/h)  ADC conversions: %llu  waterings: %lu  scans per watering window: %.1f\n",
+                scans, scans / simulatedH, static_cast<unsigned long long>(reads), waterings,
+                waterings ? wateringScans / waterings : 0.0);
+    std::printf("telemetry: %lu batches  %lu samples  %llu bytes (%.0f bytes/h)\n",
+                telemetry.batches - telemetryBefore.batches, telemetry.samples - telemetryBefore.samples,
+                telemetry.bytes - telemetryBefore.bytes, (telemetry.bytes - telemetryBefore.bytes) / simulatedH);
+    std::printf("shadow updates accepted: %llu  device requests: %llu\n",
+                static_cast<unsigned long long>(stats.updatesAccepted),
+                static_cast<unsigned long long>(stats.requests));
+    tracker.toReport.print("watering-to-report");
+    return 0;
+}
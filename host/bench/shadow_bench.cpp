@@ -0,0 +1,195 @@
+// Shadow sync against the Device Shadow service stand-in.
+//
+// Runs AppLogic in RUN_SINGLE_LOOP mode against the in-process broker with
+// ShadowService answering shadow/update and shadow/get, for --seconds of
+// simulated time. A cloud application sets desired.emotion every
+// --desired-every-ms. With --writer-every-ms a second client also updates
+// reported.notes, which bumps the shadow version under the device: its
+// versioned reports then hit 409 conflicts, the conflict-storm case.
+// --latency-ms, --jitter-ms and --loss-pct apply to every request and
+// response between the device and the service.
+//
+// With --plants N the device runs N plants, each on its own named shadow
+// (plant1..plantN) over the same MQTT connection, and the desired changes go
+// round-robin over the plants.
+//
+// Reported:
+//  - desired-to-sync: virtual time from a desired change until the shadow has
+//    no delta left. A change replaced by the next one before syncing counts
+//    as superseded.
+//  - service counters: requests, accepted/rejected updates, 409s, GETs and
+//    messages lost.
+//
+//   shadow_bench [--seconds S] [--desired-every-ms MS] [--writer-every-ms MS]
+//                [--latency-ms MS] [--jitter-ms MS] [--loss-pct P] [--seed N]
+//                [--plants N] [--serial]
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "AppLogic.h"
+#include "BenchStats.h"
+#include "HostSim.h"
+#include "ShadowService.h"
+#include "SimBroker.h"
+#include "aws_iot_config.h"
+
+namespace {
+
+const char* const kPlantNames[MAX_PLANTS] = {"plant1", "plant2", "plant3", "plant4"};
+const int kSoilPins[MAX_PLANTS] = {SOIL_MOISTURE_PIN, 33, 34, 35};
+const int kServoPins[MAX_PLANTS] = {SERVO_PIN, 19, 21, 22};
+
+struct SyncTracker {
+    ShadowService& service;
+    std::string shadowName;
+    LatencySamples& toSync;
+    uint64_t pendingSinceUs = 0;
+    unsigned long changes = 0;
+    unsigned long superseded = 0;
+
+    void changed() {
+        if (pendingSinceUs != 0) superseded++;
+        pendingSinceUs = hostsim::nowMicros();
+        changes++;
+    }
+
+    void check() {
+        if (pendingSinceUs == 0 || !service.delta(THING_NAME, shadowName).empty()) return;
+        toSync.add(hostsim::nowMicros() - pendingSinceUs);
+        pendingSinceUs = 0;
+    }
+};
+
+void scheduleEvery(uint64_t atUs, unsigned long everyMs, std::function<void()> fn) {
+    hostsim::scheduleEvent(atUs, [atUs, everyMs, fn]() {
+        fn();
+        scheduleEvery(atUs + static_cast<uint64_t>(everyMs) * 1000, everyMs, fn);
+    });
+}
+
+}
+
+int main(int argc, char** argv) {
+    const unsigned long seconds = static_cast<unsigned long>(argValue(argc, argv, "--seconds", 300));
+    const unsigned long desiredEveryMs = static_cast<unsigned long>(argValue(argc, argv, "--desired-every-ms", 3000));
+    const unsigned long writerEveryMs = static_cast<unsigned long>(argValue(argc, argv, "--writer-every-ms", 0));
+    const long plantArg = argValue(argc, argv, "--plants", 0);
+    const uint8_t plants = static_cast<uint8_t>(plantArg < 0 ? 0 : plantArg > MAX_PLANTS ? MAX_PLANTS : plantArg);
+
+    hostsim::Board& board = hostsim::board();
+    board.serialSink = argFlag(argc, argv, "--serial") ? hostsim::SerialSink::Stdout : hostsim::SerialSink::Discard;
+    board.joinDelayMs = 1500;
+    board.dnsMs = 40;
+    board.tcpConnectMs = 60;
+    board.tlsFullHandshakeMs = 2500;
+    board.tlsResumedHandshakeMs = 150;
+    DeviceConfig config = DEFAULT_DEVICE_CONFIG;
+    std::vector<std::string> shadowNames(1, std::string());
+    if (plants > 0) {
+        config.plantCount = plants;
+        shadowNames.clear();
+        for (uint8_t i = 0; i < plants; i++) {
+            config.plants[i] = {kPlantNames[i], kSoilPins[i], kServoPins[i], SOIL_DRY_VALUE, SOIL_WET_VALUE};
+            shadowNames.push_back(kPlantNames[i]);
+        }
+    }
+    for (uint8_t i = 0; i < config.plantCount; i++) {
+        hostsim::setAnalogValue(config.plants[i].soilMoisturePin, (SOIL_DRY_VALUE + SOIL_WET_VALUE) / 2);
+    }
+
+    SimBroker& broker = SimBroker::shared();
+    ShadowService service(broker);
+    ShadowService::Options options;
+    options.latencyMs = static_cast<unsigned long>(argValue(argc, argv, "--latency-ms", 50));
+    options.jitterMs = static_cast<unsigned long>(argValue(argc, argv, "--jitter-ms", 20));
+    options.lossRate = argValue(argc, argv, "--loss-pct", 0) / 100.0;
+    options.seed = static_cast<uint32_t>(argValue(argc, argv, "--seed", 1));
+    service.setOptions(options);
+    broker.setPublishHook([&service](const std::string& clientId, const std::string& topic, const std::string& payload) {
+        service.handlePublish(clientId, topic, payload);
+    });
+    LatencySamples toSync;
+    std::vector<SyncTracker> syncs;
+    for (const std::string& name : shadowNames) {
+        service.update(THING_NAME, name, "{\"state\":{\"reported\":{\"emotion\":\"NEUTRAL\",\"servoAngle\":90}}}");
+        syncs.push_back(SyncTracker{service, name, toSync});
+    }
+    service.setUpdateObserver([&syncs](const std::string&, uint64_t) {
+        for (SyncTracker& sync : syncs) sync.check();
+    });
+    auto totalVersion = [&service, &shadowNames]() {
+        uint64_t version = 0;
+        for (const std::string& name : shadowNames) version += service.version(THING_NAME, name);
+        return version;
+    };
+
+    AppLogic app(config);
+    const unsigned long bootMillis = millis();
+    app.setup(AppLogic::RUN_SINGLE_LOOP);
+    while (millis() - bootMillis < 10000) app.loop();
+
+    const uint64_t startUs = hostsim::nowMicros();
+    const uint64_t endUs = startUs + static_cast<uint64_t>(seconds) * 1000000;
+    const ShadowService::Stats before = service.stats();
+    const uint64_t versionBefore = totalVersion();
+
+    unsigned long desiredCount = 0;
+    if (desiredEveryMs > 0) {
+        scheduleEvery(startUs + 500000, desiredEveryMs, [&service, &syncs, &desiredCount]() {
+            static const char* const kEmotions[] = {"FELIZ", "TRISTE", "NEUTRAL"};
+            SyncTracker& sync = syncs[desiredCount % syncs.size()];
+            const std::string emotion = kEmotions[desiredCount / syncs.size() % 3];
+            desiredCount++;
+            sync.changed();
+            service.update(THING_NAME, sync.shadowName,
+                           "{\"state\":{\"desired\":{\"emotion\":\"" + emotion + "\"}}}");
+        });
+    }
+    unsigned long writes = 0;
+    if (writerEveryMs > 0) {
+        scheduleEvery(startUs + 700000, writerEveryMs, [&service, &shadowNames, &writes]() {
+            const unsigned long write = ++writes;
+            service.update(THING_NAME, shadowNames[write % shadowNames.size()],
+                           "{\"state\":{\"reported\":{\"notes\":\"note " + std::to_string(write) + "\"}}}");
+        });
+    }
+
+    while (hostsim::nowMicros() < endUs) app.loop();
+
+    const double simulatedS = static_cast<double>(hostsim::nowMicros() - startUs) / 1e6;
+    const ShadowService::Stats stats = service.stats();
+    unsigned long changes = 0;
+    unsigned long superseded = 0;
+    std::string outOfSync;
+    for (const SyncTracker& sync : syncs) {
+        changes += sync.changes;
+        superseded += sync.superseded;
+        const json::Value delta = service.delta(THING_NAME, sync.shadowName);
+        if (delta.empty()) continue;
+        if (!outOfSync.empty()) outOfSync += " ";
+        if (!sync.shadowName.empty()) outOfSync += sync.shadowName + "=";
+        outOfSync += delta.dump();
+    }
+    std::printf("shadow_bench: %.0f s simulated, desired every %lu ms, writer every %lu ms, "
+                "latency %lu+%lu ms, loss %.0f%%, %s\n",
+                simulatedS, desiredEveryMs, writerEveryMs, options.latencyMs, options.jitterMs,
+                options.lossRate * 100.0,
+                plants > 0 ? (std::to_string(plants) + " named shadows").c_str() : "classic shadow");
+    toSync.print("desired-to-sync");
+    std::printf("desired changes: %lu  synced: %zu  superseded: %lu  in sync at end: %s\n",
+                changes, toSync.count(), superseded, outOfSync.empty() ? "yes" : outOfSync.c_str());
+    std::printf("shadow versions: %llu (%.2f/s)  updates accepted/rejected: %llu/%llu  409 conflicts: %llu\n",
+                static_cast<unsigned long long>(totalVersion() - versionBefore),
+                (totalVersion() - versionBefore) / simulatedS,
+                static_cast<unsigned long long>(stats.updatesAccepted - before.updatesAccepted),
+                static_cast<unsigned long long>(stats.updatesRejected - before.updatesRejected),
+                static_cast<unsigned long long>(stats.conflicts - before.conflicts));
+    std::printf("device requests: %llu  GETs: %llu  deltas sent: %llu  messages lost: %llu\n",
+                static_cast<unsigned long long>(stats.requests - before.requests),
+                static_cast<unsigned long long>(stats.gets - before.gets),
+                static_cast<unsigned long long>(stats.deltas - before.deltas),
+                static_cast<unsigned long long>(stats.lost - before.lost));
+    return 0;
+}
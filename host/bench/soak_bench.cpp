@@ -0,0 +1,225 @@
+// Heap use of the firmware over a long run.
+//
+// Runs AppLogic in RUN_SINGLE_LOOP mode against ShadowService for --hours of
+// simulated time with steady traffic: a cloud application changes
+// desired.emotion every --desired-every-ms, soil moisture follows a slow sine
+// (so range reports, telemetry and metrics go out as usual) and full reports
+// fire on their own schedule. The global operator new/delete are replaced to
+// count every allocation the firmware makes inside loop(); work done by the
+// simulated broker, the emulated cloud and bench events
+// (hostsim::SimulationScope) is left out.
+//
+// The first --warmup-s seconds (boot, WiFi join, TLS, subscriptions, the
+// first GET) are reported separately; everything after is steady state,
+// where the goal is zero allocations.
+//
+// Reported, for boot and steady state:
+//  - allocations, allocated bytes, loops with at least one allocation and the
+//    most allocations in a single loop
+//  - firmware heap in use: at the end of boot, peak and at the end
+// --trace N prints the call stack of the first N steady-state allocations.
+//
+//   soak_bench [--hours H] [--warmup-s S] [--desired-every-ms MS]
+//              [--period-s S] [--trace N] [--serial]
+
+#include <execinfo.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "AppLogic.h"
+#include "BenchStats.h"
+#include "HostSim.h"
+#include "ShadowService.h"
+#include "SimBroker.h"
+#include "aws_iot_config.h"
+
+namespace {
+
+// Single-threaded run: plain counters are enough.
+struct HeapCounters {
+    unsigned long long allocations = 0;
+    unsigned long long bytes = 0;
+    long long live = 0;
+    long long peak = 0;
+};
+
+bool g_tracking = false;
+HeapCounters g_heap;
+long g_traceLeft = 0;
+bool g_tracing = false;
+
+// Every block carries its size and whether it was counted, so frees made
+// outside the tracked region still settle the live total.
+struct alignas(std::max_align_t) BlockHeader {
+    size_t size;
+    bool tracked;
+};
+
+void printTrace() {
+    if (g_traceLeft <= 0 || g_tracing) return;
+    g_tracing = true;
+    g_traceLeft--;
+    void* frames[24];
+    const int depth = backtrace(frames, 24);
+    static const char kSeparator[] = "-- allocation\n";
+    if (write(STDERR_FILENO, kSeparator, sizeof(kSeparator) - 1) < 0) {}
+    // Frame 0 and 1 are this function and the allocator.
+    backtrace_symbols_fd(frames + 2, depth - 2, STDERR_FILENO);
+    g_tracing = false;
+}
+
+void* allocate(size_t size) {
+    BlockHeader* header = static_cast<BlockHeader*>(std::malloc(sizeof(BlockHeader) + size));
+    if (header == nullptr) throw std::bad_alloc();
+    header->size = size;
+    header->tracked = g_tracking && !g_tracing && !hostsim::inSimulation();
+    if (header->tracked) {
+        g_heap.allocations++;
+        g_heap.bytes += size;
+        g_heap.live += static_cast<long long>(size);
+        if (g_heap.live > g_heap.peak) g_heap.peak = g_heap.live;
+        printTrace();
+    }
+    return header + 1;
+}
+
+void release(void* block) {
+    if (block == nullptr) return;
+    BlockHeader* header = static_cast<BlockHeader*>(block) - 1;
+    if (header->tracked) g_heap.live -= static_cast<long long>(header->size);
+    std::free(header);
+}
+
+struct PhaseStats {
+    unsigned long loops = 0;
+    unsigned long allocatingLoops = 0;
+    unsigned long long maxPerLoop = 0;
+    HeapCounters start;
+    HeapCounters end;
+
+    void print(const char* label, double hours) const {
+        const unsigned long long allocations = end.allocations - start.allocations;
+        std::printf("%-7s loops: %lu  allocating loops: %lu  allocations: %llu (%.1f/h)  bytes: %llu  "
+                    "max per loop: %llu\n",
+                    label, loops, allocatingLoops, allocations, hours > 0 ? allocations / hours : 0.0,
+                    end.bytes - start.bytes, maxPerLoop);
+    }
+};
+
+void runLoop(AppLogic& app, PhaseStats& phase) {
+    const unsigned long long before = g_heap.allocations;
+    g_tracking = true;
+    app.loop();
+    g_tracking = false;
+    const unsigned long long made = g_heap.allocations - before;
+    phase.loops++;
+    if (made > 0) phase.allocatingLoops++;
+    if (made > phase.maxPerLoop) phase.maxPerLoop = made;
+}
+
+void scheduleEvery(uint64_t atUs, uint64_t everyUs, std::function<void()> fn) {
+    hostsim::scheduleEvent(atUs, [atUs, everyUs, fn]() {
+        fn();
+        scheduleEvery(atUs + everyUs, everyUs, fn);
+    });
+}
+
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void operator delete(void* block) noexcept { release(block); }
+void operator delete[](void* block) noexcept { release(block); }
+void operator delete(void* block, size_t) noexcept { release(block); }
+void operator delete[](void* block, size_t) noexcept { release(block); }
+void operator delete(void* block, const std::nothrow_t&) noexcept { release(block); }
+void operator delete[](void* block, const std::nothrow_t&) noexcept { release(block); }
+
+int main(int argc, char** argv) {
+    const long hours = argValue(argc, argv, "--hours", 2);
+    const long warmupS = argValue(argc, argv, "--warmup-s", 60);
+    const uint64_t desiredEveryMs = static_cast<uint64_t>(argValue(argc, argv, "--desired-every-ms", 5000));
+    const double periodS = static_cast<double>(argValue(argc, argv, "--period-s", 1800));
+    g_traceLeft = argValue(argc, argv, "--trace", 0);
+
+    hostsim::Board& board = hostsim::board();
+    board.serialSink = argFlag(argc, argv, "--serial") ? hostsim::SerialSink::Stdout : hostsim::SerialSink::Discard;
+    board.joinDelayMs = 1500;
+    board.dnsMs = 40;
+    board.tcpConnectMs = 60;
+    board.tlsFullHandshakeMs = 2500;
+    board.tlsResumedHandshakeMs = 150;
+    // Moisture swings between 25 % and 75 %, crossing every range.
+    hostsim::setAnalogSignal(SOIL_MOISTURE_PIN, [periodS](unsigned long ms) {
+        const double percent = 50.0 + 25.0 * std::sin(2.0 * M_PI * ms / (periodS * 1000.0));
+        return static_cast<int>(SOIL_DRY_VALUE + (SOIL_WET_VALUE - SOIL_DRY_VALUE) * percent / 100.0) +
+               static_cast<int>(random(-8, 9));
+    });
+
+    SimBroker& broker = SimBroker::shared();
+    ShadowService service(broker);
+    ShadowService::Options options;
+    options.latencyMs = 50;
+    options.jitterMs = 20;
+    service.setOptions(options);
+    broker.setPublishHook([&service](const std::string& clientId, const std::string& topic, const std::string& payload) {
+        service.handlePublish(clientId, topic, payload);
+    });
+    service.update(THING_NAME, "", "{\"state\":{\"reported\":{\"emotion\":\"NEUTRAL\",\"servoAngle\":90}}}");
+
+    PhaseStats boot;
+    PhaseStats steady;
+    // The AppLogic object itself is built outside the counted region, as the
+    // global in the sketch is.
+    AppLogic app;
+    const uint64_t bootUs = hostsim::nowMicros();
+    g_tracking = true;
+    app.setup(AppLogic::RUN_SINGLE_LOOP);
+    g_tracking = false;
+    while (hostsim::nowMicros() - bootUs < static_cast<uint64_t>(warmupS) * 1000000) runLoop(app, boot);
+    boot.end = g_heap;
+
+    const uint64_t startUs = hostsim::nowMicros();
+    const uint64_t endUs = startUs + static_cast<uint64_t>(hours) * 3600000000ULL;
+    unsigned long desiredCount = 0;
+    if (desiredEveryMs > 0) {
+        scheduleEvery(startUs + 500000, desiredEveryMs * 1000, [&service, &desiredCount]() {
+            static const char* const kEmotions[] = {"FELIZ", "TRISTE", "NEUTRAL"};
+            service.update(THING_NAME, "",
+                           std::string("{\"state\":{\"desired\":{\"emotion\":\"") + kEmotions[desiredCount++ % 3] +
+                               "\"}}}");
+        });
+    }
+    const ShadowService::Stats before = service.stats();
+    steady.start = g_heap;
+    const long long bootPeak = g_heap.peak;
+    g_heap.peak = g_heap.live;
+    while (hostsim::nowMicros() < endUs) runLoop(app, steady);
+    steady.end = g_heap;
+
+    const double simulatedH = static_cast<double>(hostsim::nowMicros() - startUs) / 3.6e9;
+    const ShadowService::Stats stats = service.stats();
+    std::printf("soak_bench: %.1f h simulated after %ld s of boot, desired every %llu ms, moisture period %.0f s\n",
+                simulatedH, warmupS, static_cast<unsigned long long>(desiredEveryMs), periodS);
+    boot.print("boot", 0);
+    steady.print("steady", simulatedH);
+    std::printf("firmware heap: boot peak %lld bytes, %lld after boot, steady peak %lld, %lld at end\n", bootPeak,
+                boot.end.live, g_heap.peak, g_heap.live);
+    std::printf("desired changes: %lu  shadow updates accepted: %llu  device requests: %llu\n", desiredCount,
+                static_cast<unsigned long long>(stats.updatesAccepted - before.updatesAccepted),
+                static_cast<unsigned long long>(stats.requests - before.requests));
+    return 0;
+}
@@ -0,0 +1,170 @@
+// Network/control task split on the host build.
+//
+// 1. SpscQueue throughput: one producer and one consumer thread streaming
+//    --messages items through a 1024-slot queue.
+//    Waiting sides yield so the run also completes on a single host core.
+// 2. SpscQueue hand-off latency: ping-pong over two queues between two
+//    threads, reported as round trip.
+// 3. AppLogic in RUN_DUAL_CORE mode on the real-time clock: network and control
+//    tasks run as std::threads, the cloud injects a delta every
+//    --delta-every-ms and the time until the device's shadow report is
+//    measured for --seconds.
+//
+//   split_bench [--messages N] [--pings N] [--seconds S] [--delta-every-ms MS]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "AppLogic.h"
+#include "BenchStats.h"
+#include "HostSim.h"
+#include "SimBroker.h"
+#include "SpscQueue.h"
+#include "aws_iot_config.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+void benchThroughput(long messages) {
+    static SpscQueue<uint64_t, 1024> queue;
+    uint64_t checksum = 0;
+    const uint64_t start = nowNs();
+    std::thread consumer([&checksum, messages]() {
+        uint64_t value;
+        for (long received = 0; received < messages;) {
+            if (queue.pop(value)) {
+                checksum += value;
+                received++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    for (long i = 0; i < messages;) {
+        if (queue.push(static_cast<uint64_t>(i))) i++;
+        else std::this_thread::yield();
+    }
+    consumer.join();
+    const double seconds = (nowNs() - start) / 1e9;
+    const uint64_t expected = static_cast<uint64_t>(messages) * (messages - 1) / 2;
+    std::printf("spsc throughput: %ld messages in %.3f s, %.1f M msg/s%s\n", messages, seconds,
+                messages / seconds / 1e6, checksum == expected ? "" : "  CHECKSUM MISMATCH");
+}
+
+void benchPingPong(long pings) {
+    static SpscQueue<uint64_t, 16> ping;
+    static SpscQueue<uint64_t, 16> pong;
+    LatencySamples rtt;
+    rtt.reserve(pings);
+    std::thread echo([pings]() {
+        uint64_t value;
+        for (long i = 0; i < pings; i++) {
+            while (!ping.pop(value)) std::this_thread::yield();
+            while (!pong.push(value)) std::this_thread::yield();
+        }
+    });
+    for (long i = 0; i < pings; i++) {
+        uint64_t sent = nowNs();
+        while (!ping.push(sent)) std::this_thread::yield();
+        uint64_t echoed;
+        while (!pong.pop(echoed)) std::this_thread::yield();
+        rtt.add(nowNs() - echoed);
+    }
+    echo.join();
+    std::printf("spsc round trip:      n=%-8zu mean=%9.1fns p50=%7lluns p99=%7lluns p99.9=%7lluns max=%7lluns\n",
+                rtt.count(), rtt.mean(),
+                static_cast<unsigned long long>(rtt.percentile(50)),
+                static_cast<unsigned long long>(rtt.percentile(99)),
+                static_cast<unsigned long long>(rtt.percentile(99.9)),
+                static_cast<unsigned long long>(rtt.percentile(100)));
+}
+
+const std::string kShadowPrefix = std::string("$aws/things/") + THING_NAME + "/shadow";
+
+// update/accepted echoes the request's clientToken, as AWS does.
+std::string clientTokenJson(const std::string& payload) {
+    const std::string needle = "\"clientToken\":\"";
+    const size_t start = payload.find(needle);
+    if (start == std::string::npos) return std::string();
+    const size_t end = payload.find('"', start + needle.size());
+    return ",\"clientToken\":\"" + payload.substr(start + needle.size(), end - start - needle.size()) + "\"";
+}
+
+struct Cloud {
+    std::mutex mutex;
+    unsigned long version = 1;
+    uint64_t deltaSentNs = 0;
+    LatencySamples deltaToReport;
+};
+
+void benchDualCore(long seconds, long deltaEveryMs) {
+    hostsim::useRealtimeClock(true);
+    hostsim::Board& board = hostsim::board();
+    board.serialSink = hostsim::SerialSink::Discard;
+    board.joinDelayMs = 200;
+    hostsim::setAnalogValue(SOIL_MOISTURE_PIN, (SOIL_DRY_VALUE + SOIL_WET_VALUE) / 2);
+
+    SimBroker& broker = SimBroker::shared();
+    Cloud cloud;
+    broker.setPublishHook([&broker, &cloud](const std::string&, const std::string& topic,
+                                              const std::string& payload) {
+        std::lock_guard<std::mutex> lock(cloud.mutex);
+        if (topic == kShadowPrefix + "/get") {
+            broker.publish(kShadowPrefix + "/get/accepted",
+                           "{\"state\":{\"reported\":{\"emotion\":\"NEUTRAL\",\"servoAngle\":90}},\"version\":" +
+                               std::to_string(cloud.version) + "}");
+        } else if (topic == kShadowPrefix + "/update") {
+            cloud.version++;
+            if (cloud.deltaSentNs != 0) {
+                cloud.deltaToReport.add((nowNs() - cloud.deltaSentNs) / 1000);
+                cloud.deltaSentNs = 0;
+            }
+            broker.publish(kShadowPrefix + "/update/accepted",
+                           "{\"state\":{},\"version\":" + std::to_string(cloud.version) +
+                               clientTokenJson(payload) + "}");
+        }
+    });
+
+    static AppLogic app;
+    app.setup(AppLogic::RUN_DUAL_CORE);
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+
+    static const char* const kEmotions[] = {"FELIZ", "TRISTE", "NEUTRAL"};
+    const auto end = Clock::now() + std::chrono::seconds(seconds);
+    for (long i = 0; Clock::now() < end; i++) {
+        std::string payload;
+        {
+            std::lock_guard<std::mutex> lock(cloud.mutex);
+            cloud.version++;
+            cloud.deltaSentNs = nowNs();
+            payload = std::string("{\"version\":") + std::to_string(cloud.version) +
+                      ",\"state\":{\"emotion\":\"" + kEmotions[i % 3] + "\"}}";
+        }
+        broker.publish(kShadowPrefix + "/update/delta", payload);
+        std::this_thread::sleep_for(std::chrono::milliseconds(deltaEveryMs));
+    }
+
+    std::lock_guard<std::mutex> lock(cloud.mutex);
+    cloud.deltaToReport.print("dual-core delta->report");
+}
+
+}
+
+int main(int argc, char** argv) {
+    benchThroughput(argValue(argc, argv, "--messages", 20000000));
+    benchPingPong(argValue(argc, argv, "--pings", 200000));
+    benchDualCore(argValue(argc, argv, "--seconds", 10), argValue(argc, argv, "--delta-every-ms", 250));
+    std::fflush(stdout);
+    // The FreeRTOS tasks never return; leave without running static destructors
+    // under them.
+    std::_Exit(0);
+}
@@ -0,0 +1,228 @@
+#include "Arduino.h"
+#include "HostSim.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+namespace {
+
+std::atomic<bool> g_realtime{false};
+std::atomic<uint64_t> g_virtualUs{0};
+const auto g_epoch = std::chrono::steady_clock::now();
+
+hostsim::Board g_defaultBoard;
+thread_local hostsim::Board* t_board = nullptr;
+thread_local int t_simulationDepth = 0;
+
+std::mutex g_randomMutex;
+std::mt19937 g_random(0x5eed);
+
+uint64_t byteTimeUs(const hostsim::Board& b) {
+    // 8N1 framing: 10 bits per byte.
+    return b.serialBaud ? (10ULL * 1000000ULL) / b.serialBaud : 0;
+}
+
+int fifoRoom(const hostsim::Board& b) {
+    const uint64_t perByte = byteTimeUs(b);
+    const uint64_t now = hostsim::nowMicros();
+    if (perByte == 0 || b.serialBusyUntilUs <= now) return static_cast<int>(b.serialFifoBytes);
+    const uint64_t queued = (b.serialBusyUntilUs - now + perByte - 1) / perByte;
+    return queued >= b.serialFifoBytes ? 0 : static_cast<int>(b.serialFifoBytes - queued);
+}
+
+}
+
+namespace hostsim {
+
+Board& board() { return t_board ? *t_board : g_defaultBoard; }
+void setBoard(Board* b) { t_board = b; }
+
+void useRealtimeClock(bool realtime) { g_realtime = realtime; }
+bool realtimeClock() { return g_realtime; }
+
+uint64_t nowMicros() {
+    if (g_realtime) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now() - g_epoch).count();
+    }
+    return g_virtualUs.load();
+}
+
+void advanceMicros(uint64_t us) {
+    if (g_realtime) {
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+        return;
+    }
+    const uint64_t target = g_virtualUs.load() + us;
+    auto& events = board().timedEvents;
+    while (!events.empty() && events.begin()->first <= target) {
+        auto first = events.begin();
+        std::function<void()> fn = std::move(first->second);
+        if (first->first > g_virtualUs.load()) g_virtualUs.store(first->first);
+        events.erase(first);
+        SimulationScope scope;
+        fn();
+    }
+    if (target > g_virtualUs.load()) g_virtualUs.store(target);
+}
+
+void scheduleEvent(uint64_t atUs, std::function<void()> fn) {
+    board().timedEvents.emplace(atUs, std::move(fn));
+}
+
+void stall(uint64_t us) {
+    board().stallUs += us;
+    advanceMicros(us);
+}
+
+void setAnalogValue(int pin, int value) {
+    board().analogSignals.erase(pin);
+    board().analogValues[pin] = value;
+}
+
+void setAnalogSignal(int pin, std::function<int(unsigned long)> signal) {
+    board().analogSignals[pin] = std::move(signal);
+}
+
+void setWiFiAvailable(bool available) {
+    board().apAvailable = available;
+    if (!available) board().linkUp = false;
+}
+
+void dropWiFi() {
+    board().linkUp = false;
+}
+
+SimulationScope::SimulationScope() { t_simulationDepth++; }
+SimulationScope::~SimulationScope() { t_simulationDepth--; }
+bool inSimulation() { return t_simulationDepth > 0; }
+
+void setRandomSeed(uint32_t seed) {
+    std::lock_guard<std::mutex> lock(g_randomMutex);
+    g_random.seed(seed);
+}
+
+}
+
+unsigned long millis() { return static_cast<unsigned long>(hostsim::nowMicros() / 1000); }
+unsigned long micros() { return static_cast<unsigned long>(hostsim::nowMicros()); }
+void delay(uint32_t ms) {
+    hostsim::board().delayedUs += static_cast<uint64_t>(ms) * 1000;
+    hostsim::advanceMicros(static_cast<uint64_t>(ms) * 1000);
+}
+void delayMicroseconds(uint32_t us) { hostsim::advanceMicros(us); }
+void yield() { if (hostsim::realtimeClock()) std::this_thread::yield(); }
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+int digitalRead(uint8_t) { return LOW; }
+
+uint16_t analogRead(uint8_t pin) {
+    hostsim::Board& b = hostsim::board();
+    b.analogReads++;
+    int value = 0;
+    auto signal = b.analogSignals.find(pin);
+    if (signal != b.analogSignals.end()) {
+        value = signal->second(millis());
+    } else {
+        auto fixed = b.analogValues.find(pin);
+        if (fixed != b.analogValues.end()) value = fixed->second;
+    }
+    return static_cast<uint16_t>(constrain(value, 0, 4095));
+}
+
+uint32_t analogReadMilliVolts(uint8_t pin) {
+    return static_cast<uint32_t>(analogRead(pin)) * 3300 / 4095;
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    const long run = in_max - in_min;
+    if (run == 0) return 0;
+    return (x - in_min) * (out_max - out_min) / run + out_min;
+}
+
+long random(long howbig) {
+    if (howbig <= 0) return 0;
+    return static_cast<long>(esp_random() % static_cast<uint32_t>(howbig));
+}
+
+long random(long howsmall, long howbig) {
+    if (howsmall >= howbig) return howsmall;
+    return random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned long seed) {
+    if (seed != 0) hostsim::setRandomSeed(static_cast<uint32_t>(seed));
+}
+
+uint32_t esp_random() {
+    std::lock_guard<std::mutex> lock(g_randomMutex);
+    return g_random();
+}
+
+void configTime(long, int, const char*, const char*, const char*) {}
+
+bool getLocalTime(struct tm* info, uint32_t) {
+    time_t now = time(nullptr);
+    gmtime_r(&now, info);
+    return true;
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+    hostsim::board().serialBaud = baud;
+}
+
+int HardwareSerial::availableForWrite() {
+    hostsim::Board& b = hostsim::board();
+    std::lock_guard<std::recursive_mutex> lock(b.serialMutex);
+    return fifoRoom(b);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    hostsim::Board& b = hostsim::board();
+    std::lock_guard<std::recursive_mutex> lock(b.serialMutex);
+    const uint64_t perByte = byteTimeUs(b);
+    if (perByte > 0) {
+        // Bytes beyond the FIFO block the caller until the UART drains them.
+        const int room = fifoRoom(b);
+        if (size > static_cast<size_t>(room)) {
+            hostsim::stall((size - room) * perByte);
+        }
+        const uint64_t now = hostsim::nowMicros();
+        b.serialBusyUntilUs = std::max(b.serialBusyUntilUs, now) + size * perByte;
+    }
+    b.serialBytes += size;
+    if (b.serialSink == hostsim::SerialSink::Stdout) {
+        std::fwrite(buffer, 1, size, stdout);
+    }
+    return size;
+}
+
+void HardwareSerial::flush() {
+    hostsim::Board& b = hostsim::board();
+    std::lock_guard<std::recursive_mutex> lock(b.serialMutex);
+    const uint64_t now = hostsim::nowMicros();
+    if (b.serialBusyUntilUs > now) hostsim::stall(b.serialBusyUntilUs - now);
+    if (b.serialSink == hostsim::SerialSink::Stdout) std::fflush(stdout);
+}
+
+void EspClass::restart() {
+    throw hostsim::RestartRequested();
+}
+
+uint32_t EspClass::getHeapSize() { return 327680; }
+uint32_t EspClass::getFreeHeap() { return 262144; }
+uint32_t EspClass::getMinFreeHeap() { return 262144; }
+uint32_t EspClass::getMaxAllocHeap() { return 114688; }
+uint64_t EspClass::getEfuseMac() { return 0x24D7EB10A2C4ULL; }
@@ -0,0 +1,87 @@
+#ifndef Arduino_h
+#define Arduino_h
+
+// Host stand-in for the arduino-esp32 core. Only the API surface the sketch
+// uses is provided; timing, GPIO, ADC and UART behaviour are simulated per
+// board (see HostSim.h).
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include "Print.h"
+#include "Stream.h"
+#include "WString.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define PROGMEM
+#define F(string_literal) (string_literal)
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+uint32_t analogReadMilliVolts(uint8_t pin);
+
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+uint32_t esp_random();
+
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char* server1,
+                const char* server2 = nullptr, const char* server3 = nullptr);
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
+
+class HardwareSerial : public Stream {
+  public:
+    void begin(unsigned long baud);
+    void end() {}
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    int availableForWrite() override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    void flush() override;
+    operator bool() const { return true; }
+
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+  public:
+    [[noreturn]] void restart();
+    uint32_t getHeapSize();
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint64_t getEfuseMac();
+};
+
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,65 @@
+#include "ESP32Servo.h"
+
+#include "Arduino.h"
+#include "HostSim.h"
+
+int Servo::attach(int pin) {
+    return attach(pin, _minUs, _maxUs);
+}
+
+int Servo::attach(int pin, int minUs, int maxUs) {
+    _pin = pin;
+    _minUs = minUs;
+    _maxUs = maxUs;
+    hostsim::board().servos[_pin].setAttached(true, hostsim::nowMicros());
+    return 0;
+}
+
+void Servo::detach() {
+    if (_pin < 0) return;
+    hostsim::board().servos[_pin].setAttached(false, hostsim::nowMicros());
+}
+
+void Servo::write(int value) {
+    if (value < 200) {
+        _angle = constrain(value, 0, 180);
+    } else {
+        _angle = map(value, _minUs, _maxUs, 0, 180);
+    }
+    // Like the library: without PWM the value is kept but nothing moves.
+    if (!attached()) return;
+    hostsim::ServoOutput& out = hostsim::board().servos[_pin];
+    out.angle = _angle;
+    out.writes++;
+    out.lastWriteUs = hostsim::nowMicros();
+}
+
+void Servo::writeMicroseconds(int value) {
+    write(constrain(value, _minUs, _maxUs));
+}
+
+int Servo::read() {
+    return _angle;
+}
+
+bool Servo::attached() {
+    return _pin >= 0 && hostsim::board().servos[_pin].attached;
+}
+
+namespace hostsim {
+
+void ServoOutput::setAttached(bool on, uint64_t nowUs) {
+    if (on == attached) return;
+    if (on) {
+        attachedSinceUs = nowUs;
+    } else {
+        attachedUs += nowUs - attachedSinceUs;
+    }
+    attached = on;
+}
+
+uint64_t ServoOutput::attachedMicros(uint64_t nowUs) const {
+    return attachedUs + (attached ? nowUs - attachedSinceUs : 0);
+}
+
+}
@@ -0,0 +1,24 @@
+#ifndef ESP32Servo_h
+#define ESP32Servo_h
+
+#include <cstdint>
+
+// Stand-in for the ESP32Servo library; writes land in the board's ServoOutput.
+class Servo {
+  public:
+    int attach(int pin);
+    int attach(int pin, int minUs, int maxUs);
+    void detach();
+    void write(int value);
+    void writeMicroseconds(int value);
+    int read();
+    bool attached();
+
+  private:
+    int _pin = -1;
+    int _minUs = 544;
+    int _maxUs = 2400;
+    int _angle = 0;
+};
+
+#endif
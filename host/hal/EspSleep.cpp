@@ -0,0 +1,31 @@
+#include "esp_sleep.h"
+
+#include "HostSim.h"
+#include "WiFi.h"
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t timeInUs) {
+    hostsim::board().sleepTimerUs = timeInUs;
+    return ESP_OK;
+}
+
+void esp_deep_sleep_start() {
+    hostsim::Board& b = hostsim::board();
+    // Radio and PWM stop; the event handlers belong to firmware that is about
+    // to be reset.
+    WiFi.disconnect(true);
+    b.wifiEventHandlers.clear();
+    b.linkReported = false;
+    for (auto& servo : b.servos) servo.second.setAttached(false, hostsim::nowMicros());
+
+    const uint64_t us = b.sleepTimerUs;
+    b.sleepTimerUs = 0;
+    b.wakeupCause = us > 0 ? ESP_SLEEP_WAKEUP_TIMER : ESP_SLEEP_WAKEUP_UNDEFINED;
+    b.deepSleeps++;
+    b.deepSleepUs += us;
+    hostsim::advanceMicros(us);
+    throw hostsim::DeepSleepRequested(us);
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+    return static_cast<esp_sleep_wakeup_cause_t>(hostsim::board().wakeupCause);
+}
@@ -0,0 +1,158 @@
+#include "esp_tls.h"
+
+#include <cstring>
+
+#include "Arduino.h"
+#include "HostSim.h"
+#include "SimBroker.h"
+#include "WiFi.h"
+
+struct esp_tls_client_session {
+    SimBroker* broker;
+};
+
+struct esp_tls {
+    esp_tls_conn_state_t state = ESP_TLS_INIT;
+    uint64_t connectStartUs = 0;
+    SimBroker* broker = nullptr;
+    int handle = -1;
+    bool resumed = false;
+};
+
+namespace {
+
+SimBroker* boardBroker() {
+    return hostsim::board().broker ? hostsim::board().broker : &SimBroker::shared();
+}
+
+// What mbedtls_x509_crt_parse / mbedtls_pk_parse_key would accept at the
+// surface: PEM with its terminator counted, or one DER SEQUENCE exactly as
+// long as the buffer. Nothing is decoded further.
+bool parseable(const unsigned char* buf, unsigned int bytes) {
+    if (buf == nullptr || bytes == 0) return true;
+    if (buf[bytes - 1] == '\0') return std::strstr(reinterpret_cast<const char*>(buf), "-----BEGIN ") != nullptr;
+    if (bytes < 2 || buf[0] != 0x30) return false;
+    size_t header = 2;
+    size_t content = buf[1];
+    if (content & 0x80) {
+        const size_t lengthBytes = content & 0x7F;
+        if (lengthBytes == 0 || lengthBytes > 3 || bytes < header + lengthBytes) return false;
+        content = 0;
+        for (size_t i = 0; i < lengthBytes; i++) content = (content << 8) | buf[header + i];
+        header += lengthBytes;
+    }
+    return header + content == bytes;
+}
+
+bool isOpen(esp_tls_t* tls) {
+    if (tls == nullptr || tls->broker == nullptr) return false;
+    if (!hostsim::board().linkUp) tls->broker->close(tls->handle);
+    return tls->broker->isOpen(tls->handle);
+}
+
+}
+
+esp_tls_t* esp_tls_init(void) {
+    return new esp_tls();
+}
+
+// TCP connect is a wait (the caller polls); the handshake is CPU work and is
+// accounted as stall, full or resumed depending on the offered session.
+int esp_tls_conn_new_async(const char*, int, int, const esp_tls_cfg_t* cfg, esp_tls_t* tls) {
+    if (tls == nullptr || cfg == nullptr) return -1;
+    hostsim::Board& b = hostsim::board();
+    switch (tls->state) {
+        case ESP_TLS_INIT:
+            if (WiFi.status() != WL_CONNECTED) {
+                tls->state = ESP_TLS_FAIL;
+                return -1;
+            }
+            tls->state = ESP_TLS_CONNECTING;
+            tls->connectStartUs = hostsim::nowMicros();
+            return 0;
+        case ESP_TLS_CONNECTING: {
+            if (!b.linkUp) {
+                tls->state = ESP_TLS_FAIL;
+                return -1;
+            }
+            if (hostsim::nowMicros() - tls->connectStartUs < static_cast<uint64_t>(b.tcpConnectMs) * 1000) return 0;
+            SimBroker* broker = boardBroker();
+            const int handle = broker->open();
+            if (handle < 0) {
+                tls->state = ESP_TLS_FAIL;
+                return -1;
+            }
+            tls->broker = broker;
+            tls->handle = handle;
+            tls->state = ESP_TLS_HANDSHAKE;
+            return 0;
+        }
+        case ESP_TLS_HANDSHAKE:
+            if (!parseable(cfg->cacert_buf, cfg->cacert_bytes) ||
+                !parseable(cfg->clientcert_buf, cfg->clientcert_bytes) ||
+                !parseable(cfg->clientkey_buf, cfg->clientkey_bytes)) {
+                tls->state = ESP_TLS_FAIL;
+                return -1;
+            }
+            tls->resumed = cfg->client_session != nullptr && cfg->client_session->broker == tls->broker;
+            if (tls->resumed) {
+                b.tlsResumedHandshakes++;
+                hostsim::stall(static_cast<uint64_t>(b.tlsResumedHandshakeMs) * 1000);
+            } else {
+                b.tlsFullHandshakes++;
+                hostsim::stall(static_cast<uint64_t>(b.tlsFullHandshakeMs) * 1000);
+            }
+            tls->state = ESP_TLS_DONE;
+            return 1;
+        case ESP_TLS_DONE:
+            return 1;
+        default:
+            return -1;
+    }
+}
+
+int esp_tls_conn_new_sync(const char* hostname, int hostlen, int port, const esp_tls_cfg_t* cfg, esp_tls_t* tls) {
+    int ret;
+    while ((ret = esp_tls_conn_new_async(hostname, hostlen, port, cfg, tls)) == 0) {
+        delay(1);
+    }
+    return ret;
+}
+
+esp_err_t esp_tls_get_conn_state(esp_tls_t* tls, esp_tls_conn_state_t* conn_state) {
+    if (tls == nullptr || conn_state == nullptr) return ESP_ERR_INVALID_ARG;
+    *conn_state = tls->state;
+    return ESP_OK;
+}
+
+ssize_t esp_tls_conn_write(esp_tls_t* tls, const void* data, size_t datalen) {
+    if (!isOpen(tls)) return -1;
+    tls->broker->receive(tls->handle, static_cast<const uint8_t*>(data), datalen);
+    return static_cast<ssize_t>(datalen);
+}
+
+ssize_t esp_tls_conn_read(esp_tls_t* tls, void* data, size_t datalen) {
+    if (!isOpen(tls)) return 0;
+    if (tls->broker->available(tls->handle) == 0) return ESP_TLS_ERR_SSL_WANT_READ;
+    return static_cast<ssize_t>(tls->broker->read(tls->handle, static_cast<uint8_t*>(data), datalen));
+}
+
+ssize_t esp_tls_get_bytes_avail(esp_tls_t* tls) {
+    return isOpen(tls) ? static_cast<ssize_t>(tls->broker->available(tls->handle)) : 0;
+}
+
+int esp_tls_conn_destroy(esp_tls_t* tls) {
+    if (tls == nullptr) return -1;
+    if (tls->broker != nullptr) tls->broker->close(tls->handle);
+    delete tls;
+    return 0;
+}
+
+esp_tls_client_session_t* esp_tls_get_client_session(esp_tls_t* tls) {
+    if (tls == nullptr || tls->state != ESP_TLS_DONE) return nullptr;
+    return new esp_tls_client_session{tls->broker};
+}
+
+void esp_tls_free_client_session(esp_tls_client_session_t* client_session) {
+    delete client_session;
+}
@@ -0,0 +1,139 @@
+#include "FS.h"
+#include "LittleFS.h"
+
+#include <cerrno>
+#include <filesystem>
+
+#include "HostSim.h"
+
+fs::LittleFSFS LittleFS;
+
+namespace fs {
+
+File::File(std::FILE* handle) : _handle(handle, [](std::FILE* f) { std::fclose(f); }) {}
+
+size_t File::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t* buf, size_t size) {
+    return _handle ? std::fwrite(buf, 1, size, _handle.get()) : 0;
+}
+
+int File::available() {
+    if (!_handle) return 0;
+    return static_cast<int>(size() - position());
+}
+
+int File::read() {
+    if (!_handle) return -1;
+    int c = std::fgetc(_handle.get());
+    return c == EOF ? -1 : c;
+}
+
+int File::peek() {
+    if (!_handle) return -1;
+    int c = std::fgetc(_handle.get());
+    if (c == EOF) return -1;
+    std::ungetc(c, _handle.get());
+    return c;
+}
+
+void File::flush() {
+    if (_handle) std::fflush(_handle.get());
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+    return _handle ? std::fread(buf, 1, size, _handle.get()) : 0;
+}
+
+bool File::seek(uint32_t pos) {
+    return _handle && std::fseek(_handle.get(), pos, SEEK_SET) == 0;
+}
+
+size_t File::position() const {
+    if (!_handle) return 0;
+    long pos = std::ftell(_handle.get());
+    return pos < 0 ? 0 : static_cast<size_t>(pos);
+}
+
+size_t File::size() const {
+    if (!_handle) return 0;
+    std::FILE* f = _handle.get();
+    long current = std::ftell(f);
+    std::fseek(f, 0, SEEK_END);
+    long end = std::ftell(f);
+    std::fseek(f, current, SEEK_SET);
+    return end < 0 ? 0 : static_cast<size_t>(end);
+}
+
+void File::close() {
+    _handle.reset();
+}
+
+std::string FS::hostPath(const char* path) const {
+    std::string root = hostsim::board().fsRoot;
+    if (path == nullptr) return root;
+    return root + (path[0] == '/' ? "" : "/") + path;
+}
+
+File FS::open(const char* path, const char* mode, bool) {
+    const std::string host = hostPath(path);
+    std::string stdioMode = mode;
+    if (stdioMode.find('b') == std::string::npos) stdioMode += 'b';
+    if (stdioMode[0] != 'r') {
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(host).parent_path(), ec);
+    }
+    std::FILE* f = std::fopen(host.c_str(), stdioMode.c_str());
+    return f ? File(f) : File();
+}
+
+bool FS::exists(const char* path) {
+    std::error_code ec;
+    return std::filesystem::exists(hostPath(path), ec);
+}
+
+bool FS::remove(const char* path) {
+    return std::remove(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char* pathFrom, const char* pathTo) {
+    return std::rename(hostPath(pathFrom).c_str(), hostPath(pathTo).c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+    std::error_code ec;
+    return std::filesystem::create_directories(hostPath(path), ec) || !ec;
+}
+
+// A missing root directory stands for a partition that does not mount: it is
+// only created ("formatted") when formatOnFail is set.
+bool LittleFSFS::begin(bool formatOnFail, const char*, uint8_t, const char*) {
+    std::error_code ec;
+    if (std::filesystem::is_directory(hostsim::board().fsRoot, ec)) return true;
+    if (!formatOnFail) return false;
+    std::filesystem::create_directories(hostsim::board().fsRoot, ec);
+    return !ec;
+}
+
+bool LittleFSFS::format() {
+    std::error_code ec;
+    std::filesystem::remove_all(hostsim::board().fsRoot, ec);
+    return begin(true);
+}
+
+size_t LittleFSFS::totalBytes() {
+    return 1441792;
+}
+
+size_t LittleFSFS::usedBytes() {
+    size_t used = 0;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(hostsim::board().fsRoot, ec)) {
+        if (entry.is_regular_file(ec)) used += entry.file_size(ec);
+    }
+    return used;
+}
+
+}
@@ -0,0 +1,59 @@
+#ifndef FS_h
+#define FS_h
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "Stream.h"
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+// Stand-in for the arduino-esp32 fs::File, backed by a host stdio FILE.
+class File : public Stream {
+  public:
+    File() = default;
+    explicit File(std::FILE* handle);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override;
+    size_t read(uint8_t* buf, size_t size);
+    bool seek(uint32_t pos);
+    size_t position() const;
+    size_t size() const;
+    void close();
+    operator bool() const { return _handle != nullptr; }
+
+    using Print::write;
+
+  private:
+    std::shared_ptr<std::FILE> _handle;
+};
+
+// Files live under a host directory, one per simulated board.
+class FS {
+  public:
+    File open(const char* path, const char* mode = FILE_READ, bool create = false);
+    bool exists(const char* path);
+    bool remove(const char* path);
+    bool rename(const char* pathFrom, const char* pathTo);
+    bool mkdir(const char* path);
+
+  protected:
+    std::string hostPath(const char* path) const;
+};
+
+}
+
+using fs::File;
+using fs::FS;
+
+#endif
@@ -0,0 +1,90 @@
+#include "freertos/task.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "Arduino.h"
+#include "HostSim.h"
+
+struct HostTask {
+    BaseType_t core = 1;
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t notifications = 0;
+};
+
+namespace {
+
+thread_local HostTask* t_task = nullptr;
+
+HostTask& currentTask() {
+    // Threads not created through xTaskCreatePinnedToCore (main, i.e. the
+    // Arduino loop task) get a handle on first use.
+    if (!t_task) t_task = new HostTask();
+    return *t_task;
+}
+
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char*, uint32_t, void* parameters,
+                                   UBaseType_t, TaskHandle_t* createdTask, BaseType_t coreId) {
+    HostTask* task = new HostTask();
+    task->core = coreId == tskNO_AFFINITY ? 0 : coreId;
+    hostsim::Board* board = &hostsim::board();
+    if (createdTask) *createdTask = task;
+    std::thread([code, parameters, task, board]() {
+        hostsim::setBoard(board);
+        t_task = task;
+        code(parameters);
+    }).detach();
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t) {}
+
+void vTaskDelay(TickType_t ticks) {
+    delay(ticks);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return &currentTask();
+}
+
+TickType_t xTaskGetTickCount() {
+    return static_cast<TickType_t>(millis());
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    if (!task) return pdFAIL;
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->notifications++;
+    }
+    task->cv.notify_one();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait) {
+    HostTask& task = currentTask();
+    std::unique_lock<std::mutex> lock(task.mutex);
+    if (task.notifications == 0 && ticksToWait > 0) {
+        if (hostsim::realtimeClock()) {
+            auto ready = [&task]() { return task.notifications > 0; };
+            if (ticksToWait == portMAX_DELAY) task.cv.wait(lock, ready);
+            else task.cv.wait_for(lock, std::chrono::milliseconds(ticksToWait), ready);
+        } else {
+            lock.unlock();
+            delay(ticksToWait == portMAX_DELAY ? 1000 : ticksToWait);
+            lock.lock();
+        }
+    }
+    uint32_t value = task.notifications;
+    if (value > 0) task.notifications = clearCountOnExit ? 0 : value - 1;
+    return value;
+}
+
+BaseType_t xPortGetCoreID() {
+    return currentTask().core;
+}
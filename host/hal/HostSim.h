@@ -0,0 +1,150 @@
+#ifndef HostSim_h
+#define HostSim_h
+
+// Controls for the simulated board behind the host HAL. Each Board carries the
+// per-device hardware state (ADC signals, servo outputs, WiFi link, UART); the
+// clock is global. The current board is thread-local so several simulated
+// devices can be stepped from one process.
+
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class SimBroker;
+
+namespace hostsim {
+
+enum class SerialSink { Stdout, Discard };
+
+struct ServoOutput {
+    bool attached = false;
+    int angle = -1;
+    unsigned long writes = 0;
+    uint64_t lastWriteUs = 0;
+    // PWM on time: closed attach/detach spans plus the open one.
+    uint64_t attachedSinceUs = 0;
+    uint64_t attachedUs = 0;
+
+    void setAttached(bool on, uint64_t nowUs);
+    uint64_t attachedMicros(uint64_t nowUs) const;
+};
+
+struct Board {
+    // ADC: explicit value, or a signal evaluated at the current millis().
+    std::map<int, int> analogValues;
+    std::map<int, std::function<int(unsigned long)>> analogSignals;
+    uint64_t analogReads = 0;
+    std::map<int, ServoOutput> servos;
+
+    // WiFi link.
+    bool apAvailable = true;
+    unsigned long joinDelayMs = 0;
+    bool joinRequested = false;
+    unsigned long joinStartedMs = 0;
+    bool linkUp = false;
+    bool linkReported = false;  // last link state announced through WiFi events
+    std::vector<std::function<void(int event, uint8_t reason)>> wifiEventHandlers;
+    uint32_t ipAddress = 0x0A00A8C0;  // 192.168.0.10
+    // Radio power: on from WiFi.begin() until WiFi is switched off or the
+    // board sleeps.
+    bool radioOn = false;
+    uint64_t radioOnSinceUs = 0;
+    uint64_t radioOnUs = 0;
+
+    // Host directory backing LittleFS.
+    std::string fsRoot = "littlefs";
+
+    // MQTT endpoint the WiFiClientSecure and esp-tls stand-ins connect to
+    // (nullptr: default broker).
+    SimBroker* broker = nullptr;
+
+    // Connection costs towards the endpoint. DNS and TCP are waits; TLS
+    // handshakes are CPU work and count as stall.
+    unsigned long dnsMs = 0;
+    unsigned long tcpConnectMs = 0;
+    unsigned long tlsFullHandshakeMs = 0;
+    unsigned long tlsResumedHandshakeMs = 0;
+    unsigned long tlsFullHandshakes = 0;
+    unsigned long tlsResumedHandshakes = 0;
+
+    // UART model: a TX FIFO drained at the configured baud rate.
+    SerialSink serialSink = SerialSink::Stdout;
+    unsigned long serialBaud = 115200;
+    unsigned int serialFifoBytes = 128;
+    uint64_t serialBusyUntilUs = 0;
+    uint64_t serialBytes = 0;
+    std::recursive_mutex serialMutex;  // the UART is shared by all tasks of a board
+
+    // Time the simulated firmware spent blocked (UART back-pressure etc.).
+    uint64_t stallUs = 0;
+    // Time spent inside delay(); virtual, so not part of stallUs.
+    uint64_t delayedUs = 0;
+
+    // Deep sleep: armed timer wakeup, cause reported after the last wake,
+    // and totals.
+    uint64_t sleepTimerUs = 0;
+    int wakeupCause = 0;
+    unsigned long deepSleeps = 0;
+    uint64_t deepSleepUs = 0;
+
+    // Simulation events keyed by virtual time (us), see scheduleEvent().
+    std::multimap<uint64_t, std::function<void()>> timedEvents;
+};
+
+Board& board();
+void setBoard(Board* board);
+
+// Clock. Virtual by default: delay() advances time instantly so benchmarks
+// measure only CPU work plus modelled stalls. Real-time mode uses the host
+// steady clock and sleeps, which threaded runs need.
+void useRealtimeClock(bool realtime);
+bool realtimeClock();
+uint64_t nowMicros();
+void advanceMicros(uint64_t us);
+void stall(uint64_t us);
+
+// Runs fn on the current board's thread once the virtual clock reaches atUs,
+// e.g. in the middle of a delay(), so inputs can arrive while the firmware
+// sleeps. Virtual clock only.
+void scheduleEvent(uint64_t atUs, std::function<void()> fn);
+
+void setAnalogValue(int pin, int value);
+void setAnalogSignal(int pin, std::function<int(unsigned long)> signal);
+
+void setWiFiAvailable(bool available);
+void dropWiFi();
+// Radio-on time so far, including the current stretch.
+uint64_t radioOnMicros();
+
+void setRandomSeed(uint32_t seed);
+
+// Marks work done by the simulation rather than the firmware (broker,
+// emulated cloud, bench events), per thread. soak_bench leaves heap use
+// inside such a scope out of its counts.
+class SimulationScope {
+  public:
+    SimulationScope();
+    ~SimulationScope();
+    SimulationScope(const SimulationScope&) = delete;
+    SimulationScope& operator=(const SimulationScope&) = delete;
+};
+bool inSimulation();
+
+struct RestartRequested : std::exception {
+    const char* what() const noexcept override { return "ESP.restart() called"; }
+};
+
+// Thrown by esp_deep_sleep_start() once the sleep time has passed.
+struct DeepSleepRequested : std::exception {
+    explicit DeepSleepRequested(uint64_t us) : sleptUs(us) {}
+    const char* what() const noexcept override { return "esp_deep_sleep_start() called"; }
+    uint64_t sleptUs;
+};
+
+}
+
+#endif
@@ -0,0 +1,35 @@
+#include "IPAddress.h"
+
+#include <cstdio>
+
+IPAddress::IPAddress(uint32_t address)
+  : _address{static_cast<uint8_t>(address), static_cast<uint8_t>(address >> 8),
+             static_cast<uint8_t>(address >> 16), static_cast<uint8_t>(address >> 24)} {}
+
+IPAddress::operator uint32_t() const {
+    return static_cast<uint32_t>(_address[0]) | (static_cast<uint32_t>(_address[1]) << 8) |
+           (static_cast<uint32_t>(_address[2]) << 16) | (static_cast<uint32_t>(_address[3]) << 24);
+}
+
+bool IPAddress::operator==(const IPAddress& other) const {
+    return static_cast<uint32_t>(*this) == static_cast<uint32_t>(other);
+}
+
+bool IPAddress::fromString(const char* address) {
+    unsigned int a, b, c, d;
+    char tail;
+    if (std::sscanf(address, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4) return false;
+    if (a > 255 || b > 255 || c > 255 || d > 255) return false;
+    _address[0] = a; _address[1] = b; _address[2] = c; _address[3] = d;
+    return true;
+}
+
+String IPAddress::toString() const {
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _address[0], _address[1], _address[2], _address[3]);
+    return String(buf);
+}
+
+size_t IPAddress::printTo(Print& p) const {
+    return p.print(toString());
+}
@@ -0,0 +1,25 @@
+#ifndef IPAddress_h
+#define IPAddress_h
+
+#include <cstdint>
+#include "Print.h"
+
+class IPAddress : public Printable {
+  public:
+    IPAddress() : _address{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _address{a, b, c, d} {}
+    explicit IPAddress(uint32_t address);
+
+    uint8_t operator[](int index) const { return _address[index]; }
+    operator uint32_t() const;
+    bool operator==(const IPAddress& other) const;
+    bool fromString(const char* address);
+    String toString() const;
+
+    size_t printTo(Print& p) const override;
+
+  private:
+    uint8_t _address[4];
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef LittleFS_h
+#define LittleFS_h
+
+#include "FS.h"
+
+namespace fs {
+
+class LittleFSFS : public FS {
+  public:
+    bool begin(bool formatOnFail = false, const char* basePath = "/littlefs", uint8_t maxOpenFiles = 10,
+               const char* partitionLabel = "spiffs");
+    bool format();
+    void end() {}
+    size_t totalBytes();
+    size_t usedBytes();
+};
+
+}
+
+extern fs::LittleFSFS LittleFS;
+
+#endif
@@ -0,0 +1,65 @@
+#include "Print.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+        if (write(*buffer++)) n++;
+        else break;
+    }
+    return n;
+}
+
+size_t Print::write(const char* str) {
+    if (str == nullptr) return 0;
+    return write(reinterpret_cast<const uint8_t*>(str), std::strlen(str));
+}
+
+size_t Print::printf(const char* format, ...) {
+    char stackBuf[128];
+    va_list args;
+    va_start(args, format);
+    int len = std::vsnprintf(stackBuf, sizeof(stackBuf), format, args);
+    va_end(args);
+    if (len < 0) return 0;
+    if (static_cast<size_t>(len) < sizeof(stackBuf)) {
+        return write(stackBuf, len);
+    }
+    char* heapBuf = new char[len + 1];
+    va_start(args, format);
+    std::vsnprintf(heapBuf, len + 1, format, args);
+    va_end(args);
+    size_t n = write(heapBuf, len);
+    delete[] heapBuf;
+    return n;
+}
+
+size_t Print::print(const String& s) { return write(s.c_str(), s.length()); }
+size_t Print::print(const char* s) { return write(s); }
+size_t Print::print(char c) { return write(static_cast<uint8_t>(c)); }
+size_t Print::print(unsigned char value, int base) { return print(String(value, static_cast<unsigned char>(base))); }
+size_t Print::print(int value, int base) { return print(String(value, static_cast<unsigned char>(base))); }
+size_t Print::print(unsigned int value, int base) { return print(String(value, static_cast<unsigned char>(base))); }
+size_t Print::print(long value, int base) { return print(String(value, static_cast<unsigned char>(base))); }
+size_t Print::print(unsigned long value, int base) { return print(String(value, static_cast<unsigned char>(base))); }
+size_t Print::print(long long value, int base) { return print(static_cast<long>(value), base); }
+size_t Print::print(unsigned long long value, int base) { return print(static_cast<unsigned long>(value), base); }
+size_t Print::print(double value, int digits) { return print(String(value, static_cast<unsigned int>(digits))); }
+size_t Print::print(const Printable& p) { return p.printTo(*this); }
+
+size_t Print::println() { return write("\r\n"); }
+size_t Print::println(const String& s) { return print(s) + println(); }
+size_t Print::println(const char* s) { return print(s) + println(); }
+size_t Print::println(char c) { return print(c) + println(); }
+size_t Print::println(unsigned char value, int base) { return print(value, base) + println(); }
+size_t Print::println(int value, int base) { return print(value, base) + println(); }
+size_t Print::println(unsigned int value, int base) { return print(value, base) + println(); }
+size_t Print::println(long value, int base) { return print(value, base) + println(); }
+size_t Print::println(unsigned long value, int base) { return print(value, base) + println(); }
+size_t Print::println(long long value, int base) { return print(value, base) + println(); }
+size_t Print::println(unsigned long long value, int base) { return print(value, base) + println(); }
+size_t Print::println(double value, int digits) { return print(value, digits) + println(); }
+size_t Print::println(const Printable& p) { return print(p) + println(); }
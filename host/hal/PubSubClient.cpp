@@ -0,0 +1,400 @@
+#include "PubSubClient.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include "Arduino.h"
+
+namespace {
+const uint16_t MQTT_MAX_HEADER_SIZE = 5;
+}
+
+PubSubClient::PubSubClient() {
+    setBufferSize(MQTT_MAX_PACKET_SIZE);
+}
+
+PubSubClient::PubSubClient(Client& client) : PubSubClient() {
+    setClient(client);
+}
+
+PubSubClient::~PubSubClient() {
+    std::free(_buffer);
+}
+
+PubSubClient& PubSubClient::setServer(IPAddress ip, uint16_t port) {
+    _ip = ip;
+    _port = port;
+    _domain = nullptr;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setServer(const char* domain, uint16_t port) {
+    _domain = domain;
+    _port = port;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setCallback(MQTT_CALLBACK_SIGNATURE) {
+    _callback = callback;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setClient(Client& client) {
+    _client = &client;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setKeepAlive(uint16_t keepAlive) {
+    _keepAlive = keepAlive;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setSocketTimeout(uint16_t timeout) {
+    _socketTimeout = timeout;
+    return *this;
+}
+
+bool PubSubClient::setBufferSize(uint16_t size) {
+    if (size == 0) return false;
+    uint8_t* resized = static_cast<uint8_t*>(std::realloc(_buffer, size));
+    if (resized == nullptr) return false;
+    _buffer = resized;
+    _bufferSize = size;
+    return true;
+}
+
+bool PubSubClient::connect(const char* id) {
+    return connect(id, nullptr, nullptr);
+}
+
+bool PubSubClient::connect(const char* id, const char* user, const char* pass) {
+    if (connected()) return true;
+    if (_client == nullptr) return false;
+
+    int result = _client->connected() ? 1
+               : (_domain != nullptr ? _client->connect(_domain, _port) : _client->connect(_ip, _port));
+    if (result != 1) {
+        _state = MQTT_CONNECT_FAILED;
+        return false;
+    }
+
+    _nextMsgId = 1;
+    uint16_t length = MQTT_MAX_HEADER_SIZE;
+    const uint8_t protocol[7] = {0x00, 0x04, 'M', 'Q', 'T', 'T', MQTT_VERSION_3_1_1};
+    std::memcpy(_buffer + length, protocol, sizeof(protocol));
+    length += sizeof(protocol);
+
+    uint8_t flags = 0x02;  // clean session
+    if (user != nullptr) {
+        flags |= 0x80;
+        if (pass != nullptr) flags |= 0x40;
+    }
+    _buffer[length++] = flags;
+    _buffer[length++] = static_cast<uint8_t>(_keepAlive >> 8);
+    _buffer[length++] = static_cast<uint8_t>(_keepAlive & 0xFF);
+
+    length = writeString(id, _buffer, length);
+    if (user != nullptr) {
+        length = writeString(user, _buffer, length);
+        if (pass != nullptr) length = writeString(pass, _buffer, length);
+    }
+    if (!write(MQTTCONNECT, _buffer, length - MQTT_MAX_HEADER_SIZE)) {
+        _state = MQTT_CONNECT_FAILED;
+        return false;
+    }
+
+    _lastInActivity = _lastOutActivity = millis();
+    while (!_client->available()) {
+        if (millis() - _lastInActivity >= static_cast<unsigned long>(_socketTimeout) * 1000UL) {
+            _state = MQTT_CONNECTION_TIMEOUT;
+            _client->stop();
+            return false;
+        }
+        delay(1);
+    }
+
+    uint8_t llen;
+    uint32_t len = readPacket(&llen);
+    if (len == 4) {
+        if (_buffer[3] == 0) {
+            _lastInActivity = millis();
+            _pingOutstanding = false;
+            _state = MQTT_CONNECTED;
+            return true;
+        }
+        _state = _buffer[3];
+    }
+    _client->stop();
+    return false;
+}
+
+void PubSubClient::disconnect() {
+    _buffer[0] = MQTTDISCONNECT;
+    _buffer[1] = 0;
+    if (_client != nullptr) {
+        _client->write(_buffer, 2);
+        _client->flush();
+        _client->stop();
+    }
+    _state = MQTT_DISCONNECTED;
+    _lastInActivity = _lastOutActivity = millis();
+}
+
+bool PubSubClient::publish(const char* topic, const char* payload) {
+    return publish(topic, reinterpret_cast<const uint8_t*>(payload), payload ? std::strlen(payload) : 0, false);
+}
+
+bool PubSubClient::publish(const char* topic, const char* payload, bool retained) {
+    return publish(topic, reinterpret_cast<const uint8_t*>(payload), payload ? std::strlen(payload) : 0, retained);
+}
+
+bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int plength) {
+    return publish(topic, payload, plength, false);
+}
+
+bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int plength, bool retained) {
+    if (!connected()) return false;
+    if (_bufferSize < MQTT_MAX_HEADER_SIZE + 2 + std::strlen(topic) + plength) {
+        // Too long for the packet buffer.
+        return false;
+    }
+    uint16_t length = writeString(topic, _buffer, MQTT_MAX_HEADER_SIZE);
+    for (unsigned int i = 0; i < plength; i++) {
+        _buffer[length++] = payload[i];
+    }
+    uint8_t header = MQTTPUBLISH;
+    if (retained) header |= 1;
+    return write(header, _buffer, length - MQTT_MAX_HEADER_SIZE);
+}
+
+bool PubSubClient::beginPublish(const char* topic, unsigned int plength, bool retained) {
+    if (!connected()) return false;
+    uint16_t length = writeString(topic, _buffer, MQTT_MAX_HEADER_SIZE);
+    uint8_t header = MQTTPUBLISH;
+    if (retained) header |= 1;
+    const size_t hlen = buildHeader(header, _buffer, static_cast<uint16_t>(plength + length - MQTT_MAX_HEADER_SIZE));
+    const size_t rc = _client->write(_buffer + (MQTT_MAX_HEADER_SIZE - hlen), length - (MQTT_MAX_HEADER_SIZE - hlen));
+    _lastOutActivity = millis();
+    return rc == static_cast<size_t>(length - (MQTT_MAX_HEADER_SIZE - hlen));
+}
+
+int PubSubClient::endPublish() {
+    return 1;
+}
+
+size_t PubSubClient::write(uint8_t c) {
+    _lastOutActivity = millis();
+    return _client->write(c);
+}
+
+size_t PubSubClient::write(const uint8_t* buffer, size_t size) {
+    _lastOutActivity = millis();
+    return _client->write(buffer, size);
+}
+
+bool PubSubClient::subscribe(const char* topic) {
+    return subscribe(topic, 0);
+}
+
+bool PubSubClient::subscribe(const char* topic, uint8_t qos) {
+    if (topic == nullptr || qos > 1) return false;
+    if (_bufferSize < 9 + std::strlen(topic)) return false;
+    if (!connected()) return false;
+    uint16_t length = MQTT_MAX_HEADER_SIZE;
+    const uint16_t msgId = nextMsgId();
+    _buffer[length++] = static_cast<uint8_t>(msgId >> 8);
+    _buffer[length++] = static_cast<uint8_t>(msgId & 0xFF);
+    length = writeString(topic, _buffer, length);
+    _buffer[length++] = qos;
+    return write(MQTTSUBSCRIBE | MQTTQOS1, _buffer, length - MQTT_MAX_HEADER_SIZE);
+}
+
+bool PubSubClient::unsubscribe(const char* topic) {
+    const size_t topicLength = std::strlen(topic);
+    if (_bufferSize < 9 + topicLength) return false;
+    if (!connected()) return false;
+    uint16_t length = MQTT_MAX_HEADER_SIZE;
+    const uint16_t msgId = nextMsgId();
+    _buffer[length++] = static_cast<uint8_t>(msgId >> 8);
+    _buffer[length++] = static_cast<uint8_t>(msgId & 0xFF);
+    length = writeString(topic, _buffer, length);
+    return write(MQTTUNSUBSCRIBE | MQTTQOS1, _buffer, length - MQTT_MAX_HEADER_SIZE);
+}
+
+bool PubSubClient::loop() {
+    if (!connected()) return false;
+
+    const unsigned long t = millis();
+    const unsigned long keepAliveMs = static_cast<unsigned long>(_keepAlive) * 1000UL;
+    if (_keepAlive != 0 && (t - _lastInActivity > keepAliveMs || t - _lastOutActivity > keepAliveMs)) {
+        if (_pingOutstanding) {
+            _state = MQTT_CONNECTION_TIMEOUT;
+            _client->stop();
+            return false;
+        }
+        _buffer[0] = MQTTPINGREQ;
+        _buffer[1] = 0;
+        _client->write(_buffer, 2);
+        _lastOutActivity = t;
+        _lastInActivity = t;
+        _pingOutstanding = true;
+    }
+
+    if (_client->available()) {
+        uint8_t llen;
+        const uint32_t len = readPacket(&llen);
+        if (len > 0) {
+            _lastInActivity = t;
+            const uint8_t type = _buffer[0] & 0xF0;
+            if (type == MQTTPUBLISH) {
+                if (_callback) {
+                    const uint16_t tl = static_cast<uint16_t>((_buffer[llen + 1] << 8) + _buffer[llen + 2]);
+                    std::memmove(_buffer + llen + 2, _buffer + llen + 3, tl);
+                    _buffer[llen + 2 + tl] = 0;
+                    char* topic = reinterpret_cast<char*>(_buffer) + llen + 2;
+                    if ((_buffer[0] & 0x06) == MQTTQOS1) {
+                        const uint16_t msgId = static_cast<uint16_t>((_buffer[llen + 3 + tl] << 8) + _buffer[llen + 3 + tl + 1]);
+                        uint8_t* payload = _buffer + llen + 3 + tl + 2;
+                        _callback(topic, payload, len - llen - 3 - tl - 2);
+                        _buffer[0] = MQTTPUBACK;
+                        _buffer[1] = 2;
+                        _buffer[2] = static_cast<uint8_t>(msgId >> 8);
+                        _buffer[3] = static_cast<uint8_t>(msgId & 0xFF);
+                        _client->write(_buffer, 4);
+                        _lastOutActivity = t;
+                    } else {
+                        uint8_t* payload = _buffer + llen + 3 + tl;
+                        _callback(topic, payload, len - llen - 3 - tl);
+                    }
+                }
+            } else if (type == MQTTPINGREQ) {
+                _buffer[0] = MQTTPINGRESP;
+                _buffer[1] = 0;
+                _client->write(_buffer, 2);
+            } else if (type == MQTTPINGRESP) {
+                _pingOutstanding = false;
+            }
+        } else if (!connected()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PubSubClient::connected() {
+    if (_client == nullptr) return false;
+    const bool rc = _client->connected();
+    if (!rc) {
+        if (_state == MQTT_CONNECTED) {
+            _state = MQTT_CONNECTION_LOST;
+            _client->flush();
+            _client->stop();
+        }
+    } else {
+        return _state == MQTT_CONNECTED;
+    }
+    return rc;
+}
+
+bool PubSubClient::readByte(uint8_t* result) {
+    const unsigned long previous = millis();
+    while (!_client->available()) {
+        if (millis() - previous >= static_cast<unsigned long>(_socketTimeout) * 1000UL) return false;
+        delay(1);
+    }
+    *result = static_cast<uint8_t>(_client->read());
+    return true;
+}
+
+uint32_t PubSubClient::readPacket(uint8_t* lengthLength) {
+    uint16_t len = 0;
+    if (!readByte(_buffer + len)) return 0;
+    len++;
+    const bool isPublish = (_buffer[0] & 0xF0) == MQTTPUBLISH;
+    uint32_t multiplier = 1;
+    uint32_t length = 0;
+    uint8_t digit = 0;
+    uint32_t start = 0;
+
+    do {
+        if (len == 5) {
+            // Invalid remaining length encoding - kill the connection.
+            _state = MQTT_DISCONNECTED;
+            _client->stop();
+            return 0;
+        }
+        if (!readByte(&digit)) return 0;
+        _buffer[len++] = digit;
+        length += (digit & 127) * multiplier;
+        multiplier <<= 7;
+    } while ((digit & 128) != 0);
+    *lengthLength = static_cast<uint8_t>(len - 1);
+
+    if (isPublish) {
+        // Read in the topic length so the topic can be moved into place later.
+        if (!readByte(_buffer + len)) return 0;
+        len++;
+        if (!readByte(_buffer + len)) return 0;
+        len++;
+        start = 2;
+    }
+
+    uint32_t idx = len;
+    for (uint32_t i = start; i < length; i++) {
+        if (!readByte(&digit)) return 0;
+        if (len < _bufferSize) {
+            _buffer[len] = digit;
+            len++;
+        }
+        idx++;
+    }
+
+    if (idx > _bufferSize) {
+        // Packet was larger than the buffer: it is dropped.
+        len = 0;
+    }
+    return len;
+}
+
+bool PubSubClient::write(uint8_t header, uint8_t* buf, uint16_t length) {
+    const size_t hlen = buildHeader(header, buf, length);
+    const size_t rc = _client->write(buf + (MQTT_MAX_HEADER_SIZE - hlen), length + hlen);
+    _lastOutActivity = millis();
+    return rc == hlen + length;
+}
+
+size_t PubSubClient::buildHeader(uint8_t header, uint8_t* buf, uint16_t length) {
+    uint8_t lenBuf[4];
+    uint8_t llen = 0;
+    uint16_t len = length;
+    do {
+        uint8_t digit = len & 127;
+        len >>= 7;
+        if (len > 0) digit |= 0x80;
+        lenBuf[llen++] = digit;
+    } while (len > 0);
+
+    buf[4 - llen] = header;
+    for (int i = 0; i < llen; i++) {
+        buf[MQTT_MAX_HEADER_SIZE - llen + i] = lenBuf[i];
+    }
+    return llen + 1;
+}
+
+uint16_t PubSubClient::writeString(const char* string, uint8_t* buf, uint16_t pos) {
+    const uint16_t start = pos;
+    pos += 2;
+    for (const char* idp = string; *idp != '\0' && pos < _bufferSize; idp++) {
+        buf[pos++] = static_cast<uint8_t>(*idp);
+    }
+    const uint16_t i = pos - start - 2;
+    buf[start] = static_cast<uint8_t>(i >> 8);
+    buf[start + 1] = static_cast<uint8_t>(i & 0xFF);
+    return pos;
+}
+
+uint16_t PubSubClient::nextMsgId() {
+    _nextMsgId++;
+    if (_nextMsgId == 0) _nextMsgId = 1;
+    return _nextMsgId;
+}
@@ -0,0 +1,108 @@
+#ifndef PubSubClient_h
+#define PubSubClient_h
+
+// Host stand-in for knolleary/PubSubClient 2.8: same public API and the same
+// MQTT 3.1.1 wire behaviour (QoS 0 publish, whole packet in one buffer,
+// oversize packets dropped), running over any Arduino Client.
+
+#include <functional>
+
+#include "Client.h"
+#include "IPAddress.h"
+
+#define MQTT_VERSION_3_1_1 4
+#define MQTT_MAX_PACKET_SIZE 256
+#define MQTT_KEEPALIVE 15
+#define MQTT_SOCKET_TIMEOUT 15
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+#define MQTT_CONNECT_BAD_PROTOCOL 1
+#define MQTT_CONNECT_BAD_CLIENT_ID 2
+#define MQTT_CONNECT_UNAVAILABLE 3
+#define MQTT_CONNECT_BAD_CREDENTIALS 4
+#define MQTT_CONNECT_UNAUTHORIZED 5
+
+#define MQTTCONNECT 1 << 4
+#define MQTTCONNACK 2 << 4
+#define MQTTPUBLISH 3 << 4
+#define MQTTPUBACK 4 << 4
+#define MQTTSUBSCRIBE 8 << 4
+#define MQTTSUBACK 9 << 4
+#define MQTTUNSUBSCRIBE 10 << 4
+#define MQTTUNSUBACK 11 << 4
+#define MQTTPINGREQ 12 << 4
+#define MQTTPINGRESP 13 << 4
+#define MQTTDISCONNECT 14 << 4
+
+#define MQTTQOS0 (0 << 1)
+#define MQTTQOS1 (1 << 1)
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
+
+class PubSubClient : public Print {
+  public:
+    PubSubClient();
+    explicit PubSubClient(Client& client);
+    ~PubSubClient() override;
+
+    PubSubClient& setServer(IPAddress ip, uint16_t port);
+    PubSubClient& setServer(const char* domain, uint16_t port);
+    PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE);
+    PubSubClient& setClient(Client& client);
+    PubSubClient& setKeepAlive(uint16_t keepAlive);
+    PubSubClient& setSocketTimeout(uint16_t timeout);
+
+    bool setBufferSize(uint16_t size);
+    uint16_t getBufferSize() const { return _bufferSize; }
+
+    bool connect(const char* id);
+    bool connect(const char* id, const char* user, const char* pass);
+    void disconnect();
+
+    bool publish(const char* topic, const char* payload);
+    bool publish(const char* topic, const char* payload, bool retained);
+    bool publish(const char* topic, const uint8_t* payload, unsigned int plength);
+    bool publish(const char* topic, const uint8_t* payload, unsigned int plength, bool retained);
+
+    bool beginPublish(const char* topic, unsigned int plength, bool retained);
+    int endPublish();
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+
+    bool subscribe(const char* topic);
+    bool subscribe(const char* topic, uint8_t qos);
+    bool unsubscribe(const char* topic);
+
+    bool loop();
+    bool connected();
+    int state() const { return _state; }
+
+  private:
+    Client* _client = nullptr;
+    uint8_t* _buffer = nullptr;
+    uint16_t _bufferSize = 0;
+    uint16_t _keepAlive = MQTT_KEEPALIVE;
+    uint16_t _socketTimeout = MQTT_SOCKET_TIMEOUT;
+    uint16_t _nextMsgId = 0;
+    unsigned long _lastOutActivity = 0;
+    unsigned long _lastInActivity = 0;
+    bool _pingOutstanding = false;
+    std::function<void(char*, uint8_t*, unsigned int)> _callback;
+    IPAddress _ip;
+    const char* _domain = nullptr;
+    uint16_t _port = 0;
+    int _state = MQTT_DISCONNECTED;
+
+    uint32_t readPacket(uint8_t* lengthLength);
+    bool readByte(uint8_t* result);
+    bool write(uint8_t header, uint8_t* buf, uint16_t length);
+    uint16_t writeString(const char* string, uint8_t* buf, uint16_t pos);
+    size_t buildHeader(uint8_t header, uint8_t* buf, uint16_t length);
+    uint16_t nextMsgId();
+};
+
+#endif
@@ -0,0 +1,18 @@
+#include "Stream.h"
+
+#include "Arduino.h"
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    unsigned long start = millis();
+    while (count < length) {
+        int c = read();
+        if (c < 0) {
+            if (millis() - start >= _timeout) break;
+            delay(1);
+            continue;
+        }
+        buffer[count++] = static_cast<char>(c);
+    }
+    return count;
+}
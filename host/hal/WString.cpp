@@ -0,0 +1,128 @@
+#include "WString.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+std::string formatInteger(unsigned long long magnitude, bool negative, unsigned char base) {
+    if (base < 2 || base > 36) base = 10;
+    char digits[72];
+    int pos = 0;
+    do {
+        unsigned int d = static_cast<unsigned int>(magnitude % base);
+        digits[pos++] = static_cast<char>(d < 10 ? '0' + d : 'a' + d - 10);
+        magnitude /= base;
+    } while (magnitude != 0);
+    std::string out;
+    out.reserve(pos + 1);
+    if (negative) out.push_back('-');
+    while (pos > 0) out.push_back(digits[--pos]);
+    return out;
+}
+
+std::string formatSigned(long long value, unsigned char base) {
+    if (base == 10 && value < 0) {
+        return formatInteger(0ULL - static_cast<unsigned long long>(value), true, base);
+    }
+    return formatInteger(static_cast<unsigned long long>(value), false, base);
+}
+
+std::string formatFloat(double value, unsigned int decimalPlaces) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%.*f", static_cast<int>(decimalPlaces), value);
+    return buf;
+}
+
+}
+
+String::String(const char* cstr) : _buffer(cstr ? cstr : "") {}
+String::String(const char* cstr, unsigned int length) : _buffer(cstr ? std::string(cstr, length) : std::string()) {}
+String::String(char c) : _buffer(1, c) {}
+String::String(unsigned char value, unsigned char base) : _buffer(formatInteger(value, false, base)) {}
+String::String(int value, unsigned char base) : _buffer(formatSigned(value, base)) {}
+String::String(unsigned int value, unsigned char base) : _buffer(formatInteger(value, false, base)) {}
+String::String(long value, unsigned char base) : _buffer(formatSigned(value, base)) {}
+String::String(unsigned long value, unsigned char base) : _buffer(formatInteger(value, false, base)) {}
+String::String(float value, unsigned int decimalPlaces) : _buffer(formatFloat(value, decimalPlaces)) {}
+String::String(double value, unsigned int decimalPlaces) : _buffer(formatFloat(value, decimalPlaces)) {}
+
+String& String::operator=(const char* cstr) {
+    _buffer = cstr ? cstr : "";
+    return *this;
+}
+
+bool String::reserve(unsigned int size) {
+    _buffer.reserve(size);
+    return true;
+}
+
+bool String::concat(const String& str) { _buffer += str._buffer; return true; }
+bool String::concat(const char* cstr) { if (!cstr) return false; _buffer += cstr; return true; }
+bool String::concat(const char* cstr, unsigned int length) { if (!cstr) return false; _buffer.append(cstr, length); return true; }
+bool String::concat(char c) { _buffer.push_back(c); return true; }
+bool String::concat(unsigned char value) { _buffer += formatInteger(value, false, 10); return true; }
+bool String::concat(int value) { _buffer += formatSigned(value, 10); return true; }
+bool String::concat(unsigned int value) { _buffer += formatInteger(value, false, 10); return true; }
+bool String::concat(long value) { _buffer += formatSigned(value, 10); return true; }
+bool String::concat(unsigned long value) { _buffer += formatInteger(value, false, 10); return true; }
+bool String::concat(double value) { _buffer += formatFloat(value, 2); return true; }
+
+bool String::startsWith(const String& prefix) const {
+    return _buffer.compare(0, prefix._buffer.size(), prefix._buffer) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+    if (suffix._buffer.size() > _buffer.size()) return false;
+    return _buffer.compare(_buffer.size() - suffix._buffer.size(), suffix._buffer.size(), suffix._buffer) == 0;
+}
+
+int String::indexOf(char c, unsigned int fromIndex) const {
+    size_t pos = _buffer.find(c, fromIndex);
+    return pos == std::string::npos ? -1 : static_cast<int>(pos);
+}
+
+int String::indexOf(const String& str, unsigned int fromIndex) const {
+    size_t pos = _buffer.find(str._buffer, fromIndex);
+    return pos == std::string::npos ? -1 : static_cast<int>(pos);
+}
+
+String String::substring(unsigned int beginIndex) const {
+    return substring(beginIndex, length());
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+    if (beginIndex > endIndex) {
+        unsigned int tmp = beginIndex;
+        beginIndex = endIndex;
+        endIndex = tmp;
+    }
+    if (beginIndex >= length()) return String();
+    if (endIndex > length()) endIndex = length();
+    return String(_buffer.c_str() + beginIndex, endIndex - beginIndex);
+}
+
+char String::charAt(unsigned int index) const {
+    return index < _buffer.size() ? _buffer[index] : '\0';
+}
+
+long String::toInt() const { return std::strtol(_buffer.c_str(), nullptr, 10); }
+float String::toFloat() const { return std::strtof(_buffer.c_str(), nullptr); }
+
+void String::trim() {
+    size_t begin = 0;
+    while (begin < _buffer.size() && std::isspace(static_cast<unsigned char>(_buffer[begin]))) begin++;
+    size_t end = _buffer.size();
+    while (end > begin && std::isspace(static_cast<unsigned char>(_buffer[end - 1]))) end--;
+    _buffer = _buffer.substr(begin, end - begin);
+}
+
+String operator+(const String& lhs, const String& rhs) { String out(lhs); out.concat(rhs); return out; }
+String operator+(const String& lhs, const char* rhs) { String out(lhs); out.concat(rhs); return out; }
+String operator+(const String& lhs, char rhs) { String out(lhs); out.concat(rhs); return out; }
+String operator+(const String& lhs, int rhs) { String out(lhs); out.concat(rhs); return out; }
+String operator+(const String& lhs, unsigned int rhs) { String out(lhs); out.concat(rhs); return out; }
+String operator+(const String& lhs, long rhs) { String out(lhs); out.concat(rhs); return out; }
+String operator+(const String& lhs, unsigned long rhs) { String out(lhs); out.concat(rhs); return out; }
+String operator+(const char* lhs, const String& rhs) { String out(lhs); out.concat(rhs); return out; }
@@ -0,0 +1,90 @@
+#ifndef WString_h
+#define WString_h
+
+#include <cstddef>
+#include <string>
+
+// Stand-in for the Arduino core String, backed by std::string.
+class String {
+  public:
+    String(const char* cstr = "");
+    String(const char* cstr, unsigned int length);
+    String(const String& other) = default;
+    String(String&& other) noexcept = default;
+    explicit String(char c);
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimalPlaces = 2);
+    explicit String(double value, unsigned int decimalPlaces = 2);
+
+    String& operator=(const String& rhs) = default;
+    String& operator=(String&& rhs) noexcept = default;
+    String& operator=(const char* cstr);
+
+    bool reserve(unsigned int size);
+    unsigned int length() const { return static_cast<unsigned int>(_buffer.size()); }
+    bool isEmpty() const { return _buffer.empty(); }
+    const char* c_str() const { return _buffer.c_str(); }
+
+    bool concat(const String& str);
+    bool concat(const char* cstr);
+    bool concat(const char* cstr, unsigned int length);
+    bool concat(char c);
+    bool concat(unsigned char value);
+    bool concat(int value);
+    bool concat(unsigned int value);
+    bool concat(long value);
+    bool concat(unsigned long value);
+    bool concat(double value);
+
+    template <typename T>
+    String& operator+=(const T& rhs) {
+        concat(rhs);
+        return *this;
+    }
+
+    int compareTo(const String& other) const { return _buffer.compare(other._buffer); }
+    bool equals(const String& other) const { return _buffer == other._buffer; }
+    bool equals(const char* cstr) const { return _buffer == (cstr ? cstr : ""); }
+    bool operator==(const String& rhs) const { return equals(rhs); }
+    bool operator==(const char* cstr) const { return equals(cstr); }
+    bool operator!=(const String& rhs) const { return !equals(rhs); }
+    bool operator!=(const char* cstr) const { return !equals(cstr); }
+    bool operator<(const String& rhs) const { return _buffer < rhs._buffer; }
+
+    bool startsWith(const String& prefix) const;
+    bool endsWith(const String& suffix) const;
+    int indexOf(char c, unsigned int fromIndex = 0) const;
+    int indexOf(const String& str, unsigned int fromIndex = 0) const;
+    String substring(unsigned int beginIndex) const;
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+    char charAt(unsigned int index) const;
+    char operator[](unsigned int index) const { return charAt(index); }
+    long toInt() const;
+    float toFloat() const;
+    void trim();
+
+  private:
+    std::string _buffer;
+};
+
+// Arduino's temporary type for chained concatenation; libraries test for it.
+class StringSumHelper : public String {
+  public:
+    using String::String;
+    StringSumHelper(const String& s) : String(s) {}
+};
+
+String operator+(const String& lhs, const String& rhs);
+String operator+(const String& lhs, const char* rhs);
+String operator+(const String& lhs, char rhs);
+String operator+(const String& lhs, int rhs);
+String operator+(const String& lhs, unsigned int rhs);
+String operator+(const String& lhs, long rhs);
+String operator+(const String& lhs, unsigned long rhs);
+String operator+(const char* lhs, const String& rhs);
+
+#endif
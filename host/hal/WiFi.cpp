@@ -0,0 +1,119 @@
+#include "WiFi.h"
+
+#include "HostSim.h"
+
+WiFiClass WiFi;
+
+namespace {
+
+// Reason codes from wifi_err_reason_t.
+const uint8_t kReasonBeaconTimeout = 200;
+const uint8_t kReasonAssocLeave = 8;
+
+void setRadio(hostsim::Board& b, bool on) {
+    if (b.radioOn == on) return;
+    const uint64_t now = hostsim::nowMicros();
+    if (on) {
+        b.radioOnSinceUs = now;
+    } else {
+        b.radioOnUs += now - b.radioOnSinceUs;
+    }
+    b.radioOn = on;
+}
+
+void announceLink(hostsim::Board& b, bool up, uint8_t reason) {
+    if (b.linkReported == up) return;
+    b.linkReported = up;
+    // Copy: a handler may register further handlers.
+    const auto handlers = b.wifiEventHandlers;
+    if (up) {
+        for (const auto& handler : handlers) handler(ARDUINO_EVENT_WIFI_STA_CONNECTED, 0);
+        for (const auto& handler : handlers) handler(ARDUINO_EVENT_WIFI_STA_GOT_IP, 0);
+    } else {
+        for (const auto& handler : handlers) handler(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, reason);
+    }
+}
+
+}
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+    if (mode == WIFI_OFF) setRadio(hostsim::board(), false);
+    return true;
+}
+
+wl_status_t WiFiClass::begin(const char*, const char*) {
+    hostsim::Board& b = hostsim::board();
+    setRadio(b, true);
+    b.linkUp = false;
+    b.joinRequested = true;
+    b.joinStartedMs = millis();
+    return status();
+}
+
+bool WiFiClass::disconnect(bool wifiOff) {
+    hostsim::Board& b = hostsim::board();
+    b.linkUp = false;
+    b.joinRequested = false;
+    announceLink(b, false, kReasonAssocLeave);
+    if (wifiOff) setRadio(b, false);
+    return true;
+}
+
+bool WiFiClass::reconnect() {
+    begin(nullptr);
+    return true;
+}
+
+bool WiFiClass::setAutoReconnect(bool) {
+    return true;
+}
+
+wl_status_t WiFiClass::status() {
+    hostsim::Board& b = hostsim::board();
+    if (b.linkUp) return WL_CONNECTED;
+    announceLink(b, false, kReasonBeaconTimeout);
+    if (!b.joinRequested) return WL_DISCONNECTED;
+    if (!b.apAvailable) return WL_NO_SSID_AVAIL;
+    if (millis() - b.joinStartedMs >= b.joinDelayMs) {
+        b.linkUp = true;
+        b.joinRequested = false;
+        announceLink(b, true, 0);
+        return WL_CONNECTED;
+    }
+    return WL_DISCONNECTED;
+}
+
+IPAddress WiFiClass::localIP() {
+    return status() == WL_CONNECTED ? IPAddress(hostsim::board().ipAddress) : IPAddress();
+}
+
+int8_t WiFiClass::RSSI() {
+    return status() == WL_CONNECTED ? -58 : 0;
+}
+
+int WiFiClass::hostByName(const char*, IPAddress& result) {
+    if (status() != WL_CONNECTED) return 0;
+    if (hostsim::board().dnsMs > 0) delay(hostsim::board().dnsMs);
+    result = IPAddress(127, 0, 0, 1);
+    return 1;
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventFuncCb callback, arduino_event_id_t event) {
+    hostsim::Board& b = hostsim::board();
+    b.wifiEventHandlers.push_back([callback, event](int id, uint8_t reason) {
+        if (event != ARDUINO_EVENT_MAX && event != id) return;
+        arduino_event_info_t info;
+        info.wifi_sta_disconnected.reason = reason;
+        callback(static_cast<arduino_event_id_t>(id), info);
+    });
+    return b.wifiEventHandlers.size();
+}
+
+namespace hostsim {
+
+uint64_t radioOnMicros() {
+    const Board& b = board();
+    return b.radioOnUs + (b.radioOn ? nowMicros() - b.radioOnSinceUs : 0);
+}
+
+}
@@ -0,0 +1,64 @@
+#ifndef WiFi_h
+#define WiFi_h
+
+#include <functional>
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+typedef enum {
+    WL_NO_SHIELD = 255,
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+} wifi_mode_t;
+
+// Subset of the arduino-esp32 system events; the values match the core.
+typedef enum {
+    ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+    ARDUINO_EVENT_WIFI_STA_LOST_IP = 9,
+    ARDUINO_EVENT_MAX = 47
+} arduino_event_id_t;
+
+typedef union {
+    struct {
+        uint8_t reason;
+    } wifi_sta_disconnected;
+} arduino_event_info_t;
+
+typedef std::function<void(arduino_event_id_t event, arduino_event_info_t info)> WiFiEventFuncCb;
+typedef size_t wifi_event_id_t;
+
+// Stand-in for the ESP32 WiFi singleton. The link comes up joinDelayMs after
+// begin() while the board's access point is available. Events are delivered
+// when status() observes a link change rather than from a separate task.
+class WiFiClass {
+  public:
+    bool mode(wifi_mode_t mode);
+    wl_status_t begin(const char* ssid, const char* passphrase = nullptr);
+    bool disconnect(bool wifiOff = false);
+    bool reconnect();
+    bool setAutoReconnect(bool autoReconnect);
+    wl_status_t status();
+    IPAddress localIP();
+    int8_t RSSI();
+    int hostByName(const char* host, IPAddress& result);
+    wifi_event_id_t onEvent(WiFiEventFuncCb callback, arduino_event_id_t event = ARDUINO_EVENT_MAX);
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,84 @@
+#include "WiFiClientSecure.h"
+
+#include <cstdio>
+
+#include "Arduino.h"
+#include "HostSim.h"
+#include "SimBroker.h"
+#include "WiFi.h"
+
+WiFiClientSecure::~WiFiClientSecure() {
+    stop();
+}
+
+int WiFiClientSecure::lastError(char* buf, const size_t size) {
+    if (buf != nullptr && size > 0) {
+        std::snprintf(buf, size, _lastError ? "connection refused (%d)" : "no error", _lastError);
+    }
+    return _lastError;
+}
+
+int WiFiClientSecure::connect(IPAddress, uint16_t port) {
+    return connect("sim-broker", port);
+}
+
+int WiFiClientSecure::connect(const char*, uint16_t) {
+    stop();
+    if (WiFi.status() != WL_CONNECTED) {
+        _lastError = -1;
+        return 0;
+    }
+    hostsim::Board& b = hostsim::board();
+    if (b.tcpConnectMs > 0) delay(b.tcpConnectMs);
+    SimBroker* broker = b.broker ? b.broker : &SimBroker::shared();
+    const int handle = broker->open();
+    if (handle < 0) {
+        _lastError = -2;
+        return 0;
+    }
+    // No session reuse: every connection pays the full handshake.
+    b.tlsFullHandshakes++;
+    hostsim::stall(static_cast<uint64_t>(b.tlsFullHandshakeMs) * 1000);
+    _broker = broker;
+    _handle = handle;
+    _lastError = 0;
+    return 1;
+}
+
+size_t WiFiClientSecure::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t WiFiClientSecure::write(const uint8_t* buf, size_t size) {
+    if (!connected()) return 0;
+    _broker->receive(_handle, buf, size);
+    return size;
+}
+
+int WiFiClientSecure::available() {
+    return connected() ? static_cast<int>(_broker->available(_handle)) : 0;
+}
+
+int WiFiClientSecure::read() {
+    return _broker ? _broker->read(_handle) : -1;
+}
+
+int WiFiClientSecure::read(uint8_t* buf, size_t size) {
+    return _broker ? static_cast<int>(_broker->read(_handle, buf, size)) : -1;
+}
+
+int WiFiClientSecure::peek() {
+    return _broker ? _broker->peek(_handle) : -1;
+}
+
+void WiFiClientSecure::stop() {
+    if (_broker != nullptr) _broker->close(_handle);
+    _broker = nullptr;
+    _handle = -1;
+}
+
+uint8_t WiFiClientSecure::connected() {
+    if (_broker == nullptr) return 0;
+    if (!hostsim::board().linkUp) _broker->close(_handle);
+    return _broker->isOpen(_handle) ? 1 : 0;
+}
@@ -0,0 +1,47 @@
+#ifndef WiFiClientSecure_h
+#define WiFiClientSecure_h
+
+#include "Client.h"
+
+class SimBroker;
+
+// Stand-in for WiFiClientSecure. Certificates are stored but no TLS is done;
+// the byte stream goes to the board's SimBroker. TCP connect and a full
+// handshake cost what the board's connection costs say.
+class WiFiClientSecure : public Client {
+  public:
+    WiFiClientSecure() = default;
+    ~WiFiClientSecure() override;
+
+    void setCACert(const char* rootCA) { _caCert = rootCA; }
+    void setCertificate(const char* clientCert) { _clientCert = clientCert; }
+    void setPrivateKey(const char* privateKey) { _privateKey = privateKey; }
+    void setInsecure() { _caCert = nullptr; }
+    void setHandshakeTimeout(unsigned long) {}
+    int lastError(char* buf, const size_t size);
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override {}
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return connected(); }
+
+    using Print::write;
+
+  private:
+    SimBroker* _broker = nullptr;
+    int _handle = -1;
+    int _lastError = 0;
+    const char* _caCert = nullptr;
+    const char* _clientCert = nullptr;
+    const char* _privateKey = nullptr;
+};
+
+#endif
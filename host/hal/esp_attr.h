@@ -0,0 +1,13 @@
+#ifndef esp_attr_h
+#define esp_attr_h
+
+// Section attributes from ESP-IDF. On the host every variable lives in plain
+// memory, and a deep sleep never resets the process: RTC_DATA_ATTR data keeps
+// its value like on the chip, but there is one copy per process, so only one
+// board per process should use deep sleep.
+
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define IRAM_ATTR
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef esp_sleep_h
+#define esp_sleep_h
+
+// Stand-in for the ESP-IDF sleep API, timer wakeup and deep sleep only.
+// esp_deep_sleep_start() powers the board's radio and servos down, lets the
+// sleep time pass on the clock and throws hostsim::DeepSleepRequested: the
+// caller plays the reset by constructing the firmware again.
+
+#include <cstdint>
+
+#include "esp_err.h"
+
+typedef enum {
+    ESP_SLEEP_WAKEUP_UNDEFINED = 0,
+    ESP_SLEEP_WAKEUP_TIMER = 4
+} esp_sleep_wakeup_cause_t;
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t timeInUs);
+[[noreturn]] void esp_deep_sleep_start();
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause();
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef esp_tls_h
+#define esp_tls_h
+
+// Stand-in for the ESP-IDF esp-tls API, subset used by EspTlsClient. No TLS
+// is done: the connection goes to the board's SimBroker and the handshake is
+// modelled with the board's connection costs. A session handed back through
+// esp_tls_cfg_t::client_session makes the next handshake a resumed one.
+
+#include <cstddef>
+#include <sys/types.h>
+
+#include "esp_err.h"
+
+#define ESP_TLS_ERR_SSL_WANT_READ -0x6900
+#define ESP_TLS_ERR_SSL_WANT_WRITE -0x6880
+
+typedef struct esp_tls esp_tls_t;
+typedef struct esp_tls_client_session esp_tls_client_session_t;
+
+typedef enum {
+    ESP_TLS_INIT = 0,
+    ESP_TLS_CONNECTING,
+    ESP_TLS_HANDSHAKE,
+    ESP_TLS_FAIL,
+    ESP_TLS_DONE,
+} esp_tls_conn_state_t;
+
+typedef struct esp_tls_cfg {
+    const unsigned char* cacert_buf;
+    unsigned int cacert_bytes;
+    const unsigned char* clientcert_buf;
+    unsigned int clientcert_bytes;
+    const unsigned char* clientkey_buf;
+    unsigned int clientkey_bytes;
+    bool non_block;
+    int timeout_ms;
+    esp_tls_client_session_t* client_session;
+} esp_tls_cfg_t;
+
+esp_tls_t* esp_tls_init(void);
+int esp_tls_conn_new_sync(const char* hostname, int hostlen, int port, const esp_tls_cfg_t* cfg, esp_tls_t* tls);
+int esp_tls_conn_new_async(const char* hostname, int hostlen, int port, const esp_tls_cfg_t* cfg, esp_tls_t* tls);
+esp_err_t esp_tls_get_conn_state(esp_tls_t* tls, esp_tls_conn_state_t* conn_state);
+ssize_t esp_tls_conn_write(esp_tls_t* tls, const void* data, size_t datalen);
+ssize_t esp_tls_conn_read(esp_tls_t* tls, void* data, size_t datalen);
+ssize_t esp_tls_get_bytes_avail(esp_tls_t* tls);
+int esp_tls_conn_destroy(esp_tls_t* tls);
+esp_tls_client_session_t* esp_tls_get_client_session(esp_tls_t* tls);
+void esp_tls_free_client_session(esp_tls_client_session_t* client_session);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef FreeRTOS_h
+#define FreeRTOS_h
+
+// Host stand-in for the FreeRTOS subset the sketch uses. Tasks are std::threads
+// that inherit the creating thread's simulated board; core affinity is
+// recorded but not enforced. Tasks need the real-time clock
+// (hostsim::useRealtimeClock) since the virtual clock is not shared safely
+// between threads.
+
+#include <cstdint>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+#endif
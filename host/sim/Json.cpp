@@ -0,0 +1,309 @@
+#include "Json.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace json {
+
+namespace {
+
+const std::string kEmptyString;
+const int kMaxDepth = 32;
+
+struct Parser {
+    const std::string& text;
+    size_t pos = 0;
+
+    void skipSpace() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r')) {
+            pos++;
+        }
+    }
+
+    bool literal(const char* word) {
+        size_t length = std::char_traits<char>::length(word);
+        if (text.compare(pos, length, word) != 0) return false;
+        pos += length;
+        return true;
+    }
+
+    static void appendUtf8(std::string& out, unsigned long codepoint) {
+        if (codepoint < 0x80) {
+            out += static_cast<char>(codepoint);
+        } else if (codepoint < 0x800) {
+            out += static_cast<char>(0xC0 | (codepoint >> 6));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        } else {
+            out += static_cast<char>(0xE0 | (codepoint >> 12));
+            out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+    }
+
+    bool string(std::string& out) {
+        if (pos >= text.size() || text[pos] != '"') return false;
+        pos++;
+        while (pos < text.size()) {
+            char c = text[pos++];
+            if (c == '"') return true;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos >= text.size()) return false;
+            char escaped = text[pos++];
+            switch (escaped) {
+                case '"': case '\\': case '/': out += escaped; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    if (pos + 4 > text.size()) return false;
+                    char* end = nullptr;
+                    const std::string hex = text.substr(pos, 4);
+                    unsigned long codepoint = std::strtoul(hex.c_str(), &end, 16);
+                    if (end != hex.c_str() + 4) return false;
+                    pos += 4;
+                    appendUtf8(out, codepoint);
+                    break;
+                }
+                default: return false;
+            }
+        }
+        return false;
+    }
+
+    bool value(Value& out, int depth) {
+        if (depth > kMaxDepth) return false;
+        skipSpace();
+        if (pos >= text.size()) return false;
+        char c = text[pos];
+        if (c == '{') {
+            pos++;
+            out = Value::object();
+            skipSpace();
+            if (pos < text.size() && text[pos] == '}') {
+                pos++;
+                return true;
+            }
+            while (true) {
+                skipSpace();
+                std::string key;
+                if (!string(key)) return false;
+                skipSpace();
+                if (pos >= text.size() || text[pos] != ':') return false;
+                pos++;
+                if (!value(out[key], depth + 1)) return false;
+                skipSpace();
+                if (pos >= text.size()) return false;
+                if (text[pos] == ',') {
+                    pos++;
+                    continue;
+                }
+                if (text[pos] != '}') return false;
+                pos++;
+                return true;
+            }
+        }
+        if (c == '[') {
+            pos++;
+            out = Value::array();
+            skipSpace();
+            if (pos < text.size() && text[pos] == ']') {
+                pos++;
+                return true;
+            }
+            while (true) {
+                Value item;
+                if (!value(item, depth + 1)) return false;
+                out.push(std::move(item));
+                skipSpace();
+                if (pos >= text.size()) return false;
+                if (text[pos] == ',') {
+                    pos++;
+                    continue;
+                }
+                if (text[pos] != ']') return false;
+                pos++;
+                return true;
+            }
+        }
+        if (c == '"') {
+            std::string s;
+            if (!string(s)) return false;
+            out = Value(std::move(s));
+            return true;
+        }
+        if (literal("true")) {
+            out = Value(true);
+            return true;
+        }
+        if (literal("false")) {
+            out = Value(false);
+            return true;
+        }
+        if (literal("null")) {
+            out = Value();
+            return true;
+        }
+        const char* start = text.c_str() + pos;
+        char* end = nullptr;
+        double number = std::strtod(start, &end);
+        if (end == start) return false;
+        pos += end - start;
+        out = Value(number);
+        return true;
+    }
+};
+
+void appendEscaped(std::string& out, const std::string& s) {
+    out += '"';
+    for (char c : s) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+}
+
+Value Value::object() {
+    Value v;
+    v._type = Object;
+    return v;
+}
+
+Value Value::array() {
+    Value v;
+    v._type = Array;
+    return v;
+}
+
+const std::string& Value::asString() const {
+    return _type == String ? _string : kEmptyString;
+}
+
+const Value* Value::find(const std::string& key) const {
+    if (_type != Object) return nullptr;
+    auto it = _members.find(key);
+    return it == _members.end() ? nullptr : &it->second;
+}
+
+Value* Value::find(const std::string& key) {
+    if (_type != Object) return nullptr;
+    auto it = _members.find(key);
+    return it == _members.end() ? nullptr : &it->second;
+}
+
+Value& Value::operator[](const std::string& key) {
+    if (_type != Object) *this = object();
+    return _members[key];
+}
+
+bool Value::erase(const std::string& key) {
+    return _type == Object && _members.erase(key) != 0;
+}
+
+void Value::push(Value value) {
+    if (_type != Array) *this = array();
+    _items.push_back(std::move(value));
+}
+
+size_t Value::size() const {
+    if (_type == Object) return _members.size();
+    if (_type == Array) return _items.size();
+    return 0;
+}
+
+bool Value::operator==(const Value& other) const {
+    if (_type != other._type) return false;
+    switch (_type) {
+        case Null: return true;
+        case Bool: return _bool == other._bool;
+        case Number: return _number == other._number;
+        case String: return _string == other._string;
+        case Object: return _members == other._members;
+        case Array: return _items == other._items;
+    }
+    return false;
+}
+
+std::string Value::dump() const {
+    std::string out;
+    dumpTo(out);
+    return out;
+}
+
+void Value::dumpTo(std::string& out) const {
+    switch (_type) {
+        case Null: out += "null"; break;
+        case Bool: out += _bool ? "true" : "false"; break;
+        case Number: {
+            char buf[32];
+            if (std::floor(_number) == _number && std::fabs(_number) < 9007199254740992.0) {
+                std::snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(_number));
+            } else {
+                std::snprintf(buf, sizeof(buf), "%.17g", _number);
+            }
+            out += buf;
+            break;
+        }
+        case String: appendEscaped(out, _string); break;
+        case Object: {
+            out += '{';
+            bool first = true;
+            for (const auto& member : _members) {
+                if (!first) out += ',';
+                first = false;
+                appendEscaped(out, member.first);
+                out += ':';
+                member.second.dumpTo(out);
+            }
+            out += '}';
+            break;
+        }
+        case Array: {
+            out += '[';
+            for (size_t i = 0; i < _items.size(); i++) {
+                if (i > 0) out += ',';
+                _items[i].dumpTo(out);
+            }
+            out += ']';
+            break;
+        }
+    }
+}
+
+bool Value::parse(const std::string& text, Value& out) {
+    Parser parser{text};
+    Value result;
+    if (!parser.value(result, 0)) {
+        out = Value();
+        return false;
+    }
+    parser.skipSpace();
+    if (parser.pos != text.size()) {
+        out = Value();
+        return false;
+    }
+    out = std::move(result);
+    return true;
+}
+
+}
@@ -0,0 +1,81 @@
+#ifndef Json_h
+#define Json_h
+
+// Small JSON value with a parser and writer for the host cloud stand-ins.
+// Independent of ArduinoJson so the simulated cloud does not share code (or
+// bugs) with the firmware it talks to. Object keys are kept sorted.
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace json {
+
+class Value {
+  public:
+    enum Type { Null, Bool, Number, String, Object, Array };
+    using Members = std::map<std::string, Value>;
+    using Items = std::vector<Value>;
+
+    Value() = default;
+    Value(std::nullptr_t) {}
+    Value(bool value) : _type(Bool), _bool(value) {}
+    Value(int value) : _type(Number), _number(value) {}
+    Value(long value) : _type(Number), _number(static_cast<double>(value)) {}
+    Value(unsigned long value) : _type(Number), _number(static_cast<double>(value)) {}
+    Value(unsigned long long value) : _type(Number), _number(static_cast<double>(value)) {}
+    Value(double value) : _type(Number), _number(value) {}
+    Value(const char* value) : _type(String), _string(value) {}
+    Value(std::string value) : _type(String), _string(std::move(value)) {}
+
+    static Value object();
+    static Value array();
+
+    Type type() const { return _type; }
+    bool isNull() const { return _type == Null; }
+    bool isObject() const { return _type == Object; }
+    bool isNumber() const { return _type == Number; }
+    bool isString() const { return _type == String; }
+
+    bool asBool() const { return _type == Bool && _bool; }
+    double asNumber() const { return _type == Number ? _number : 0.0; }
+    uint64_t asUint() const { return _type == Number && _number > 0 ? static_cast<uint64_t>(_number) : 0; }
+    const std::string& asString() const;
+
+    // Objects. operator[] turns a null value into an empty object.
+    const Value* find(const std::string& key) const;
+    Value* find(const std::string& key);
+    Value& operator[](const std::string& key);
+    bool erase(const std::string& key);
+    const Members& members() const { return _members; }
+
+    // Arrays.
+    void push(Value value);
+    const Items& items() const { return _items; }
+
+    // Members of an object or items of an array.
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+
+    bool operator==(const Value& other) const;
+    bool operator!=(const Value& other) const { return !(*this == other); }
+
+    std::string dump() const;
+    // False on malformed input; `out` is left null then.
+    static bool parse(const std::string& text, Value& out);
+
+  private:
+    Type _type = Null;
+    bool _bool = false;
+    double _number = 0.0;
+    std::string _string;
+    Members _members;
+    Items _items;
+
+    void dumpTo(std::string& out) const;
+};
+
+}
+
+#endif
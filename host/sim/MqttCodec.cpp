@@ -0,0 +1,113 @@
+#include "MqttCodec.h"
+
+namespace mqtt {
+
+void FrameDecoder::feed(const uint8_t* data, size_t length) {
+    _pending.insert(_pending.end(), data, data + length);
+}
+
+bool FrameDecoder::next(Packet& out) {
+    if (_malformed || _pending.size() < 2) return false;
+    size_t remaining = 0;
+    size_t multiplier = 1;
+    size_t pos = 1;
+    while (true) {
+        if (pos >= _pending.size()) return false;
+        const uint8_t digit = _pending[pos++];
+        remaining += (digit & 0x7F) * multiplier;
+        if ((digit & 0x80) == 0) break;
+        multiplier *= 128;
+        if (pos > 4) {
+            _malformed = true;
+            return false;
+        }
+    }
+    if (_pending.size() < pos + remaining) return false;
+    out.header = _pending[0];
+    out.body.assign(_pending.begin() + pos, _pending.begin() + pos + remaining);
+    _pending.erase(_pending.begin(), _pending.begin() + pos + remaining);
+    return true;
+}
+
+void FrameDecoder::reset() {
+    _pending.clear();
+    _malformed = false;
+}
+
+void appendRemainingLength(std::vector<uint8_t>& out, size_t length) {
+    do {
+        uint8_t digit = length % 128;
+        length /= 128;
+        if (length > 0) digit |= 0x80;
+        out.push_back(digit);
+    } while (length > 0);
+}
+
+void appendUint16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value & 0xFF));
+}
+
+void appendString(std::vector<uint8_t>& out, const std::string& value) {
+    appendUint16(out, static_cast<uint16_t>(value.size()));
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+bool readUint16(const std::vector<uint8_t>& body, size_t& pos, uint16_t& out) {
+    if (pos + 2 > body.size()) return false;
+    out = static_cast<uint16_t>((body[pos] << 8) | body[pos + 1]);
+    pos += 2;
+    return true;
+}
+
+bool readString(const std::vector<uint8_t>& body, size_t& pos, std::string& out) {
+    uint16_t length = 0;
+    if (!readUint16(body, pos, length) || pos + length > body.size()) return false;
+    out.assign(reinterpret_cast<const char*>(body.data()) + pos, length);
+    pos += length;
+    return true;
+}
+
+std::vector<uint8_t> encode(uint8_t header, const std::vector<uint8_t>& body) {
+    std::vector<uint8_t> out;
+    out.reserve(body.size() + 5);
+    out.push_back(header);
+    appendRemainingLength(out, body.size());
+    out.insert(out.end(), body.begin(), body.end());
+    return out;
+}
+
+std::vector<uint8_t> encodePublish(const std::string& topic, const uint8_t* payload, size_t length,
+                                   uint8_t qos, uint16_t packetId, bool retain) {
+    std::vector<uint8_t> body;
+    body.reserve(topic.size() + length + 4);
+    appendString(body, topic);
+    if (qos > 0) appendUint16(body, packetId);
+    body.insert(body.end(), payload, payload + length);
+    const uint8_t header = static_cast<uint8_t>((PUBLISH << 4) | (qos << 1) | (retain ? 1 : 0));
+    return encode(header, body);
+}
+
+bool topicMatches(const std::string& filter, const std::string& topic) {
+    size_t f = 0;
+    size_t t = 0;
+    while (f < filter.size()) {
+        const size_t fEnd = filter.find('/', f);
+        const std::string level = filter.substr(f, fEnd == std::string::npos ? std::string::npos : fEnd - f);
+        if (level == "#") return true;
+        if (t > topic.size()) return false;
+        const size_t tEnd = topic.find('/', t);
+        const size_t tLen = (tEnd == std::string::npos ? topic.size() : tEnd) - t;
+        if (level != "+" && topic.compare(t, tLen, level) != 0) return false;
+        if (fEnd == std::string::npos) return tEnd == std::string::npos;
+        if (tEnd == std::string::npos) {
+            // "a/#" also matches "a".
+            return filter.compare(fEnd + 1, std::string::npos, "#") == 0;
+        }
+        f = fEnd + 1;
+        t = tEnd + 1;
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,63 @@
+#ifndef MqttCodec_h
+#define MqttCodec_h
+
+// Minimal MQTT 3.1.1 framing shared by the host broker stand-ins.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mqtt {
+
+enum PacketType : uint8_t {
+    CONNECT = 1,
+    CONNACK = 2,
+    PUBLISH = 3,
+    PUBACK = 4,
+    SUBSCRIBE = 8,
+    SUBACK = 9,
+    UNSUBSCRIBE = 10,
+    UNSUBACK = 11,
+    PINGREQ = 12,
+    PINGRESP = 13,
+    DISCONNECT = 14
+};
+
+struct Packet {
+    uint8_t header = 0;
+    std::vector<uint8_t> body;
+
+    uint8_t type() const { return header >> 4; }
+    uint8_t flags() const { return header & 0x0F; }
+};
+
+// Incremental decoder: feed bytes as they arrive, pop complete packets.
+class FrameDecoder {
+  public:
+    void feed(const uint8_t* data, size_t length);
+    bool next(Packet& out);
+    void reset();
+    bool malformed() const { return _malformed; }
+
+  private:
+    std::vector<uint8_t> _pending;
+    bool _malformed = false;
+};
+
+void appendRemainingLength(std::vector<uint8_t>& out, size_t length);
+void appendString(std::vector<uint8_t>& out, const std::string& value);
+void appendUint16(std::vector<uint8_t>& out, uint16_t value);
+bool readString(const std::vector<uint8_t>& body, size_t& pos, std::string& out);
+bool readUint16(const std::vector<uint8_t>& body, size_t& pos, uint16_t& out);
+
+std::vector<uint8_t> encode(uint8_t header, const std::vector<uint8_t>& body);
+std::vector<uint8_t> encodePublish(const std::string& topic, const uint8_t* payload, size_t length,
+                                   uint8_t qos, uint16_t packetId, bool retain);
+
+// True when `topic` matches the subscription `filter` ('+' and '#' wildcards).
+bool topicMatches(const std::string& filter, const std::string& topic);
+
+}
+
+#endif
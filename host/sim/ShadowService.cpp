@@ -0,0 +1,432 @@
+#include "ShadowService.h"
+
+#include <ctime>
+
+#include "HostSim.h"
+#include "SimBroker.h"
+
+namespace {
+
+const std::string kThingsPrefix = "$aws/things/";
+
+json::Value stamp(uint64_t ts) {
+    json::Value meta = json::Value::object();
+    meta["timestamp"] = json::Value(static_cast<unsigned long long>(ts));
+    return meta;
+}
+
+// Leaves become {"timestamp": ts}; objects are walked.
+json::Value metadataFor(const json::Value& patch, uint64_t ts) {
+    if (!patch.isObject()) return stamp(ts);
+    json::Value meta = json::Value::object();
+    for (const auto& member : patch.members()) {
+        meta[member.first] = metadataFor(member.second, ts);
+    }
+    return meta;
+}
+
+// Shadow merge rules: null removes a key, objects merge recursively, anything
+// else (arrays included) replaces the old value.
+void merge(json::Value& target, json::Value& metadata, const json::Value& patch, uint64_t ts) {
+    for (const auto& member : patch.members()) {
+        const std::string& name = member.first;
+        const json::Value& value = member.second;
+        if (value.isNull()) {
+            target.erase(name);
+            metadata.erase(name);
+        } else if (value.isObject()) {
+            json::Value& child = target[name];
+            json::Value& childMetadata = metadata[name];
+            if (!child.isObject()) child = json::Value::object();
+            if (!childMetadata.isObject() || childMetadata.find("timestamp") != nullptr) {
+                childMetadata = json::Value::object();
+            }
+            merge(child, childMetadata, value, ts);
+            if (child.empty()) {
+                target.erase(name);
+                metadata.erase(name);
+            }
+        } else {
+            target[name] = value;
+            metadata[name] = stamp(ts);
+        }
+    }
+}
+
+// Desired fields that reported does not have or has with another value.
+json::Value computeDelta(const json::Value& desired, const json::Value& reported) {
+    json::Value delta = json::Value::object();
+    for (const auto& member : desired.members()) {
+        const json::Value* current = reported.find(member.first);
+        if (member.second.isObject() && current != nullptr && current->isObject()) {
+            json::Value nested = computeDelta(member.second, *current);
+            if (!nested.empty()) delta[member.first] = nested;
+        } else if (current == nullptr || *current != member.second) {
+            delta[member.first] = member.second;
+        }
+    }
+    return delta;
+}
+
+void dropIfEmpty(json::Value& section, json::Value& metadata) {
+    if (section.isObject() && section.empty()) {
+        section = json::Value();
+        metadata = json::Value();
+    }
+}
+
+}
+
+ShadowService::ShadowService(SimBroker& broker) : _broker(broker), _random(_options.seed) {
+    _defer = [](unsigned long delayMs, std::function<void()> fn) {
+        if (delayMs == 0) {
+            fn();
+            return;
+        }
+        hostsim::scheduleEvent(hostsim::nowMicros() + static_cast<uint64_t>(delayMs) * 1000, std::move(fn));
+    };
+}
+
+void ShadowService::setOptions(const Options& options) {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    _options = options;
+    _random.seed(options.seed);
+}
+
+void ShadowService::setDefer(Defer defer) {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    _defer = std::move(defer);
+}
+
+void ShadowService::setUpdateObserver(UpdateObserver observer) {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    _observer = std::move(observer);
+}
+
+bool ShadowService::parseTopic(const std::string& topic, Request& out) {
+    if (topic.compare(0, kThingsPrefix.size(), kThingsPrefix) != 0) return false;
+    size_t pos = kThingsPrefix.size();
+    size_t slash = topic.find('/', pos);
+    if (slash == std::string::npos || slash == pos) return false;
+    out.thingName = topic.substr(pos, slash - pos);
+    pos = slash + 1;
+    if (topic.compare(pos, 7, "shadow/") != 0) return false;
+    pos += 7;
+    out.shadowName.clear();
+    if (topic.compare(pos, 5, "name/") == 0) {
+        pos += 5;
+        slash = topic.find('/', pos);
+        if (slash == std::string::npos || slash == pos) return false;
+        out.shadowName = topic.substr(pos, slash - pos);
+        pos = slash + 1;
+    }
+    out.operation = topic.substr(pos);
+    if (out.operation != "update" && out.operation != "get" && out.operation != "delete") return false;
+    out.topicPrefix = topic.substr(0, pos - 1);
+    return true;
+}
+
+std::string ShadowService::key(const std::string& thingName, const std::string& shadowName) {
+    return shadowName.empty() ? thingName : thingName + "/" + shadowName;
+}
+
+std::string ShadowService::keyOf(const Request& request) {
+    return key(request.thingName, request.shadowName);
+}
+
+uint64_t ShadowService::timestamp() {
+    return static_cast<uint64_t>(std::time(nullptr));
+}
+
+bool ShadowService::lose() {
+    if (_options.lossRate <= 0.0) return false;
+    return std::uniform_real_distribution<double>(0.0, 1.0)(_random) < _options.lossRate;
+}
+
+unsigned long ShadowService::delay() {
+    unsigned long wait = _options.latencyMs;
+    if (_options.jitterMs > 0) {
+        wait += std::uniform_int_distribution<unsigned long>(0, _options.jitterMs)(_random);
+    }
+    return wait;
+}
+
+bool ShadowService::handlePublish(const std::string&, const std::string& topic, const std::string& payload) {
+    Request request;
+    if (!parseTopic(topic, request)) return false;
+    unsigned long wait;
+    Defer defer;
+    {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        _stats.requests++;
+        if (lose()) {
+            _stats.lost++;
+            return true;
+        }
+        wait = delay();
+        defer = _defer;
+    }
+    defer(wait, [this, request, payload]() { process(request, payload); });
+    return true;
+}
+
+int ShadowService::update(const std::string& thingName, const std::string& shadowName, const std::string& payload) {
+    Request request;
+    request.thingName = thingName;
+    request.shadowName = shadowName;
+    request.operation = "update";
+    request.topicPrefix = kThingsPrefix + thingName + "/shadow" + (shadowName.empty() ? "" : "/name/" + shadowName);
+    std::vector<Message> out;
+    int code;
+    {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        code = applyUpdate(request, payload, out);
+    }
+    deliver(out);
+    return code;
+}
+
+// Responses are built under the service mutex and published after releasing
+// it: the broker calls handlePublish() with its own mutex held.
+void ShadowService::process(const Request& request, const std::string& payload) {
+    std::vector<Message> out;
+    {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        if (request.operation == "update") {
+            applyUpdate(request, payload, out);
+        } else if (request.operation == "get") {
+            applyGet(request, payload, out);
+        } else {
+            applyDelete(request, payload, out);
+        }
+    }
+    deliver(out);
+}
+
+json::Value ShadowService::rejection(int code, const std::string& message, const json::Value* clientToken) {
+    json::Value body = json::Value::object();
+    body["code"] = code;
+    body["message"] = message;
+    body["timestamp"] = json::Value(static_cast<unsigned long long>(timestamp()));
+    if (clientToken != nullptr) body["clientToken"] = *clientToken;
+    return body;
+}
+
+json::Value ShadowService::documentOf(const Shadow& shadow, uint64_t ts) const {
+    json::Value document = json::Value::object();
+    json::Value& state = document["state"];
+    state = json::Value::object();
+    json::Value& metadata = document["metadata"];
+    metadata = json::Value::object();
+    if (!shadow.desired.isNull()) {
+        state["desired"] = shadow.desired;
+        metadata["desired"] = shadow.desiredMetadata;
+    }
+    if (!shadow.reported.isNull()) {
+        state["reported"] = shadow.reported;
+        metadata["reported"] = shadow.reportedMetadata;
+    }
+    json::Value delta = computeDelta(shadow.desired, shadow.reported);
+    if (!delta.empty()) state["delta"] = delta;
+    document["version"] = json::Value(static_cast<unsigned long long>(shadow.version));
+    document["timestamp"] = json::Value(static_cast<unsigned long long>(ts));
+    return document;
+}
+
+int ShadowService::applyUpdate(const Request& request, const std::string& payload, std::vector<Message>& out) {
+    const std::string rejectedTopic = request.topicPrefix + "/update/rejected";
+    auto reject = [&](int code, const std::string& message, const json::Value* clientToken) {
+        _stats.updatesRejected++;
+        if (code == 409) _stats.conflicts++;
+        out.emplace_back(rejectedTopic, rejection(code, message, clientToken).dump());
+        return code;
+    };
+
+    if (payload.size() > _options.maxPayloadBytes) return reject(413, "Payload too large", nullptr);
+    json::Value doc;
+    if (!json::Value::parse(payload, doc) || !doc.isObject()) return reject(400, "Invalid JSON", nullptr);
+    const json::Value* clientToken = doc.find("clientToken");
+    const json::Value* state = doc.find("state");
+    if (state == nullptr || !state->isObject()) return reject(400, "Missing required node: state", clientToken);
+    const json::Value* desired = state->find("desired");
+    const json::Value* reported = state->find("reported");
+    if ((desired != nullptr && !desired->isNull() && !desired->isObject()) ||
+        (reported != nullptr && !reported->isNull() && !reported->isObject())) {
+        return reject(400, "State node must be an object", clientToken);
+    }
+
+    const std::string shadowKey = keyOf(request);
+    auto existing = _shadows.find(shadowKey);
+    const bool existed = existing != _shadows.end();
+    const json::Value* requestVersion = doc.find("version");
+    if (requestVersion != nullptr &&
+        (!requestVersion->isNumber() || requestVersion->asUint() != (existed ? existing->second.version : 0))) {
+        return reject(409, "Version conflict", clientToken);
+    }
+
+    const uint64_t ts = timestamp();
+    Shadow& shadow = _shadows[shadowKey];
+    json::Value previous;
+    if (existed) previous = documentOf(shadow, ts);
+
+    if (desired != nullptr) {
+        if (desired->isNull()) {
+            shadow.desired = json::Value();
+            shadow.desiredMetadata = json::Value();
+        } else {
+            merge(shadow.desired, shadow.desiredMetadata, *desired, ts);
+            dropIfEmpty(shadow.desired, shadow.desiredMetadata);
+        }
+    }
+    if (reported != nullptr) {
+        if (reported->isNull()) {
+            shadow.reported = json::Value();
+            shadow.reportedMetadata = json::Value();
+        } else {
+            merge(shadow.reported, shadow.reportedMetadata, *reported, ts);
+            dropIfEmpty(shadow.reported, shadow.reportedMetadata);
+        }
+    }
+    shadow.version++;
+    _stats.updatesAccepted++;
+
+    json::Value accepted = json::Value::object();
+    accepted["state"] = *state;
+    json::Value& acceptedMetadata = accepted["metadata"];
+    acceptedMetadata = json::Value::object();
+    if (desired != nullptr) acceptedMetadata["desired"] = metadataFor(*desired, ts);
+    if (reported != nullptr) acceptedMetadata["reported"] = metadataFor(*reported, ts);
+    accepted["version"] = json::Value(static_cast<unsigned long long>(shadow.version));
+    accepted["timestamp"] = json::Value(static_cast<unsigned long long>(ts));
+    if (clientToken != nullptr) accepted["clientToken"] = *clientToken;
+    out.emplace_back(request.topicPrefix + "/update/accepted", accepted.dump());
+
+    json::Value documents = json::Value::object();
+    json::Value current = documentOf(shadow, ts);
+    current.erase("timestamp");
+    if (existed) {
+        previous.erase("timestamp");
+        documents["previous"] = previous;
+    }
+    documents["current"] = current;
+    documents["timestamp"] = json::Value(static_cast<unsigned long long>(ts));
+    if (clientToken != nullptr) documents["clientToken"] = *clientToken;
+    out.emplace_back(request.topicPrefix + "/update/documents", documents.dump());
+
+    // As in AWS, a delta is only published for requests that carry desired.
+    if (desired != nullptr && !desired->isNull()) {
+        json::Value delta = computeDelta(shadow.desired, shadow.reported);
+        if (!delta.empty()) {
+            json::Value message = json::Value::object();
+            message["version"] = json::Value(static_cast<unsigned long long>(shadow.version));
+            message["timestamp"] = json::Value(static_cast<unsigned long long>(ts));
+            json::Value& deltaMetadata = message["metadata"];
+            deltaMetadata = json::Value::object();
+            for (const auto& member : delta.members()) {
+                const json::Value* fieldMetadata = shadow.desiredMetadata.find(member.first);
+                if (fieldMetadata != nullptr) deltaMetadata[member.first] = *fieldMetadata;
+            }
+            message["state"] = delta;
+            if (clientToken != nullptr) message["clientToken"] = *clientToken;
+            out.emplace_back(request.topicPrefix + "/update/delta", message.dump());
+            _stats.deltas++;
+        }
+    }
+
+    if (_observer) _observer(shadowKey, shadow.version);
+    return 200;
+}
+
+void ShadowService::applyGet(const Request& request, const std::string& payload, std::vector<Message>& out) {
+    _stats.gets++;
+    json::Value doc;
+    json::Value::parse(payload, doc);
+    const json::Value* clientToken = doc.find("clientToken");
+    auto it = _shadows.find(keyOf(request));
+    if (it == _shadows.end()) {
+        _stats.getsRejected++;
+        out.emplace_back(request.topicPrefix + "/get/rejected",
+                         rejection(404, "No shadow exists with name: '" + keyOf(request) + "'", clientToken).dump());
+        return;
+    }
+    json::Value document = documentOf(it->second, timestamp());
+    if (clientToken != nullptr) document["clientToken"] = *clientToken;
+    out.emplace_back(request.topicPrefix + "/get/accepted", document.dump());
+}
+
+void ShadowService::applyDelete(const Request& request, const std::string& payload, std::vector<Message>& out) {
+    json::Value doc;
+    json::Value::parse(payload, doc);
+    const json::Value* clientToken = doc.find("clientToken");
+    auto it = _shadows.find(keyOf(request));
+    if (it == _shadows.end()) {
+        out.emplace_back(request.topicPrefix + "/delete/rejected",
+                         rejection(404, "No shadow exists with name: '" + keyOf(request) + "'", clientToken).dump());
+        return;
+    }
+    _stats.deletes++;
+    json::Value accepted = json::Value::object();
+    accepted["version"] = json::Value(static_cast<unsigned long long>(it->second.version));
+    accepted["timestamp"] = json::Value(static_cast<unsigned long long>(timestamp()));
+    if (clientToken != nullptr) accepted["clientToken"] = *clientToken;
+    _shadows.erase(it);
+    out.emplace_back(request.topicPrefix + "/delete/accepted", accepted.dump());
+}
+
+// The responses to one request arrive together; each can be lost on its own.
+void ShadowService::deliver(const std::vector<Message>& messages) {
+    std::vector<Message> kept;
+    unsigned long wait;
+    Defer defer;
+    {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        for (const Message& message : messages) {
+            if (lose()) {
+                _stats.lost++;
+                continue;
+            }
+            kept.push_back(message);
+        }
+        wait = delay();
+        defer = _defer;
+    }
+    if (kept.empty()) return;
+    defer(wait, [this, kept]() {
+        for (const Message& message : kept) _broker.publish(message.first, message.second);
+    });
+}
+
+bool ShadowService::exists(const std::string& thingName, const std::string& shadowName) {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    return _shadows.count(key(thingName, shadowName)) != 0;
+}
+
+uint64_t ShadowService::version(const std::string& thingName, const std::string& shadowName) {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    auto it = _shadows.find(key(thingName, shadowName));
+    return it == _shadows.end() ? 0 : it->second.version;
+}
+
+json::Value ShadowService::document(const std::string& thingName, const std::string& shadowName) {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    auto it = _shadows.find(key(thingName, shadowName));
+    return it == _shadows.end() ? json::Value() : documentOf(it->second, timestamp());
+}
+
+json::Value ShadowService::delta(const std::string& thingName, const std::string& shadowName) {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    auto it = _shadows.find(key(thingName, shadowName));
+    return it == _shadows.end() ? json::Value::object() : computeDelta(it->second.desired, it->second.reported);
+}
+
+ShadowService::Stats ShadowService::stats() {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    return _stats;
+}
+
+void ShadowService::reset() {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    _shadows.clear();
+    _stats = Stats();
+    _random.seed(_options.seed);
+}
@@ -0,0 +1,124 @@
+#ifndef ShadowService_h
+#define ShadowService_h
+
+// AWS IoT Device Shadow service stand-in on top of SimBroker. Handles
+// shadow/update, shadow/get and shadow/delete requests published by devices
+// (classic and named shadows) the way the real service does: versioned
+// documents with per-field metadata, desired/reported merge with null
+// deletes, delta computation, accepted/rejected/documents/delta responses and
+// 409 on a version mismatch. Request and response latency, jitter and loss
+// are configurable.
+//
+// Wire it in from the broker's publish hook with handlePublish(); the cloud
+// side of a benchmark writes through update(), as another MQTT client would.
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Json.h"
+
+class SimBroker;
+
+class ShadowService {
+  public:
+    // Runs fn after delayMs. The default uses hostsim::scheduleEvent, so
+    // deferred work fires on the virtual clock of the publishing board.
+    using Defer = std::function<void(unsigned long delayMs, std::function<void()> fn)>;
+    // Called after every accepted update with the shadow key
+    // ("thing" or "thing/name") and its new version.
+    using UpdateObserver = std::function<void(const std::string& key, uint64_t version)>;
+
+    struct Options {
+        unsigned long latencyMs = 0;   // one way: request to service, response to device
+        unsigned long jitterMs = 0;    // added uniformly per message
+        double lossRate = 0.0;         // per message, requests and responses alike
+        uint32_t seed = 1;
+        size_t maxPayloadBytes = 8192; // AWS rejects larger updates with 413
+    };
+
+    struct Stats {
+        uint64_t requests = 0;
+        uint64_t lost = 0;
+        uint64_t updatesAccepted = 0;
+        uint64_t updatesRejected = 0;
+        uint64_t conflicts = 0;
+        uint64_t gets = 0;
+        uint64_t getsRejected = 0;
+        uint64_t deletes = 0;
+        uint64_t deltas = 0;
+    };
+
+    explicit ShadowService(SimBroker& broker);
+
+    void setOptions(const Options& options);
+    void setDefer(Defer defer);
+    void setUpdateObserver(UpdateObserver observer);
+
+    // True when `topic` was a shadow request and has been taken over.
+    bool handlePublish(const std::string& clientId, const std::string& topic, const std::string& payload);
+
+    // Update from the cloud side: applied at once, without latency or loss
+    // on the request. Responses go through the broker like any other.
+    // Returns 200 or the rejection code.
+    int update(const std::string& thingName, const std::string& shadowName, const std::string& payload);
+
+    bool exists(const std::string& thingName, const std::string& shadowName = std::string());
+    uint64_t version(const std::string& thingName, const std::string& shadowName = std::string());
+    // The document as get/accepted returns it (state with delta, metadata,
+    // version); null when the shadow does not exist.
+    json::Value document(const std::string& thingName, const std::string& shadowName = std::string());
+    json::Value delta(const std::string& thingName, const std::string& shadowName = std::string());
+
+    Stats stats();
+    void reset();
+
+  private:
+    struct Shadow {
+        json::Value desired;
+        json::Value reported;
+        json::Value desiredMetadata;
+        json::Value reportedMetadata;
+        uint64_t version = 0;
+    };
+
+    struct Request {
+        std::string thingName;
+        std::string shadowName;
+        std::string operation;
+        std::string topicPrefix;  // up to and including "shadow" or "shadow/name/<name>"
+    };
+
+    using Message = std::pair<std::string, std::string>;  // topic, payload
+
+    SimBroker& _broker;
+    std::recursive_mutex _mutex;
+    Options _options;
+    Defer _defer;
+    UpdateObserver _observer;
+    std::mt19937 _random;
+    std::map<std::string, Shadow> _shadows;
+    Stats _stats;
+
+    static bool parseTopic(const std::string& topic, Request& out);
+    static std::string key(const std::string& thingName, const std::string& shadowName);
+    static std::string keyOf(const Request& request);
+    static uint64_t timestamp();
+
+    bool lose();
+    unsigned long delay();
+    void process(const Request& request, const std::string& payload);
+    int applyUpdate(const Request& request, const std::string& payload, std::vector<Message>& out);
+    void applyGet(const Request& request, const std::string& payload, std::vector<Message>& out);
+    void applyDelete(const Request& request, const std::string& payload, std::vector<Message>& out);
+    json::Value rejection(int code, const std::string& message, const json::Value* clientToken);
+    json::Value documentOf(const Shadow& shadow, uint64_t ts) const;
+    void deliver(const std::vector<Message>& messages);
+};
+
+#endif
@@ -0,0 +1,249 @@
+#include "SimBroker.h"
+
+#include <algorithm>
+
+#include "HostSim.h"
+
+SimBroker& SimBroker::shared() {
+    static SimBroker broker;
+    return broker;
+}
+
+int SimBroker::open() {
+    hostsim::SimulationScope scope;
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    if (!_online) {
+        _stats.refused++;
+        return -1;
+    }
+    const int handle = _nextHandle++;
+    _sessions[handle];
+    return handle;
+}
+
+void SimBroker::close(int handle) {
+    hostsim::SimulationScope scope;
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    _sessions.erase(handle);
+}
+
+bool SimBroker::isOpen(int handle) {
+    hostsim::SimulationScope scope;
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    return _sessions.count(handle) != 0;
+}
+
+void SimBroker::receive(int handle, const uint8_t* data, size_t length) {
+    hostsim::SimulationScope scope;
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    auto it = _sessions.find(handle);
+    if (it == _sessions.end()) return;
+    _stats.bytesIn += length;
+    it->second.decoder.feed(data, length);
+    mqtt::Packet packet;
+    while (true) {
+        it = _sessions.find(handle);
+        if (it == _sessions.end() || !it->second.decoder.next(packet)) break;
+        handlePacket(handle, packet);
+    }
+    it = _sessions.find(handle);
+    if (it != _sessions.end() && it->second.decoder.malformed()) _sessions.erase(it);
+}
+
+size_t SimBroker::available(int handle) {
+    hostsim::SimulationScope scope;
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    auto it = _sessions.find(handle);
+    return it == _sessions.end() ? 0 : it->second.toClient.size();
+}
+
+int SimBroker::read(int handle) {
+    hostsim::SimulationScope scope;
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    auto it = _sessions.find(handle);
+    if (it == _sessions.end() || it->second.toClient.empty()) return -1;
+    const uint8_t c = it->second.toClient.front();
+    it->second.toClient.pop_front();
+    return c;
+}
+
+int SimBroker::peek(int handle) {
+    hostsim::SimulationScope scope;
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    auto it = _sessions.find(handle);
+    if (it == _sessions.end() || it->second.toClient.empty()) return -1;
+    return it->second.toClient.front();
+}
+
+size_t SimBroker::read(int handle, uint8_t* buffer, size_t length) {
+    hostsim::SimulationScope scope;
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    auto it = _sessions.find(handle);
+    if (it == _sessions.end()) return 0;
+    std::deque<uint8_t>& queue = it->second.toClient;
+    const size_t n = std::min(length, queue.size());
+    std::copy(queue.begin(), queue.begin() + n, buffer);
+    queue.erase(queue.begin(), queue.begin() + n);
+    return n;
+}
+
+void SimBroker::publish(const std::string& topic, const std::string& payload, bool retain) {
+    hostsim::SimulationScope scope;
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    if (retain) _retained[topic] = payload;
+    route(topic, payload);
+}
+
+void SimBroker::setPublishHook(PublishHook hook) {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    _hook = std::move(hook);
+}
+
+void SimBroker::setPubAckOptions(unsigned long latencyMs, double lossRate, uint32_t seed) {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    _pubAckLatencyMs = latencyMs;
+    _pubAckLossRate = lossRate;
+    _random.seed(seed);
+}
+
+void SimBroker::setOnline(bool online) {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    _online = online;
+    if (!online) _sessions.clear();
+}
+
+bool SimBroker::online() {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    return _online;
+}
+
+SimBroker::Stats SimBroker::stats() {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    return _stats;
+}
+
+void SimBroker::send(Session& session, const std::vector<uint8_t>& bytes) {
+    _stats.bytesOut += bytes.size();
+    session.toClient.insert(session.toClient.end(), bytes.begin(), bytes.end());
+}
+
+void SimBroker::route(const std::string& topic, const std::string& payload) {
+    const std::vector<uint8_t> packet = mqtt::encodePublish(
+        topic, reinterpret_cast<const uint8_t*>(payload.data()), payload.size(), 0, 0, false);
+    for (auto& entry : _sessions) {
+        Session& session = entry.second;
+        if (!session.connected) continue;
+        for (const std::string& filter : session.filters) {
+            if (mqtt::topicMatches(filter, topic)) {
+                _stats.publishesOut++;
+                send(session, packet);
+                break;
+            }
+        }
+    }
+}
+
+void SimBroker::sendPubAck(int handle, uint16_t packetId) {
+    if (_pubAckLossRate > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(_random) < _pubAckLossRate) {
+        _stats.pubacksLost++;
+        return;
+    }
+    std::vector<uint8_t> ack;
+    mqtt::appendUint16(ack, packetId);
+    if (_pubAckLatencyMs == 0) {
+        send(_sessions[handle], mqtt::encode(mqtt::PUBACK << 4, ack));
+        return;
+    }
+    hostsim::scheduleEvent(hostsim::nowMicros() + static_cast<uint64_t>(_pubAckLatencyMs) * 1000, [this, handle, ack]() {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        auto it = _sessions.find(handle);
+        if (it != _sessions.end()) send(it->second, mqtt::encode(mqtt::PUBACK << 4, ack));
+    });
+}
+
+void SimBroker::handlePacket(int handle, const mqtt::Packet& packet) {
+    Session& session = _sessions[handle];
+    size_t pos = 0;
+    switch (packet.type()) {
+        case mqtt::CONNECT: {
+            std::string protocol;
+            uint16_t keepAlive = 0;
+            bool ok = mqtt::readString(packet.body, pos, protocol) && pos + 2 <= packet.body.size();
+            pos += 2;  // protocol level + connect flags
+            ok = ok && mqtt::readUint16(packet.body, pos, keepAlive) &&
+                 mqtt::readString(packet.body, pos, session.clientId);
+            session.connected = ok;
+            _stats.connects++;
+            send(session, mqtt::encode(mqtt::CONNACK << 4, {0x00, static_cast<uint8_t>(ok ? 0x00 : 0x02)}));
+            break;
+        }
+        case mqtt::PUBLISH: {
+            std::string topic;
+            uint16_t packetId = 0;
+            const uint8_t qos = (packet.flags() >> 1) & 0x03;
+            if (!mqtt::readString(packet.body, pos, topic)) break;
+            if (qos > 0 && !mqtt::readUint16(packet.body, pos, packetId)) break;
+            std::string payload(packet.body.begin() + pos, packet.body.end());
+            _stats.publishesIn++;
+            if (packet.flags() & 0x08) _stats.duplicatesIn++;
+            if (qos == 1) sendPubAck(handle, packetId);
+            if (packet.flags() & 0x01) _retained[topic] = payload;
+            const std::string clientId = session.clientId;
+            if (_hook) _hook(clientId, topic, payload);
+            route(topic, payload);
+            break;
+        }
+        case mqtt::SUBSCRIBE: {
+            uint16_t packetId = 0;
+            if (!mqtt::readUint16(packet.body, pos, packetId)) break;
+            std::vector<uint8_t> ack;
+            mqtt::appendUint16(ack, packetId);
+            std::vector<std::string> added;
+            while (pos < packet.body.size()) {
+                std::string filter;
+                if (!mqtt::readString(packet.body, pos, filter) || pos >= packet.body.size()) break;
+                pos++;  // requested QoS; the stand-in always grants 0
+                session.filters.push_back(filter);
+                added.push_back(filter);
+                ack.push_back(0x00);
+            }
+            send(session, mqtt::encode(mqtt::SUBACK << 4, ack));
+            for (const auto& retained : _retained) {
+                for (const std::string& filter : added) {
+                    if (mqtt::topicMatches(filter, retained.first)) {
+                        send(session, mqtt::encodePublish(retained.first,
+                                                          reinterpret_cast<const uint8_t*>(retained.second.data()),
+                                                          retained.second.size(), 0, 0, true));
+                        break;
+                    }
+                }
+            }
+            break;
+        }
+        case mqtt::UNSUBSCRIBE: {
+            uint16_t packetId = 0;
+            if (!mqtt::readUint16(packet.body, pos, packetId)) break;
+            std::string filter;
+            while (mqtt::readString(packet.body, pos, filter)) {
+                for (auto it = session.filters.begin(); it != session.filters.end(); ++it) {
+                    if (*it == filter) {
+                        session.filters.erase(it);
+                        break;
+                    }
+                }
+            }
+            std::vector<uint8_t> ack;
+            mqtt::appendUint16(ack, packetId);
+            send(session, mqtt::encode(mqtt::UNSUBACK << 4, ack));
+            break;
+        }
+        case mqtt::PINGREQ:
+            send(session, mqtt::encode(mqtt::PINGRESP << 4, {}));
+            break;
+        case mqtt::DISCONNECT:
+            _sessions.erase(handle);
+            break;
+        default:
+            break;
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef SimBroker_h
+#define SimBroker_h
+
+// In-process MQTT 3.1.1 broker the host WiFiClientSecure stand-in connects to.
+// Client connections exchange real MQTT bytes; the "cloud" side observes device
+// publishes through a hook and injects messages with publish().
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "MqttCodec.h"
+
+class SimBroker {
+  public:
+    using PublishHook = std::function<void(const std::string& clientId, const std::string& topic,
+                                           const std::string& payload)>;
+
+    struct Stats {
+        uint64_t connects = 0;
+        uint64_t refused = 0;  // connections attempted while offline
+        uint64_t publishesIn = 0;
+        uint64_t duplicatesIn = 0;  // QoS 1 publishes resent with DUP
+        uint64_t pubacksLost = 0;
+        uint64_t publishesOut = 0;
+        uint64_t bytesIn = 0;
+        uint64_t bytesOut = 0;
+    };
+
+    static SimBroker& shared();
+
+    int open();
+    void close(int handle);
+    bool isOpen(int handle);
+
+    void receive(int handle, const uint8_t* data, size_t length);
+    size_t available(int handle);
+    int read(int handle);
+    int peek(int handle);
+    size_t read(int handle, uint8_t* buffer, size_t length);
+
+    void publish(const std::string& topic, const std::string& payload, bool retain = false);
+    void setPublishHook(PublishHook hook);
+
+    // PUBACK for QoS 1 publishes: sent latencyMs later on the virtual clock
+    // and dropped with probability lossRate. The publish itself always goes
+    // through, so a lost PUBACK turns into a duplicate when the client resends.
+    void setPubAckOptions(unsigned long latencyMs, double lossRate, uint32_t seed = 1);
+
+    void setOnline(bool online);
+    bool online();
+    Stats stats();
+
+  private:
+    struct Session {
+        std::string clientId;
+        bool connected = false;
+        std::vector<std::string> filters;
+        mqtt::FrameDecoder decoder;
+        std::deque<uint8_t> toClient;
+    };
+
+    std::recursive_mutex _mutex;
+    std::map<int, Session> _sessions;
+    std::map<std::string, std::string> _retained;
+    PublishHook _hook;
+    Stats _stats;
+    int _nextHandle = 1;
+    bool _online = true;
+    unsigned long _pubAckLatencyMs = 0;
+    double _pubAckLossRate = 0.0;
+    std::mt19937 _random;
+
+    void handlePacket(int handle, const mqtt::Packet& packet);
+    void send(Session& session, const std::vector<uint8_t>& bytes);
+    void route(const std::string& topic, const std::string& payload);
+    void sendPubAck(int handle, uint16_t packetId);
+};
+
+#endif
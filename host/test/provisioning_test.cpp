@@ -0,0 +1,167 @@
+// ProvisioningStore against the host LittleFS, on whichever TLS client this
+// build selects (FLOR_TLS_SESSION_TICKETS).
+//
+//  - DER credentials go through save() and load(): the store hands back the
+//    format the client takes (DER on esp-tls, PEM on WiFiClientSecure),
+//    MQTTManager::setCertificates() accepts them and AppLogic gets a shadow
+//    update accepted with them.
+//  - .der files put in the partition by hand load the same way.
+//  - A partition that does not mount is not formatted, and a unit without
+//    identity comes up unprovisioned instead of borrowing the fallback's.
+//
+// Exits non-zero on the first failed check.
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AppLogic.h"
+#include "EspTlsClient.h"
+#include "HostSim.h"
+#include "MQTTManager.h"
+#include "ProvisioningStore.h"
+#include "ShadowService.h"
+#include "SimBroker.h"
+#include "aws_iot_config.h"
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                                  \
+    do {                                                                                  \
+        if (!(condition)) {                                                               \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                                   \
+        }                                                                                 \
+    } while (0)
+
+#if FLOR_TLS_SESSION_RESUMPTION
+const bool kClientTakesDer = true;
+#else
+const bool kClientTakesDer = false;
+#endif
+
+std::vector<uint8_t> toDer(const TlsCredential& pem) {
+    std::vector<uint8_t> der(ProvisioningStore::MAX_CREDENTIAL_SIZE);
+    der.resize(ProvisioningStore::pemToDer(pem, der.data(), der.size()));
+    return der;
+}
+
+TlsCredential credential(const std::vector<uint8_t>& der) {
+    return {reinterpret_cast<const char*>(der.data()), der.size()};
+}
+
+// Same certificate whatever the encoding it came back in.
+bool sameCredential(const TlsCredential& loaded, const std::vector<uint8_t>& der) {
+    if (!loaded.isPem()) return loaded.length == der.size() && std::memcmp(loaded.data, der.data(), der.size()) == 0;
+    return toDer(loaded) == der;
+}
+
+void checkLoaded(const ProvisioningStore& store, const DeviceConfig& loaded, const std::vector<uint8_t> ders[3]) {
+    CHECK(store.ready());
+    CHECK(store.credentialsProvisioned());
+    const TlsCredential* credentials[] = {&loaded.credentials.rootCa, &loaded.credentials.certificate,
+                                          &loaded.credentials.privateKey};
+    for (int i = 0; i < 3; i++) {
+        CHECK(credentials[i]->isPem() != kClientTakesDer);
+        CHECK(sameCredential(*credentials[i], ders[i]));
+    }
+    MQTTManager mqtt(loaded.endpoint, loaded.port, loaded.thingName);
+    CHECK(mqtt.setCertificates(loaded.credentials));
+}
+
+void writeRaw(const std::string& path, const std::vector<uint8_t>& data) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+}
+
+}
+
+int main() {
+    const std::filesystem::path root = std::filesystem::temp_directory_path() / "flor_provisioning_test";
+    std::filesystem::remove_all(root);
+    hostsim::Board& board = hostsim::board();
+    board.serialSink = hostsim::SerialSink::Discard;
+    board.fsRoot = (root / "device").string();
+
+    const std::vector<uint8_t> ders[3] = {toDer(DEFAULT_DEVICE_CONFIG.credentials.rootCa),
+                                          toDer(DEFAULT_DEVICE_CONFIG.credentials.certificate),
+                                          toDer(DEFAULT_DEVICE_CONFIG.credentials.privateKey)};
+    for (const std::vector<uint8_t>& der : ders) CHECK(!der.empty());
+
+    // DER in, through save() and load().
+    DeviceConfig provisioned = DEFAULT_DEVICE_CONFIG;
+    provisioned.thingName = "flor-test-01";
+    provisioned.credentials = {credential(ders[0]), credential(ders[1]), credential(ders[2])};
+    std::unique_ptr<ProvisioningStore> writer(new ProvisioningStore());
+    CHECK(writer->save(provisioned));
+
+    std::unique_ptr<ProvisioningStore> store(new ProvisioningStore());
+    const DeviceConfig& loaded = store->load(DEFAULT_DEVICE_CONFIG);
+    CHECK(store->deviceProvisioned());
+    CHECK(std::strcmp(loaded.thingName, "flor-test-01") == 0);
+    checkLoaded(*store, loaded, ders);
+
+    // The loaded identity connects and reports.
+    SimBroker& broker = SimBroker::shared();
+    ShadowService service(broker);
+    broker.setPublishHook([&service](const std::string& clientId, const std::string& topic,
+                                     const std::string& payload) { service.handlePublish(clientId, topic, payload); });
+    service.update(loaded.thingName, "", "{\"state\":{\"reported\":{\"emotion\":\"NEUTRAL\",\"servoAngle\":90}}}");
+    const uint64_t seeded = service.stats().updatesAccepted;
+    for (uint8_t i = 0; i < loaded.plantCount; i++) {
+        hostsim::setAnalogValue(loaded.plants[i].soilMoisturePin, (SOIL_DRY_VALUE + SOIL_WET_VALUE) / 2);
+    }
+    {
+        AppLogic app(loaded);
+        const unsigned long bootMillis = millis();
+        app.setup(AppLogic::RUN_SINGLE_LOOP);
+        while (millis() - bootMillis < 20000 && service.stats().updatesAccepted == seeded) app.loop();
+        CHECK(service.stats().updatesAccepted > seeded);
+    }
+    broker.setPublishHook(nullptr);
+
+    // .der files dropped into the partition by hand, without device.json.
+    board.fsRoot = (root / "uploaded").string();
+    const std::filesystem::path dir = root / "uploaded" / "provision";
+    std::filesystem::create_directories(dir);
+    writeRaw((dir / "root_ca.der").string(), ders[0]);
+    writeRaw((dir / "certificate.der").string(), ders[1]);
+    writeRaw((dir / "private_key.der").string(), ders[2]);
+    std::unique_ptr<ProvisioningStore> uploaded(new ProvisioningStore());
+    checkLoaded(*uploaded, uploaded->load(DEFAULT_DEVICE_CONFIG), ders);
+
+    // No identity to fall back on: a partition that does not mount stays
+    // unformatted and the unit is unprovisioned.
+    DeviceConfig anonymous = DEFAULT_DEVICE_CONFIG;
+    anonymous.thingName = "";
+    anonymous.wifiSsid = "";
+    anonymous.wifiPass = "";
+    anonymous.credentials = {};
+    board.fsRoot = (root / "unformatted").string();
+    std::unique_ptr<ProvisioningStore> unformatted(new ProvisioningStore());
+    unformatted->load(anonymous);
+    CHECK(!unformatted->ready());
+    CHECK(unformatted->missing() != nullptr && std::strcmp(unformatted->missing(), "storage") == 0);
+    CHECK(!std::filesystem::exists(board.fsRoot));
+
+    board.fsRoot = (root / "empty").string();
+    std::filesystem::create_directories(board.fsRoot);
+    std::unique_ptr<ProvisioningStore> empty(new ProvisioningStore());
+    empty->load(anonymous);
+    CHECK(!empty->ready());
+    CHECK(empty->missing() != nullptr && std::strcmp(empty->missing(), "thingName") == 0);
+
+    std::filesystem::remove_all(root);
+    if (failures > 0) {
+        std::fprintf(stderr, "provisioning_test: %d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("provisioning_test: %s credentials, all checks passed\n", kClientTakesDer ? "DER" : "PEM");
+    return 0;
+}
@@ -0,0 +1,109 @@
+// Writes a device's provisioning files (ProvisioningStore) into a host
+// directory laid out like its LittleFS partition.
+//
+// Starts from DEFAULT_DEVICE_CONFIG and overrides what is given on the
+// command line; --root-ca, --cert and --key take PEM or DER files instead of
+// the built-in PEM credentials. They are stored in the format this build's
+// TLS client takes: DER with esp-tls session tickets, PEM otherwise. The
+// result is read back through ProvisioningStore::load() and summarised.
+// On a board the same directory can be uploaded as the LittleFS image.
+//
+//   provision [--dir DIR] [--thing NAME] [--endpoint HOST] [--port P]
+//             [--ssid SSID] [--pass PASS] [--sad DEG] [--happy DEG]
+//             [--neutral DEG] [--root-ca FILE] [--cert FILE] [--key FILE]
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+
+#include "BenchStats.h"
+#include "HostSim.h"
+#include "ProvisioningStore.h"
+#include "aws_iot_config.h"
+
+namespace {
+
+const char* argString(int argc, char** argv, const char* name, const char* fallback) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::strcmp(argv[i], name) == 0) return argv[i + 1];
+    }
+    return fallback;
+}
+
+// PEM keeps its terminator inside the length, as mbedtls expects.
+bool readCredential(const char* path, std::string& storage, TlsCredential& credential) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    storage.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    const bool pem = storage.find("-----BEGIN ") != std::string::npos;
+    credential = {storage.c_str(), storage.size() + (pem ? 1 : 0)};
+    return !storage.empty();
+}
+
+void printCredential(const char* name, const TlsCredential& source, const TlsCredential& stored) {
+    std::printf("  %-12s %5zu bytes %s -> %5zu bytes %s\n", name, source.length, source.isPem() ? "PEM" : "DER",
+                stored.length, stored.isPem() ? "PEM" : "DER");
+}
+
+}
+
+int main(int argc, char** argv) {
+    hostsim::board().fsRoot = argString(argc, argv, "--dir", "littlefs");
+
+    DeviceConfig config = DEFAULT_DEVICE_CONFIG;
+    config.thingName = argString(argc, argv, "--thing", config.thingName);
+    config.endpoint = argString(argc, argv, "--endpoint", config.endpoint);
+    config.port = static_cast<uint16_t>(argValue(argc, argv, "--port", config.port));
+    config.wifiSsid = argString(argc, argv, "--ssid", config.wifiSsid);
+    config.wifiPass = argString(argc, argv, "--pass", config.wifiPass);
+    config.servoAngles.sad = static_cast<int>(argValue(argc, argv, "--sad", config.servoAngles.sad));
+    config.servoAngles.happy = static_cast<int>(argValue(argc, argv, "--happy", config.servoAngles.happy));
+    config.servoAngles.neutral = static_cast<int>(argValue(argc, argv, "--neutral", config.servoAngles.neutral));
+
+    const struct {
+        const char* option;
+        TlsCredential* credential;
+    } files[] = {
+        {"--root-ca", &config.credentials.rootCa},
+        {"--cert", &config.credentials.certificate},
+        {"--key", &config.credentials.privateKey},
+    };
+    std::string storage[3];
+    for (int i = 0; i < 3; i++) {
+        const char* path = argString(argc, argv, files[i].option, nullptr);
+        if (path != nullptr && !readCredential(path, storage[i], *files[i].credential)) {
+            std::fprintf(stderr, "provision: cannot read %s\n", path);
+            return 1;
+        }
+    }
+
+    std::unique_ptr<ProvisioningStore> store(new ProvisioningStore());
+    if (!store->save(config)) {
+        std::fprintf(stderr, "provision: writing to %s failed\n", hostsim::board().fsRoot.c_str());
+        return 1;
+    }
+    std::unique_ptr<ProvisioningStore> check(new ProvisioningStore());
+    const DeviceConfig& loaded = check->load(DEFAULT_DEVICE_CONFIG);
+    if (!check->ready() || !check->deviceProvisioned() || !check->credentialsProvisioned()) {
+        std::fprintf(stderr, "provision: %s does not read back\n", hostsim::board().fsRoot.c_str());
+        return 1;
+    }
+
+    std::printf("provisioned %s in %s/provision\n", loaded.thingName, hostsim::board().fsRoot.c_str());
+    std::printf("  endpoint     %s:%u\n", loaded.endpoint, static_cast<unsigned int>(loaded.port));
+    std::printf("  servo        sad %d  happy %d  neutral %d\n", loaded.servoAngles.sad, loaded.servoAngles.happy,
+                loaded.servoAngles.neutral);
+    for (uint8_t i = 0; i < loaded.plantCount; i++) {
+        const PlantConfig& plant = loaded.plants[i];
+        std::printf("  plant %u      shadow '%s'  soil pin %d  servo pin %d  dry %d  wet %d\n",
+                    static_cast<unsigned int>(i), plant.shadowName, plant.soilMoisturePin, plant.servoPin,
+                    plant.soilDryValue, plant.soilWetValue);
+    }
+    printCredential("root CA", config.credentials.rootCa, loaded.credentials.rootCa);
+    printCredential("certificate", config.credentials.certificate, loaded.credentials.certificate);
+    printCredential("private key", config.credentials.privateKey, loaded.credentials.privateKey);
+    return 0;
+}
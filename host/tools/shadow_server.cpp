@@ -0,0 +1,177 @@
+// Standalone MQTT broker with the Device Shadow service stand-in.
+//
+// Serves SimBroker and ShadowService over plain TCP (MQTT 3.1.1, no TLS) so
+// the simulated cloud can be driven from outside the benchmarks: mosquitto
+// clients, scripts, or a board on the LAN built against a local endpoint.
+// Shadow requests on $aws/things/<thing>/shadow/... (classic and named) are
+// answered like AWS IoT does; everything else is plain pub/sub.
+//
+//   shadow_server [--port P] [--latency-ms MS] [--jitter-ms MS] [--loss-pct P]
+//                 [--seed N] [--verbose]
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "Arduino.h"
+#include "BenchStats.h"
+#include "HostSim.h"
+#include "ShadowService.h"
+#include "SimBroker.h"
+
+namespace {
+
+volatile std::sig_atomic_t g_stop = 0;
+
+void onSignal(int) { g_stop = 1; }
+
+int listenOn(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int yes = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, 16) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool sendAll(int fd, const uint8_t* data, size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        data += sent;
+        length -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char** argv) {
+    const int port = static_cast<int>(argValue(argc, argv, "--port", 1883));
+    const bool verbose = argFlag(argc, argv, "--verbose");
+    hostsim::useRealtimeClock(true);
+
+    SimBroker& broker = SimBroker::shared();
+    ShadowService service(broker);
+    ShadowService::Options options;
+    options.latencyMs = static_cast<unsigned long>(argValue(argc, argv, "--latency-ms", 0));
+    options.jitterMs = static_cast<unsigned long>(argValue(argc, argv, "--jitter-ms", 0));
+    options.lossRate = argValue(argc, argv, "--loss-pct", 0) / 100.0;
+    options.seed = static_cast<uint32_t>(argValue(argc, argv, "--seed", 1));
+    service.setOptions(options);
+
+    // Deferred requests and responses run from the poll loop below.
+    std::multimap<unsigned long, std::function<void()>> timers;
+    service.setDefer([&timers](unsigned long delayMs, std::function<void()> fn) {
+        timers.emplace(millis() + delayMs, std::move(fn));
+    });
+    broker.setPublishHook([&service, verbose](const std::string& clientId, const std::string& topic,
+                                              const std::string& payload) {
+        if (verbose) std::printf("%lu %s -> %s %s\n", millis(), clientId.c_str(), topic.c_str(), payload.c_str());
+        service.handlePublish(clientId, topic, payload);
+    });
+
+    const int listener = listenOn(port);
+    if (listener < 0) {
+        std::fprintf(stderr, "shadow_server: cannot listen on port %d: %s\n", port, std::strerror(errno));
+        return 1;
+    }
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    std::printf("shadow_server: listening on port %d, latency %lu+%lu ms, loss %.0f%%\n", port,
+                options.latencyMs, options.jitterMs, options.lossRate * 100.0);
+    std::fflush(stdout);
+
+    std::map<int, int> handles;  // socket -> broker session
+    std::vector<uint8_t> buffer(4096);
+    while (!g_stop) {
+        std::vector<pollfd> fds;
+        fds.push_back({listener, POLLIN, 0});
+        for (const auto& client : handles) fds.push_back({client.first, POLLIN, 0});
+
+        int timeoutMs = 100;
+        if (!timers.empty()) {
+            const unsigned long now = millis();
+            const unsigned long due = timers.begin()->first;
+            timeoutMs = due <= now ? 0 : static_cast<int>(std::min<unsigned long>(due - now, 100));
+        }
+        if (poll(fds.data(), fds.size(), timeoutMs) < 0 && errno != EINTR) break;
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd >= 0) {
+                const int handle = broker.open();
+                if (handle < 0) {
+                    close(fd);
+                } else {
+                    handles[fd] = handle;
+                }
+            }
+        }
+        for (size_t i = 1; i < fds.size(); i++) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            const int fd = fds[i].fd;
+            ssize_t received = recv(fd, buffer.data(), buffer.size(), 0);
+            if (received > 0) {
+                broker.receive(handles[fd], buffer.data(), static_cast<size_t>(received));
+            } else if (received == 0 || errno != EINTR) {
+                broker.close(handles[fd]);
+            }
+        }
+
+        while (!timers.empty() && timers.begin()->first <= millis()) {
+            std::function<void()> fn = std::move(timers.begin()->second);
+            timers.erase(timers.begin());
+            fn();
+        }
+
+        for (auto it = handles.begin(); it != handles.end();) {
+            const int fd = it->first;
+            const int handle = it->second;
+            size_t pending = broker.available(handle);
+            bool ok = true;
+            while (ok && pending > 0) {
+                const size_t n = broker.read(handle, buffer.data(), std::min(pending, buffer.size()));
+                ok = sendAll(fd, buffer.data(), n);
+                pending = broker.available(handle);
+            }
+            if (!ok || !broker.isOpen(handle)) {
+                broker.close(handle);
+                close(fd);
+                it = handles.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (const auto& client : handles) close(client.first);
+    close(listener);
+    const ShadowService::Stats stats = service.stats();
+    std::printf("shadow_server: %llu shadow requests, updates accepted/rejected %llu/%llu, 409 conflicts %llu\n",
+                static_cast<unsigned long long>(stats.requests),
+                static_cast<unsigned long long>(stats.updatesAccepted),
+                static_cast<unsigned long long>(stats.updatesRejected),
+                static_cast<unsigned long long>(stats.conflicts));
+    return 0;
+}